@@ -15,47 +15,64 @@
 #include "cd.h"
 #include "time.h"
 
-#ifdef YY_BUF_SIZE
-#undef YY_BUF_SIZE
-#endif
-#define YY_BUF_SIZE 16384
-
 #define YYDEBUG 1
 
-char fnamebuf[PARSER_BUFFER];
-
 /* debugging */
 //int yydebug = 1;
+%}
 
-extern int yylineno;
-extern FILE* yyin;
-
-const char *yyfilename;
+%code requires {
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
 
-static Cd *cd = NULL;
-static Track *track = NULL;
-static Track *prev_track = NULL;
-static Cdtext *cdtext = NULL;
-static Rem *rem = NULL;
-static char *prev_filename = NULL;	/* last file in or before last track */
-static char *cur_filename = NULL;	/* last file in the last track */
-static char *new_filename = NULL;	/* last file in this track */
+/* string owned by a parse */
+struct CueString {
+	struct CueString *next;
+	char data[];
+};
+
+/* state of one parse, so that several sheets may be parsed at once */
+typedef struct CueParser {
+	const char *filename;
+
+	Cd *cd;
+	Track *track;
+	Track *prev_track;
+	Cdtext *cdtext;
+	Rem *rem;
+	char *prev_filename;	/* last file in or before last track */
+	char *cur_filename;	/* last file in the last track */
+	char *new_filename;	/* last file in this track */
+
+	struct CueString *strings;	/* strings returned by the lexer */
+	int nomem;			/* string allocation failed */
+} CueParser;
+
+char *cue_parser_strndup(CueParser *parser, const char *s, size_t len);
+}
 
+%code {
 /* lexer interface */
-typedef struct yy_buffer_state* YY_BUFFER_STATE;
+int yylex(YYSTYPE*, yyscan_t);
+int yylex_init_extra(CueParser*, yyscan_t*);
+int yylex_destroy(yyscan_t);
+void yyset_in(FILE*, yyscan_t);
+void yyset_lineno(int, yyscan_t);
+int yyget_lineno(yyscan_t);
+struct yy_buffer_state *yy_scan_string(const char*, yyscan_t);
 
-int yylex(void);
-void yyerror(const char*);
-YY_BUFFER_STATE yy_scan_string(const char*);
-YY_BUFFER_STATE yy_create_buffer(FILE*, int);
-void yy_switch_to_buffer(YY_BUFFER_STATE);
-void yy_delete_buffer(YY_BUFFER_STATE);
+void yyerror(yyscan_t, CueParser*, const char*);
 
 /* parser interface */
-int yyparse(void);
 Cd *cue_parse_file(FILE *fp, const char *filename);
 Cd *cue_parse_string(const char*);
-%}
+}
+
+%define api.pure full
+%lex-param {yyscan_t scanner}
+%parse-param {yyscan_t scanner} {CueParser *parser}
 
 %start cuefile
 
@@ -147,9 +164,9 @@ maybe_bom
 
 new_cd
 	: /* empty */ {
-		cd = cd_init();
-		cdtext = cd_get_cdtext(cd);
-		rem = cd_get_rem(cd);
+		parser->cd = cd_init();
+		parser->cdtext = cd_get_cdtext(parser->cd);
+		parser->rem = cd_get_rem(parser->cd);
 	}
 	;
 
@@ -159,8 +176,8 @@ global_statements
 	;
 
 global_statement
-	: CATALOG STRING '\n' { cd_set_catalog(cd, $2); }
-	| CDTEXTFILE STRING '\n' { cd_set_cdtextfile(cd, $2); }
+	: CATALOG STRING '\n' { cd_set_catalog(parser->cd, $2); }
+	| CDTEXTFILE STRING '\n' { cd_set_cdtextfile(parser->cd, $2); }
 	| cdtext
 	| rem
 	| track_data
@@ -169,11 +186,10 @@ global_statement
 
 track_data
 	: FFILE STRING file_format '\n' {
-		if (NULL != new_filename) {
-			yyerror("too many files specified\n");
+		if (NULL != parser->new_filename) {
+			yyerror(scanner, parser, "too many files specified\n");
 		}
-		new_filename = strncpy(fnamebuf, $2, sizeof(fnamebuf));
-		new_filename[strlen(new_filename)] = '\0';
+		parser->new_filename = $2;
 	}
 	;
 
@@ -200,28 +216,28 @@ file_format
 new_track
 	: /*empty */ {
 		/* save previous track, to later set length */
-		prev_track = track;
+		parser->prev_track = parser->track;
 
-		track = cd_add_track(cd);
-		cdtext = track_get_cdtext(track);
-		rem = track_get_rem(track);
+		parser->track = cd_add_track(parser->cd);
+		parser->cdtext = track_get_cdtext(parser->track);
+		parser->rem = track_get_rem(parser->track);
 
-		cur_filename = new_filename;
-		if (NULL != cur_filename)
-			prev_filename = cur_filename;
+		parser->cur_filename = parser->new_filename;
+		if (NULL != parser->cur_filename)
+			parser->prev_filename = parser->cur_filename;
 
-		if (NULL == prev_filename)
-			yyerror("no file specified for track");
+		if (NULL == parser->prev_filename)
+			yyerror(scanner, parser, "no file specified for track");
 		else
-			track_set_filename(track, prev_filename);
+			track_set_filename(parser->track, parser->prev_filename);
 
-		new_filename = NULL;
+		parser->new_filename = NULL;
 	}
 	;
 
 track_def
 	: TRACK NUMBER track_mode '\n' {
-		track_set_mode(track, $3);
+		track_set_mode(parser->track, $3);
 	}
 	;
 
@@ -245,50 +261,50 @@ track_statement
 	: cdtext
 	| rem
 	| FLAGS track_flags '\n'
-	| TRACK_ISRC STRING '\n' { track_set_isrc(track, $2); }
-	| PREGAP time '\n' { track_set_zero_pre(track, $2); }
+	| TRACK_ISRC STRING '\n' { track_set_isrc(parser->track, $2); }
+	| PREGAP time '\n' { track_set_zero_pre(parser->track, $2); }
 	| INDEX NUMBER time '\n' {
-		int i = track_get_nindex(track);
+		int i = track_get_nindex(parser->track);
 		long prev_length;
 
 		/* Handle non-compliant cuesheets, i.e. multi-file sheets where index 0
 		 * is at the end of the previous track file
 		 * In such cases we have a FILE occurence between index 0 and index 1.
 		 * Just discard that index 0 */
-		if (NULL != new_filename && 1 == i) {
+		if (NULL != parser->new_filename && 1 == i) {
 			/* Set correct file name */
-			track_set_filename(track, new_filename);
-			new_filename = NULL;
+			track_set_filename(parser->track, parser->new_filename);
+			parser->new_filename = NULL;
 
 			/* Discard indices */
-			track_remove_indices(track);
+			track_remove_indices(parser->track);
 			i = 0;
 		}
 
 		if (0 == i) {
 			/* first index */
-			track_set_start(track, $3);
+			track_set_start(parser->track, $3);
 
-			if (NULL != prev_track && NULL == cur_filename) {
+			if (NULL != parser->prev_track && NULL == parser->cur_filename) {
 				/* track shares file with previous track */
-				prev_length = $3 - track_get_start(prev_track);
-				track_set_length(prev_track, prev_length);
+				prev_length = $3 - track_get_start(parser->prev_track);
+				track_set_length(parser->prev_track, prev_length);
 			}
 		}
 
 		for (; i <= $2; i++)
-			track_add_index(track, \
-			track_get_zero_pre(track) + $3 \
-			- track_get_start(track));
+			track_add_index(parser->track, \
+			track_get_zero_pre(parser->track) + $3 \
+			- track_get_start(parser->track));
 	}
-	| POSTGAP time '\n' { track_set_zero_post(track, $2); }
+	| POSTGAP time '\n' { track_set_zero_post(parser->track, $2); }
 	| track_data
 	| error '\n'
 	;
 
 track_flags
 	: /* empty */
-	| track_flags track_flag { track_set_flag(track, $2); }
+	| track_flags track_flag { track_set_flag(parser->track, $2); }
 	;
 
 track_flag
@@ -299,7 +315,7 @@ track_flag
 	;
 
 cdtext
-	: cdtext_item STRING '\n' { cdtext_set ($1, $2, cdtext); }
+	: cdtext_item STRING '\n' { cdtext_set ($1, $2, parser->cdtext); }
 	;
 
 cdtext_item
@@ -324,7 +340,7 @@ time
 	;
 
 rem
-	: rem_item STRING '\n' { rem_set($1, $2, rem); }
+	: rem_item STRING '\n' { rem_set($1, $2, parser->rem); }
 	;
 
 rem_item
@@ -340,47 +356,74 @@ rem_item
 
 /* lexer interface */
 
-void yyerror (const char *s)
+void yyerror (yyscan_t scanner, CueParser *parser, const char *s)
 {
-	fprintf(stderr, "%d: %s (in %s)\n", yylineno, s, yyfilename);
+	fprintf(stderr, "%d: %s (in %s)\n", yyget_lineno(scanner), s,
+			parser->filename);
 }
 
-Cd *cue_parse_file(FILE *fp, const char *filename)
+char *cue_parser_strndup(CueParser *parser, const char *s, size_t len)
 {
-	YY_BUFFER_STATE buffer = NULL;
+	struct CueString *str = malloc(sizeof(*str) + len + 1);
 
-	yyin = fp;
-	yyfilename = filename;
-	yylineno = 1;
+	if (NULL == str) {
+		parser->nomem = 1;
+		return NULL;
+	}
 
-	buffer = yy_create_buffer(yyin, YY_BUF_SIZE);
+	memcpy(str->data, s, len);
+	str->data[len] = '\0';
+	str->next = parser->strings;
+	parser->strings = str;
+	return str->data;
+}
+
+static Cd *cue_parse(yyscan_t scanner, CueParser *parser)
+{
+	struct CueString *str;
+	int res;
 
-	yy_switch_to_buffer(buffer);
+	yyset_lineno(1, scanner);
+	res = yyparse(scanner, parser);
+	yylex_destroy(scanner);
 
-	if (0 == yyparse())
-	{
-		yy_delete_buffer(buffer);
-		return cd;
+	while (NULL != parser->strings) {
+		str = parser->strings;
+		parser->strings = str->next;
+		free(str);
 	}
 
-	yy_delete_buffer(buffer);
-	return NULL;
+	if (0 != res || parser->nomem) {
+		if (NULL != parser->cd)
+			cd_delete(parser->cd);
+		return NULL;
+	}
+	return parser->cd;
 }
 
-Cd *cue_parse_string(const char* string)
+Cd *cue_parse_file(FILE *fp, const char *filename)
 {
-	YY_BUFFER_STATE buffer = NULL;
+	CueParser parser;
+	yyscan_t scanner;
 
-	buffer = yy_scan_string(string);
-	yylineno = 1;
+	memset(&parser, 0, sizeof(parser));
+	parser.filename = filename;
+	if (0 != yylex_init_extra(&parser, &scanner))
+		return NULL;
 
-	if (0 == yyparse())
-	{
-		yy_delete_buffer(buffer);
-		return cd;
-	}
+	yyset_in(fp, scanner);
+	return cue_parse(scanner, &parser);
+}
+
+Cd *cue_parse_string(const char* string)
+{
+	CueParser parser;
+	yyscan_t scanner;
 
-	yy_delete_buffer(buffer);
+	memset(&parser, 0, sizeof(parser));
+	if (0 != yylex_init_extra(&parser, &scanner))
+		return NULL;
 
-	return NULL;
+	yy_scan_string(string, scanner);
+	return cue_parse(scanner, &parser);
 }
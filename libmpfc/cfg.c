@@ -30,6 +30,18 @@
 #include "cfg.h"
 #include "util.h"
 
+/* Tree generation. It is changed every time a node is inserted or freed
+ * and is used for variable handles validation. Handles are read from 
+ * several threads, so it is accessed atomically */
+static dword cfg_generation = 1;
+
+/* Search list for a child node using a name part and its hash */
+static cfg_node_t *cfg_search_list_hashed( cfg_node_t *list, 
+		const char *name, int len, dword hash );
+
+/* Change list hash table size */
+static void cfg_list_rehash( cfg_node_t *list, int new_size );
+
 /* Create a new configuration list */
 cfg_node_t *cfg_new_list( cfg_node_t *parent, const char *name, 
 		cfg_set_default_values_t set_def, dword flags, int hash_size )
@@ -54,6 +66,7 @@ cfg_node_t *cfg_new_list( cfg_node_t *parent, const char *name,
 			hash_size = CFG_HASH_DEFAULT_SIZE;
 	}
 	CFG_LIST(node)->m_hash_size = hash_size;
+	CFG_LIST(node)->m_num_children = 0;
 	CFG_LIST(node)->m_children = (struct cfg_list_hash_item_t **)
 		malloc(hash_size * sizeof(struct cfg_list_hash_item_t *));
 	memset(CFG_LIST(node)->m_children, 0, 
@@ -84,6 +97,7 @@ cfg_node_t *cfg_new_var_full( cfg_node_t *parent, const char *name,
 
 	/* Set variable data */
 	CFG_VAR(node)->m_value = value;
+	cfg_var_parse_value(node);
 	CFG_VAR(node)->m_handler = handler;
 	CFG_VAR(node)->m_handler_data = handler_data;
 
@@ -128,6 +142,7 @@ cfg_node_t *cfg_new_node( cfg_node_t *parent, const char *name, dword flags )
 
 	/* Set fields */
 	node->m_name = strdup(real_name);
+	node->m_hash = cfg_hash_name(real_name, -1);
 	node->m_flags = flags;
 	node->m_parent = real_parent;
 	return node;
@@ -137,6 +152,7 @@ cfg_node_t *cfg_new_node( cfg_node_t *parent, const char *name, dword flags )
 void cfg_free_node( cfg_node_t *node, bool_t recursively )
 {
 	assert(node);
+	__atomic_add_fetch(&cfg_generation, 1, __ATOMIC_RELEASE);
 
 	/* Free common data */
 	free(node->m_name);
@@ -199,13 +215,16 @@ void cfg_insert_node( cfg_node_t *list, cfg_node_t *node )
 	assert(node->m_name);
 	assert(CFG_NODE_IS_LIST(list));
 	
+	__atomic_add_fetch(&cfg_generation, 1, __ATOMIC_RELEASE);
+	
 	/* Search for this node in the list */
-	hash = cfg_calc_hash(node->m_name, CFG_LIST(list)->m_hash_size);
+	hash = node->m_hash % CFG_LIST(list)->m_hash_size;
 	for ( item = CFG_LIST(list)->m_children[hash]; item != NULL; 
 			item = item->m_next )
 	{
 		/* Copy existing node to the new node and free it */
-		if (!strcmp(node->m_name, item->m_node->m_name))
+		if (node->m_hash == item->m_node->m_hash && 
+				!strcmp(node->m_name, item->m_node->m_name))
 		{
 			cfg_copy_node(node, item->m_node);
 			item->m_node = node;
@@ -221,6 +240,12 @@ void cfg_insert_node( cfg_node_t *list, cfg_node_t *node )
 	item->m_node = node;
 	item->m_next = CFG_LIST(list)->m_children[hash];
 	CFG_LIST(list)->m_children[hash] = item;
+
+	/* Enlarge hash table if it has become too crowded */
+	CFG_LIST(list)->m_num_children ++;
+	if (CFG_LIST(list)->m_num_children > 
+			CFG_LIST(list)->m_hash_size * CFG_HASH_MAX_LOAD)
+		cfg_list_rehash(list, CFG_LIST(list)->m_hash_size * 2 + 1);
 } /* End of 'cfg_insert_node' function */
 
 /* Search for the node */
@@ -306,6 +331,7 @@ void cfg_set_var_full( cfg_node_t *parent, const char *name, const char *value,
 			CFG_VAR(node)->m_value = NULL;
 		else
 			CFG_VAR(node)->m_value = new_value;
+		cfg_var_parse_value(node);
 		cfg_call_var_handler(TRUE, node, new_value);
 	}
 	/* Create node if not found */
@@ -369,8 +395,8 @@ void cfg_set_var_float( cfg_node_t *parent, const char *name, float val )
 	cfg_set_var(parent, name, str);
 } /* End of 'cfg_set_var_float' function */
 
-/* Get variable value */
-char *cfg_get_var( cfg_node_t *parent, const char *name )
+/* Get variable node (NULL if not found or if node is not a variable) */
+cfg_node_t *cfg_get_var_node( cfg_node_t *parent, const char *name )
 {
 	cfg_node_t *node;
 
@@ -378,40 +404,63 @@ char *cfg_get_var( cfg_node_t *parent, const char *name )
 	node = cfg_search_node(parent, name);
 	if (node == NULL || !CFG_NODE_IS_VAR(node))
 		return NULL;
-	return CFG_VAR(node)->m_value;
+	return node;
+} /* End of 'cfg_get_var_node' function */
+
+/* Get variable value */
+char *cfg_get_var( cfg_node_t *parent, const char *name )
+{
+	cfg_node_t *node = cfg_get_var_node(parent, name);
+	return (node == NULL) ? NULL : CFG_VAR_VALUE(node);
 } /* End of 'cfg_get_var' function */
 
 /* Get variable integer value */
 int cfg_get_var_int( cfg_node_t *parent, const char *name )
 {
-	char *str = cfg_get_var(parent, name);
-	return (str == NULL) ? 0 : atoi(str);
+	cfg_node_t *node = cfg_get_var_node(parent, name);
+	return (node == NULL) ? 0 : CFG_VAR_INT(node);
 } /* End of 'cfg_get_var_int' function */
 
 /* Get variable pointer value */
 void *cfg_get_var_ptr( cfg_node_t *parent, const char *name )
 {
-	void *value;
-	char *str = cfg_get_var(parent, name);
-	if (str == NULL)
-		return NULL;
-	sscanf(str, "%p", &value);
-	return value;
+	cfg_node_t *node = cfg_get_var_node(parent, name);
+	return (node == NULL) ? NULL : CFG_VAR_PTR(node);
 } /* End of 'cfg_get_var_ptr' function */
 
 /* Get variable float value */
 float cfg_get_var_float( cfg_node_t *parent, const char *name )
 {
-	char *str = cfg_get_var(parent, name);
-	return (str == NULL) ? 0. : atof(str);
+	cfg_node_t *node = cfg_get_var_node(parent, name);
+	return (node == NULL) ? 0. : CFG_VAR_FLOAT(node);
 } /* End of 'cfg_get_var_float' function */
 
+/* Update variable typed values after its string value change */
+void cfg_var_parse_value( cfg_node_t *node )
+{
+	struct cfg_var_data_t *var;
+
+	assert(node);
+	assert(CFG_NODE_IS_VAR(node));
+	var = CFG_VAR(node);
+
+	var->m_int_value = 0;
+	var->m_float_value = 0.;
+	var->m_ptr_value = NULL;
+	if (var->m_value == NULL)
+		return;
+
+	var->m_int_value = atoi(var->m_value);
+	var->m_float_value = atof(var->m_value);
+	if (sscanf(var->m_value, "%p", &var->m_ptr_value) != 1)
+		var->m_ptr_value = NULL;
+} /* End of 'cfg_var_parse_value' function */
+
 /* Find the real parent of node */
 cfg_node_t *cfg_find_real_parent( cfg_node_t *parent, const char *name, 
 		const char **real_name )
 {
 	cfg_node_t *real_parent;
-	char *item_name;
 
 	assert(parent);
 	assert(name);
@@ -422,21 +471,30 @@ cfg_node_t *cfg_find_real_parent( cfg_node_t *parent, const char *name,
 	{
 		const char *next_name = strchr(name, '.');
 		cfg_node_t *was_real = real_parent;
+		int len;
 
 		/* If no '.' found - stop (we've found last parent in hierarchy) */
 		if (next_name == NULL)
 			break;
 
-		/* Extract child list name */
-		item_name = strndup(name, next_name - name);
-		real_parent = cfg_search_list(real_parent, item_name);
+		/* Search for the child list right in the path string */
+		len = next_name - name;
+		real_parent = cfg_search_list_hashed(real_parent, name, len,
+				cfg_hash_name(name, len));
 
 		/* Create temporary list if it does not exist */
 		if (real_parent == NULL)
+		{
+			char *item_name = strndup(name, len);
 			real_parent = cfg_new_list(was_real, item_name, NULL, 0, 0);
+			free(item_name);
+			if (real_parent == NULL)
+				return NULL;
+		}
+		else if (CFG_NODE_IS_VAR(real_parent))
+			return NULL;
 
 		/* Move to next child name */
-		free(item_name);
 		name = next_name + 1;
 	}
 
@@ -448,30 +506,63 @@ cfg_node_t *cfg_find_real_parent( cfg_node_t *parent, const char *name,
 
 /* Search list for a child node (name given is the exact name, without dots) */
 cfg_node_t *cfg_search_list( cfg_node_t *list, const char *name )
+{
+	int len = strlen(name);
+	return cfg_search_list_hashed(list, name, len, cfg_hash_name(name, len));
+} /* End of 'cfg_search_list' function */
+
+/* Search list for a child node using a name part and its hash */
+static cfg_node_t *cfg_search_list_hashed( cfg_node_t *list, 
+		const char *name, int len, dword hash )
 {
 	struct cfg_list_hash_item_t *item;
-	int hash;
-	cfg_node_t *node = NULL;
 
 	/* Check that this is a list */
 	if (!CFG_NODE_IS_LIST(list))
 		return NULL;
 
-	/* Calculate hash */
-	hash = cfg_calc_hash(name, CFG_LIST(list)->m_hash_size);
-
 	/* Search for node */
-	for ( item = CFG_LIST(list)->m_children[hash]; item != NULL; 
-			item = item->m_next )
+	for ( item = CFG_LIST(list)->m_children[hash % CFG_LIST(list)->m_hash_size]; 
+			item != NULL; item = item->m_next )
 	{
-		if (!strcmp(item->m_node->m_name, name))
+		cfg_node_t *node = item->m_node;
+		if (node->m_hash == hash && !strncmp(node->m_name, name, len) &&
+				node->m_name[len] == 0)
+			return node;
+	}
+	return NULL;
+} /* End of 'cfg_search_list_hashed' function */
+
+/* Change list hash table size */
+static void cfg_list_rehash( cfg_node_t *list, int new_size )
+{
+	struct cfg_list_hash_item_t **children;
+	int i;
+
+	/* Allocate new table */
+	children = (struct cfg_list_hash_item_t **)malloc(
+			new_size * sizeof(struct cfg_list_hash_item_t *));
+	if (children == NULL)
+		return;
+	memset(children, 0, new_size * sizeof(struct cfg_list_hash_item_t *));
+
+	/* Move items to the new table (hash values are cached in nodes) */
+	for ( i = 0; i < CFG_LIST(list)->m_hash_size; i ++ )
+	{
+		struct cfg_list_hash_item_t *item, *next;
+		for ( item = CFG_LIST(list)->m_children[i]; item != NULL; 
+				item = next )
 		{
-			node = item->m_node;
-			break;
+			int h = item->m_node->m_hash % new_size;
+			next = item->m_next;
+			item->m_next = children[h];
+			children[h] = item;
 		}
 	}
-	return node;
-} /* End of 'cfg_search_list' function */
+	free(CFG_LIST(list)->m_children);
+	CFG_LIST(list)->m_children = children;
+	CFG_LIST(list)->m_hash_size = new_size;
+} /* End of 'cfg_list_rehash' function */
 
 /* Call variable handler */
 bool_t cfg_call_var_handler( bool_t after, cfg_node_t *node, char *value )
@@ -491,15 +582,23 @@ bool_t cfg_call_var_handler( bool_t after, cfg_node_t *node, char *value )
 /* Calculate string hash value */
 int cfg_calc_hash( const char *str, int table_size )
 {
-	int val = 0;
+	return cfg_hash_name(str, -1) % table_size;
+} /* End of 'cfg_calc_hash' function */
+
+/* Calculate full (not reduced to the table size) hash value of the first 
+ * 'len' characters of a name (or of the whole name if 'len' is negative).
+ * This is 32-bit FNV-1a hash */
+dword cfg_hash_name( const char *name, int len )
+{
+	dword val = 2166136261U;
 
-	while (*str)
+	for ( ; len != 0 && *name; name ++, len -- )
 	{
-		val += *str;
-		str ++;
+		val ^= (byte)(*name);
+		val *= 16777619U;
 	}
-	return val % table_size;
-} /* End of 'cfg_calc_hash' function */
+	return val;
+} /* End of 'cfg_hash_name' function */
 
 /* Set variable's handler */
 void cfg_set_var_handler( cfg_node_t *parent, const char *name, 
@@ -591,6 +690,7 @@ void cfg_copy_node( cfg_node_t *dest, cfg_node_t *src )
 				free(dv->m_value);
 			dv->m_value = new_value;
 		}
+		cfg_var_parse_value(dest);
 		cfg_free_node(src, FALSE);
 		return;
 	}
@@ -607,11 +707,12 @@ void cfg_copy_node( cfg_node_t *dest, cfg_node_t *src )
 			struct cfg_list_hash_item_t *i, *prev = NULL;
 
 			/* Find corresponding destination item */
-			int h = cfg_calc_hash(node->m_name, dl->m_hash_size);
+			int h = node->m_hash % dl->m_hash_size;
 			for ( i = dl->m_children[h]; i != NULL; prev = i, i = i->m_next )
 			{
 				/* Copy this node recursively */
-				if (!strcmp(node->m_name, i->m_node->m_name))
+				if (node->m_hash == i->m_node->m_hash &&
+						!strcmp(node->m_name, i->m_node->m_name))
 				{
 					cfg_copy_node(i->m_node, node);
 					break;
@@ -636,11 +737,71 @@ void cfg_copy_node( cfg_node_t *dest, cfg_node_t *src )
 					dl->m_children[h] = new_item;
 				else
 					prev->m_next = new_item;
+				dl->m_num_children ++;
 			}
 		}
 	}
 	cfg_free_node(src, FALSE);
+
+	/* Enlarge destination hash table if needed */
+	if (dl->m_num_children > dl->m_hash_size * CFG_HASH_MAX_LOAD)
+		cfg_list_rehash(dest, dl->m_hash_size * 2 + 1);
 } /* End of 'cfg_copy_node' function */
 
+/* Get node a handle points to (binding it to the list if it is not yet) */
+cfg_node_t *cfg_handle_node( cfg_node_t *list, cfg_var_handle_t *h )
+{
+	assert(h);
+	assert(h->m_name);
+
+	/* Search for the node again only if tree has changed. Generation is
+	 * read before searching, so a change made meanwhile is noticed next
+	 * time */
+	dword gen = __atomic_load_n(&cfg_generation, __ATOMIC_ACQUIRE);
+	if (h->m_list != list || h->m_generation != gen)
+	{
+		h->m_list = list;
+		h->m_node = (list == NULL) ? NULL : cfg_search_node(list, h->m_name);
+		h->m_generation = gen;
+	}
+	return h->m_node;
+} /* End of 'cfg_handle_node' function */
+
+/* Get variable value through a handle */
+char *cfg_handle_get_var( cfg_node_t *list, cfg_var_handle_t *h )
+{
+	cfg_node_t *node = cfg_handle_node(list, h);
+	if (node == NULL || !CFG_NODE_IS_VAR(node))
+		return NULL;
+	return CFG_VAR(node)->m_value;
+} /* End of 'cfg_handle_get_var' function */
+
+/* Get variable integer value through a handle */
+int cfg_handle_get_var_int( cfg_node_t *list, cfg_var_handle_t *h )
+{
+	cfg_node_t *node = cfg_handle_node(list, h);
+	if (node == NULL || !CFG_NODE_IS_VAR(node))
+		return 0;
+	return CFG_VAR_INT(node);
+} /* End of 'cfg_handle_get_var_int' function */
+
+/* Get variable float value through a handle */
+float cfg_handle_get_var_float( cfg_node_t *list, cfg_var_handle_t *h )
+{
+	cfg_node_t *node = cfg_handle_node(list, h);
+	if (node == NULL || !CFG_NODE_IS_VAR(node))
+		return 0.;
+	return CFG_VAR_FLOAT(node);
+} /* End of 'cfg_handle_get_var_float' function */
+
+/* Get variable pointer value through a handle */
+void *cfg_handle_get_var_ptr( cfg_node_t *list, cfg_var_handle_t *h )
+{
+	cfg_node_t *node = cfg_handle_node(list, h);
+	if (node == NULL || !CFG_NODE_IS_VAR(node))
+		return NULL;
+	return CFG_VAR_PTR(node);
+} /* End of 'cfg_handle_get_var_ptr' function */
+
 /* End of 'cfg.c' file */
 
@@ -0,0 +1,548 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2012 by SG Software.
+ *
+ * SG MPFC. Filesystem utility functions.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "file_utils.h"
+
+static bool_t fu_file_type_recc( const char *name, bool_t *is_dir, int rec_level )
+{
+	struct stat st;
+	if (stat(name, &st))
+		return FALSE;
+
+	if (S_ISREG(st.st_mode))
+	{
+		(*is_dir) = FALSE;
+		return TRUE;
+	}
+	else if (S_ISDIR(st.st_mode))
+	{
+		(*is_dir) = TRUE;
+		return TRUE;
+	}
+	else if (S_ISLNK(st.st_mode))
+	{
+		/* Cyclic link? */
+		if (rec_level > 10)
+			return FALSE;
+
+		char linked_name[MAX_FILE_NAME];
+		if (readlink(name, linked_name, sizeof(linked_name)) < 0)
+			return FALSE;
+		return fu_file_type_recc(linked_name, is_dir, rec_level + 1);
+	}
+
+	/* Special file which we are not interested in */
+	return FALSE;
+} 
+
+/* Determine file type (regular or directory) resolving symlinks */
+bool_t fu_file_type(const char *name, bool_t *is_dir)
+{
+	return fu_file_type_recc(name, is_dir, 0);
+}
+
+/* Open a directory */
+fu_dir_t *fu_opendir(const char *name)
+{
+	fu_dir_t *dir = (fu_dir_t *)malloc(sizeof(fu_dir_t));
+
+	if (!(dir->m_dir = opendir(name)))
+	{
+		free(dir);
+		return NULL;
+	}
+
+	/* Allocate dirent */
+	if (!(dir->m_dirent = (struct dirent *)malloc(offsetof(struct dirent, d_name) +
+			pathconf(name, _PC_NAME_MAX) + 1)))
+	{
+		closedir(dir->m_dir);
+		free(dir);
+		return NULL;
+	}
+
+	return dir;
+}
+
+/* Read directory entry */
+struct dirent *fu_readdir(fu_dir_t *dir)
+{
+	struct dirent *de_result;
+	if (readdir_r(dir->m_dir, dir->m_dirent, &de_result))
+		return NULL;
+	if (!de_result)
+		return NULL;
+	return de_result;
+}
+
+/* Close directory */
+void fu_closedir(fu_dir_t *dir)
+{
+	if (!dir)
+		return;
+	closedir(dir->m_dir);
+	free(dir->m_dirent);
+	free(dir);
+}
+
+/* Is this a '.' or '..' ? */
+bool_t fu_is_special_dir(const char *name)
+{
+	return (name[0] == '.' &&
+			(name[1] == 0 || 
+			 (name[1] == '.' && name[2] == 0)));
+}
+
+/* Does path have a prefix? */
+bool_t fu_is_prefixed(const char *name)
+{
+	const char *p = strchr(name, '/');
+	return (p && p != name && *(p - 1) == ':' && *(p + 1) == '/');
+}
+
+/* Listings cache size */
+#define FU_CACHE_SIZE 64
+
+/* Cached directory listing */
+typedef struct tag_fu_cache_t
+{
+	/* Directory path (without trailing slashes) */
+	char *m_path;
+
+	/* Full listing (NULL while directory is being read) */
+	fu_list_t *m_list;
+
+	/* Inotify watch and entry identifier */
+	int m_wd;
+	unsigned m_id;
+
+	/* LRU list links (head is the most recently used) */
+	struct tag_fu_cache_t *m_next, *m_prev;
+} fu_cache_t;
+
+/* Listings cache */
+static fu_cache_t *fu_cache_head = NULL, *fu_cache_tail = NULL;
+static int fu_cache_num = 0;
+static unsigned fu_cache_last_id = 0;
+static int fu_inotify_fd = -2;
+static pthread_mutex_t fu_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Compare listing entries by name ('..' goes first) */
+static int fu_list_cmp_names(const void *a, const void *b)
+{
+	const char *na = ((const fu_list_entry_t *)a)->m_name;
+	const char *nb = ((const fu_list_entry_t *)b)->m_name;
+	bool_t a_up = !strcmp(na, ".."), b_up = !strcmp(nb, "..");
+
+	if (a_up || b_up)
+		return b_up - a_up;
+	return strcoll(na, nb);
+}
+
+/* Compare listing entries putting directories first */
+static int fu_list_cmp_dirs_first(const void *a, const void *b)
+{
+	bool_t da = ((const fu_list_entry_t *)a)->m_is_dir;
+	bool_t db = ((const fu_list_entry_t *)b)->m_is_dir;
+
+	if (da != db)
+		return db - da;
+	return fu_list_cmp_names(a, b);
+}
+
+/* Read all directory entries except '.' */
+static fu_list_t *fu_list_read(const char *name, bool_t stat_all)
+{
+	fu_list_t *list;
+	size_t *offsets = NULL;
+	size_t names_size = 0;
+	int size = 0, i;
+	struct dirent *de;
+
+	/* Open directory */
+	int fd = open(name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (fd < 0)
+		return NULL;
+	DIR *dir = fdopendir(fd);
+	if (!dir)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	list = (fu_list_t *)malloc(sizeof(*list));
+	if (!list)
+	{
+		closedir(dir);
+		return NULL;
+	}
+	memset(list, 0, sizeof(*list));
+	list->m_stat = stat_all;
+
+	while ((de = readdir(dir)) != NULL)
+	{
+		char *n = de->d_name;
+		fu_list_entry_t e;
+
+		if (n[0] == '.' && n[1] == 0)
+			continue;
+		memset(&e, 0, sizeof(e));
+
+		/* Determine type. Links and unknown types need a stat */
+		if (stat_all || de->d_type == DT_UNKNOWN || de->d_type == DT_LNK)
+		{
+			struct stat st;
+			if (fstatat(dirfd(dir), n, &st, 0))
+				continue;
+			e.m_mode = st.st_mode;
+			e.m_size = st.st_size;
+			e.m_mtime = st.st_mtime;
+		}
+		else
+			e.m_mode = DTTOIF(de->d_type);
+		e.m_is_dir = S_ISDIR(e.m_mode);
+
+		/* Enlarge arrays */
+		if (list->m_num >= size)
+		{
+			int new_size = (size == 0 ? 64 : size * 2);
+			fu_list_entry_t *entries = (fu_list_entry_t *)realloc(
+					list->m_entries, sizeof(*entries) * new_size);
+			if (entries)
+				list->m_entries = entries;
+			size_t *new_offsets = (size_t *)realloc(offsets, 
+					sizeof(*offsets) * new_size);
+			if (new_offsets)
+				offsets = new_offsets;
+			if (!entries || !new_offsets)
+				break;
+			size = new_size;
+		}
+		size_t len = strlen(n) + 1;
+		if (list->m_names_len + len > names_size)
+		{
+			size_t new_size = (names_size == 0 ? 1024 : names_size * 2);
+			while (new_size < list->m_names_len + len)
+				new_size *= 2;
+			char *names = (char *)realloc(list->m_names, new_size);
+			if (!names)
+				break;
+			list->m_names = names;
+			names_size = new_size;
+		}
+
+		/* Save entry */
+		memcpy(list->m_names + list->m_names_len, n, len);
+		offsets[list->m_num] = list->m_names_len;
+		list->m_names_len += len;
+		list->m_entries[list->m_num ++] = e;
+	}
+	closedir(dir);
+
+	/* Names block won't move any more */
+	for ( i = 0; i < list->m_num; i ++ )
+		list->m_entries[i].m_name = list->m_names + offsets[i];
+	free(offsets);
+	return list;
+}
+
+/* Copy a listing */
+static fu_list_t *fu_list_copy(fu_list_t *src)
+{
+	fu_list_t *list = (fu_list_t *)malloc(sizeof(*list));
+	int i;
+
+	if (!list)
+		return NULL;
+	*list = *src;
+	list->m_entries = (fu_list_entry_t *)malloc(
+			sizeof(*list->m_entries) * (src->m_num + 1));
+	list->m_names = (char *)malloc(src->m_names_len + 1);
+	if (!list->m_entries || !list->m_names)
+	{
+		fu_list_free(list);
+		return NULL;
+	}
+	if (src->m_names_len > 0)
+		memcpy(list->m_names, src->m_names, src->m_names_len);
+	for ( i = 0; i < src->m_num; i ++ )
+	{
+		list->m_entries[i] = src->m_entries[i];
+		list->m_entries[i].m_name = list->m_names + 
+			(src->m_entries[i].m_name - src->m_names);
+	}
+	return list;
+}
+
+/* Filter and sort listing in place */
+static void fu_list_filter(fu_list_t *list, int flags)
+{
+	int i, j;
+
+	for ( i = 0, j = 0; i < list->m_num; i ++ )
+	{
+		fu_list_entry_t *e = &list->m_entries[i];
+		char *n = e->m_name;
+
+		if (n[0] == '.')
+		{
+			if (n[1] == '.' && n[2] == 0)
+			{
+				if (!(flags & FU_LIST_UPDIR))
+					continue;
+			}
+			else if (!(flags & FU_LIST_HIDDEN))
+				continue;
+		}
+		if ((flags & FU_LIST_SKIP_SPECIAL) && !e->m_is_dir && 
+				!S_ISREG(e->m_mode))
+			continue;
+		list->m_entries[j ++] = *e;
+	}
+	list->m_num = j;
+
+	if (list->m_num > 0 && (flags & (FU_LIST_SORT | FU_LIST_DIRS_FIRST)))
+	{
+		qsort(list->m_entries, list->m_num, sizeof(*list->m_entries),
+				(flags & FU_LIST_DIRS_FIRST) ? fu_list_cmp_dirs_first :
+				fu_list_cmp_names);
+	}
+}
+
+/* Remove entry from the cache. Cache mutex must be locked */
+static void fu_cache_remove(fu_cache_t *c, bool_t rm_watch)
+{
+	if (c->m_prev)
+		c->m_prev->m_next = c->m_next;
+	else
+		fu_cache_head = c->m_next;
+	if (c->m_next)
+		c->m_next->m_prev = c->m_prev;
+	else
+		fu_cache_tail = c->m_prev;
+	fu_cache_num --;
+
+	if (rm_watch && c->m_wd >= 0)
+		inotify_rm_watch(fu_inotify_fd, c->m_wd);
+	fu_list_free(c->m_list);
+	free(c->m_path);
+	free(c);
+}
+
+/* Find cache entry by watch descriptor */
+static fu_cache_t *fu_cache_find_wd(int wd)
+{
+	fu_cache_t *c;
+	for ( c = fu_cache_head; c; c = c->m_next )
+	{
+		if (c->m_wd == wd)
+			return c;
+	}
+	return NULL;
+}
+
+/* Handle pending inotify events. Cache mutex must be locked */
+static void fu_cache_update(void)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	ssize_t len;
+
+	while ((len = read(fu_inotify_fd, buf, sizeof(buf))) > 0)
+	{
+		char *p;
+		for ( p = buf; p < buf + len; )
+		{
+			struct inotify_event *ev = (struct inotify_event *)p;
+			p += sizeof(*ev) + ev->len;
+
+			/* Events were lost: drop everything */
+			if (ev->mask & IN_Q_OVERFLOW)
+			{
+				while (fu_cache_head)
+					fu_cache_remove(fu_cache_head, TRUE);
+				continue;
+			}
+
+			fu_cache_t *c = fu_cache_find_wd(ev->wd);
+			if (c)
+				fu_cache_remove(c, !(ev->mask & IN_IGNORED));
+		}
+	}
+}
+
+/* Read directory through the cache */
+static fu_list_t *fu_list_cached(const char *name, bool_t stat_all)
+{
+	fu_cache_t *c;
+	fu_list_t *list;
+	unsigned id;
+	int wd;
+
+	/* Normalize path */
+	char *path = strdup(name);
+	if (!path)
+		return NULL;
+	size_t plen = strlen(path);
+	while (plen > 1 && path[plen - 1] == '/')
+		path[-- plen] = 0;
+
+	pthread_mutex_lock(&fu_cache_mutex);
+	if (fu_inotify_fd == -2)
+		fu_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fu_inotify_fd < 0)
+	{
+		pthread_mutex_unlock(&fu_cache_mutex);
+		free(path);
+		return fu_list_read(name, stat_all);
+	}
+	fu_cache_update();
+
+	/* Search cache */
+	for ( c = fu_cache_head; c; c = c->m_next )
+	{
+		if (c->m_list && strcmp(c->m_path, path) == 0 &&
+				(c->m_list->m_stat || !stat_all))
+			break;
+	}
+	if (c)
+	{
+		/* Move to the head */
+		if (c != fu_cache_head)
+		{
+			c->m_prev->m_next = c->m_next;
+			if (c->m_next)
+				c->m_next->m_prev = c->m_prev;
+			else
+				fu_cache_tail = c->m_prev;
+			c->m_prev = NULL;
+			c->m_next = fu_cache_head;
+			fu_cache_head->m_prev = c;
+			fu_cache_head = c;
+		}
+		list = fu_list_copy(c->m_list);
+		pthread_mutex_unlock(&fu_cache_mutex);
+		free(path);
+		return list;
+	}
+
+	/* Watch directory before reading it, so that changes done while
+	 * reading invalidate the entry. Cached entries keep file sizes, so
+	 * writes to files invalidate it too */
+	wd = inotify_add_watch(fu_inotify_fd, path, IN_CREATE | IN_DELETE | 
+			IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB | IN_MODIFY | 
+			IN_CLOSE_WRITE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+	if (wd < 0)
+	{
+		pthread_mutex_unlock(&fu_cache_mutex);
+		free(path);
+		return fu_list_read(name, stat_all);
+	}
+
+	/* The same directory may be cached under another name */
+	c = fu_cache_find_wd(wd);
+	if (c)
+		fu_cache_remove(c, FALSE);
+
+	/* Insert placeholder */
+	c = (fu_cache_t *)malloc(sizeof(*c));
+	if (!c)
+	{
+		pthread_mutex_unlock(&fu_cache_mutex);
+		free(path);
+		return fu_list_read(name, stat_all);
+	}
+	c->m_path = path;
+	c->m_list = NULL;
+	c->m_wd = wd;
+	c->m_id = id = ++ fu_cache_last_id;
+	c->m_prev = NULL;
+	c->m_next = fu_cache_head;
+	if (fu_cache_head)
+		fu_cache_head->m_prev = c;
+	else
+		fu_cache_tail = c;
+	fu_cache_head = c;
+	fu_cache_num ++;
+	while (fu_cache_num > FU_CACHE_SIZE && fu_cache_tail != c)
+		fu_cache_remove(fu_cache_tail, TRUE);
+	pthread_mutex_unlock(&fu_cache_mutex);
+
+	/* Read directory */
+	list = fu_list_read(name, stat_all);
+
+	/* Store listing if entry was not invalidated meanwhile */
+	pthread_mutex_lock(&fu_cache_mutex);
+	fu_cache_update();
+	for ( c = fu_cache_head; c; c = c->m_next )
+	{
+		if (c->m_id == id)
+			break;
+	}
+	if (c)
+	{
+		fu_list_t *copy = (list ? fu_list_copy(list) : NULL);
+		if (copy)
+			c->m_list = copy;
+		else
+			fu_cache_remove(c, TRUE);
+	}
+	pthread_mutex_unlock(&fu_cache_mutex);
+	return list;
+}
+
+/* List directory in one pass */
+fu_list_t *fu_list_dir(const char *name, int flags)
+{
+	fu_list_t *list;
+
+	if (flags & FU_LIST_NOCACHE)
+		list = fu_list_read(name, (flags & FU_LIST_STAT) != 0);
+	else
+		list = fu_list_cached(name, (flags & FU_LIST_STAT) != 0);
+	if (list)
+		fu_list_filter(list, flags);
+	return list;
+}
+
+/* Free directory listing */
+void fu_list_free(fu_list_t *list)
+{
+	if (!list)
+		return;
+	free(list->m_entries);
+	free(list->m_names);
+	free(list);
+}
+
+/* End of 'file_utils.h' file */
+
+
@@ -0,0 +1,181 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Play list files reader implementation.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "types.h"
+#include "plp_file.h"
+
+/* Read the whole stream into memory (for non-regular files) */
+static bool_t plp_file_read( plp_file_t *f, int fd )
+{
+	size_t size = 0, alloc = 4096;
+	char *data = (char *)malloc(alloc);
+	if (data == NULL)
+		return FALSE;
+	for ( ;; )
+	{
+		ssize_t n;
+
+		/* Keep one byte for the terminating zero */
+		if (size + 1 >= alloc)
+		{
+			char *new_data = (char *)realloc(data, alloc * 2);
+			if (new_data == NULL)
+			{
+				free(data);
+				return FALSE;
+			}
+			data = new_data;
+			alloc *= 2;
+		}
+		n = read(fd, data + size, alloc - size - 1);
+		if (n < 0)
+		{
+			free(data);
+			return FALSE;
+		}
+		if (n == 0)
+			break;
+		size += n;
+	}
+	f->m_data = data;
+	f->m_size = size;
+	f->m_mapped = FALSE;
+	return TRUE;
+} /* End of 'plp_file_read' function */
+
+/* Open a play list file */
+plp_file_t *plp_file_open( const char *name )
+{
+	plp_file_t *f;
+	struct stat st;
+	int fd;
+
+	fd = open(name, O_RDONLY);
+	if (fd < 0)
+		return NULL;
+	if (fstat(fd, &st))
+	{
+		close(fd);
+		return NULL;
+	}
+
+	f = (plp_file_t *)malloc(sizeof(*f));
+	if (f == NULL)
+	{
+		close(fd);
+		return NULL;
+	}
+	memset(f, 0, sizeof(*f));
+
+	/* Map regular files privately, so that lines may be terminated
+	 * in place without touching the file itself */
+	if (S_ISREG(st.st_mode) && st.st_size > 0)
+	{
+		void *data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, 
+				MAP_PRIVATE, fd, 0);
+		if (data != MAP_FAILED)
+		{
+			madvise(data, st.st_size, MADV_SEQUENTIAL);
+			f->m_data = (char *)data;
+			f->m_size = st.st_size;
+			f->m_mapped = TRUE;
+		}
+	}
+	if (f->m_data == NULL && !plp_file_read(f, fd))
+	{
+		close(fd);
+		free(f);
+		return NULL;
+	}
+	close(fd);
+
+	/* Skip UTF-8 byte order mark */
+	if (f->m_size >= 3 && !memcmp(f->m_data, "\xEF\xBB\xBF", 3))
+		f->m_pos = 3;
+	return f;
+} /* End of 'plp_file_open' function */
+
+/* Close file */
+void plp_file_close( plp_file_t *f )
+{
+	if (f == NULL)
+		return;
+
+	if (f->m_mapped)
+		munmap(f->m_data, f->m_size);
+	else
+		free(f->m_data);
+	if (f->m_tail != NULL)
+		free(f->m_tail);
+	free(f);
+} /* End of 'plp_file_close' function */
+
+/* Get next line. Returns FALSE at the end of file */
+bool_t plp_file_next_line( plp_file_t *f, char **line, size_t *len )
+{
+	char *start, *end;
+	size_t left;
+
+	if (f->m_pos >= f->m_size)
+		return FALSE;
+
+	start = f->m_data + f->m_pos;
+	left = f->m_size - f->m_pos;
+	end = (char *)memchr(start, '\n', left);
+	if (end != NULL)
+		f->m_pos += (end - start) + 1;
+	else
+	{
+		f->m_pos = f->m_size;
+		end = start + left;
+
+		/* There may be no room for the terminator after the mapping */
+		if (f->m_mapped)
+		{
+			f->m_tail = (char *)malloc(left + 1);
+			if (f->m_tail == NULL)
+				return FALSE;
+			memcpy(f->m_tail, start, left);
+			start = f->m_tail;
+			end = start + left;
+		}
+	}
+
+	/* Strip carriage return and terminate */
+	if (end > start && end[-1] == '\r')
+		end --;
+	*end = 0;
+
+	*line = start;
+	if (len != NULL)
+		*len = end - start;
+	return TRUE;
+} /* End of 'plp_file_next_line' function */
+
+/* End of 'plp_file.c' file */
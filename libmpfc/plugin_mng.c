@@ -20,11 +20,15 @@
  * MA 02111-1307, USA.
  */
 
+#include <ctype.h>
+#include <dirent.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 #include <fts.h>
+#include <time.h>
+#include <sys/stat.h>
 #include <gst/gst.h>
 #include "types.h"
 #include "cfg.h"
@@ -35,8 +39,198 @@
 #include "util.h"
 #include "wnd.h"
 
-/* Build supported media file extensions list */
-static bool_t pmng_fill_media_file_exts( pmng_t *pmng )
+/* Media extensions cache file name (relative to the home directory) */
+#define PMNG_MEDIA_EXTS_CACHE "/.mpfc/media_exts"
+
+/* Calculate extension hash and convert it to lower case. 
+ * Returns FALSE if extension is too long */
+static bool_t pmng_ext_fold( const char *ext, char *folded, dword *hash )
+{
+	int i;
+	dword val = 2166136261U;
+
+	for ( i = 0; ext[i]; i ++ )
+	{
+		if (i >= PMNG_MAX_EXT_LEN)
+			return FALSE;
+		folded[i] = tolower((byte)ext[i]);
+		val ^= (byte)folded[i];
+		val *= 16777619U;
+	}
+	folded[i] = 0;
+	*hash = val;
+	return TRUE;
+} /* End of 'pmng_ext_fold' function */
+
+/* Search extensions set */
+static struct pmng_ext_set_item_t *pmng_ext_set_search( pmng_ext_set_t *set,
+		const char *ext )
+{
+	char folded[PMNG_MAX_EXT_LEN + 1];
+	dword hash;
+	struct pmng_ext_set_item_t *item;
+
+	if (set->m_buckets == NULL || !pmng_ext_fold(ext, folded, &hash))
+		return NULL;
+	for ( item = set->m_buckets[hash % set->m_size]; item != NULL; 
+			item = item->m_next )
+	{
+		if (item->m_hash == hash && !strcmp(item->m_ext, folded))
+			return item;
+	}
+	return NULL;
+} /* End of 'pmng_ext_set_search' function */
+
+/* Add extension to the set (if it is not there yet) */
+static void pmng_ext_set_add( pmng_ext_set_t *set, const char *ext,
+		plist_plugin_t *plp )
+{
+	char folded[PMNG_MAX_EXT_LEN + 1];
+	dword hash;
+	struct pmng_ext_set_item_t *item;
+
+	if (!(*ext) || !pmng_ext_fold(ext, folded, &hash))
+		return;
+
+	/* Create buckets */
+	if (set->m_buckets == NULL)
+	{
+		set->m_size = 127;
+		set->m_buckets = (struct pmng_ext_set_item_t **)calloc(set->m_size,
+				sizeof(*set->m_buckets));
+		if (set->m_buckets == NULL)
+			return;
+	}
+	if (pmng_ext_set_search(set, folded) != NULL)
+		return;
+
+	/* Add item */
+	item = (struct pmng_ext_set_item_t *)malloc(sizeof(*item));
+	if (item == NULL)
+		return;
+	item->m_ext = strdup(folded);
+	item->m_hash = hash;
+	item->m_plp = plp;
+	item->m_next = set->m_buckets[hash % set->m_size];
+	set->m_buckets[hash % set->m_size] = item;
+} /* End of 'pmng_ext_set_add' function */
+
+/* Free extensions set */
+static void pmng_ext_set_free( pmng_ext_set_t *set )
+{
+	int i;
+
+	if (set->m_buckets == NULL)
+		return;
+	for ( i = 0; i < set->m_size; i ++ )
+	{
+		struct pmng_ext_set_item_t *item, *next;
+		for ( item = set->m_buckets[i]; item != NULL; item = next )
+		{
+			next = item->m_next;
+			free(item->m_ext);
+			free(item);
+		}
+	}
+	free(set->m_buckets);
+	set->m_buckets = NULL;
+	set->m_size = 0;
+} /* End of 'pmng_ext_set_free' function */
+
+/* Get GStreamer registry cache modification time (0 if not found) */
+static time_t pmng_registry_mtime( void )
+{
+	char dir_name[MAX_FILE_NAME];
+	struct stat st;
+	time_t mtime = 0;
+	DIR *dir;
+	struct dirent *de;
+
+	/* Registry location is specified explicitly */
+	const char *reg = getenv("GST_REGISTRY_1_0");
+	if (reg == NULL)
+		reg = getenv("GST_REGISTRY");
+	if (reg != NULL)
+		return (stat(reg, &st) ? 0 : st.st_mtime);
+
+	/* Look for registry.<arch>.bin files in the default location */
+	if (getenv("XDG_CACHE_HOME") != NULL)
+		snprintf(dir_name, sizeof(dir_name), "%s/gstreamer-1.0", 
+				getenv("XDG_CACHE_HOME"));
+	else
+		snprintf(dir_name, sizeof(dir_name), "%s/.cache/gstreamer-1.0", 
+				getenv("HOME"));
+	dir = opendir(dir_name);
+	if (dir == NULL)
+		return 0;
+	while ((de = readdir(dir)) != NULL)
+	{
+		char path[MAX_FILE_NAME];
+
+		if (strncmp(de->d_name, "registry.", 9))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir_name, de->d_name);
+		if (!stat(path, &st) && st.st_mtime > mtime)
+			mtime = st.st_mtime;
+	}
+	closedir(dir);
+	return mtime;
+} /* End of 'pmng_registry_mtime' function */
+
+/* Load media extensions from cache if it matches registry */
+static char *pmng_load_media_exts_cache( time_t mtime )
+{
+	char *fname, *exts;
+	FILE *fd;
+	long long cached_mtime;
+	str_t *line;
+
+	if (mtime == 0)
+		return NULL;
+	fname = util_strcat(getenv("HOME"), PMNG_MEDIA_EXTS_CACHE, NULL);
+	fd = fopen(fname, "rt");
+	free(fname);
+	if (fd == NULL)
+		return NULL;
+
+	/* Check the registry time stamp */
+	if (fscanf(fd, "%lld\n", &cached_mtime) != 1 || 
+			cached_mtime != (long long)mtime)
+	{
+		fclose(fd);
+		return NULL;
+	}
+
+	/* Read extensions */
+	line = util_fgets(fd);
+	fclose(fd);
+	if (line == NULL)
+		return NULL;
+	exts = strdup(STR_TO_CPTR(line));
+	str_free(line);
+	util_del_nl(exts, exts);
+	return exts;
+} /* End of 'pmng_load_media_exts_cache' function */
+
+/* Save media extensions cache */
+static void pmng_save_media_exts_cache( time_t mtime, const char *exts )
+{
+	char *fname;
+	FILE *fd;
+
+	if (mtime == 0)
+		return;
+	fname = util_strcat(getenv("HOME"), PMNG_MEDIA_EXTS_CACHE, NULL);
+	fd = fopen(fname, "wt");
+	free(fname);
+	if (fd == NULL)
+		return;
+	fprintf(fd, "%lld\n%s\n", (long long)mtime, exts);
+	fclose(fd);
+} /* End of 'pmng_save_media_exts_cache' function */
+
+/* Collect supported media file extensions from GStreamer registry */
+static char *pmng_collect_media_file_exts( void )
 {
 	/* First collect all mimetypes which might correspond to audio */
 	GHashTable *all_mimes = g_hash_table_new(g_str_hash, g_str_equal);
@@ -118,13 +312,30 @@ static bool_t pmng_fill_media_file_exts( pmng_t *pmng )
 	gst_plugin_feature_list_free(tffs);
 	g_hash_table_destroy(all_mimes);
 
-	pmng->m_media_file_exts = strdup(STR_TO_CPTR(media_exts));
+	char *res = strdup(STR_TO_CPTR(media_exts));
 	str_free(media_exts);
+	return res;
+} /* End of 'pmng_collect_media_file_exts' function */
+
+/* Build supported media file extensions list */
+static bool_t pmng_fill_media_file_exts( pmng_t *pmng )
+{
+	/* Walk registry only if it has changed since the last time */
+	time_t mtime = pmng_registry_mtime();
+	pmng->m_media_file_exts = pmng_load_media_exts_cache(mtime);
+	if (pmng->m_media_file_exts == NULL)
+	{
+		pmng->m_media_file_exts = pmng_collect_media_file_exts();
+		if (pmng->m_media_file_exts == NULL)
+			return FALSE;
+		pmng_save_media_exts_cache(mtime, pmng->m_media_file_exts);
+	}
 
 	logger_message(pmng->m_log, 1, _("Supported media file extensions: %s"),
 			pmng->m_media_file_exts);
 
-	/* Replace ';' with 0 and calculate maximal extension length */
+	/* Replace ';' with 0, calculate maximal extension length and 
+	 * fill extensions set */
 	size_t max_len = 0, len = 0;
 	for ( char *p = pmng->m_media_file_exts;; ++p, ++len )
 	{
@@ -135,7 +346,8 @@ static bool_t pmng_fill_media_file_exts( pmng_t *pmng )
 			(*p) = 0;
 			if (len > max_len)
 				max_len = len;
-			len = 0;
+			pmng_ext_set_add(&pmng->m_media_ext_set, p - len, NULL);
+			len = -1;
 
 			if (end)
 				break;
@@ -146,6 +358,29 @@ static bool_t pmng_fill_media_file_exts( pmng_t *pmng )
 	return TRUE;
 } /* End of 'pmng_fill_media_file_exts' function */
 
+/* Build play list extensions set */
+static void pmng_fill_plist_exts( pmng_t *pmng )
+{
+	pmng_iterator_t iter = pmng_start_iteration(pmng, PLUGIN_TYPE_PLIST);
+	for ( ;; )
+	{
+		char formats[128];
+		char *ext, *next;
+		plist_plugin_t *plp = PLIST_PLUGIN(pmng_iterate(&iter));
+		if (!plp)
+			break;
+
+		plp_get_formats(plp, formats, NULL);
+		for ( ext = formats; ext != NULL; ext = next )
+		{
+			next = strchr(ext, ';');
+			if (next != NULL)
+				*(next ++) = 0;
+			pmng_ext_set_add(&pmng->m_plist_ext_set, ext, plp);
+		}
+	}
+} /* End of 'pmng_fill_plist_exts' function */
+
 /* Initialize plugins */
 pmng_t *pmng_init( cfg_node_t *list, logger_t *log, wnd_t *wnd_root )
 {
@@ -167,8 +402,9 @@ pmng_t *pmng_init( cfg_node_t *list, logger_t *log, wnd_t *wnd_root )
 		return NULL;
 	}
 
-	/* Fill m_media_file_exts */
+	/* Fill m_media_file_exts and extensions sets */
 	pmng_fill_media_file_exts(pmng);
+	pmng_fill_plist_exts(pmng);
 
 	/* Autostart general plugins */
 	pmng_autostart_general(pmng);
@@ -185,6 +421,8 @@ void pmng_free( pmng_t *pmng )
 
 	if (pmng->m_media_file_exts)
 		free(pmng->m_media_file_exts);
+	pmng_ext_set_free(&pmng->m_media_ext_set);
+	pmng_ext_set_free(&pmng->m_plist_ext_set);
 
 	for ( i = 0; i < pmng->m_num_plugins; i ++ )
 		plugin_free(pmng->m_plugins[i]);
@@ -247,13 +485,7 @@ bool_t pmng_search_format( pmng_t *pmng, const char *filename, const char *forma
 
 	logger_debug(pmng->m_log, "pmng_search_format(%s, %s)", filename, format);
 
-	for ( char *ext = pmng_first_media_ext(pmng); ext; 
-			ext = pmng_next_media_ext(ext) )
-	{
-		if (!strcasecmp(ext, format))
-			return TRUE;
-	}
-	return FALSE;
+	return pmng_ext_set_search(&pmng->m_media_ext_set, format) != NULL;
 } /* End of 'pmng_search_format' function */
 
 /* Search for plugin with a specified name */
@@ -535,33 +767,12 @@ plist_plugin_t *pmng_is_playlist_extension( pmng_t *pmng, char *format )
 
 	logger_debug(pmng->m_log, "pmng_is_playlist(%s)", format);
 
-	pmng_iterator_t iter = pmng_start_iteration(pmng, PLUGIN_TYPE_PLIST);
-	for ( ;; )
-	{
-		char formats[128], ext[10];
-		int j, k = 0;
-		plist_plugin_t *plp = PLIST_PLUGIN(pmng_iterate(&iter));
-		if (!plp)
-			break;
-
-		plp_get_formats(plp, formats, NULL);
-		for ( j = 0;; ext[k ++] = formats[j ++] )
-		{
-			if (formats[j] == 0 || formats[j] == ';')
-			{
-				ext[k] = 0;
-				if (!strcasecmp(ext, format))
-				{
-					logger_debug(pmng->m_log, "extension matches");
-					return plp;
-				}
-				k = 0;
-			}
-			if (!formats[j])
-				break;
-		}
-	}
-	return NULL;
+	struct pmng_ext_set_item_t *item = 
+		pmng_ext_set_search(&pmng->m_plist_ext_set, format);
+	if (item == NULL)
+		return NULL;
+	logger_debug(pmng->m_log, "extension matches");
+	return item->m_plp;
 } /* End of 'pmng_is_playlist' function */
 
 /* End of 'pmng.c' file */
@@ -25,6 +25,7 @@
 #include "types.h"
 #include "pmng.h"
 #include "song_info.h"
+#include "strpool.h"
 
 /* Initialize song info */
 song_info_t *si_new( void )
@@ -38,14 +39,14 @@ song_info_t *si_new( void )
 
 	/* Set empty fields */
 	memset(si, 0, sizeof(*si));
-	si->m_name = strdup("");
-	si->m_artist = strdup("");
-	si->m_album = strdup("");
-	si->m_year = strdup("");
-	si->m_track = strdup("");
-	si->m_comments = strdup("");
-	si->m_own_data = strdup("");
-	si->m_genre = strdup("");
+	si->m_name = strpool_empty;
+	si->m_artist = strpool_empty;
+	si->m_album = strpool_empty;
+	si->m_year = strpool_empty;
+	si->m_track = strpool_empty;
+	si->m_comments = strpool_empty;
+	si->m_own_data = strpool_empty;
+	si->m_genre = strpool_empty;
 	return si;
 } /* End of 'si_new' function */
 
@@ -64,15 +65,19 @@ song_info_t *si_dup( song_info_t *info )
 
 	/* Copy fields */
 	memset(si, 0, sizeof(*si));
-	si->m_name = strdup(info->m_name);
-	si->m_artist = strdup(info->m_artist);
-	si->m_album = strdup(info->m_album);
-	si->m_year = strdup(info->m_year);
-	si->m_track = strdup(info->m_track);
-	si->m_comments = strdup(info->m_comments);
-	si->m_genre = strdup(info->m_genre);
-	si->m_own_data = strdup(info->m_own_data);
+	si->m_name = strpool_ref(info->m_name);
+	si->m_artist = strpool_ref(info->m_artist);
+	si->m_album = strpool_ref(info->m_album);
+	si->m_year = strpool_ref(info->m_year);
+	si->m_track = strpool_ref(info->m_track);
+	si->m_comments = strpool_ref(info->m_comments);
+	si->m_genre = strpool_ref(info->m_genre);
+	si->m_own_data = strpool_ref(info->m_own_data);
 	si->m_flags = info->m_flags;
+	si->m_track_gain = info->m_track_gain;
+	si->m_track_peak = info->m_track_peak;
+	si->m_album_gain = info->m_album_gain;
+	si->m_album_peak = info->m_album_peak;
 	return si;
 } /* End of 'si_dup' function */
 
@@ -83,14 +88,14 @@ void si_free( song_info_t *si )
 		return;
 
 	/* Free memory */
-	free(si->m_name);
-	free(si->m_artist);
-	free(si->m_album);
-	free(si->m_year);
-	free(si->m_track);
-	free(si->m_comments);
-	free(si->m_own_data);
-	free(si->m_genre);
+	strpool_release(si->m_name);
+	strpool_release(si->m_artist);
+	strpool_release(si->m_album);
+	strpool_release(si->m_year);
+	strpool_release(si->m_track);
+	strpool_release(si->m_comments);
+	strpool_release(si->m_own_data);
+	strpool_release(si->m_genre);
 	free(si);
 } /* End of 'si_free' function */
 
@@ -100,8 +105,9 @@ void si_set_name( song_info_t *si, const char *name )
 	if (si == NULL)
 		return;
 
-	free(si->m_name);
-	si->m_name = strdup(name == NULL ? "" : name);
+	char *old = si->m_name;
+	si->m_name = strpool_get(name);
+	strpool_release(old);
 	if (name != NULL)
 		si->m_flags |= SI_INITIALIZED;
 } /* End of 'si_set_name' function */
@@ -112,8 +118,9 @@ void si_set_artist( song_info_t *si, const char *artist )
 	if (si == NULL)
 		return;
 
-	free(si->m_artist);
-	si->m_artist = strdup(artist == NULL ? "" : artist);
+	char *old = si->m_artist;
+	si->m_artist = strpool_get(artist);
+	strpool_release(old);
 	if (artist != NULL)
 		si->m_flags |= SI_INITIALIZED;
 } /* End of 'si_set_artist' function */
@@ -124,8 +131,9 @@ void si_set_album( song_info_t *si, const char *album )
 	if (si == NULL)
 		return;
 
-	free(si->m_album);
-	si->m_album = strdup(album == NULL ? "" : album);
+	char *old = si->m_album;
+	si->m_album = strpool_get(album);
+	strpool_release(old);
 	if (album != NULL)
 		si->m_flags |= SI_INITIALIZED;
 } /* End of 'si_set_album' function */
@@ -136,8 +144,9 @@ void si_set_year( song_info_t *si, const char *year )
 	if (si == NULL)
 		return;
 
-	free(si->m_year);
-	si->m_year = strdup(year == NULL ? "" : year);
+	char *old = si->m_year;
+	si->m_year = strpool_get(year);
+	strpool_release(old);
 	if (year != NULL)
 		si->m_flags |= SI_INITIALIZED;
 } /* End of 'si_set_year' function */
@@ -148,8 +157,9 @@ void si_set_track( song_info_t *si, const char *track )
 	if (si == NULL)
 		return;
 
-	free(si->m_track);
-	si->m_track = strdup(track == NULL ? "" : track);
+	char *old = si->m_track;
+	si->m_track = strpool_get(track);
+	strpool_release(old);
 	if (track != NULL)
 		si->m_flags |= SI_INITIALIZED;
 } /* End of 'si_set_track' function */
@@ -160,8 +170,9 @@ void si_set_comments( song_info_t *si, const char *comments )
 	if (si == NULL)
 		return;
 
-	free(si->m_comments);
-	si->m_comments = strdup(comments == NULL ? "" : comments);
+	char *old = si->m_comments;
+	si->m_comments = strpool_get(comments);
+	strpool_release(old);
 	if (comments != NULL)
 		si->m_flags |= SI_INITIALIZED;
 } /* End of 'si_set_comments' function */
@@ -172,8 +183,9 @@ void si_set_genre( song_info_t *si, const char *genre )
 	if (si == NULL)
 		return;
 
-	free(si->m_genre);
-	si->m_genre = strdup(genre == NULL ? "" : genre);
+	char *old = si->m_genre;
+	si->m_genre = strpool_get(genre);
+	strpool_release(old);
 	if (genre != NULL)
 		si->m_flags |= SI_INITIALIZED;
 } /* End of 'si_set_genre' function */
@@ -184,9 +196,46 @@ void si_set_own_data( song_info_t *si, const char *own_data )
 	if (si == NULL)
 		return;
 
-	free(si->m_own_data);
-	si->m_own_data = strdup(own_data == NULL ? "" : own_data);
+	char *old = si->m_own_data;
+	si->m_own_data = strpool_get(own_data);
+	strpool_release(old);
 } /* End of 'si_set_own_data' function */
 
-/* End of 'song_info.h' file */
+/* Set ReplayGain values */
+void si_set_replay_gain( song_info_t *si, bool_t album, float gain, float peak )
+{
+	if (si == NULL)
+		return;
+
+	if (album)
+	{
+		si->m_album_gain = gain;
+		si->m_album_peak = peak;
+		si->m_flags |= SI_ALBUM_GAIN;
+	}
+	else
+	{
+		si->m_track_gain = gain;
+		si->m_track_peak = peak;
+		si->m_flags |= SI_TRACK_GAIN;
+	}
+} /* End of 'si_set_replay_gain' function */
+
+/* Get gain for playing song with ReplayGain. Like rgvolume does we take
+ * track values if the album ones are missing and vice versa */
+bool_t si_get_replay_gain( song_info_t *si, bool_t album, float *gain, float *peak )
+{
+	if (si == NULL || !(si->m_flags & (SI_TRACK_GAIN | SI_ALBUM_GAIN)))
+		return FALSE;
+
+	if (!(si->m_flags & SI_ALBUM_GAIN))
+		album = FALSE;
+	else if (!(si->m_flags & SI_TRACK_GAIN))
+		album = TRUE;
+	(*gain) = album ? si->m_album_gain : si->m_track_gain;
+	(*peak) = album ? si->m_album_peak : si->m_track_peak;
+	return TRUE;
+} /* End of 'si_get_replay_gain' function */
+
+/* End of 'song_info.c' file */
 
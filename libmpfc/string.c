@@ -29,44 +29,32 @@
 #include "mystring.h"
 #include "util.h"
 
-/* String portion size */
-#define STR_PORTION_SIZE 64
-
 /* Some private functions */
 static void str_allocate( str_t *str, int new_len );
 static int str_move_back( str_t *str, int pos );
+static str_t *str_new_len( const char *s, int len );
 
 /* Create a new string */
 str_t *str_new( const char *s )
 {
 	str_t *str;
-	int len;
 
 	if (s == NULL)
 		return NULL;
 
-	/* Allocate memory */
-	str = (str_t *)malloc(sizeof(str_t));
-	if (str == NULL)
-		return NULL;
-
-	/* Initialize fields */
-	str->m_len = strlen(s);
-	str->m_data = NULL;
-	str->m_allocated = 0;
-	str->m_portion_size = STR_PORTION_SIZE;
-	str->m_bytes_to_complete = 0;
-	str->m_utf8_seq_len = 0;
-	str->m_width = ((*s) == 0) ? 0 : -1;
-	str_allocate(str, str->m_len);
-	strcpy(str->m_data, s);
+	str = str_new_len(s, strlen(s));
+	if (str != NULL && str->m_len == 0)
+		str->m_width = 0;
 	return str;
 } /* End of 'str_new' function */
 
 /* Duplicate string */
 str_t *str_dup( const str_t *s )
 {
-	return str_new(s->m_data);
+	str_t *str = str_new_len(s->m_data, s->m_len);
+	if (str != NULL)
+		str->m_width = s->m_width;
+	return str;
 } /* End of 'str_dup' function */
 
 /* Free string */
@@ -75,7 +63,7 @@ void str_free( str_t *str )
 	if (str == NULL)
 		return;
 
-	if (str->m_data != NULL)
+	if (str->m_data != str->m_inline)
 		free(str->m_data);
 	free(str);
 } /* End of 'str_free' function */
@@ -101,8 +89,10 @@ str_t *str_copy_cptr( str_t *dest, const char *src )
 	if (dest == NULL || src == NULL)
 		return NULL;
 
-	str_allocate(dest, dest->m_len = strlen(src));
-	strcpy(dest->m_data, src);
+	len = strlen(src);
+	str_reserve(dest, len);
+	memcpy(dest->m_data, src, len + 1);
+	dest->m_len = len;
 	dest->m_width = -1;
 	return dest;
 } /* End of 'str_copy_cptr' function */
@@ -124,10 +114,10 @@ str_t *str_cat_cptr( str_t *dest, const char *src )
 		return NULL;
 
 	len = strlen(src);
-	str_allocate(dest, dest->m_len + len);
+	str_reserve(dest, dest->m_len + len);
+	memcpy(&dest->m_data[dest->m_len], src, len + 1);
 	dest->m_len += len;
 	dest->m_width = -1;
-	strcat(dest->m_data, src);
 	return dest;
 } /* End of 'str_cat_cptr' function */
 
@@ -141,6 +131,27 @@ str_t *str_cat( str_t *dest, const str_t *src )
 	return new_str;
 } /* End of 'str_cat' function */
 
+/* Concatenate string with first 'len' bytes of (char *) */
+str_t *str_cat_cptr_len( str_t *dest, const char *src, int len )
+{
+	if (dest == NULL || src == NULL)
+		return NULL;
+
+	str_reserve(dest, dest->m_len + len);
+	memcpy(&dest->m_data[dest->m_len], src, len);
+	dest->m_len += len;
+	dest->m_data[dest->m_len] = 0;
+	dest->m_width = -1;
+	return dest;
+} /* End of 'str_cat_cptr_len' function */
+
+/* Make sure that string has enough memory to hold 'len' bytes */
+void str_reserve( str_t *str, int len )
+{
+	if (len + 1 > str->m_allocated)
+		str_allocate(str, len);
+} /* End of 'str_reserve' function */
+
 /* Is the string in consistent state? */
 static inline bool_t str_is_consistent( str_t *str )
 {
@@ -154,7 +165,7 @@ int str_insert_char( str_t *str, char ch, int index )
 	if (str == NULL || index < 0 || index > str->m_len)
 		return 0;
 
-	str_allocate(str, str->m_len + 1);
+	str_reserve(str, str->m_len + 1);
 	memmove(&str->m_data[index + 1], &str->m_data[index],
 			str->m_len - index + 1);
 	str->m_data[index] = ch;
@@ -223,9 +234,7 @@ bool_t str_delete_char( str_t *str, int index, bool_t before )
 	if (str->m_width >= 0)
 		--str->m_width;
 
-	int new_len = str->m_len - (bp - index);
-	str_allocate(str, new_len);
-	str->m_len = new_len;
+	str->m_len -= (bp - index);
 	return TRUE;
 } /* End of 'str_delete_char' function */
 
@@ -251,7 +260,7 @@ str_t *str_insert_cptr( str_t *dest, const char *src, int index )
 		return NULL;
 
 	len = strlen(src);
-	str_allocate(dest, dest->m_len + len);
+	str_reserve(dest, dest->m_len + len);
 	memmove(&dest->m_data[index + len], &dest->m_data[index],
 			dest->m_len - index + 1);
 	memcpy(&dest->m_data[index], src, len);
@@ -273,14 +282,15 @@ str_t *str_insert_str( str_t *dest, const str_t *src, int index )
 /* Formatted print */
 int str_printf( str_t *str, const char *fmt, ... )
 {
-	int n, size = 100;
+	int n, size;
 	va_list ap;
 
 	if (str == NULL)
 		return 0;
 
+	/* Try to print into the memory we already have first */
 	str->m_width = -1;
-	str_allocate(str, size);
+	size = str->m_allocated;
 	for ( ;; )
 	{
 		va_start(ap, fmt);
@@ -293,75 +303,78 @@ int str_printf( str_t *str, const char *fmt, ... )
 		else 
 			size *= 2;
 
-		str_allocate(str, size);
+		str_reserve(str, size - 1);
 	}
 	return 0;
 } /* End of 'str_printf' function */
 
-/* Allocate space for string data */
+/* Allocate space for string data. Memory grows geometrically and
+ * is never given back, so that appending is amortized constant time */
 static void str_allocate( str_t *str, int new_len )
 {
-	for ( str->m_allocated = new_len + 1; 
-			str->m_allocated % str->m_portion_size; str->m_allocated ++ );
-	str->m_data = (char *)realloc(str->m_data, str->m_allocated);
+	int size = str->m_allocated;
+	char *data;
+
+	while (size < new_len + 1)
+		size *= 2;
+
+	/* Leave inline storage */
+	if (str->m_data == str->m_inline)
+	{
+		data = (char *)malloc(size);
+		if (data != NULL)
+			memcpy(data, str->m_inline, STR_INLINE_SIZE);
+	}
+	else
+		data = (char *)realloc(str->m_data, size);
+	assert(data);
+	str->m_data = data;
+	str->m_allocated = size;
 } /* End of 'str_allocate' function */
 
+/* Create a string from the first 'len' bytes of (char *) */
+static str_t *str_new_len( const char *s, int len )
+{
+	str_t *str;
+
+	/* Allocate memory */
+	str = (str_t *)malloc(sizeof(str_t));
+	if (str == NULL)
+		return NULL;
+
+	/* Initialize fields */
+	str->m_data = str->m_inline;
+	str->m_allocated = STR_INLINE_SIZE;
+	str->m_bytes_to_complete = 0;
+	str->m_utf8_seq_len = 0;
+	str->m_width = -1;
+	str_reserve(str, len);
+	memcpy(str->m_data, s, len);
+	str->m_data[len] = 0;
+	str->m_len = len;
+	return str;
+} /* End of 'str_new_len' function */
+
 /* Extract a substring */
 str_t *str_substring( const str_t *str, int start, int end )
 {
-	str_t *new_str;
-
 	if (str == NULL)
 		return NULL;
 	if (end < start)
 		return str_new("");
 
-	/* Allocate memory */
-	new_str = (str_t *)malloc(sizeof(str_t));
-	if (new_str == NULL)
-		return NULL;
-
-	/* Initialize fields */
-	new_str->m_len = end - start + 1;
-	new_str->m_data = NULL;
-	new_str->m_allocated = 0;
-	new_str->m_portion_size = STR_PORTION_SIZE;
-	new_str->m_bytes_to_complete = 0;
-	new_str->m_utf8_seq_len = 0;
-	new_str->m_width = -1;
-	str_allocate(new_str, new_str->m_len);
-	memcpy(new_str->m_data, &str->m_data[start], new_str->m_len);
-	new_str->m_data[new_str->m_len] = 0;
-	return new_str;
+	return str_new_len(&str->m_data[start], end - start + 1);
 } /* End of 'str_substring' function */
 
 /* Extract a substring from (char *) */
 str_t *str_substring_cptr( const char *str, int start, int end )
 {
-	str_t *new_str;
-
 	if (str == NULL)
 		return NULL;
 	if (end < start)
 		return str_new("");
 
-	/* Allocate memory */
-	new_str = (str_t *)malloc(sizeof(str_t));
-	if (new_str == NULL)
-		return NULL;
-
-	/* Initialize fields */
-	new_str->m_len = end - start + 1;
-	new_str->m_data = NULL;
-	new_str->m_allocated = 0;
-	new_str->m_portion_size = STR_PORTION_SIZE;
-	new_str->m_bytes_to_complete = 0;
-	new_str->m_utf8_seq_len = 0;
-	new_str->m_width = -1;
-	str_allocate(new_str, new_str->m_len);
-	memcpy(new_str->m_data, &str[start], new_str->m_len);
-	new_str->m_data[new_str->m_len] = 0;
-	return new_str;
+	return str_new_len(&str[start], end - start + 1);
 } /* End of 'str_substring_cptr' function */
 
 /* Escape the special symbols (assuming that string is a file name) */
@@ -487,5 +500,67 @@ int str_calc_width( str_t *str )
 	return (str->m_width = utf8_width(str->m_data));
 } /* End of 'str_calc_width' function */
 
+/* Decode string for displaying */
+str_wide_t *str_wide_new( const str_t *str )
+{
+	str_wide_t *ws;
+	int pos, n = 0;
+
+	if (str == NULL)
+		return NULL;
+
+	/* Allocate memory (there are no more characters than bytes) */
+	ws = (str_wide_t *)malloc(sizeof(*ws) + 
+			str->m_len * (sizeof(wchar_t) + sizeof(byte)));
+	if (ws == NULL)
+		return NULL;
+	ws->m_chars = (wchar_t *)(ws + 1);
+	ws->m_widths = (byte *)(ws->m_chars + str->m_len);
+	ws->m_width = 0;
+	ws->m_cut_width = -1;
+	ws->m_cut_len = 0;
+
+	/* Decode characters */
+	for ( pos = 0; pos < str->m_len; n ++ )
+	{
+		int nbytes;
+		wchar_t ch = str_wchar_at((str_t *)str, pos, &nbytes);
+		int w = (ch < 0x20) ? 0 : wcwidth(ch);
+		if (w < 0)
+			w = 0;
+
+		ws->m_chars[n] = ch;
+		ws->m_widths[n] = w;
+		ws->m_width += w;
+		pos += nbytes;
+	}
+	ws->m_len = n;
+	return ws;
+} /* End of 'str_wide_new' function */
+
+/* Free decoded string */
+void str_wide_free( str_wide_t *ws )
+{
+	free(ws);
+} /* End of 'str_wide_free' function */
+
+/* Get number of characters of a decoded string that fit into 
+ * 'width' positions */
+int str_wide_cut( str_wide_t *ws, int width )
+{
+	int i, w = 0;
+
+	if (width >= ws->m_width)
+		return ws->m_len;
+	if (width == ws->m_cut_width)
+		return ws->m_cut_len;
+
+	for ( i = 0; i < ws->m_len && w + ws->m_widths[i] <= width; i ++ )
+		w += ws->m_widths[i];
+	ws->m_cut_width = width;
+	ws->m_cut_len = i;
+	return i;
+} /* End of 'str_wide_cut' function */
+
 /* End of 'string.c' file */
 
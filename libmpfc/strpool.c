@@ -0,0 +1,185 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Shared strings pool implementation.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "strpool.h"
+
+/* Initial hash table size */
+#define STRPOOL_INITIAL_SIZE	1021
+
+/* Pooled string entry */
+typedef struct tag_strpool_entry_t
+{
+	struct tag_strpool_entry_t *m_next;
+	dword m_hash;
+	int m_ref_count;
+	char m_str[];
+} strpool_entry_t;
+
+/* Get entry by the string */
+#define STRPOOL_ENTRY(str) \
+	((strpool_entry_t *)((str) - offsetof(strpool_entry_t, m_str)))
+
+/* The shared empty string */
+char strpool_empty[1] = "";
+
+/* Pool hash table */
+static strpool_entry_t **strpool_table = NULL;
+static int strpool_size = 0;
+static int strpool_count = 0;
+static pthread_mutex_t strpool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Calculate string hash value */
+static dword strpool_hash( const char *str )
+{
+	dword val = 2166136261U;
+
+	for ( ; *str; str ++ )
+	{
+		val ^= (byte)(*str);
+		val *= 16777619U;
+	}
+	return val;
+} /* End of 'strpool_hash' function */
+
+/* Change hash table size */
+static bool_t strpool_resize( int new_size )
+{
+	strpool_entry_t **table;
+	int i;
+
+	table = (strpool_entry_t **)calloc(new_size, sizeof(*table));
+	if (table == NULL)
+		return FALSE;
+	for ( i = 0; i < strpool_size; i ++ )
+	{
+		strpool_entry_t *e, *next;
+		for ( e = strpool_table[i]; e != NULL; e = next )
+		{
+			next = e->m_next;
+			e->m_next = table[e->m_hash % new_size];
+			table[e->m_hash % new_size] = e;
+		}
+	}
+	free(strpool_table);
+	strpool_table = table;
+	strpool_size = new_size;
+	return TRUE;
+} /* End of 'strpool_resize' function */
+
+/* Get a pooled copy of the string (adding a reference to it). 
+ * Empty string is returned if there is not enough memory */
+char *strpool_get( const char *str )
+{
+	strpool_entry_t *e;
+	dword hash;
+	int len;
+
+	if (str == NULL || (*str) == 0)
+		return strpool_empty;
+
+	hash = strpool_hash(str);
+	pthread_mutex_lock(&strpool_mutex);
+
+	/* Create table */
+	if (strpool_table == NULL && !strpool_resize(STRPOOL_INITIAL_SIZE))
+	{
+		pthread_mutex_unlock(&strpool_mutex);
+		return strpool_empty;
+	}
+
+	/* Search for an existing entry */
+	for ( e = strpool_table[hash % strpool_size]; e != NULL; e = e->m_next )
+	{
+		if (e->m_hash == hash && !strcmp(e->m_str, str))
+		{
+			e->m_ref_count ++;
+			pthread_mutex_unlock(&strpool_mutex);
+			return e->m_str;
+		}
+	}
+
+	/* Create a new one */
+	len = strlen(str);
+	e = (strpool_entry_t *)malloc(sizeof(*e) + len + 1);
+	if (e == NULL)
+	{
+		pthread_mutex_unlock(&strpool_mutex);
+		return strpool_empty;
+	}
+	e->m_hash = hash;
+	e->m_ref_count = 1;
+	memcpy(e->m_str, str, len + 1);
+	e->m_next = strpool_table[hash % strpool_size];
+	strpool_table[hash % strpool_size] = e;
+
+	/* Enlarge table if it has become too crowded */
+	strpool_count ++;
+	if (strpool_count > strpool_size * 2)
+		strpool_resize(strpool_size * 2 + 1);
+	pthread_mutex_unlock(&strpool_mutex);
+	return e->m_str;
+} /* End of 'strpool_get' function */
+
+/* Add a reference to a pooled string */
+char *strpool_ref( char *str )
+{
+	if (str == NULL || str == strpool_empty)
+		return str;
+
+	pthread_mutex_lock(&strpool_mutex);
+	assert(STRPOOL_ENTRY(str)->m_ref_count > 0);
+	STRPOOL_ENTRY(str)->m_ref_count ++;
+	pthread_mutex_unlock(&strpool_mutex);
+	return str;
+} /* End of 'strpool_ref' function */
+
+/* Release a reference to a pooled string */
+void strpool_release( char *str )
+{
+	strpool_entry_t *e, **prev;
+
+	if (str == NULL || str == strpool_empty)
+		return;
+
+	pthread_mutex_lock(&strpool_mutex);
+	e = STRPOOL_ENTRY(str);
+	assert(e->m_ref_count > 0);
+	e->m_ref_count --;
+	if (e->m_ref_count == 0)
+	{
+		/* Remove entry from the table */
+		for ( prev = &strpool_table[e->m_hash % strpool_size]; (*prev) != e;
+				prev = &(*prev)->m_next );
+		*prev = e->m_next;
+		strpool_count --;
+		free(e);
+	}
+	pthread_mutex_unlock(&strpool_mutex);
+} /* End of 'strpool_release' function */
+
+/* End of 'strpool.c' file */
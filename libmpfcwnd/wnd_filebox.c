@@ -30,6 +30,7 @@
 #include <sys/types.h>
 #include <unistd.h>
 #include "types.h"
+#include "file_utils.h"
 #include "mystring.h"
 #include "wnd.h"
 #include "wnd_editbox.h"
@@ -71,33 +72,25 @@ static void filebox_scandir( filebox_t *fb, char *dirname )
 			real_name = util_strcat(home, dirname + 1, NULL);
 	}
 
-	struct dirent **namelist;
-	int n = scandir(real_name, &namelist, NULL, alphasort);
-	if (n < 0)
+	/* Only executables are completed in the command position */
+	bool_t need_exec = (fb->m_command_box && !fb->m_not_first);
+	fu_list_t *list = fu_list_dir(real_name, 
+			FU_LIST_SORT | (need_exec ? FU_LIST_STAT : 0));
+	if (list == NULL)
 		goto finally;
 
-	for ( int i = 0; i < n; ++i )
+	for ( int i = 0; i < list->m_num; ++i )
 	{
-		char *name = namelist[i]->d_name;
-
-		struct stat st;
-		char *fullname = util_strcat(real_name, "/", name, NULL);
-		int st_ret = stat(fullname, &st);
-		free(fullname);
-		if (st_ret)
-			goto next;
+		char *name = list->m_entries[i].m_name;
+		bool_t is_dir = list->m_entries[i].m_is_dir;
 
 		/* Filter file */
-		if (name[0] == '.' ||
-				strncmp(STR_TO_CPTR(fb->m_pattern), name, STR_BYTE_LEN(fb->m_pattern)))
-			goto next;
-		if (fb->m_command_box && !fb->m_not_first)
-		{
-			if (!(st.st_mode & S_IXUSR))
-				goto next;
-		}
-		if ((fb->m_flags & FILEBOX_ONLY_DIRS) && !S_ISDIR(st.st_mode))
-			goto next;
+		if (strncmp(STR_TO_CPTR(fb->m_pattern), name, STR_BYTE_LEN(fb->m_pattern)))
+			continue;
+		if (need_exec && !(list->m_entries[i].m_mode & S_IXUSR))
+			continue;
+		if ((fb->m_flags & FILEBOX_ONLY_DIRS) && !is_dir)
+			continue;
 
 		/* Escape when in command mode */
 		bool_t escape = FALSE;
@@ -115,7 +108,7 @@ static void filebox_scandir( filebox_t *fb, char *dirname )
 			util_escape_fname(item->m_name, name);
 		else
 			strcpy(item->m_name, name);
-		if (S_ISDIR(st.st_mode))
+		if (is_dir)
 			strcat(item->m_name, "/");
 
 		/* It's the first name */
@@ -132,11 +125,8 @@ static void filebox_scandir( filebox_t *fb, char *dirname )
 			fb->m_names->m_prev->m_next = item;
 			fb->m_names->m_prev = item;
 		}
-
-	next:
-		free(namelist[i]);
 	}
-	free(namelist);
+	fu_list_free(list);
 
 finally:
 	if (real_name != dirname)
@@ -78,13 +78,9 @@ void wnd_move( wnd_t *wnd, wnd_move_style_t style, int x, int y )
 	}
 } /* End of 'wnd_move' function */
 
-/* Low-level character printing */
-static void wnd_putc_impl( wnd_t *wnd, wchar_t ch )
+/* Low-level printing of a character with known display width */
+static void wnd_putc_width( wnd_t *wnd, wchar_t ch, int width )
 {
-	int width = wcwidth(ch);
-	if (width < 0)
-		width = 0;
-
 	/* Obtain position to print to */
 	struct wnd_display_buf_symbol_t *pos = NULL;
 	if (width == 0)
@@ -124,7 +120,16 @@ static void wnd_putc_impl( wnd_t *wnd, wchar_t ch )
 
 	/* Advance cursor */
 	wnd->m_cursor_x += width;
-} /* End of 'wnd_putc' function */
+} /* End of 'wnd_putc_width' function */
+
+/* Low-level character printing */
+static void wnd_putc_impl( wnd_t *wnd, wchar_t ch )
+{
+	int width = wcwidth(ch);
+	if (width < 0)
+		width = 0;
+	wnd_putc_width(wnd, ch, width);
+} /* End of 'wnd_putc_impl' function */
 
 /* Put a special (ACS_*) symbol */
 void wnd_put_special( wnd_t *wnd, wchar_t ch )
@@ -176,14 +181,10 @@ void wnd_putchar( wnd_t *wnd, wnd_print_flags_t flags, wchar_t ch )
 	wnd_putc(wnd, ch);
 } /* End of 'wnd_putchar' function */
 
-/* Print a string */
-void wnd_putstring( wnd_t *wnd, wnd_print_flags_t flags, int right_border,
-		char *str )
+/* Convert right border passed to printing functions to client coordinates */
+static int wnd_print_border( wnd_t *wnd, wnd_print_flags_t flags, 
+		int right_border )
 {
-	assert(wnd);
-	assert(str);
-
-	/* Convert border to client coordinates */
 	if (flags & WND_PRINT_NONCLIENT)
 	{
 		if (right_border <= 0 || right_border >= wnd->m_width)
@@ -193,6 +194,18 @@ void wnd_putstring( wnd_t *wnd, wnd_print_flags_t flags, int right_border,
 	/* Set border if it is not specified */
 	else if (right_border <= 0 || right_border >= wnd->m_client_w)
 		right_border = wnd->m_client_w - 1;
+	return right_border;
+} /* End of 'wnd_print_border' function */
+
+/* Print a string */
+void wnd_putstring( wnd_t *wnd, wnd_print_flags_t flags, int right_border,
+		char *str )
+{
+	assert(wnd);
+	assert(str);
+
+	/* Convert border to client coordinates */
+	right_border = wnd_print_border(wnd, flags, right_border);
 
 	/* Prepare for conversion to unicode */
 	size_t nbytes = strlen(str);
@@ -274,6 +287,50 @@ void wnd_putstring( wnd_t *wnd, wnd_print_flags_t flags, int right_border,
 	}
 } /* End of 'wnd_putstring' function */
 
+/* Print a decoded string. Unlike 'wnd_putstring' it doesn't handle
+ * special characters and never wraps */
+void wnd_put_wide( wnd_t *wnd, wnd_print_flags_t flags, int right_border,
+		str_wide_t *ws )
+{
+	int i, len, avail;
+	bool_t ellipses = FALSE;
+
+	assert(wnd);
+	assert(ws);
+
+	/* Find out how many characters fit */
+	right_border = wnd_print_border(wnd, flags, right_border);
+	avail = right_border - wnd->m_cursor_x + 1;
+	len = ws->m_len;
+	if (ws->m_width > avail)
+	{
+		ellipses = (flags & WND_PRINT_ELLIPSES) != 0;
+		len = str_wide_cut(ws, ellipses ? avail - 3 : avail);
+	}
+
+	/* Print them */
+	for ( i = 0; i < len; i ++ )
+	{
+		wchar_t ch = ws->m_chars[i];
+		if (ch < 0x20)
+			continue;
+
+		if (!(flags & WND_PRINT_NONCLIENT) && !wnd_cursor_in_client(wnd))
+			wnd->m_cursor_x += ws->m_widths[i];
+		else
+			wnd_putc_width(wnd, ch, ws->m_widths[i]);
+	}
+
+	/* Put ellipses */
+	if (ellipses)
+	{
+		wnd_move(wnd, WND_MOVE_NORMAL, right_border - 2, wnd->m_cursor_y);
+		wnd_putchar(wnd, flags, '.');
+		wnd_putchar(wnd, flags, '.');
+		wnd_putchar(wnd, flags, '.');
+	}
+} /* End of 'wnd_put_wide' function */
+
 /* Print a formatted string */
 int wnd_printf( wnd_t *wnd, wnd_print_flags_t flags, int right_border,
 		char *format, ... )
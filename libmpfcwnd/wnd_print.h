@@ -24,6 +24,7 @@
 #define __SG_MPFC_WND_PRINT_H__
 
 #include "types.h"
+#include "mystring.h"
 
 /* Forward declaration of window */
 struct tag_wnd_t;
@@ -112,6 +113,10 @@ void wnd_putchar( struct tag_wnd_t *wnd, wnd_print_flags_t flags, wchar_t ch );
 void wnd_putstring( struct tag_wnd_t *wnd, wnd_print_flags_t flags,
 		int right_border, char *str );
 
+/* Print a decoded string */
+void wnd_put_wide( struct tag_wnd_t *wnd, wnd_print_flags_t flags,
+		int right_border, str_wide_t *ws );
+
 /* Print a formatted string */
 int wnd_printf( struct tag_wnd_t *wnd, wnd_print_flags_t flags,
 		int right_border, char *format, ... );
@@ -21,11 +21,11 @@
  */
 
 #include <ctype.h>
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include "types.h"
 #include "plp.h"
+#include "plp_file.h"
 #include "logger.h"
 #include "pmng.h"
 #include "util.h"
@@ -64,79 +64,66 @@ static int m3u_read_int( char **s )
 /* Parse playlist and handle its contents */
 plp_status_t m3u_for_each_item( char *pl_name, void *ctx, plp_func_t f )
 {
-	char str[1024];
-	bool_t ext_info;
+	char *str;
+	size_t len;
+	bool_t ext_info = FALSE, first = TRUE;
+	song_metadata_t metadata = SONG_METADATA_EMPTY;
 
 	/* Try to open file */
-	FILE *fd = fopen(pl_name, "rt");
+	plp_file_t *fd = plp_file_open(pl_name);
 	if (fd == NULL)
 	{
 		logger_error(m3u_log, 0, _("Unable to read %s file"), pl_name);
 		return PLP_STATUS_FAILED;
 	}
 
-	/* Read file head */
-	fgets(str, sizeof(str), fd);
-	ext_info = !strncmp(str, "#EXTM3U", 7);
-	if (!ext_info)
-		fseek(fd, 0, SEEK_SET);
-		
 	/* Read file contents */
 	plp_status_t res = PLP_STATUS_OK;
-	while (!feof(fd))
+	while (plp_file_next_line(fd, &str, &len))
 	{
-		/* Read file name if no extended info is supplied */
-		if (!ext_info)
+		/* Check file head */
+		if (first)
 		{
-			fgets(str, sizeof(str), fd);
-			if (feof(fd))
-				break;
-			util_del_nl(str, str);
-
-			song_metadata_t metadata = SONG_METADATA_EMPTY;
-			plp_status_t st = f(ctx, str, &metadata);
-			if (st != PLP_STATUS_OK)
+			first = FALSE;
+			ext_info = !strncmp(str, "#EXTM3U", 7);
+			if (ext_info)
+				continue;
+		}
+
+		/* Extended info line. Title points into the file buffer and
+		 * stays valid until the next file name is handled */
+		if (ext_info && !strncmp(str, "#EXTINF:", 8))
+		{
+			/* Extract song length and starting position from string read */
+			char *s = &str[8]; /* skip '#EXTINF:' */
+			song_time_t song_len = SECONDS_TO_TIME(m3u_read_int(&s));
+			song_time_t song_start = -1;
+			if ((*s) == '-')
 			{
-				res = st;
-				break;
+				++s;
+				song_start = SECONDS_TO_TIME(m3u_read_int(&s));
+			}
+			if ((*s) == ',')
+				++s;
+
+			metadata = (song_metadata_t)SONG_METADATA_EMPTY;
+			metadata.m_title = ((*s) ? s : NULL);
+			metadata.m_len = song_len;
+			if (song_start >= 0)
+			{
+				metadata.m_start_time = song_start;
+				metadata.m_end_time = song_start + song_len - 1;
 			}
 			continue;
 		}
-		
-		/* Read song length and title string */
-		fgets(str, sizeof(str), fd);
-		if (feof(fd) || strlen(str) < 10)
-			break;
 
-		/* Extract song length and starting position from string read */
-		char *s = &str[8]; /* skip '#EXTINF:' */
-		song_time_t song_len = SECONDS_TO_TIME(m3u_read_int(&s));
-		song_time_t song_start = -1;
-		if ((*s) == '-')
-		{
-			++s;
-			song_start = SECONDS_TO_TIME(m3u_read_int(&s));
-		}
-		if ((*s) == ',')
-			++s;
-		char *title = strdup(s);
-		util_del_nl(title, title);
-
-		/* Read song file name */
-		fgets(str, sizeof(str), fd);
-		util_del_nl(str, str);
-
-		song_metadata_t metadata = SONG_METADATA_EMPTY;
-		metadata.m_title = title;
-		metadata.m_len = song_len;
-		if (song_start >= 0)
-		{
-			metadata.m_start_time = song_start;
-			metadata.m_end_time = song_start + song_len - 1;
-		}
-		plp_status_t st = f(ctx, str, &metadata);
-		free(title);
+		/* Skip empty lines and comments */
+		if (len == 0 || (*str) == '#')
+			continue;
 
+		/* Handle song file name */
+		plp_status_t st = f(ctx, str, &metadata);
+		metadata = (song_metadata_t)SONG_METADATA_EMPTY;
 		if (st != PLP_STATUS_OK)
 		{
 			res = st;
@@ -145,7 +132,7 @@ plp_status_t m3u_for_each_item( char *pl_name, void *ctx, plp_func_t f )
 	}
 
 	/* Close file */
-	fclose(fd);
+	plp_file_close(fd);
 	return res;
 } /* End of 'm3u_for_each_item' function */
 
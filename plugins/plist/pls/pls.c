@@ -20,12 +20,12 @@
  * MA 02111-1307, USA.
  */
 
-#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 #include "types.h"
 #include "plp.h"
+#include "plp_file.h"
 #include "logger.h"
 #include "pmng.h"
 #include "util.h"
@@ -47,22 +47,29 @@ void pls_get_formats( char *extensions, char *content_type )
 		strcpy(content_type, "");
 } /* End of 'pls_get_formats' function */
 
+/* Maximal supported entry index */
+#define PLS_MAX_ENTRIES (1 << 22)
+
+/* Play list entry. Strings point into the file buffer */
+typedef struct
+{
+	char *m_name;
+	char *m_title;
+	int m_len;
+} pls_entry_t;
+
 /* Parse playlist and handle its contents */
 plp_status_t pls_for_each_item( char *pl_name, void *ctx, plp_func_t f )
 {
-	int num = 0;
-	char str[1024];
-	int num_entries;
-	struct pls_entry_t
-	{
-		char *name;
-		char *title;
-		int len;
-	} *entries;
+	char *str;
+	size_t len;
+	int num_entries = -1;
+	pls_entry_t *entries = NULL;
+	int entries_size = 0, max_index = -1;
 	int i;
 
 	/* Try to open file */
-	FILE *fd = fopen(pl_name, "rt");
+	plp_file_t *fd = plp_file_open(pl_name);
 	if (fd == NULL)
 	{
 		logger_error(pls_log, 0, _("Unable to open file %s"), pl_name);
@@ -70,42 +77,25 @@ plp_status_t pls_for_each_item( char *pl_name, void *ctx, plp_func_t f )
 	}
 
 	/* Read header */
-	fgets(str, sizeof(str), fd);
-	util_del_nl(str, str);
+	do
+	{
+		if (!plp_file_next_line(fd, &str, &len))
+		{
+			str = "";
+			break;
+		}
+	} while (len == 0);
 	if (strcasecmp(str, "[playlist]"))
 	{
-		fclose(fd);
+		plp_file_close(fd);
 		logger_error(pls_log, 1, _("%s: missing play list header"), 
 				pl_name);
 		return PLP_STATUS_FAILED;
 	}
 
-	/* Read number of entries */
-	fgets(str, sizeof(str), fd);
-	util_del_nl(str, str);
-	if (strncasecmp(str, "numberofentries=", 16))
-	{
-		fclose(fd);
-		logger_error(pls_log, 1, _("%s: missing `numberofentries' tag"), 
-				pl_name);
-		return 0;
-	}
-	num_entries = atoi(strchr(str, '=') + 1);
-
-	/* Allocate memory for play list entries */
-	entries = (struct pls_entry_t *)malloc(sizeof(*entries) * num_entries);
-	if (entries == NULL)
-	{
-		fclose(fd);
-		logger_error(pls_log, 0, _("No enough memory"));
-		return 0;
-	}
-	memset(entries, 0, sizeof(*entries) * num_entries);
-
 	/* Read data */
-	while (!feof(fd))
+	while (plp_file_next_line(fd, &str, &len))
 	{
-		char *value;
 		enum
 		{
 			FILE_NAME,
@@ -114,11 +104,14 @@ plp_status_t pls_for_each_item( char *pl_name, void *ctx, plp_func_t f )
 		} type;
 		int index;
 		char *s = str;
-		
-		/* Read line */
-		fgets(str, sizeof(str), fd);
-		util_del_nl(str, str);
 
+		/* Number of entries may appear anywhere in the section */
+		if (!strncasecmp(s, "numberofentries=", 16))
+		{
+			num_entries = atoi(s + 16);
+			continue;
+		}
+		
 		/* Determine line type */
 		if (!strncasecmp(s, "File", 4))
 		{
@@ -142,14 +135,14 @@ plp_status_t pls_for_each_item( char *pl_name, void *ctx, plp_func_t f )
 
 		/* Extract index */
 		index = 0;
-		while (isdigit(*s))
+		while (isdigit(*s) && index <= PLS_MAX_ENTRIES)
 		{
 			index *= 10;
 			index += ((*s) - '0');
 			s ++;
 		}
 		index --;
-		if (index >= num_entries)
+		if (index < 0 || index >= PLS_MAX_ENTRIES)
 			continue;
 
 		/* Extract value */
@@ -157,53 +150,62 @@ plp_status_t pls_for_each_item( char *pl_name, void *ctx, plp_func_t f )
 			continue;
 		else
 			s ++;
-		value = strdup(s);
+
+		/* Enlarge entries array */
+		if (index >= entries_size)
+		{
+			int new_size = (entries_size == 0 ? 64 : entries_size);
+			while (new_size <= index)
+				new_size *= 2;
+			pls_entry_t *new_entries = (pls_entry_t *)realloc(entries, 
+					sizeof(*entries) * new_size);
+			if (new_entries == NULL)
+			{
+				logger_error(pls_log, 0, _("No enough memory"));
+				break;
+			}
+			entries = new_entries;
+			memset(&entries[entries_size], 0, 
+					sizeof(*entries) * (new_size - entries_size));
+			entries_size = new_size;
+		}
+		if (index > max_index)
+			max_index = index;
 
 		/* Save entry */
 		if (type == FILE_NAME)
-			entries[index].name = value;
+			entries[index].m_name = s;
 		else if (type == TITLE)
-			entries[index].title = value;
+			entries[index].m_title = s;
 		else 
-		{
-			entries[index].len = atoi(value);
-			free(value);
-		}
+			entries[index].m_len = atoi(s);
 	}
 
-	/* Close file */
-	fclose(fd);
-
 	/* Add the value to the play list */
+	if (num_entries < 0 || num_entries > max_index + 1)
+		num_entries = max_index + 1;
 	plp_status_t res = PLP_STATUS_OK;
 	for ( i = 0; i < num_entries; i ++ )
 	{
-		char *name = entries[i].name;
-		char *title = entries[i].title;
-		int len = entries[i].len;
+		char *name = entries[i].m_name;
+		int len = entries[i].m_len;
 
 		if (name != NULL)
 		{
 			song_metadata_t metadata = SONG_METADATA_EMPTY;
-			metadata.m_title = title;
+			metadata.m_title = entries[i].m_title;
 			metadata.m_len = len < 0 ? 0 : SECONDS_TO_TIME(len);
 			plp_status_t st = f(ctx, name, &metadata);
-
-			/* Free this entry */
-			free(name);
-			if (title != NULL)
-				free(title);
-
 			if (st != PLP_STATUS_OK)
 			{
 				res = st;
 				break;
 			}
 		}
-		else if (title != NULL)
-			free(title);
 	}
-	free(entries);
+	if (entries != NULL)
+		free(entries);
+	plp_file_close(fd);
 	return res;
 } /* End of 'pls_for_each_item' function */
 
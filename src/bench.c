@@ -0,0 +1,714 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Benchmarks implementation.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+#include <errno.h>
+#include <ftw.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <glib.h>
+#include <json-glib/json-glib.h>
+#include "types.h"
+#include "bench.h"
+#include "json_helpers.h"
+#include "player.h"
+#include "plist.h"
+#include "server_client.h"
+#include "snapshot.h"
+#include "test.h"
+#include "util.h"
+
+/* Parameters of the generated tracks (8 kHz mono 8-bit PCM) */
+#define BENCH_RATE 8000
+#define BENCH_TRACK_SECONDS 1
+
+/* Every this album is stored as an image with a cue sheet */
+#define BENCH_CUE_EVERY 8
+
+/* Benchmark context */
+typedef struct
+{
+	/* Temporary directory for the generated library and exports */
+	char m_work_dir[MAX_FILE_NAME];
+
+	/* Library directory */
+	char m_lib_dir[MAX_FILE_NAME];
+
+	/* List with the added library */
+	plist_t *m_pl;
+
+	/* Number of repetitions for the fast operations */
+	int m_repeat;
+
+	/* Results */
+	JsonArray *m_results;
+} bench_ctx_t;
+
+/* Synthetic library generator state */
+typedef struct
+{
+	unsigned m_seed;
+	int m_depth;
+	int m_num_tracks, m_num_dirs, m_num_cues;
+	int64_t m_size;
+} bench_gen_t;
+
+/* Words for the generated tags. Some are not ASCII to make sorting and 
+ * searching deal with multibyte characters */
+static char *bench_words[] = 
+{
+	"Black", "Blue", "Love", "Night", "Day", "River", "Stone", "Fire", 
+	"Rain", "Heart", "Road", "Dream", "Silver", "Golden", "Sun", "Moon",
+	"Electric", "Lonely", "Midnight", "Summer", "Winter", "Ghost", "Wild",
+	"Song", "Machine", "Garden", "Ocean", "City", "Train", "Angel",
+	"Café", "Noël", "Ночь", "Звезда", "Über", "Mañana", "Ljós", "Été"
+};
+#define BENCH_NUM_WORDS (sizeof(bench_words) / sizeof(bench_words[0]))
+
+/* Genres; the first ones are more frequent */
+static char *bench_genres[] =
+{
+	"Rock", "Pop", "Jazz", "Electronic", "Classical", "Folk", "Blues",
+	"Metal", "Hip-Hop", "Reggae", "Soundtrack", "Ambient"
+};
+#define BENCH_NUM_GENRES (sizeof(bench_genres) / sizeof(bench_genres[0]))
+
+/* Get current time in milliseconds */
+static double bench_now( void )
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000. + ts.tv_nsec / 1000000.;
+} /* End of 'bench_now' function */
+
+/* Get a random number in [0, max) */
+static int bench_rand( bench_gen_t *g, int max )
+{
+	return rand_r(&g->m_seed) % max;
+} /* End of 'bench_rand' function */
+
+/* Generate a few words */
+static void bench_gen_words( bench_gen_t *g, char *buf, size_t size, 
+		int min, int max )
+{
+	int i, num = min + bench_rand(g, max - min + 1);
+
+	buf[0] = 0;
+	for ( i = 0; i < num; i ++ )
+	{
+		size_t len = strlen(buf);
+		snprintf(buf + len, size - len, "%s%s", (i == 0) ? "" : " ",
+				bench_words[bench_rand(g, BENCH_NUM_WORDS)]);
+	}
+} /* End of 'bench_gen_words' function */
+
+/* Write a little endian number */
+static void bench_put( FILE *fd, dword val, int bytes )
+{
+	for ( ; bytes > 0; bytes --, val >>= 8 )
+		fputc(val & 0xFF, fd);
+} /* End of 'bench_put' function */
+
+/* Write a WAV file with RIFF INFO tags. 'tags' are pairs of four
+ * character chunk identifiers and values terminated with NULL */
+static bool_t bench_write_wav( bench_gen_t *g, char *name, int seconds,
+		char **tags )
+{
+	FILE *fd;
+	dword info_size = 4, data_size = seconds * BENCH_RATE, i;
+	char **t;
+
+	fd = fopen(name, "wb");
+	if (fd == NULL)
+		return FALSE;
+
+	/* Calculate INFO list size: every value is NUL terminated and 
+	 * padded to even length */
+	for ( t = tags; *t != NULL; t += 2 )
+		info_size += 8 + ((strlen(t[1]) + 2) & ~1);
+
+	/* Headers */
+	fwrite("RIFF", 1, 4, fd);
+	bench_put(fd, 4 + (8 + 16) + (8 + info_size) + (8 + data_size), 4);
+	fwrite("WAVEfmt ", 1, 8, fd);
+	bench_put(fd, 16, 4);
+	bench_put(fd, 1, 2);
+	bench_put(fd, 1, 2);
+	bench_put(fd, BENCH_RATE, 4);
+	bench_put(fd, BENCH_RATE, 4);
+	bench_put(fd, 1, 2);
+	bench_put(fd, 8, 2);
+
+	/* Tags */
+	fwrite("LIST", 1, 4, fd);
+	bench_put(fd, info_size, 4);
+	fwrite("INFO", 1, 4, fd);
+	for ( t = tags; *t != NULL; t += 2 )
+	{
+		dword len = (strlen(t[1]) + 2) & ~1;
+		fwrite(t[0], 1, 4, fd);
+		bench_put(fd, len, 4);
+		fwrite(t[1], 1, strlen(t[1]), fd);
+		for ( i = strlen(t[1]); i < len; i ++ )
+			fputc(0, fd);
+	}
+
+	/* Silence */
+	fwrite("data", 1, 4, fd);
+	bench_put(fd, data_size, 4);
+	for ( i = 0; i < data_size; i ++ )
+		fputc(0x80, fd);
+
+	g->m_size += 8 + 4 + (8 + 16) + (8 + info_size) + (8 + data_size);
+	return (fclose(fd) == 0);
+} /* End of 'bench_write_wav' function */
+
+/* Generate an album */
+static bool_t bench_gen_album( bench_gen_t *g, char *lib_dir, char *artist,
+		int index )
+{
+	char dir[MAX_FILE_NAME], name[MAX_FILE_NAME];
+	char album[128], title[128], year[8], track[8];
+	char *genre;
+	int i, num_tracks, len;
+	bool_t as_cue;
+	FILE *cue = NULL;
+
+	/* Choose album parameters */
+	bench_gen_words(g, album, sizeof(album), 1, 3);
+	genre = bench_genres[bench_rand(g, BENCH_NUM_GENRES) * 
+		bench_rand(g, BENCH_NUM_GENRES) / BENCH_NUM_GENRES];
+	snprintf(year, sizeof(year), "%d", 1960 + bench_rand(g, 50));
+	num_tracks = 6 + bench_rand(g, 9);
+	as_cue = ((index % BENCH_CUE_EVERY) == BENCH_CUE_EVERY - 1);
+
+	/* Make directory: artist, album, then discs */
+	len = snprintf(dir, sizeof(dir), "%s", lib_dir);
+	for ( i = 0; i < g->m_depth; i ++ )
+	{
+		if (i == 0)
+			len += snprintf(dir + len, sizeof(dir) - len, "/%s", artist);
+		else if (i == 1)
+			len += snprintf(dir + len, sizeof(dir) - len, "/%s (%s)", 
+					album, year);
+		else
+			len += snprintf(dir + len, sizeof(dir) - len, "/CD%d", i - 1);
+	}
+	if (g_mkdir_with_parents(dir, 0755))
+		return FALSE;
+	g->m_num_dirs ++;
+
+	/* Write cue sheet header */
+	if (as_cue)
+	{
+		snprintf(name, sizeof(name), "%s/%s - %s %d.cue", dir, artist, 
+				album, index);
+		cue = fopen(name, "wt");
+		if (cue == NULL)
+			return FALSE;
+		fprintf(cue, "REM GENRE \"%s\"\nREM DATE %s\nPERFORMER \"%s\"\n"
+				"TITLE \"%s\"\nFILE \"%s - %s %d.wav\" WAVE\n", genre, year, 
+				artist, album, artist, album, index);
+		g->m_num_cues ++;
+	}
+
+	/* Write tracks */
+	for ( i = 0; i < num_tracks; i ++ )
+	{
+		snprintf(track, sizeof(track), "%d", i + 1);
+		bench_gen_words(g, title, sizeof(title), 1, 4);
+		if (as_cue)
+		{
+			int start = i * BENCH_TRACK_SECONDS;
+			fprintf(cue, "  TRACK %02d AUDIO\n    TITLE \"%s\"\n"
+					"    PERFORMER \"%s\"\n    INDEX 01 %02d:%02d:00\n",
+					i + 1, title, artist, start / 60, start % 60);
+		}
+		else
+		{
+			char *tags[] = { "INAM", title, "IART", artist, "IPRD", album,
+				"ICRD", year, "IGNR", genre, "ITRK", track, NULL };
+			snprintf(name, sizeof(name), "%s/%02d - %s.wav", dir, i + 1, 
+					title);
+			if (!bench_write_wav(g, name, BENCH_TRACK_SECONDS, tags))
+				return FALSE;
+		}
+		g->m_num_tracks ++;
+	}
+
+	/* Write image for the cue sheet */
+	if (as_cue)
+	{
+		char *tags[] = { "IART", artist, "IPRD", album, NULL };
+
+		fclose(cue);
+		snprintf(name, sizeof(name), "%s/%s - %s %d.wav", dir, artist, 
+				album, index);
+		if (!bench_write_wav(g, name, num_tracks * BENCH_TRACK_SECONDS, tags))
+			return FALSE;
+	}
+	return TRUE;
+} /* End of 'bench_gen_album' function */
+
+/* Generate a library with the given number of tracks */
+static bool_t bench_generate( bench_gen_t *g, char *lib_dir, int num_files )
+{
+	int albums = 0;
+
+	while (g->m_num_tracks < num_files && !test_stop_job)
+	{
+		char artist[128];
+		int i, num_albums = 1 + bench_rand(g, 4);
+
+		bench_gen_words(g, artist, sizeof(artist), 1, 3);
+		for ( i = 0; i < num_albums && g->m_num_tracks < num_files; i ++ )
+		{
+			if (!bench_gen_album(g, lib_dir, artist, albums ++))
+			{
+				logger_error(player_log, 0, _("Unable to generate %s: %s"), 
+						lib_dir, strerror(errno));
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+} /* End of 'bench_generate' function */
+
+/* Remove a file while walking a directory */
+static int bench_remove_file( const char *name, const struct stat *st,
+		int flag, struct FTW *ftw )
+{
+	remove(name);
+	return 0;
+} /* End of 'bench_remove_file' function */
+
+/* Store an operation result */
+static void bench_report( bench_ctx_t *ctx, char *name, int count, 
+		double time )
+{
+	JsonObject *js = json_object_new();
+
+	json_object_set_string_member(js, "name", name);
+	json_object_set_int_member(js, "count", count);
+	json_object_set_int_member(js, "songs", 
+			(ctx->m_pl == NULL) ? 0 : ctx->m_pl->m_len);
+	json_object_set_double_member(js, "total_ms", time);
+	json_object_set_double_member(js, "mean_ms", time / count);
+	json_array_add_object_element(ctx->m_results, js);
+
+	logger_message(player_log, 0, _("Benchmark %s: %.3f ms"), name, 
+			time / count);
+} /* End of 'bench_report' function */
+
+/* Add library to a new list and read songs info */
+static bool_t bench_library_load( bench_ctx_t *ctx )
+{
+	plist_set_t *set;
+	double t;
+
+	ctx->m_pl = plist_new(3);
+	if (ctx->m_pl == NULL)
+		return FALSE;
+	set = plist_set_new(TRUE);
+	if (set == NULL)
+		return FALSE;
+
+	/* Scan directories only; info is read separately */
+	plist_set_add(set, ctx->m_lib_dir);
+	set->m_lazy_info = TRUE;
+	t = bench_now();
+	plist_add_set(ctx->m_pl, set);
+	t = bench_now() - t;
+	plist_set_free(set);
+	bench_report(ctx, "add_dir", 1, t);
+
+	t = bench_now();
+	plist_need_info(ctx->m_pl, 0, ctx->m_pl->m_len - 1, FALSE);
+	if (!plist_wait_info(ctx->m_pl, 0, ctx->m_pl->m_len - 1, 
+				&test_stop_job))
+		return FALSE;
+	bench_report(ctx, "load_info", 1, bench_now() - t);
+	return TRUE;
+} /* End of 'bench_library_load' function */
+
+/* Time sorting and searching */
+static void bench_library( bench_ctx_t *ctx )
+{
+	static struct { char *m_name; int m_criteria; } sorts[] =
+	{
+		{ "sort_title", PLIST_SORT_BY_TITLE },
+		{ "sort_name", PLIST_SORT_BY_NAME },
+		{ "sort_path", PLIST_SORT_BY_PATH },
+		{ "sort_track", PLIST_SORT_BY_TRACK }
+	}, searches[] = 
+	{
+		{ "search_title", PLIST_SEARCH_TITLE },
+		{ "search_name", PLIST_SEARCH_NAME },
+		{ "search_artist", PLIST_SEARCH_ARTIST },
+		{ "search_album", PLIST_SEARCH_ALBUM },
+		{ "search_year", PLIST_SEARCH_YEAR },
+		{ "search_genre", PLIST_SEARCH_GENRE },
+		{ "search_track", PLIST_SEARCH_TRACK }
+	};
+	plist_t *pl = ctx->m_pl;
+	int i, j;
+
+	/* Sort whole list by each criterion. The list order changes every
+	 * time, so repeating is not needed */
+	for ( i = 0; i < sizeof(sorts) / sizeof(sorts[0]) && !test_stop_job; 
+			i ++ )
+	{
+		double t = bench_now();
+		plist_sort_bounds(pl, 0, pl->m_len - 1, sorts[i].m_criteria);
+		bench_report(ctx, sorts[i].m_name, 1, bench_now() - t);
+	}
+
+	/* Search for a string which is not found, so all songs are checked */
+	for ( i = 0; i < sizeof(searches) / sizeof(searches[0]) && 
+			!test_stop_job; i ++ )
+	{
+		double t = bench_now();
+		for ( j = 0; j < ctx->m_repeat; j ++ )
+			plist_search(pl, "no such song", 1, searches[i].m_criteria);
+		bench_report(ctx, searches[i].m_name, ctx->m_repeat, 
+				bench_now() - t);
+	}
+} /* End of 'bench_library' function */
+
+/* Time state saving and loading and play list exports */
+static void bench_state( bench_ctx_t *ctx )
+{
+	static char *exports[] = { "m3u", "pls" };
+	plist_t *pl = ctx->m_pl, *loaded;
+	snapshot_state_t state;
+	song_t **songs;
+	char name[MAX_FILE_NAME], op[32];
+	int i, num;
+	double t;
+
+	/* Save snapshot */
+	snprintf(name, sizeof(name), "%s/snapshot", ctx->m_work_dir);
+	memset(&state, 0, sizeof(state));
+	state.m_cur_song = -1;
+	state.m_start = state.m_end = -1;
+	plist_lock(pl);
+	num = pl->m_len;
+	songs = (song_t **)malloc(sizeof(*songs) * (num + 1));
+	if (songs == NULL)
+	{
+		plist_unlock(pl);
+		return;
+	}
+	pseq_get_range(pl->m_seq, 0, num, songs);
+	plist_unlock(pl);
+	t = bench_now();
+	snapshot_save(name, songs, num, &state);
+	bench_report(ctx, "save_state", 1, bench_now() - t);
+	free(songs);
+
+	/* Load it */
+	loaded = plist_new(3);
+	if (loaded != NULL)
+	{
+		t = bench_now();
+		snapshot_load(name, loaded, &state);
+		bench_report(ctx, "load_state", 1, bench_now() - t);
+		plist_free(loaded);
+	}
+
+	/* Export list and add it back */
+	for ( i = 0; i < sizeof(exports) / sizeof(exports[0]) && !test_stop_job; 
+			i ++ )
+	{
+		snprintf(name, sizeof(name), "%s/list.%s", ctx->m_work_dir, 
+				exports[i]);
+		snprintf(op, sizeof(op), "save_%s", exports[i]);
+		t = bench_now();
+		plist_save(pl, name);
+		bench_report(ctx, op, 1, bench_now() - t);
+
+		loaded = plist_new(3);
+		if (loaded == NULL)
+			continue;
+		snprintf(op, sizeof(op), "load_%s", exports[i]);
+		t = bench_now();
+		plist_add(loaded, name);
+		bench_report(ctx, op, 1, bench_now() - t);
+		plist_free(loaded);
+	}
+} /* End of 'bench_state' function */
+
+/* Time play list rendering. It is done by the main thread, so just send 
+ * a request and wait */
+static void bench_ui( bench_ctx_t *ctx )
+{
+	bench_render_t *r;
+	bool_t done = FALSE;
+
+	if (player_wnd == NULL)
+		return;
+	r = (bench_render_t *)malloc(sizeof(*r));
+	if (r == NULL)
+		return;
+	pthread_mutex_init(&r->m_mutex, NULL);
+	r->m_pl = ctx->m_pl;
+	r->m_frames = ctx->m_repeat * 20;
+	r->m_time = 0;
+	r->m_done = r->m_abandoned = FALSE;
+	wnd_msg_send(player_wnd, "user", 
+			wnd_msg_user_new(PLAYER_MSG_BENCH_RENDER, r));
+
+	/* Wait. If we are stopped the request is freed by the handler */
+	for ( ;; )
+	{
+		pthread_mutex_lock(&r->m_mutex);
+		done = r->m_done;
+		if (!done && test_stop_job)
+			r->m_abandoned = TRUE;
+		pthread_mutex_unlock(&r->m_mutex);
+		if (done || test_stop_job)
+			break;
+		util_wait();
+	}
+	if (!done)
+		return;
+	bench_report(ctx, "render", r->m_frames, r->m_time);
+	pthread_mutex_destroy(&r->m_mutex);
+	free(r);
+} /* End of 'bench_ui' function */
+
+/* Handle rendering request */
+void bench_render( bench_render_t *r )
+{
+	int i;
+
+	pthread_mutex_lock(&r->m_mutex);
+	if (r->m_abandoned)
+	{
+		pthread_mutex_unlock(&r->m_mutex);
+		pthread_mutex_destroy(&r->m_mutex);
+		free(r);
+		return;
+	}
+
+	/* Scroll a screen down every frame */
+	for ( i = 0; i < r->m_frames; i ++ )
+	{
+		double t;
+
+		plist_move(r->m_pl, (r->m_pl->m_len == 0) ? 0 :
+				(i * PLIST_HEIGHT) % r->m_pl->m_len, FALSE);
+		t = bench_now();
+		plist_display(r->m_pl, player_wnd);
+		r->m_time += bench_now() - t;
+	}
+	r->m_done = TRUE;
+	pthread_mutex_unlock(&r->m_mutex);
+
+	/* Get the real list back on the screen */
+	wnd_invalidate(player_wnd);
+} /* End of 'bench_render' function */
+
+/* Time building the server reply with the play list */
+static void bench_server( bench_ctx_t *ctx )
+{
+	double t = bench_now();
+	int i;
+
+	for ( i = 0; i < ctx->m_repeat; i ++ )
+	{
+		JsonNode *node;
+		size_t len;
+		char *msg;
+
+		plist_lock(ctx->m_pl);
+		node = js_make_array_node(server_conn_playlist_to_json(ctx->m_pl));
+		plist_unlock(ctx->m_pl);
+		msg = js_to_string(node, &len);
+		g_free(msg);
+		json_node_free(node);
+	}
+	bench_report(ctx, "server_get_playlist", ctx->m_repeat, bench_now() - t);
+} /* End of 'bench_server' function */
+
+/* Check if suite is enabled */
+static bool_t bench_suite_enabled( char *suites, char *name )
+{
+	char **list = g_strsplit(suites, ",", -1), **s;
+	bool_t found = FALSE;
+
+	for ( s = list; *s != NULL && !found; s ++ )
+	{
+		g_strstrip(*s);
+		found = (!strcmp(*s, "all") || !strcmp(*s, name));
+	}
+	g_strfreev(list);
+	return found;
+} /* End of 'bench_suite_enabled' function */
+
+/* Write results */
+static bool_t bench_save( bench_ctx_t *ctx, char *suites, bench_gen_t *g,
+		bool_t generated )
+{
+	JsonObject *js = json_object_new(), *lib = json_object_new();
+	char *name = cfg_get_var(cfg_list, "bench-output");
+	JsonNode *node;
+	char *str;
+	size_t len;
+	FILE *fd;
+
+	json_object_set_string_member(js, "version", VERSION);
+	json_object_set_string_member(js, "suite", suites);
+	json_object_set_int_member(js, "date", time(NULL));
+	json_object_set_string_member(lib, "path", ctx->m_lib_dir);
+	json_object_set_boolean_member(lib, "generated", generated);
+	if (generated)
+	{
+		json_object_set_int_member(lib, "tracks", g->m_num_tracks);
+		json_object_set_int_member(lib, "dirs", g->m_num_dirs);
+		json_object_set_int_member(lib, "cue_sheets", g->m_num_cues);
+		json_object_set_int_member(lib, "depth", g->m_depth);
+		json_object_set_int_member(lib, "seed", 
+				cfg_get_var_int(cfg_list, "bench-seed"));
+		json_object_set_int_member(lib, "size", g->m_size);
+	}
+	json_object_set_object_member(js, "library", lib);
+	json_object_set_array_member(js, "results", ctx->m_results);
+	ctx->m_results = NULL;
+
+	node = js_make_node(js);
+	str = js_to_string(node, &len);
+	json_node_free(node);
+	if (name == NULL || !strcmp(name, ""))
+		name = "mpfc-bench.json";
+	fd = fopen(name, "wt");
+	if (fd == NULL)
+	{
+		logger_error(player_log, 0, _("Unable to write %s: %s"), name, 
+				strerror(errno));
+		g_free(str);
+		return FALSE;
+	}
+	fwrite(str, 1, len, fd);
+	fputc('\n', fd);
+	fclose(fd);
+	g_free(str);
+	logger_message(player_log, 0, _("Benchmark results are saved to %s"), 
+			name);
+	return TRUE;
+} /* End of 'bench_save' function */
+
+/* Run benchmark suites */
+bool_t bench_run( char *suites )
+{
+	static char *known[] = { "all", "library", "state", "ui", "server" };
+	bench_ctx_t ctx;
+	bench_gen_t g;
+	char *lib_dir = cfg_get_var(cfg_list, "bench-dir");
+	char *tmp = getenv("TMPDIR");
+	char **list, **s;
+	bool_t generated = FALSE, ret = FALSE;
+
+	/* Check suites names */
+	list = g_strsplit(suites, ",", -1);
+	for ( s = list; *s != NULL; s ++ )
+	{
+		int i;
+
+		g_strstrip(*s);
+		for ( i = 0; i < sizeof(known) / sizeof(known[0]); i ++ )
+			if (!strcmp(*s, known[i]))
+				break;
+		if (i == sizeof(known) / sizeof(known[0]))
+		{
+			logger_error(player_log, 0, _("Unknown benchmark suite %s"), *s);
+			g_strfreev(list);
+			return FALSE;
+		}
+	}
+	g_strfreev(list);
+
+	/* Make work directory */
+	memset(&ctx, 0, sizeof(ctx));
+	memset(&g, 0, sizeof(g));
+	snprintf(ctx.m_work_dir, sizeof(ctx.m_work_dir), "%s/mpfc-bench-XXXXXX",
+			(tmp == NULL) ? "/tmp" : tmp);
+	if (mkdtemp(ctx.m_work_dir) == NULL)
+	{
+		logger_error(player_log, 0, _("Unable to create %s: %s"), 
+				ctx.m_work_dir, strerror(errno));
+		return FALSE;
+	}
+	ctx.m_repeat = cfg_get_var_int(cfg_list, "bench-repeat");
+	if (ctx.m_repeat <= 0)
+		ctx.m_repeat = 1;
+	ctx.m_results = json_array_new();
+
+	/* Generate library or use the given one */
+	if (lib_dir != NULL && strcmp(lib_dir, ""))
+		util_strncpy(ctx.m_lib_dir, lib_dir, sizeof(ctx.m_lib_dir));
+	else
+	{
+		double t;
+
+		snprintf(ctx.m_lib_dir, sizeof(ctx.m_lib_dir), "%s/library", 
+				ctx.m_work_dir);
+		g.m_seed = cfg_get_var_int(cfg_list, "bench-seed");
+		g.m_depth = cfg_get_var_int(cfg_list, "bench-depth");
+		logger_message(player_log, 0, _("Generating library in %s"), 
+				ctx.m_lib_dir);
+		t = bench_now();
+		if (!bench_generate(&g, ctx.m_lib_dir, 
+					cfg_get_var_int(cfg_list, "bench-files")))
+			goto finally;
+		bench_report(&ctx, "generate", 1, bench_now() - t);
+		generated = TRUE;
+	}
+
+	/* Run suites. All of them need the library loaded */
+	if (test_stop_job || !bench_library_load(&ctx))
+		goto finally;
+	if (bench_suite_enabled(suites, "library") && !test_stop_job)
+		bench_library(&ctx);
+	if (bench_suite_enabled(suites, "state") && !test_stop_job)
+		bench_state(&ctx);
+	if (bench_suite_enabled(suites, "ui") && !test_stop_job)
+		bench_ui(&ctx);
+	if (bench_suite_enabled(suites, "server") && !test_stop_job)
+		bench_server(&ctx);
+	if (!test_stop_job)
+		ret = bench_save(&ctx, suites, &g, generated);
+
+finally:
+	if (ctx.m_pl != NULL)
+		plist_free(ctx.m_pl);
+	if (ctx.m_results != NULL)
+		json_array_unref(ctx.m_results);
+	nftw(ctx.m_work_dir, bench_remove_file, 16, FTW_DEPTH | FTW_PHYS);
+	return ret;
+} /* End of 'bench_run' function */
+
+/* End of 'bench.c' file */
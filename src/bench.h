@@ -0,0 +1,65 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Interface for benchmarks.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+#ifndef __SG_MPFC_BENCH_H__
+#define __SG_MPFC_BENCH_H__
+
+#include <pthread.h>
+#include "types.h"
+#include "main_types.h"
+
+/*
+ * Benchmarks time the operations whose speed depends on the library size.
+ * Unless 'bench-dir' points to an existing library, a synthetic one is
+ * generated first: WAV files with RIFF INFO tags laid out as
+ * artist/album directories, with some albums stored as a single image
+ * and a cue sheet. Results are written to 'bench-output' as JSON, so
+ * they may be compared between releases.
+ */
+
+/* Request for timing play list rendering in the main thread */
+typedef struct
+{
+	pthread_mutex_t m_mutex;
+
+	/* List to render and number of frames */
+	plist_t *m_pl;
+	int m_frames;
+
+	/* Total time in milliseconds */
+	double m_time;
+
+	/* Whether rendering is finished and whether the benchmark thread
+	 * does not wait for it any more */
+	bool_t m_done, m_abandoned;
+} bench_render_t;
+
+/* Run benchmark suites. 'suites' is a comma separated list of 'library',
+ * 'state', 'ui', 'server' or 'all' */
+bool_t bench_run( char *suites );
+
+/* Handle rendering request (called from the player window) */
+void bench_render( bench_render_t *r );
+
+#endif
+
+/* End of 'bench.h' file */
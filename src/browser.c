@@ -28,7 +28,9 @@
 #include <sys/types.h>
 #include "types.h"
 #include "browser.h"
+#include "file_utils.h"
 #include "help_screen.h"
+#include "ingest.h"
 #include "metadata_io.h"
 #include "player.h"
 #include "plist.h"
@@ -114,6 +116,10 @@ bool_t fb_construct( browser_t *fb, wnd_t *parent, char *dir )
 	fb->m_search_mode = FALSE;
 	strcpy(fb->m_search_str, "");
 	fb->m_search_str_len = 0;
+	pthread_mutex_init(&fb->m_info_mutex, NULL);
+	pthread_cond_init(&fb->m_info_cond, NULL);
+	fb->m_info_tid = 0;
+	fb->m_info_end = FALSE;
 	fb_load_files(fb);
 	wnd->m_cursor_hidden = TRUE;
 	return TRUE;
@@ -122,9 +128,24 @@ bool_t fb_construct( browser_t *fb, wnd_t *parent, char *dir )
 /* Browser destructor */
 void fb_destructor( wnd_t *wnd )
 {
-	util_strncpy(player_fb_dir, ((browser_t *)wnd)->m_cur_dir, 
-			sizeof(player_fb_dir));
-	fb_free_files((browser_t *)wnd);
+	browser_t *fb = (browser_t *)wnd;
+
+	util_strncpy(player_fb_dir, fb->m_cur_dir, sizeof(player_fb_dir));
+
+	/* Stop info loading thread */
+	if (fb->m_info_tid)
+	{
+		pthread_mutex_lock(&fb->m_info_mutex);
+		fb->m_info_end = TRUE;
+		pthread_cond_signal(&fb->m_info_cond);
+		pthread_mutex_unlock(&fb->m_info_mutex);
+		pthread_join(fb->m_info_tid, NULL);
+		fb->m_info_tid = 0;
+	}
+
+	fb_free_files(fb);
+	pthread_cond_destroy(&fb->m_info_cond);
+	pthread_mutex_destroy(&fb->m_info_mutex);
 } /* End of 'fb_free' function */
 
 /* Display window */
@@ -453,90 +474,43 @@ void fb_move_cursor( browser_t *fb, int pos, bool_t rel )
 	}
 } /* End of 'fb_move_cursor' function */
 
-/* Add a file to list */
-static void fb_add_file( browser_t *fb, char *name )
-{
-	struct browser_list_item *item;
-	bool_t isdir = FALSE;
-	assert(fb);
-
-	char *full_name = util_strcat(fb->m_cur_dir, name, NULL);
-	struct stat st;
-	if (stat(full_name, &st))
-	{
-		free(full_name);
-		return;
-	}
-	
-	/* Get file type */
-	if (S_ISDIR(st.st_mode))
-		isdir = TRUE;
-
-	/* Rellocate memory for files list */
-	fb->m_files = (struct browser_list_item *)realloc(fb->m_files,
-			(fb->m_num_files + 1) * sizeof(*fb->m_files));
-
-	/* If we have a directory - insert it before normal files */
-	if (isdir)
-	{
-		int i;
-		for ( i = 0; i < fb->m_num_files; i ++ )
-			if (!(fb->m_files[i].m_type & FB_ITEM_DIR))
-			{
-				memmove(&fb->m_files[i + 1], &fb->m_files[i], 
-						(fb->m_num_files - i) * sizeof(*fb->m_files));
-				break;
-			}
-		item = &fb->m_files[i];
-	}
-	else
-		item = &fb->m_files[fb->m_num_files];
-
-	/* Set file data */
-	item->m_type = isdir ? FB_ITEM_DIR : 0;
-	item->m_full_name = full_name;
-	item->m_name = util_short_name(full_name);
-	item->m_y = -1;
-	item->m_info = NULL;
-	item->m_len = 0;
-	if (!strcmp(item->m_name, ".."))
-		item->m_type |= FB_ITEM_UPDIR;
-	fb->m_num_files ++;
-} /* End of 'fb_add_file' function */
-
 /* Reload directory files list */
 void fb_load_files( browser_t *fb )
 {
+	fu_list_t *list;
+	int i;
 	assert(fb);
 
-	/* Free current files list */
+	/* Free current files list. This also drops pending info loading */
+	pthread_mutex_lock(&fb->m_info_mutex);
 	fb_free_files(fb);
+	fb->m_info_gen ++;
+	fb->m_info_next = 0;
 
-	/* Add link to parent directory */
-	fb->m_files = (struct browser_list_item *)malloc(sizeof(*fb->m_files));
-	fb->m_num_files = 0;
-
-	/* Find files */
-	struct dirent **namelist;
-	int n = scandir(fb->m_cur_dir, &namelist, NULL, alphasort);
-	if (n >= 0)
+	/* Find files. Directories (and link to parent) go first */
+	list = fu_list_dir(fb->m_cur_dir, FU_LIST_DIRS_FIRST | FU_LIST_UPDIR);
+	if (list != NULL && list->m_num > 0)
 	{
-		for ( int i = 0; i < n; ++i )
+		fb->m_files = (struct browser_list_item *)malloc(
+				list->m_num * sizeof(*fb->m_files));
+		for ( i = 0; fb->m_files != NULL && i < list->m_num; i ++ )
 		{
-			char *name = namelist[i]->d_name;
-
-			/* Filter */
-			if (strcmp(name, "..") && name[0] == '.')
-				goto next;
-			
-			/* Add this file */
-			fb_add_file(fb, name);
-
-		next:
-			free(namelist[i]);
+			fu_list_entry_t *e = &list->m_entries[i];
+			struct browser_list_item *item = &fb->m_files[fb->m_num_files ++];
+
+			item->m_type = e->m_is_dir ? FB_ITEM_DIR : 0;
+			item->m_full_name = util_strcat(fb->m_cur_dir, e->m_name, NULL);
+			item->m_name = util_short_name(item->m_full_name);
+			item->m_y = -1;
+			item->m_info = NULL;
+			item->m_len = 0;
+			item->m_info_loaded = e->m_is_dir;
+			if (!strcmp(item->m_name, ".."))
+				item->m_type |= FB_ITEM_UPDIR;
 		}
-		free(namelist);
 	}
+	pthread_mutex_unlock(&fb->m_info_mutex);
+	fu_list_free(list);
 
 	/* Load info if we are in info mode */
 	if (fb->m_info_mode)
@@ -633,7 +607,7 @@ void fb_add2plist( browser_t *fb )
 		if (fb->m_files[i].m_type & FB_ITEM_SEL)
 			plist_set_add(set, fb->m_files[i].m_full_name);
 	}
-	plist_add_set(player_plist, set);
+	ingest_push(player_plist, set, FALSE);
 	plist_set_free(set);
 } /* End of 'fb_add2plist' function */
 
@@ -723,35 +697,106 @@ void fb_toggle_info( browser_t *fb )
 		fb_load_info(fb);
 } /* End of 'fb_toggle_info' function */
 
-/* Load song info */
-void fb_load_info( browser_t *fb )
+/* Check if item info should be loaded. Info mutex must be locked */
+static bool_t fb_info_needed( browser_t *fb, int i )
 {
-	int i;
+	struct browser_list_item *item = &fb->m_files[i];
 
-	if (fb == NULL)
-		return;
+	if (item->m_info_loaded)
+		return FALSE;
 
-	for ( i = 0; i < fb->m_num_files; i ++ )
+	/* Determine file type and its associated plugin */
+	if (!pmng_search_format(player_pmng, item->m_name, 
+				util_extension(item->m_name)))
 	{
-		struct browser_list_item *item = &fb->m_files[i];
-		char *ext;
+		item->m_info_loaded = TRUE;
+		return FALSE;
+	}
+	return TRUE;
+} /* End of 'fb_info_needed' function */
 
-		/* Don't load info if it is already loaded */
-		if (item->m_info != NULL && item->m_len)
-			continue;
-		/* Don't load info for directories */
-		if (item->m_type & FB_ITEM_DIR)
-			continue;
+/* Choose next item to load info for. Info mutex must be locked */
+static int fb_info_next( browser_t *fb )
+{
+	int i, end;
 
-		/* Determine file type and its associated plugin */
-		ext = util_extension(item->m_name);
-		if (!pmng_search_format(player_pmng, item->m_name, ext))
+	if (!fb->m_info_mode)
+		return -1;
+
+	/* Visible rows go first */
+	end = fb->m_scrolled + FB_HEIGHT(fb);
+	if (end > fb->m_num_files)
+		end = fb->m_num_files;
+	for ( i = fb->m_scrolled; i < end; i ++ )
+	{
+		if (fb_info_needed(fb, i))
+			return i;
+	}
+
+	/* Then the rest in order */
+	for ( ; fb->m_info_next < fb->m_num_files; fb->m_info_next ++ )
+	{
+		if (fb_info_needed(fb, fb->m_info_next))
+			return fb->m_info_next;
+	}
+	return -1;
+} /* End of 'fb_info_next' function */
+
+/* Info loading thread function */
+static void *fb_info_thread( void *arg )
+{
+	browser_t *fb = (browser_t *)arg;
+
+	pthread_mutex_lock(&fb->m_info_mutex);
+	while (!fb->m_info_end)
+	{
+		song_info_t *info;
+		song_time_t len = 0;
+
+		int i = fb_info_next(fb);
+		if (i < 0)
+		{
+			pthread_cond_wait(&fb->m_info_cond, &fb->m_info_mutex);
 			continue;
+		}
 
-		/* Load info */
-		si_free(item->m_info);
-		item->m_info = md_get_info(item->m_full_name, NULL, &item->m_len);
+		/* Load info without holding the lock */
+		int gen = fb->m_info_gen;
+		char *name = strdup(fb->m_files[i].m_full_name);
+		fb->m_files[i].m_info_loaded = TRUE;
+		pthread_mutex_unlock(&fb->m_info_mutex);
+		info = (name == NULL ? NULL : md_get_info(name, NULL, &len));
+		free(name);
+		pthread_mutex_lock(&fb->m_info_mutex);
+
+		/* Store it unless the list was reloaded meanwhile */
+		if (gen != fb->m_info_gen)
+		{
+			si_free(info);
+			continue;
+		}
+		fb->m_files[i].m_len = len;
+		fb->m_files[i].m_info = info;
+		pthread_mutex_unlock(&fb->m_info_mutex);
+		wnd_invalidate(WND_OBJ(fb));
+		pthread_mutex_lock(&fb->m_info_mutex);
 	}
+	pthread_mutex_unlock(&fb->m_info_mutex);
+	return NULL;
+} /* End of 'fb_info_thread' function */
+
+/* Start loading songs info in background */
+void fb_load_info( browser_t *fb )
+{
+	if (fb == NULL)
+		return;
+
+	pthread_mutex_lock(&fb->m_info_mutex);
+	if (!fb->m_info_tid && 
+			pthread_create(&fb->m_info_tid, NULL, fb_info_thread, fb))
+		fb->m_info_tid = 0;
+	pthread_cond_signal(&fb->m_info_cond);
+	pthread_mutex_unlock(&fb->m_info_mutex);
 } /* End of 'fb_load_info' function */
 
 /* Print header */
@@ -897,7 +942,7 @@ void fb_replace_plist( browser_t *fb )
 
 	/* Replace files */
 	plist_clear(player_plist);
-	plist_add_set(player_plist, set);
+	ingest_push(player_plist, set, FALSE);
 	plist_set_free(set);
 } /* End of 'fb_replace_plist' function */
 
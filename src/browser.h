@@ -23,6 +23,7 @@
 #ifndef __SG_MPFC_BROWSER_H__
 #define __SG_MPFC_BROWSER_H__
 
+#include <pthread.h>
 #include "types.h"
 #include "main_types.h"
 #include "song_info.h"
@@ -47,6 +48,9 @@ typedef struct
 		int m_y;
 		byte m_type;
 
+		/* Info loading has been done or is in progress */
+		bool_t m_info_loaded;
+
 /* Item types */
 #define FB_ITEM_DIR 0x01
 #define FB_ITEM_SEL 0x02
@@ -64,6 +68,18 @@ typedef struct
 	/* Is info mode active? */
 	bool_t m_info_mode;
 
+	/* Info loading thread. Mutex protects files list changes */
+	pthread_t m_info_tid;
+	pthread_mutex_t m_info_mutex;
+	pthread_cond_t m_info_cond;
+	bool_t m_info_end;
+
+	/* Files list generation (changed when list is reloaded) */
+	int m_info_gen;
+
+	/* First item which info may be still not loaded */
+	int m_info_next;
+
 	/* Is search mode active? */
 	bool_t m_search_mode;
 
@@ -117,7 +133,7 @@ void fb_move_cursor( browser_t *fb, int pos, bool_t rel );
 /* Reload directory files list */
 void fb_load_files( browser_t *fb );
 
-/* Free files list */
+/* Free files list (info mutex must be locked or thread stopped) */
 void fb_free_files( browser_t *fb );
 
 /* Go to the directory under cursor */
@@ -144,7 +160,7 @@ void fb_change_dir( browser_t *fb, char *dir );
 /* Toggle song info mode */
 void fb_toggle_info( browser_t *fb );
 
-/* Load song info */
+/* Start loading songs info in background */
 void fb_load_info( browser_t *fb );
 
 /* Print header */
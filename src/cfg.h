@@ -52,6 +52,10 @@ typedef enum
 #define CFG_HASH_BIG_SIZE		50
 #define CFG_HASH_DEFAULT_SIZE	CFG_HASH_MEDIUM_SIZE
 
+/* Maximal average number of children per hash bucket. When it is 
+ * exceeded hash table gets enlarged */
+#define CFG_HASH_MAX_LOAD		2
+
 /* Handler for a variable (a function that is called whenever variable 
  * value is changed) type. 
  * If this function returns FALSE (and flag CFG_NODE_HANDLE_AFTER_CHANGE
@@ -71,8 +75,9 @@ typedef enum
 /* Configuration tree node */
 typedef struct tag_cfg_node_t
 {
-	/* Node name */
+	/* Node name and its cached hash value */
 	char *m_name;
+	dword m_hash;
 
 	/* Node flags */
 	cfg_node_flags_t m_flags;
@@ -89,6 +94,12 @@ typedef struct tag_cfg_node_t
 			/* Variable value */
 			char *m_value;
 
+			/* Value parsed to other types. These are updated every time
+			 * the value changes, so typed getters do no parsing */
+			int m_int_value;
+			float m_float_value;
+			void *m_ptr_value;
+
 			/* Handler for this variable (a function that is called
 			 * whenever variable value is changed) */
 			cfg_var_handler_t m_handler;
@@ -113,6 +124,9 @@ typedef struct tag_cfg_node_t
 				struct cfg_list_hash_item_t *m_next;
 			} **m_children;
 			int m_hash_size;
+
+			/* Number of children (used to grow the hash table) */
+			int m_num_children;
 		} m_list;
 	} m_data;
 } cfg_node_t;
@@ -130,6 +144,9 @@ typedef void (*cfg_set_default_values_t)( cfg_node_t *list );
 #define CFG_VAR(node)				(&((node)->m_data.m_var))
 #define CFG_VAR_VALUE(node)			(CFG_VAR(node)->m_value)
 #define CFG_VAR_HANDLER(node)		(CFG_VAR(node)->m_handler)
+#define CFG_VAR_INT(node)			(CFG_VAR(node)->m_int_value)
+#define CFG_VAR_FLOAT(node)			(CFG_VAR(node)->m_float_value)
+#define CFG_VAR_PTR(node)			(CFG_VAR(node)->m_ptr_value)
 
 /* Create a new configuration list */
 cfg_node_t *cfg_new_list( cfg_node_t *parent, const char *name, 
@@ -182,6 +199,9 @@ void cfg_set_var_ptr( cfg_node_t *parent, const char *name, void *val );
 /* Get variable value */
 char *cfg_get_var( cfg_node_t *parent, const char *name );
 
+/* Get variable node (NULL if not found or if node is not a variable) */
+cfg_node_t *cfg_get_var_node( cfg_node_t *parent, const char *name );
+
 /* Get variable integer value */
 int cfg_get_var_int( cfg_node_t *parent, const char *name );
 
@@ -211,9 +231,67 @@ cfg_node_t *cfg_search_list( cfg_node_t *list, const char *name );
 /* Call variable handler */
 bool_t cfg_call_var_handler( bool_t after, cfg_node_t *node, char *value );
 
+/* Update variable typed values after its string value change */
+void cfg_var_parse_value( cfg_node_t *node );
+
 /* Calculate string hash value */
 int cfg_calc_hash( const char *str, int table_size );
 
+/* Calculate full (not reduced to the table size) hash value of the first 
+ * 'len' characters of a name (or of the whole name if 'len' is negative) */
+dword cfg_hash_name( const char *name, int len );
+
+/*
+ * Variable handles
+ *
+ * Handle caches the result of a variable search, so reading a variable 
+ * through it involves neither path parsing nor hashing. Handle is 
+ * automatically revalidated when the tree structure changes.
+ * Handles are used from several threads, so each thread keeps its own 
+ * copy: declare them with CFG_VAR_HANDLE.
+ */
+
+/* Handle type */
+typedef struct
+{
+	/* Variable name (may contain dots) */
+	const char *m_name;
+
+	/* List the handle is bound to */
+	cfg_node_t *m_list;
+
+	/* Cached node */
+	cfg_node_t *m_node;
+
+	/* Tree generation at the moment of caching */
+	dword m_generation;
+} cfg_var_handle_t;
+
+/* Handle initializer */
+#define CFG_VAR_HANDLE_INIT(name)	{ (name), NULL, NULL, 0 }
+
+/* Declare a thread local handle */
+#define CFG_VAR_HANDLE(var, name)	\
+	static __thread cfg_var_handle_t var = CFG_VAR_HANDLE_INIT(name)
+
+/* Get node a handle points to (binding it to the list if it is not yet) */
+cfg_node_t *cfg_handle_node( cfg_node_t *list, cfg_var_handle_t *h );
+
+/* Get variable value through a handle */
+char *cfg_handle_get_var( cfg_node_t *list, cfg_var_handle_t *h );
+
+/* Get variable integer value through a handle */
+int cfg_handle_get_var_int( cfg_node_t *list, cfg_var_handle_t *h );
+
+/* Get variable float value through a handle */
+float cfg_handle_get_var_float( cfg_node_t *list, cfg_var_handle_t *h );
+
+/* Get variable pointer value through a handle */
+void *cfg_handle_get_var_ptr( cfg_node_t *list, cfg_var_handle_t *h );
+
+#define cfg_handle_get_var_bool(list, h)	\
+	((bool_t)cfg_handle_get_var_int(list, h))
+
 /*
  * Configuration list iteration functions
  */
@@ -0,0 +1,797 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2013 by SG Software.
+ *
+ * SG MPFC. Player state checkpointing.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "types.h"
+#include "cfg.h"
+#include "checkpoint.h"
+#include "logger.h"
+#include "player.h"
+#include "plist.h"
+#include "song.h"
+#include "song_info.h"
+#include "undo.h"
+#include "util.h"
+
+/* Value written to the byte order field */
+#define CKPT_BYTE_ORDER 0x01020304
+
+/* Buffered records are written when they take this much space */
+#define CKPT_FLUSH_SIZE 65536
+
+/* Journal is compacted at once when it becomes this large */
+#define CKPT_MAX_JOURNAL_SIZE (4 * 1024 * 1024)
+
+/* Default interval between compactions (in seconds) */
+#define CKPT_DEFAULT_INTERVAL 60
+
+static void *ckpt_thread( void *arg );
+
+/* Calculate record data check sum */
+static dword ckpt_check_sum( const char *data, dword size )
+{
+	dword h = 2166136261u, i;
+	for ( i = 0; i < size; i ++ )
+	{
+		h ^= (byte)data[i];
+		h *= 16777619u;
+	}
+	return h;
+} /* End of 'ckpt_check_sum' function */
+
+/* Create a checkpointer */
+ckpt_t *ckpt_new( plist_t *pl, const char *snapshot_name,
+		const char *journal_name, bool_t save_plist,
+		void (*get_state)( plist_t *pl, snapshot_state_t *state ) )
+{
+	ckpt_t *ck;
+
+	/* Allocate memory */
+	ck = (ckpt_t *)malloc(sizeof(*ck));
+	if (ck == NULL)
+		return NULL;
+	memset(ck, 0, sizeof(*ck));
+
+	/* Set fields */
+	ck->m_plist = pl;
+	ck->m_save_plist = save_plist;
+	ck->m_get_state = get_state;
+	ck->m_snapshot_name = strdup(snapshot_name);
+	ck->m_journal_name = strdup(journal_name);
+	if (ck->m_snapshot_name == NULL || ck->m_journal_name == NULL)
+	{
+		free(ck->m_snapshot_name);
+		free(ck->m_journal_name);
+		free(ck);
+		return NULL;
+	}
+	ck->m_fd = -1;
+	pthread_mutex_init(&ck->m_mutex, NULL);
+	pthread_cond_init(&ck->m_cond, NULL);
+	return ck;
+} /* End of 'ckpt_new' function */
+
+/* Read journal header */
+static bool_t ckpt_read_header( int fd, ckpt_journal_header_t *hdr )
+{
+	if (pread(fd, hdr, sizeof(*hdr), 0) != sizeof(*hdr))
+		return FALSE;
+	return (!memcmp(hdr->m_magic, CKPT_JOURNAL_MAGIC, 
+				sizeof(CKPT_JOURNAL_MAGIC)) &&
+			hdr->m_version == CKPT_JOURNAL_VERSION &&
+			hdr->m_byte_order == CKPT_BYTE_ORDER);
+} /* End of 'ckpt_read_header' function */
+
+/* Get sequence number of the journal on disk (0 if there is none) */
+static dword ckpt_journal_seq( ckpt_t *ck )
+{
+	ckpt_journal_header_t hdr;
+	dword seq = 0;
+	int fd = open(ck->m_journal_name, O_RDONLY);
+	if (fd < 0)
+		return 0;
+	if (ckpt_read_header(fd, &hdr))
+		seq = hdr.m_seq;
+	close(fd);
+	return seq;
+} /* End of 'ckpt_journal_seq' function */
+
+/* Create a new journal moving to it the records of the current one 
+ * starting from the given offset (mutex must be locked) */
+static bool_t ckpt_journal_create( ckpt_t *ck, dword seq, off_t from )
+{
+	ckpt_journal_header_t hdr;
+	char buf[CKPT_FLUSH_SIZE];
+	off_t size = sizeof(hdr);
+	char *tmp_name;
+	int fd;
+
+	tmp_name = util_strcat(ck->m_journal_name, ".tmp", NULL);
+	if (tmp_name == NULL)
+		return FALSE;
+	/* Journal is read back when it is rotated, so it is opened for 
+	 * reading too */
+	fd = open(tmp_name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+	if (fd < 0)
+	{
+		logger_error(player_log, 1, _("unable to open file %s for writing"),
+				tmp_name);
+		free(tmp_name);
+		return FALSE;
+	}
+
+	/* Write header */
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.m_magic, CKPT_JOURNAL_MAGIC, sizeof(CKPT_JOURNAL_MAGIC));
+	hdr.m_version = CKPT_JOURNAL_VERSION;
+	hdr.m_byte_order = CKPT_BYTE_ORDER;
+	hdr.m_seq = seq;
+	if (write(fd, &hdr, sizeof(hdr)) != sizeof(hdr))
+		goto failed;
+
+	/* Copy records that are not in the snapshot */
+	if (ck->m_fd >= 0)
+	{
+		for ( ; from < ck->m_journal_size; )
+		{
+			ssize_t len = ck->m_journal_size - from;
+			if (len > sizeof(buf))
+				len = sizeof(buf);
+			len = pread(ck->m_fd, buf, len, from);
+			if (len <= 0 || write(fd, buf, len) != len)
+				goto failed;
+			from += len;
+			size += len;
+		}
+	}
+
+	/* Replace the old journal */
+	if (fdatasync(fd) < 0 || rename(tmp_name, ck->m_journal_name) < 0)
+		goto failed;
+	free(tmp_name);
+	if (ck->m_fd >= 0)
+		close(ck->m_fd);
+	ck->m_fd = fd;
+	ck->m_seq = seq;
+	ck->m_journal_size = size;
+	ck->m_need_sync = FALSE;
+	return TRUE;
+
+failed:
+	logger_error(player_log, 1, _("unable to write journal %s"), tmp_name);
+	close(fd);
+	unlink(tmp_name);
+	free(tmp_name);
+	return FALSE;
+} /* End of 'ckpt_journal_create' function */
+
+/* Write buffered records to the journal (mutex must be locked) */
+static void ckpt_flush( ckpt_t *ck )
+{
+	int done = 0;
+
+	if (ck->m_fd < 0 || ck->m_buf_len == 0)
+		return;
+
+	while (done < ck->m_buf_len)
+	{
+		ssize_t len = write(ck->m_fd, ck->m_buf + done, 
+				ck->m_buf_len - done);
+		if (len < 0 && errno == EINTR)
+			continue;
+		if (len <= 0)
+		{
+			/* Drop incomplete records. Play list will be saved with
+			 * the next compaction */
+			logger_error(player_log, 1, _("unable to write journal %s"), 
+					ck->m_journal_name);
+			if (ftruncate(ck->m_fd, ck->m_journal_size) == 0)
+				lseek(ck->m_fd, ck->m_journal_size, SEEK_SET);
+			ck->m_buf_len = 0;
+			ck->m_need_compact = TRUE;
+			return;
+		}
+		done += len;
+	}
+	ck->m_journal_size += ck->m_buf_len;
+	ck->m_buf_len = 0;
+	ck->m_need_sync = TRUE;
+} /* End of 'ckpt_flush' function */
+
+/* Append data to the records buffer */
+static bool_t ckpt_put( ckpt_t *ck, const void *data, int size )
+{
+	if (ck->m_buf_len + size > ck->m_buf_size)
+	{
+		int new_size = (ck->m_buf_size == 0) ? 4096 : ck->m_buf_size;
+		char *buf;
+		while (new_size < ck->m_buf_len + size)
+			new_size *= 2;
+		buf = (char *)realloc(ck->m_buf, new_size);
+		if (buf == NULL)
+			return FALSE;
+		ck->m_buf = buf;
+		ck->m_buf_size = new_size;
+	}
+	memcpy(ck->m_buf + ck->m_buf_len, data, size);
+	ck->m_buf_len += size;
+	return TRUE;
+} /* End of 'ckpt_put' function */
+
+/* Append string to the records buffer */
+static bool_t ckpt_put_str( ckpt_t *ck, const char *str )
+{
+	if (str == NULL)
+		str = "";
+	return ckpt_put(ck, str, strlen(str) + 1);
+} /* End of 'ckpt_put_str' function */
+
+/* Start a record (mutex must be locked). Returns its position in buffer */
+static int ckpt_begin_record( ckpt_t *ck, dword type )
+{
+	ckpt_record_t rec;
+	int pos = ck->m_buf_len;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.m_type = type;
+	if (!ckpt_put(ck, &rec, sizeof(rec)))
+		return -1;
+	return pos;
+} /* End of 'ckpt_begin_record' function */
+
+/* Finish a record */
+static void ckpt_end_record( ckpt_t *ck, int pos, bool_t ok )
+{
+	ckpt_record_t rec;
+
+	/* Record data could not be stored. Save play list by compaction */
+	if (pos < 0 || !ok)
+	{
+		if (pos >= 0)
+			ck->m_buf_len = pos;
+		ck->m_need_compact = TRUE;
+		pthread_cond_signal(&ck->m_cond);
+		return;
+	}
+
+	memcpy(&rec, ck->m_buf + pos, sizeof(rec));
+	rec.m_size = ck->m_buf_len - pos - sizeof(rec);
+	rec.m_check = ckpt_check_sum(ck->m_buf + pos + sizeof(rec), rec.m_size);
+	memcpy(ck->m_buf + pos, &rec, sizeof(rec));
+
+	if (ck->m_buf_len >= CKPT_FLUSH_SIZE)
+		ckpt_flush(ck);
+} /* End of 'ckpt_end_record' function */
+
+/* Lock checkpointer if play list changes are to be journaled */
+static bool_t ckpt_lock_journal( ckpt_t *ck, plist_t *pl )
+{
+	if (ck == NULL || pl != ck->m_plist)
+		return FALSE;
+	pthread_mutex_lock(&ck->m_mutex);
+	if (ck->m_fd < 0)
+	{
+		pthread_mutex_unlock(&ck->m_mutex);
+		return FALSE;
+	}
+	return TRUE;
+} /* End of 'ckpt_lock_journal' function */
+
+/* Journal song addition */
+void ckpt_log_add( ckpt_t *ck, plist_t *pl, song_t *song, int pos )
+{
+	ckpt_add_t add;
+	song_info_t *si = NULL;
+	bool_t ok;
+	int rec;
+
+	if (!ckpt_lock_journal(ck, pl))
+		return;
+
+	song_lock(song);
+	memset(&add, 0, sizeof(add));
+	add.m_pos = pos;
+	add.m_len = song->m_full_len;
+	add.m_start_time = song_get_start_time(song);
+	add.m_end_time = song_get_end_time(song);
+	if (song->m_filename == NULL)
+		add.m_flags |= CKPT_ADD_URI;
+	if (song_get_default_title(song) != NULL)
+		add.m_flags |= CKPT_ADD_TITLE;
+
+	/* Only static info is saved; the other one is read again */
+	if ((song->m_flags & SONG_STATIC_INFO) && song->m_info != NULL)
+	{
+		si = song->m_info;
+		add.m_flags |= CKPT_ADD_INFO;
+
+		/* ReplayGain values are not journaled, they come with the file */
+		add.m_info_flags = si->m_flags & ~(SI_TRACK_GAIN | SI_ALBUM_GAIN);
+	}
+
+	rec = ckpt_begin_record(ck, CKPT_ADD);
+	ok = (rec >= 0 && ckpt_put(ck, &add, sizeof(add)) &&
+			ckpt_put_str(ck, song_get_name(song)));
+	if (ok && (add.m_flags & CKPT_ADD_TITLE))
+		ok = ckpt_put_str(ck, song_get_default_title(song));
+	if (ok && si != NULL)
+	{
+		ok = (ckpt_put_str(ck, si->m_artist) &&
+				ckpt_put_str(ck, si->m_name) &&
+				ckpt_put_str(ck, si->m_album) &&
+				ckpt_put_str(ck, si->m_year) &&
+				ckpt_put_str(ck, si->m_genre) &&
+				ckpt_put_str(ck, si->m_comments) &&
+				ckpt_put_str(ck, si->m_track) &&
+				ckpt_put_str(ck, si->m_own_data));
+	}
+	song_unlock(song);
+	ckpt_end_record(ck, rec, ok);
+
+	pthread_mutex_unlock(&ck->m_mutex);
+} /* End of 'ckpt_log_add' function */
+
+/* Journal songs range record */
+static void ckpt_log_range( ckpt_t *ck, plist_t *pl, dword type,
+		int start, int end, int to )
+{
+	ckpt_range_t range;
+	int rec;
+
+	if (!ckpt_lock_journal(ck, pl))
+		return;
+
+	range.m_start = start;
+	range.m_end = end;
+	range.m_to = to;
+	rec = ckpt_begin_record(ck, type);
+	ckpt_end_record(ck, rec, 
+			rec >= 0 && ckpt_put(ck, &range, sizeof(range)));
+
+	pthread_mutex_unlock(&ck->m_mutex);
+} /* End of 'ckpt_log_range' function */
+
+/* Journal songs removal */
+void ckpt_log_rem( ckpt_t *ck, plist_t *pl, int start, int end )
+{
+	ckpt_log_range(ck, pl, CKPT_REM, start, end, 0);
+} /* End of 'ckpt_log_rem' function */
+
+/* Journal songs moving */
+void ckpt_log_move( ckpt_t *ck, plist_t *pl, int start, int end, int to )
+{
+	ckpt_log_range(ck, pl, CKPT_MOVE, start, end, to);
+} /* End of 'ckpt_log_move' function */
+
+/* Notify about reordering (it is saved by compaction) */
+void ckpt_log_reorder( ckpt_t *ck, plist_t *pl )
+{
+	if (!ckpt_lock_journal(ck, pl))
+		return;
+	ck->m_need_compact = TRUE;
+	pthread_cond_signal(&ck->m_cond);
+	pthread_mutex_unlock(&ck->m_mutex);
+} /* End of 'ckpt_log_reorder' function */
+
+/* Get next string from the record data */
+static const char *ckpt_get_str( const char **data, const char *end )
+{
+	const char *str = *data;
+	const char *zero = memchr(str, 0, end - str);
+	if (zero == NULL)
+		return NULL;
+	(*data) = zero + 1;
+	return str;
+} /* End of 'ckpt_get_str' function */
+
+/* Replay song addition */
+static bool_t ckpt_replay_add( plist_t *pl, const char *data, dword size )
+{
+	song_metadata_t metadata = SONG_METADATA_EMPTY;
+	const char *end = data + size, *name, *fields[8];
+	song_info_t *si = NULL;
+	ckpt_add_t add;
+	song_t *s;
+	int i;
+
+	if (size < sizeof(add))
+		return FALSE;
+	memcpy(&add, data, sizeof(add));
+	data += sizeof(add);
+	if (add.m_pos < 0 || add.m_pos > pl->m_len)
+		return FALSE;
+
+	/* Get strings */
+	name = ckpt_get_str(&data, end);
+	if (name == NULL)
+		return FALSE;
+	if (add.m_flags & CKPT_ADD_TITLE)
+	{
+		metadata.m_title = ckpt_get_str(&data, end);
+		if (metadata.m_title == NULL)
+			return FALSE;
+	}
+	if (add.m_flags & CKPT_ADD_INFO)
+	{
+		for ( i = 0; i < 8; i ++ )
+		{
+			fields[i] = ckpt_get_str(&data, end);
+			if (fields[i] == NULL)
+				return FALSE;
+		}
+		si = si_new();
+		si_set_artist	(si, fields[0]);
+		si_set_name		(si, fields[1]);
+		si_set_album	(si, fields[2]);
+		si_set_year		(si, fields[3]);
+		si_set_genre	(si, fields[4]);
+		si_set_comments	(si, fields[5]);
+		si_set_track	(si, fields[6]);
+		si_set_own_data	(si, fields[7]);
+		if (si != NULL)
+			si->m_flags = add.m_info_flags;
+	}
+	metadata.m_len = add.m_len;
+	metadata.m_start_time = add.m_start_time;
+	metadata.m_end_time = add.m_end_time;
+	metadata.m_song_info = si;
+
+	/* Create song */
+	s = song_new_from_state(name, (add.m_flags & CKPT_ADD_URI) ? TRUE : FALSE,
+			&metadata, NULL);
+	if (s == NULL)
+	{
+		si_free(si);
+		return TRUE;
+	}
+	if (metadata.m_title == NULL && si == NULL)
+		song_schedule_info(s);
+	plist_add_song(pl, s, add.m_pos);
+	return TRUE;
+} /* End of 'ckpt_replay_add' function */
+
+/* Replay songs removal or moving */
+static bool_t ckpt_replay_range( plist_t *pl, dword type,
+		const char *data, dword size )
+{
+	ckpt_range_t range;
+	int was_start = pl->m_sel_start, was_end = pl->m_sel_end;
+
+	if (size != sizeof(range))
+		return FALSE;
+	memcpy(&range, data, sizeof(range));
+	if (range.m_start < 0 || range.m_start > range.m_end || 
+			range.m_end >= pl->m_len)
+		return FALSE;
+
+	pl->m_sel_start = range.m_start;
+	pl->m_sel_end = range.m_end;
+	if (type == CKPT_REM)
+		plist_rem(pl);
+	else
+	{
+		if (range.m_to < 0 || 
+				range.m_to >= pl->m_len - (range.m_end - range.m_start))
+			return FALSE;
+		plist_move_sel(pl, range.m_to, FALSE);
+	}
+	pl->m_sel_start = was_start;
+	pl->m_sel_end = was_end;
+	UNDO_FIX_SEL(pl);
+	return TRUE;
+} /* End of 'ckpt_replay_range' function */
+
+/* Replay journal over the loaded snapshot */
+void ckpt_replay( ckpt_t *ck, snapshot_state_t *state )
+{
+	ckpt_journal_header_t hdr;
+	struct stat st;
+	char *data = NULL;
+	off_t from, pos;
+	bool_t was_store = player_store_undo;
+	int fd;
+
+	if (ck == NULL)
+		return;
+	ck->m_seq = state->m_journal_seq;
+
+	/* Open journal and check that it has something not in the snapshot */
+	fd = open(ck->m_journal_name, O_RDONLY);
+	if (fd < 0)
+		return;
+	if (!ckpt_read_header(fd, &hdr) || hdr.m_seq < state->m_journal_seq ||
+			fstat(fd, &st) < 0)
+		goto finally;
+	from = (hdr.m_seq == state->m_journal_seq) ? 
+		state->m_journal_offset : sizeof(hdr);
+	if (from < sizeof(hdr) || from > st.st_size)
+		goto finally;
+
+	/* Read records */
+	data = (char *)malloc(st.st_size - from + 1);
+	if (data == NULL || 
+			pread(fd, data, st.st_size - from, from) != st.st_size - from)
+		goto finally;
+
+	/* Replay them. Stop at the first incomplete record, which may be
+	 * left by a crash */
+	player_store_undo = FALSE;
+	for ( pos = 0; pos + sizeof(ckpt_record_t) <= st.st_size - from; )
+	{
+		ckpt_record_t rec;
+		const char *rec_data;
+		bool_t ok;
+
+		memcpy(&rec, data + pos, sizeof(rec));
+		rec_data = data + pos + sizeof(rec);
+		if (rec.m_size > st.st_size - from - pos - sizeof(rec) ||
+				ckpt_check_sum(rec_data, rec.m_size) != rec.m_check)
+			break;
+
+		if (rec.m_type == CKPT_ADD)
+			ok = ckpt_replay_add(ck->m_plist, rec_data, rec.m_size);
+		else if (rec.m_type == CKPT_REM || rec.m_type == CKPT_MOVE)
+			ok = ckpt_replay_range(ck->m_plist, rec.m_type, rec_data, 
+					rec.m_size);
+		else
+			ok = FALSE;
+		if (!ok)
+		{
+			logger_error(player_log, 1, _("journal %s is corrupted"),
+					ck->m_journal_name);
+			break;
+		}
+		pos += sizeof(rec) + rec.m_size;
+	}
+	player_store_undo = was_store;
+	plist_flush_scheduled(ck->m_plist);
+
+	/* Journal will be continued from here */
+	ck->m_journal_valid = TRUE;
+	ck->m_journal_seq = hdr.m_seq;
+	ck->m_journal_end = from + pos;
+
+finally:
+	free(data);
+	close(fd);
+} /* End of 'ckpt_replay' function */
+
+/* Save snapshot and start a new journal */
+static bool_t ckpt_compact( ckpt_t *ck )
+{
+	snapshot_state_t state;
+	song_t **songs = NULL;
+	plist_t *pl = ck->m_plist;
+	bool_t ret;
+	int i, num;
+
+	/* Take play list copy and remember the journal position it 
+	 * corresponds to */
+	plist_lock(pl);
+	pthread_mutex_lock(&ck->m_mutex);
+	ckpt_flush(ck);
+	ck->m_need_compact = FALSE;
+	ck->m_compact_failed = FALSE;
+	num = pl->m_len;
+	if (num > 0)
+	{
+		songs = (song_t **)malloc(sizeof(song_t *) * num);
+		if (songs == NULL)
+		{
+			ck->m_need_compact = TRUE;
+			ck->m_compact_failed = TRUE;
+			ck->m_last_compact = time(NULL);
+			pthread_mutex_unlock(&ck->m_mutex);
+			plist_unlock(pl);
+			return FALSE;
+		}
+		pseq_get_range(pl->m_seq, 0, num, songs);
+		for ( i = 0; i < num; i ++ )
+			song_add_ref(songs[i]);
+	}
+	ck->m_get_state(ck->m_plist, &state);
+	state.m_journal_seq = ck->m_seq;
+	state.m_journal_offset = ck->m_journal_size;
+	pthread_mutex_unlock(&ck->m_mutex);
+	plist_unlock(pl);
+
+	/* Save snapshot */
+	ret = snapshot_save(ck->m_snapshot_name, songs, num, &state);
+
+	/* Release songs */
+	plist_lock(pl);
+	for ( i = 0; i < num; i ++ )
+		song_free(songs[i]);
+	plist_unlock(pl);
+	free(songs);
+
+	/* Leave in journal only records made after the copy */
+	pthread_mutex_lock(&ck->m_mutex);
+	if (ret)
+	{
+		ckpt_flush(ck);
+		ret = ckpt_journal_create(ck, state.m_journal_seq + 1, 
+				state.m_journal_offset);
+	}
+	if (!ret)
+		ck->m_need_compact = TRUE;
+	ck->m_compact_failed = !ret;
+	ck->m_last_compact = time(NULL);
+	pthread_mutex_unlock(&ck->m_mutex);
+	return ret;
+} /* End of 'ckpt_compact' function */
+
+/* Start journaling and checkpointing thread. If play list was not 
+ * restored from the snapshot, it is saved at once */
+bool_t ckpt_start( ckpt_t *ck, bool_t restored )
+{
+	if (ck == NULL)
+		return FALSE;
+	if (!ck->m_save_plist)
+		return TRUE;
+
+	/* Continue the replayed journal */
+	if (restored && ck->m_journal_valid)
+	{
+		ck->m_fd = open(ck->m_journal_name, O_RDWR);
+		if (ck->m_fd >= 0 && 
+				(ftruncate(ck->m_fd, ck->m_journal_end) < 0 ||
+				 lseek(ck->m_fd, ck->m_journal_end, SEEK_SET) < 0))
+		{
+			close(ck->m_fd);
+			ck->m_fd = -1;
+		}
+		if (ck->m_fd >= 0)
+		{
+			ck->m_seq = ck->m_journal_seq;
+			ck->m_journal_size = ck->m_journal_end;
+		}
+	}
+	
+	/* Start a new journal after the restored snapshot */
+	if (restored && ck->m_fd < 0)
+		ckpt_journal_create(ck, ck->m_seq + 1, 0);
+	
+	/* Play list is not the saved one, so save it now. Sequence number is
+	 * chosen so that old journal will never be applied to it */
+	else if (!restored)
+	{
+		ck->m_seq = ckpt_journal_seq(ck) + 1;
+		ck->m_journal_size = sizeof(ckpt_journal_header_t);
+		ckpt_compact(ck);
+	}
+	ck->m_last_compact = time(NULL);
+
+	/* Start thread */
+	if (pthread_create(&ck->m_tid, NULL, ckpt_thread, ck))
+	{
+		ck->m_tid = 0;
+		return FALSE;
+	}
+	return TRUE;
+} /* End of 'ckpt_start' function */
+
+/* Stop checkpointing, save final snapshot and free checkpointer */
+void ckpt_free( ckpt_t *ck )
+{
+	if (ck == NULL)
+		return;
+
+	/* Stop thread */
+	if (ck->m_tid)
+	{
+		pthread_mutex_lock(&ck->m_mutex);
+		ck->m_stop = TRUE;
+		pthread_cond_signal(&ck->m_cond);
+		pthread_mutex_unlock(&ck->m_mutex);
+		pthread_join(ck->m_tid, NULL);
+		ck->m_tid = 0;
+	}
+
+	/* Save final snapshot */
+	if (ck->m_save_plist)
+		ckpt_compact(ck);
+	else
+	{
+		snapshot_state_t state;
+		ck->m_get_state(ck->m_plist, &state);
+		state.m_journal_seq = ckpt_journal_seq(ck) + 1;
+		state.m_journal_offset = sizeof(ckpt_journal_header_t);
+		if (snapshot_save(ck->m_snapshot_name, NULL, 0, &state))
+			unlink(ck->m_journal_name);
+	}
+
+	/* Free memory */
+	if (ck->m_fd >= 0)
+		close(ck->m_fd);
+	pthread_mutex_destroy(&ck->m_mutex);
+	pthread_cond_destroy(&ck->m_cond);
+	free(ck->m_buf);
+	free(ck->m_snapshot_name);
+	free(ck->m_journal_name);
+	free(ck);
+} /* End of 'ckpt_free' function */
+
+/* Thread function */
+static void *ckpt_thread( void *arg )
+{
+	CFG_VAR_HANDLE(interval_h, "checkpoint-interval");
+	ckpt_t *ck = (ckpt_t *)arg;
+
+	pthread_mutex_lock(&ck->m_mutex);
+	while (!ck->m_stop)
+	{
+		struct timeval now;
+		struct timespec ts;
+		int interval;
+		bool_t compact;
+
+		/* Wake up every second or when asked to */
+		gettimeofday(&now, NULL);
+		ts.tv_sec = now.tv_sec + 1;
+		ts.tv_nsec = now.tv_usec * 1000;
+		pthread_cond_timedwait(&ck->m_cond, &ck->m_mutex, &ts);
+		if (ck->m_stop)
+			break;
+
+		/* Write records and sync them */
+		ckpt_flush(ck);
+		if (ck->m_need_sync && ck->m_fd >= 0)
+		{
+			int fd = ck->m_fd;
+			ck->m_need_sync = FALSE;
+			pthread_mutex_unlock(&ck->m_mutex);
+			fdatasync(fd);
+			pthread_mutex_lock(&ck->m_mutex);
+		}
+
+		/* Compact journal if it is time */
+		interval = cfg_handle_get_var_int(cfg_list, &interval_h);
+		if (interval <= 0)
+			interval = CKPT_DEFAULT_INTERVAL;
+		if (ck->m_compact_failed)
+			compact = (time(NULL) - ck->m_last_compact >= interval);
+		else
+			compact = ck->m_need_compact || 
+				ck->m_journal_size >= CKPT_MAX_JOURNAL_SIZE ||
+				(ck->m_journal_size > sizeof(ckpt_journal_header_t) &&
+				 time(NULL) - ck->m_last_compact >= interval);
+		if (compact)
+		{
+			pthread_mutex_unlock(&ck->m_mutex);
+			ckpt_compact(ck);
+			pthread_mutex_lock(&ck->m_mutex);
+		}
+	}
+	pthread_mutex_unlock(&ck->m_mutex);
+	return NULL;
+} /* End of 'ckpt_thread' function */
+
+/* End of 'checkpoint.c' file */
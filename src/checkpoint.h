@@ -0,0 +1,163 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2013 by SG Software.
+ *
+ * SG MPFC. Interface for player state checkpointing.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_CHECKPOINT_H__
+#define __SG_MPFC_CHECKPOINT_H__
+
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+#include "types.h"
+#include "main_types.h"
+#include "snapshot.h"
+
+/* Play list changes are appended to a journal, which is periodically
+ * compacted into a fresh snapshot by a background thread. The snapshot 
+ * remembers the journal sequence number and offset it includes, so 
+ * at startup only the rest of the journal is replayed */
+
+/* Journal file signature and format version */
+#define CKPT_JOURNAL_MAGIC "MPFCJRN"
+#define CKPT_JOURNAL_VERSION 1
+
+/* Journal file header */
+typedef struct tag_ckpt_journal_header_t
+{
+	char m_magic[8];
+	dword m_version;
+	dword m_byte_order;
+	dword m_seq;
+	dword m_reserved;
+} ckpt_journal_header_t;
+
+/* Journal record header. It is followed by m_size bytes of data */
+typedef struct tag_ckpt_record_t
+{
+	dword m_type;
+	dword m_size;
+	dword m_check;
+} ckpt_record_t;
+
+/* Journal record types */
+#define CKPT_ADD	0
+#define CKPT_REM	1
+#define CKPT_MOVE	2
+
+/* Song addition record data. It is followed by song name, title 
+ * (if CKPT_ADD_TITLE flag is set) and eight song info strings
+ * (if CKPT_ADD_INFO flag is set) */
+typedef struct tag_ckpt_add_t
+{
+	int32_t m_pos;
+	dword m_flags;
+	dword m_info_flags;
+	dword m_reserved;
+	int64_t m_len;
+	int64_t m_start_time, m_end_time;
+} ckpt_add_t;
+
+/* Song addition record flags */
+#define CKPT_ADD_URI	0x00000001
+#define CKPT_ADD_TITLE	0x00000002
+#define CKPT_ADD_INFO	0x00000004
+
+/* Songs removal or moving record data */
+typedef struct tag_ckpt_range_t
+{
+	int32_t m_start, m_end, m_to;
+} ckpt_range_t;
+
+/* Checkpointer type */
+typedef struct tag_ckpt_t
+{
+	/* Play list being saved */
+	plist_t *m_plist;
+
+	/* Is play list saved at all? */
+	bool_t m_save_plist;
+
+	/* Function getting current player state */
+	void (*m_get_state)( plist_t *pl, snapshot_state_t *state );
+
+	/* Files names */
+	char *m_snapshot_name, *m_journal_name;
+
+	/* Journal file (-1 if play list changes are not journaled yet) */
+	int m_fd;
+	dword m_seq;
+	off_t m_journal_size;
+
+	/* Records not written to the journal yet */
+	char *m_buf;
+	int m_buf_len, m_buf_size;
+
+	/* Journal has unsynced data */
+	bool_t m_need_sync;
+
+	/* Play list was changed in the way that is not journaled */
+	bool_t m_need_compact;
+	time_t m_last_compact;
+	bool_t m_compact_failed;
+
+	/* Journal position found at startup */
+	bool_t m_journal_valid;
+	dword m_journal_seq;
+	off_t m_journal_end;
+
+	/* Thread stuff */
+	pthread_t m_tid;
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_cond;
+	bool_t m_stop;
+} ckpt_t;
+
+/* Create a checkpointer */
+ckpt_t *ckpt_new( plist_t *pl, const char *snapshot_name,
+		const char *journal_name, bool_t save_plist,
+		void (*get_state)( plist_t *pl, snapshot_state_t *state ) );
+
+/* Replay journal over the loaded snapshot */
+void ckpt_replay( ckpt_t *ck, snapshot_state_t *state );
+
+/* Start journaling and checkpointing thread. If play list was not 
+ * restored from the snapshot, it is saved at once */
+bool_t ckpt_start( ckpt_t *ck, bool_t restored );
+
+/* Stop checkpointing, save final snapshot and free checkpointer */
+void ckpt_free( ckpt_t *ck );
+
+/* Journal song addition */
+void ckpt_log_add( ckpt_t *ck, plist_t *pl, song_t *song, int pos );
+
+/* Journal songs removal */
+void ckpt_log_rem( ckpt_t *ck, plist_t *pl, int start, int end );
+
+/* Journal songs moving */
+void ckpt_log_move( ckpt_t *ck, plist_t *pl, int start, int end, int to );
+
+/* Notify about reordering (it is saved by compaction) */
+void ckpt_log_reorder( ckpt_t *ck, plist_t *pl );
+
+#endif
+
+/* End of 'checkpoint.h' file */
@@ -24,6 +24,8 @@
 #define __SG_MPFC_FILE_UTILS_H__
 
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
 #include <dirent.h>
 #include "types.h"
 
@@ -51,6 +53,56 @@ bool_t fu_is_special_dir(const char *name);
 /* Does path have a prefix? */
 bool_t fu_is_prefixed(const char *name);
 
+/* Directory listing entry */
+typedef struct
+{
+	/* Entry name (points into the listing names block) */
+	char *m_name;
+
+	/* Is this a directory (links are resolved) */
+	bool_t m_is_dir;
+
+	/* File mode. Only type bits are set unless FU_LIST_STAT is given */
+	mode_t m_mode;
+
+	/* File size and modification time (filled only with FU_LIST_STAT) */
+	off_t m_size;
+	time_t m_mtime;
+} fu_list_entry_t;
+
+/* Directory listing */
+typedef struct
+{
+	fu_list_entry_t *m_entries;
+	int m_num;
+
+	/* Names block */
+	char *m_names;
+	size_t m_names_len;
+
+	/* Whether entries have full stat information */
+	bool_t m_stat;
+} fu_list_t;
+
+/* Directory listing flags */
+#define FU_LIST_SORT			0x01	/* Sort entries by name */
+#define FU_LIST_DIRS_FIRST		0x02	/* Put directories before files */
+#define FU_LIST_HIDDEN			0x04	/* Include hidden files */
+#define FU_LIST_UPDIR			0x08	/* Include '..' (put first) */
+#define FU_LIST_STAT			0x10	/* Fill modes, sizes and times */
+#define FU_LIST_SKIP_SPECIAL	0x20	/* Skip all but regulars and dirs */
+#define FU_LIST_NOCACHE			0x40	/* Don't use listings cache */
+
+/* List directory in one pass. File types are taken from 'd_type'
+ * when possible, 'fstatat' is used otherwise. Entries which can't
+ * be examined (e.g. broken links) are skipped.
+ * Listings are kept in a small LRU cache which is invalidated through
+ * inotify, so repeated listings of a directory need no system calls */
+fu_list_t *fu_list_dir(const char *name, int flags);
+
+/* Free directory listing */
+void fu_list_free(fu_list_t *list);
+
 #endif
 
 /* End of 'file_utils.h' file */
@@ -199,6 +199,7 @@ void help_init_player( help_screen_t *help )
 	help_add(help, _("R:\t\t Set/unset shuffle play mode"));
 	help_add(help, _("L:\t\t Set/unset loop play mode"));
 	help_add(help, _("o:\t\t Variables manager"));
+	help_add(help, _("gl:\t\t Play lists"));
 	help_add(help, _("O:\t\t Show logger window"));
 	help_add(help, _("U:\t\t Undo"));
 	help_add(help, _("D:\t\t Redo"));
@@ -211,6 +212,7 @@ void help_init_player( help_screen_t *help )
 	help_add(help, _("`<Letter>:\t Go to mark <Letter>"));
 	help_add(help, _("``:\t\t Go to previous position"));
 	help_add(help, _("<Backspace>:\t Go to previous time"));
+	help_add(help, _("<Ctrl-g>:\t Cancel adding files"));
 	help_add(help, "");
 	help_add(help, _("Window library bindings"));
 	help_add(help, _("^l:\t\t Redisplay screen"));
@@ -23,16 +23,26 @@
 
 #include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
+#include <glib.h>
 #include "types.h"
 #include "info_rw_thread.h"
 #include "player.h"
 #include "song.h"
 #include "util.h"
 
-/* Thread queue */
+/* Thread queue (background priority) and the set of songs in it */
 irw_queue_t *irw_head, *irw_tail;
+GHashTable *irw_queued = NULL;
 pthread_mutex_t irw_mutex;
 
+/* Songs to be read first (see irw_hint) */
+song_t *irw_hints[IRW_MAX_HINTS];
+int irw_num_hints = 0, irw_next_hint = 0;
+
+/* Number of threads waiting for the queue to be read */
+int irw_hurry_count = 0;
+
 /* Thread info */
 pthread_t irw_tid = 0;
 bool_t irw_stop_thread = FALSE;
@@ -42,6 +52,10 @@ bool_t irw_init( void )
 {
 	/* Initialize queue */
 	irw_head = irw_tail = NULL;
+	irw_queued = g_hash_table_new(g_direct_hash, g_direct_equal);
+	if (irw_queued == NULL)
+		return FALSE;
+	irw_num_hints = irw_next_hint = 0;
 	pthread_mutex_init(&irw_mutex, NULL);
 
 	/* Initialize thread */
@@ -54,6 +68,7 @@ bool_t irw_init( void )
 void irw_free( void )
 {
 	irw_queue_t *q;
+	int i;
 
 	/* Stop thread */
 	if (irw_tid)
@@ -72,71 +87,91 @@ void irw_free( void )
 		free(q);
 		q = next;
 	}
+	irw_head = irw_tail = NULL;
+	for ( i = irw_next_hint; i < irw_num_hints; i ++ )
+		song_free(irw_hints[i]);
+	irw_num_hints = irw_next_hint = 0;
+	if (irw_queued != NULL)
+	{
+		g_hash_table_destroy(irw_queued);
+		irw_queued = NULL;
+	}
 } /* End of 'irw_free' function */
 
 /* Add song to the queue */
 void irw_push( song_t *song, song_flags_t flag )
 {
-	irw_queue_t *node, *q;
+	irw_queue_t *node;
 
 	/* Check if this song is not in queue */
 	irw_lock();
-	for ( q = irw_head; q != NULL; q = q->m_next )
+	song->m_flags |= flag;
+	if (g_hash_table_contains(irw_queued, song))
 	{
-		if (q->m_song == song)
-		{
-			/* If we want to write info and song in the queue has no this
-			 * flag yet, move it to the queue head */
-			if (flag & SONG_INFO_WRITE && !(song->m_flags & SONG_INFO_WRITE))
-			{
-				if (q->m_prev != NULL)
-					q->m_prev->m_next = q->m_next;
-				if (q->m_next != NULL)
-					q->m_next->m_prev = q->m_prev;
-				else
-					irw_tail = q->m_prev;
-				q->m_prev = NULL;
-				q->m_next = irw_head;
-				irw_head->m_prev = q;
-				irw_head = q;
-			}
-			song->m_flags |= flag;
-			irw_unlock();
-			return;
-		}
+		irw_unlock();
+		return;
 	}
 
 	/* Create new queue node */
 	node = (irw_queue_t *)malloc(sizeof(*node));
 	if (node == NULL)
+	{
+		irw_unlock();
 		return;
+	}
 	node->m_song = song_add_ref(song);
-	node->m_song->m_flags |= flag;
+	g_hash_table_add(irw_queued, song);
 
-	/* If we want to write info - move node to the head */
-	if (flag & SONG_INFO_WRITE)
-	{
-		node->m_prev = NULL;
-		node->m_next = irw_head;
-		if (irw_head != NULL)
-			irw_head->m_prev = node;
-		else
-			irw_tail = node;
-		irw_head = node;
-	}
-	/* Else - move node to the tail */
+	/* Move node to the tail */
+	node->m_next = NULL;
+	node->m_prev = irw_tail;
+	if (irw_tail != NULL)
+		irw_tail->m_next = node;
 	else
+		irw_head = node;
+	irw_tail = node;
+	irw_unlock();
+} /* End of 'irw_push' function */
+
+/* Set songs which info must be read before the queued ones */
+void irw_hint( song_t **songs, int num )
+{
+	song_t *old[IRW_MAX_HINTS];
+	int i, num_old = 0;
+
+	if (num > IRW_MAX_HINTS)
+		num = IRW_MAX_HINTS;
+
+	irw_lock();
+
+	/* Same hints as before (it is the usual case on redisplay) */
+	if (num == irw_num_hints - irw_next_hint &&
+			!memcmp(songs, &irw_hints[irw_next_hint], sizeof(song_t *) * num))
 	{
-		node->m_next = NULL;
-		node->m_prev = irw_tail;
-		if (irw_tail != NULL)
-			irw_tail->m_next = node;
-		else
-			irw_head = node;
-		irw_tail = node;
+		irw_unlock();
+		return;
 	}
+
+	/* Replace hints */
+	for ( i = irw_next_hint; i < irw_num_hints; i ++ )
+		old[num_old ++] = irw_hints[i];
+	for ( i = 0; i < num; i ++ )
+		irw_hints[i] = song_add_ref(songs[i]);
+	irw_num_hints = num;
+	irw_next_hint = 0;
 	irw_unlock();
-} /* End of 'irw_push' function */
+
+	for ( i = 0; i < num_old; i ++ )
+		song_free(old[i]);
+} /* End of 'irw_hint' function */
+
+/* Start or stop reading queue at full speed */
+void irw_hurry( bool_t hurry )
+{
+	irw_lock();
+	irw_hurry_count += (hurry ? 1 : -1);
+	irw_unlock();
+} /* End of 'irw_hurry' function */
 
 /* Get song from the queue */
 song_t *irw_pop( void )
@@ -145,9 +180,19 @@ song_t *irw_pop( void )
 	irw_queue_t *next;
 
 	irw_lock();
+
+	/* Hinted songs go first */
+	if (irw_next_hint < irw_num_hints)
+	{
+		s = irw_hints[irw_next_hint ++];
+		irw_unlock();
+		return s;
+	}
+
 	if (irw_head != NULL)
 	{
 		s = irw_head->m_song;
+		g_hash_table_remove(irw_queued, s);
 		next = irw_head->m_next;
 		free(irw_head);
 		irw_head = next;
@@ -160,44 +205,45 @@ song_t *irw_pop( void )
 	return s;
 } /* End of 'irw_pop' function */
 
+/* Check if the next song must be read without a pause */
+static bool_t irw_urgent( void )
+{
+	bool_t urgent;
+
+	irw_lock();
+	urgent = (irw_next_hint < irw_num_hints || 
+			(irw_hurry_count > 0 && irw_head != NULL));
+	irw_unlock();
+	return urgent;
+} /* End of 'irw_urgent' function */
+
 /* Thread function */
 void *irw_thread( void *arg )
 {
 	for ( ; !irw_stop_thread; )
 	{
-		for ( ;; )
-		{
-			song_flags_t flags;
-			song_t *s;
-
-			/* Get next task */
-			s = irw_pop();
-			if (s == NULL)
-				break;
-			flags = s->m_flags;
+		song_t *s;
 
-			/* Read song info */
+		/* Get next task */
+		s = irw_pop();
+		if (s != NULL)
+		{
+			/* Read song info (writing is done by info writer, see
+			 * info_writer.h). Song may be already read if it was 
+			 * both hinted and queued */
 			if (s->m_flags & SONG_INFO_READ)
 			{
 				song_update_info(s);
 				wnd_invalidate(player_wnd);
 			}
 
-			/* Write song info */
-			if (s->m_flags & SONG_INFO_WRITE)
-			{
-				song_write_info(s);
-			}
-
 			/* Release song reference */
 			song_free(s);
-
-			/* If we have not written info - leave cycle to be able to stop
-			 * the thread */
-			if (!(flags & SONG_INFO_WRITE))
-				break;
 		}
-		util_wait();
+
+		/* Songs in the background are read at a low rate */
+		if (!irw_urgent())
+			util_wait();
 	}
 	return NULL;
 } /* End of 'irw_thread' function */
@@ -215,4 +261,3 @@ void irw_unlock( void )
 } /* End of 'irw_unlock' function */
 
 /* End of 'info_rw_thread.c' file */
-
@@ -27,6 +27,13 @@
 #include "types.h"
 #include "song.h"
 
+/* Songs are read in the background in the order they were pushed,
+ * except for the hinted ones (those which user sees now) which are read
+ * first. Hints are replaced as a whole each time */
+
+/* Maximal number of hinted songs */
+#define IRW_MAX_HINTS 256
+
 /* Songs queue */
 typedef struct tag_irw_queue_t 
 {
@@ -46,6 +53,13 @@ void irw_free( void );
 /* Add song to the queue */
 void irw_push( song_t *song, song_flags_t flag );
 
+/* Set songs which info must be read before the queued ones */
+void irw_hint( song_t **songs, int num );
+
+/* Start (hurry is TRUE) or stop reading queue at full speed. Used
+ * while somebody waits for info */
+void irw_hurry( bool_t hurry );
+
 /* Get song from the queue */
 song_t *irw_pop( void );
 
@@ -0,0 +1,463 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Song information writer.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib.h>
+#include "types.h"
+#include "cfg.h"
+#include "info_rw_thread.h"
+#include "info_writer.h"
+#include "player.h"
+#include "song.h"
+
+/* Maximal number of writer threads */
+#define IW_MAX_THREADS 16
+
+/* Batch of songs committed together */
+typedef struct tag_iw_batch_t
+{
+	int m_total, m_done, m_failed;
+	int m_groups_left;
+
+	/* Name of the first file failed (for the summary) */
+	char *m_first_failed;
+} iw_batch_t;
+
+/* Songs from a single directory */
+typedef struct tag_iw_group_t
+{
+	song_t **m_songs;
+	bool_t *m_written;
+	int m_num;
+	iw_batch_t *m_batch;
+	struct tag_iw_group_t *m_next;
+} iw_group_t;
+
+/* Songs collected for the next batch */
+static song_t **iw_collected = NULL;
+static int iw_num_collected = 0, iw_collected_size = 0;
+
+/* Songs which are collected or queued but not being written yet */
+static GHashTable *iw_pending = NULL;
+
+/* Songs being written now. A song pushed again while it is written is
+ * written once more, but only after the current write finishes */
+static GHashTable *iw_writing = NULL;
+static pthread_cond_t iw_written_cond;
+
+/* Groups queue */
+static iw_group_t *iw_head = NULL, *iw_tail = NULL;
+
+/* Threads stuff */
+static pthread_t iw_tids[IW_MAX_THREADS];
+static int iw_num_threads = 0;
+static pthread_mutex_t iw_mutex;
+static pthread_cond_t iw_cond;
+static bool_t iw_stop_threads = FALSE;
+
+/* Get length of the directory part of the song name */
+static int iw_dir_len( const char *name )
+{
+	const char *slash = strrchr(name, '/');
+	return (slash == NULL ? 0 : slash - name);
+} /* End of 'iw_dir_len' function */
+
+/* Compare songs by directory and then by name */
+static int iw_compare( const void *a, const void *b )
+{
+	const char *n1 = song_get_name(*(song_t **)a);
+	const char *n2 = song_get_name(*(song_t **)b);
+	int l1 = iw_dir_len(n1), l2 = iw_dir_len(n2);
+	int res = memcmp(n1, n2, (l1 < l2 ? l1 : l2));
+	if (res != 0)
+		return res;
+	if (l1 != l2)
+		return l1 - l2;
+	return strcmp(n1 + l1, n2 + l2);
+} /* End of 'iw_compare' function */
+
+/* Check if songs are in the same directory */
+static bool_t iw_same_dir( song_t *s1, song_t *s2 )
+{
+	const char *n1 = song_get_name(s1), *n2 = song_get_name(s2);
+	int l = iw_dir_len(n1);
+	return (l == iw_dir_len(n2) && !memcmp(n1, n2, l));
+} /* End of 'iw_same_dir' function */
+
+/* Create a group */
+static iw_group_t *iw_group_new( song_t **songs, int num, iw_batch_t *b )
+{
+	iw_group_t *g = (iw_group_t *)malloc(sizeof(*g));
+	if (g == NULL)
+		return NULL;
+	g->m_songs = (song_t **)malloc(sizeof(song_t *) * num);
+	g->m_written = (bool_t *)malloc(sizeof(bool_t) * num);
+	if (g->m_songs == NULL || g->m_written == NULL)
+	{
+		free(g->m_songs);
+		free(g->m_written);
+		free(g);
+		return NULL;
+	}
+	memcpy(g->m_songs, songs, sizeof(song_t *) * num);
+	g->m_num = num;
+	g->m_batch = b;
+	g->m_next = NULL;
+	return g;
+} /* End of 'iw_group_new' function */
+
+/* Flush written files of the group to disk */
+static void iw_sync_group( iw_group_t *g )
+{
+	char *dir_name = NULL;
+	int i, fd;
+
+	for ( i = 0; i < g->m_num; i ++ )
+	{
+		if (!g->m_written[i])
+			continue;
+		fd = open(g->m_songs[i]->m_filename, O_RDONLY);
+		if (fd < 0)
+			continue;
+		fsync(fd);
+		close(fd);
+		if (dir_name == NULL)
+			dir_name = strndup(g->m_songs[i]->m_filename, 
+					iw_dir_len(g->m_songs[i]->m_filename));
+	}
+
+	/* Directory too (TagLib may replace files) */
+	if (dir_name != NULL)
+	{
+		fd = open(*dir_name ? dir_name : "/", O_RDONLY);
+		if (fd >= 0)
+		{
+			fsync(fd);
+			close(fd);
+		}
+		free(dir_name);
+	}
+} /* End of 'iw_sync_group' function */
+
+/* Write songs of a group */
+static void iw_write_group( iw_group_t *g )
+{
+	iw_batch_t *b = g->m_batch;
+	int i, failed = 0;
+	char *first_failed = NULL;
+
+	/* Write files */
+	for ( i = 0; i < g->m_num; i ++ )
+	{
+		song_t *s = g->m_songs[i];
+
+		/* Wait for another thread writing this song. From now on a new 
+		 * push of this song means a new write */
+		pthread_mutex_lock(&iw_mutex);
+		while (g_hash_table_contains(iw_writing, s))
+			pthread_cond_wait(&iw_written_cond, &iw_mutex);
+		g_hash_table_remove(iw_pending, s);
+		g_hash_table_add(iw_writing, s);
+		pthread_mutex_unlock(&iw_mutex);
+
+		g->m_written[i] = song_write_info(s);
+
+		/* Song is written unless it was pushed again meanwhile */
+		pthread_mutex_lock(&iw_mutex);
+		g_hash_table_remove(iw_writing, s);
+		if (!g_hash_table_contains(iw_pending, s))
+			s->m_flags &= ~SONG_INFO_WRITE;
+		pthread_cond_broadcast(&iw_written_cond);
+		pthread_mutex_unlock(&iw_mutex);
+
+		if (!g->m_written[i])
+		{
+			logger_debug(player_log, "Failed to save info to file %s",
+					song_get_name(s));
+			if (first_failed == NULL)
+				first_failed = strdup(song_get_name(s));
+			failed ++;
+		}
+	}
+	if (cfg_get_var_bool(cfg_list, "info-write-sync"))
+		iw_sync_group(g);
+
+	/* Release songs. Info of the failed ones is read again */
+	for ( i = 0; i < g->m_num; i ++ )
+	{
+		song_t *s = g->m_songs[i];
+
+		if (!g->m_written[i])
+			irw_push(s, SONG_INFO_READ);
+		song_free(s);
+	}
+	wnd_invalidate(player_wnd);
+
+	/* Update batch and report about it */
+	pthread_mutex_lock(&iw_mutex);
+	b->m_done += g->m_num;
+	b->m_failed += failed;
+	if (b->m_first_failed == NULL)
+	{
+		b->m_first_failed = first_failed;
+		first_failed = NULL;
+	}
+	b->m_groups_left --;
+	if (b->m_groups_left > 0)
+	{
+		logger_message(player_log, 1, _("Saving song info: %d of %d files done"),
+				b->m_done, b->m_total);
+		b = NULL;
+	}
+	pthread_mutex_unlock(&iw_mutex);
+	free(first_failed);
+
+	/* It was the last group */
+	if (b != NULL)
+	{
+		if (b->m_failed == 1)
+			logger_error(player_log, 0, _("Failed to save info to file %s"),
+					b->m_first_failed);
+		else if (b->m_failed > 1)
+			logger_error(player_log, 0, 
+					_("Failed to save info to %d of %d files (%s and others)"),
+					b->m_failed, b->m_total, b->m_first_failed);
+		else
+			logger_message(player_log, 1, _("Song info saved to %d files"), 
+					b->m_total);
+		free(b->m_first_failed);
+		free(b);
+	}
+} /* End of 'iw_write_group' function */
+
+/* Thread function */
+static void *iw_thread( void *arg )
+{
+	pthread_mutex_lock(&iw_mutex);
+	for ( ;; )
+	{
+		iw_group_t *g = iw_head;
+
+		/* Wait for a group */
+		if (g == NULL)
+		{
+			if (iw_stop_threads)
+				break;
+			pthread_cond_wait(&iw_cond, &iw_mutex);
+			continue;
+		}
+		iw_head = g->m_next;
+		if (iw_head == NULL)
+			iw_tail = NULL;
+		pthread_mutex_unlock(&iw_mutex);
+
+		iw_write_group(g);
+		free(g->m_songs);
+		free(g->m_written);
+		free(g);
+
+		pthread_mutex_lock(&iw_mutex);
+	}
+	pthread_mutex_unlock(&iw_mutex);
+	return NULL;
+} /* End of 'iw_thread' function */
+
+/* Initialize writer threads */
+bool_t iw_init( void )
+{
+	int i, num;
+
+	iw_pending = g_hash_table_new(g_direct_hash, g_direct_equal);
+	if (iw_pending == NULL)
+		return FALSE;
+	iw_writing = g_hash_table_new(g_direct_hash, g_direct_equal);
+	if (iw_writing == NULL)
+	{
+		g_hash_table_destroy(iw_pending);
+		iw_pending = NULL;
+		return FALSE;
+	}
+	pthread_mutex_init(&iw_mutex, NULL);
+	pthread_cond_init(&iw_cond, NULL);
+	pthread_cond_init(&iw_written_cond, NULL);
+	iw_stop_threads = FALSE;
+
+	/* Start threads */
+	num = cfg_get_var_int(cfg_list, "info-write-threads");
+	if (num < 1)
+		num = 1;
+	else if (num > IW_MAX_THREADS)
+		num = IW_MAX_THREADS;
+	for ( i = 0; i < num; i ++ )
+	{
+		if (pthread_create(&iw_tids[iw_num_threads], NULL, iw_thread, NULL))
+			break;
+		iw_num_threads ++;
+	}
+	return (iw_num_threads > 0);
+} /* End of 'iw_init' function */
+
+/* Stop writer threads */
+void iw_free( void )
+{
+	int i;
+
+	if (iw_pending == NULL)
+		return;
+
+	/* Write what was scheduled and stop */
+	iw_commit();
+	pthread_mutex_lock(&iw_mutex);
+	iw_stop_threads = TRUE;
+	pthread_cond_broadcast(&iw_cond);
+	pthread_mutex_unlock(&iw_mutex);
+	for ( i = 0; i < iw_num_threads; i ++ )
+		pthread_join(iw_tids[i], NULL);
+	iw_num_threads = 0;
+
+	pthread_cond_destroy(&iw_cond);
+	pthread_cond_destroy(&iw_written_cond);
+	pthread_mutex_destroy(&iw_mutex);
+	g_hash_table_destroy(iw_pending);
+	iw_pending = NULL;
+	g_hash_table_destroy(iw_writing);
+	iw_writing = NULL;
+	free(iw_collected);
+	iw_collected = NULL;
+	iw_num_collected = iw_collected_size = 0;
+} /* End of 'iw_free' function */
+
+/* Schedule song info writing */
+void iw_push( song_t *song )
+{
+	if (song == NULL || iw_pending == NULL)
+		return;
+
+	pthread_mutex_lock(&iw_mutex);
+
+	/* This song is not written yet, so its latest info will be written */
+	if (g_hash_table_contains(iw_pending, song))
+	{
+		pthread_mutex_unlock(&iw_mutex);
+		return;
+	}
+
+	/* Add song to the collected ones */
+	if (iw_num_collected >= iw_collected_size)
+	{
+		int new_size = (iw_collected_size == 0 ? 32 : iw_collected_size * 2);
+		song_t **new_songs = (song_t **)realloc(iw_collected, 
+				sizeof(song_t *) * new_size);
+		if (new_songs == NULL)
+		{
+			pthread_mutex_unlock(&iw_mutex);
+			return;
+		}
+		iw_collected = new_songs;
+		iw_collected_size = new_size;
+	}
+	song->m_flags |= SONG_INFO_WRITE;
+	iw_collected[iw_num_collected ++] = song_add_ref(song);
+	g_hash_table_add(iw_pending, song);
+	pthread_mutex_unlock(&iw_mutex);
+} /* End of 'iw_push' function */
+
+/* Start writing the scheduled songs */
+void iw_commit( void )
+{
+	iw_batch_t *b;
+	iw_group_t *head = NULL, *tail = NULL, *g;
+	song_t **songs;
+	int num, i, start = 0;
+
+	/* Take the collected songs */
+	pthread_mutex_lock(&iw_mutex);
+	songs = iw_collected;
+	num = iw_num_collected;
+	iw_collected = NULL;
+	iw_num_collected = iw_collected_size = 0;
+	pthread_mutex_unlock(&iw_mutex);
+	if (num == 0)
+		return;
+
+	/* Split songs into directory groups */
+	b = (iw_batch_t *)malloc(sizeof(*b));
+	if (b != NULL)
+	{
+		memset(b, 0, sizeof(*b));
+		qsort(songs, num, sizeof(*songs), iw_compare);
+		for ( start = 0; start < num; start = i )
+		{
+			for ( i = start + 1; i < num && iw_same_dir(songs[start], songs[i]); 
+					i ++ );
+			g = iw_group_new(&songs[start], i - start, b);
+			if (g == NULL)
+				break;
+			if (tail != NULL)
+				tail->m_next = g;
+			else
+				head = g;
+			tail = g;
+			b->m_total += g->m_num;
+			b->m_groups_left ++;
+		}
+	}
+
+	/* Queue groups */
+	if (head != NULL)
+	{
+		pthread_mutex_lock(&iw_mutex);
+		if (iw_tail != NULL)
+			iw_tail->m_next = head;
+		else
+			iw_head = head;
+		iw_tail = tail;
+		pthread_cond_broadcast(&iw_cond);
+		pthread_mutex_unlock(&iw_mutex);
+	}
+	else
+		free(b);
+
+	/* Not enough memory for the rest of songs */
+	if (start < num)
+	{
+		logger_error(player_log, 0, _("No memory for saving info to %d files"),
+				num - start);
+		pthread_mutex_lock(&iw_mutex);
+		for ( i = start; i < num; i ++ )
+		{
+			g_hash_table_remove(iw_pending, songs[i]);
+			songs[i]->m_flags &= ~SONG_INFO_WRITE;
+		}
+		pthread_mutex_unlock(&iw_mutex);
+		for ( i = start; i < num; i ++ )
+			song_free(songs[i]);
+	}
+	free(songs);
+} /* End of 'iw_commit' function */
+
+/* End of 'info_writer.c' file */
@@ -0,0 +1,54 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Interface for song information writer.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_INFO_WRITER_H__
+#define __SG_MPFC_INFO_WRITER_H__
+
+#include "types.h"
+#include "main_types.h"
+
+/*
+ * Song information is written in batches. Songs pushed with iw_push are
+ * collected until iw_commit is called. A song pushed again before its
+ * file is written is written once, with its latest info (songs are 
+ * shared by file name, see song.c). Committed songs are grouped by
+ * directory and the groups are written by a pool of threads. Files of a
+ * group are synced together, and each batch ends with a single summary
+ * message. Files that could not be written get their info read again.
+ */
+
+/* Initialize writer threads */
+bool_t iw_init( void );
+
+/* Stop writer threads. Already committed songs are written first */
+void iw_free( void );
+
+/* Schedule song info writing */
+void iw_push( song_t *song );
+
+/* Start writing the scheduled songs */
+void iw_commit( void );
+
+#endif
+
+/* End of 'info_writer.h' file */
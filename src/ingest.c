@@ -0,0 +1,491 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Play list files ingestion.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "types.h"
+#include "cfg.h"
+#include "ingest.h"
+#include "file_utils.h"
+#include "player.h"
+#include "plist.h"
+#include "pmng.h"
+#include "util.h"
+#include "wnd.h"
+
+/* Maximal number of directory walkers */
+#define INGEST_MAX_THREADS 64
+
+/* Number of files merged between progress checks */
+#define INGEST_PROGRESS_STEP 1024
+
+/* Directory node */
+typedef struct tag_ingest_dir_t
+{
+	/* Directory path */
+	char *m_path;
+
+	/* Filtered listing and subdirectories nodes for its entries 
+	 * (NULL for files). Set by walker together with 'm_done' */
+	fu_list_t *m_list;
+	struct tag_ingest_dir_t **m_dirs;
+	bool_t m_done;
+
+	/* Next node in the work stack */
+	struct tag_ingest_dir_t *m_next;
+} ingest_dir_t;
+
+/* Directory walk data */
+typedef struct
+{
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_work_cond, m_done_cond;
+
+	/* Directories waiting to be read */
+	ingest_dir_t *m_work;
+	bool_t m_stop;
+
+	/* Adding parameters */
+	bool_t m_smart_add, m_skip_hidden;
+
+	/* Progress (updated by merging thread) */
+	int m_num_files, m_num_dirs;
+	time_t m_progress_time;
+} ingest_walk_t;
+
+/* Jobs thread data */
+static pthread_t ingest_tid = 0;
+static pthread_mutex_t ingest_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ingest_cond = PTHREAD_COND_INITIALIZER;
+static ingest_job_t *ingest_head = NULL, *ingest_tail = NULL;
+static bool_t ingest_end = FALSE;
+static bool_t ingest_busy = FALSE;
+static volatile bool_t ingest_cancel_flag = FALSE;
+
+/* Free job */
+static void ingest_job_free( ingest_job_t *job )
+{
+	plist_set_free(job->m_set);
+	free(job);
+} /* End of 'ingest_job_free' function */
+
+/* Choose the best ranked play list for smart directory adding */
+static int ingest_smart_choose( fu_list_t *list )
+{
+	int idx = -1, rank = 0;
+	int i;
+
+	for ( i = 0; i < list->m_num; i ++ )
+	{
+		char *ext = strrchr(list->m_entries[i].m_name, '.');
+		if (ext == NULL || !(*(++ext)))
+			continue;
+
+		plist_plugin_t *plp = pmng_is_playlist_extension(player_pmng, ext);
+		if (plp == NULL)
+			continue;
+
+		int this_rank = PLIST_RANK(plp);
+		if (idx < 0 || this_rank > rank)
+		{
+			idx = i;
+			rank = this_rank;
+		}
+	}
+	return idx;
+} /* End of 'ingest_smart_choose' function */
+
+/* Read directory. Subdirectories nodes are created here */
+static void ingest_scan_dir( ingest_walk_t *w, ingest_dir_t *node )
+{
+	int only_idx = -1;
+	int i, j, err;
+
+	fu_list_t *list = fu_list_dir(node->m_path, 
+			FU_LIST_SORT | FU_LIST_HIDDEN | FU_LIST_NOCACHE);
+	err = errno;
+	if (list == NULL)
+	{
+		logger_error(player_log, 1, _("Unable to read directory %s: %s"),
+				node->m_path, strerror(err));
+		return;
+	}
+	ingest_dir_t **dirs = (ingest_dir_t **)malloc(
+			sizeof(*dirs) * (list->m_num + 1));
+	if (dirs == NULL)
+	{
+		fu_list_free(list);
+		return;
+	}
+
+	/* Smart directory adding: add only one play list if there is any */
+	if (w->m_smart_add)
+		only_idx = ingest_smart_choose(list);
+
+	/* Filter entries */
+	for ( i = 0, j = 0; i < list->m_num; i ++ )
+	{
+		fu_list_entry_t *e = &list->m_entries[i];
+
+		if ((only_idx >= 0 && i != only_idx) ||
+				(e->m_name[0] == '.' && w->m_skip_hidden))
+			continue;
+
+		/* Create subdirectory node */
+		dirs[j] = NULL;
+		if (e->m_is_dir)
+		{
+			ingest_dir_t *sub = (ingest_dir_t *)malloc(sizeof(*sub));
+			if (sub == NULL)
+				continue;
+			memset(sub, 0, sizeof(*sub));
+			sub->m_path = util_strcat(node->m_path, "/", e->m_name, NULL);
+			dirs[j] = sub;
+		}
+		list->m_entries[j ++] = *e;
+	}
+	list->m_num = j;
+
+	node->m_list = list;
+	node->m_dirs = dirs;
+} /* End of 'ingest_scan_dir' function */
+
+/* Directory walker thread function */
+static void *ingest_walker( void *arg )
+{
+	ingest_walk_t *w = (ingest_walk_t *)arg;
+
+	pthread_mutex_lock(&w->m_mutex);
+	for ( ;; )
+	{
+		int i;
+
+		while (w->m_work == NULL && !w->m_stop)
+			pthread_cond_wait(&w->m_work_cond, &w->m_mutex);
+		if (w->m_stop)
+			break;
+
+		/* Take directory from the stack and read it */
+		ingest_dir_t *node = w->m_work;
+		w->m_work = node->m_next;
+		pthread_mutex_unlock(&w->m_mutex);
+		ingest_scan_dir(w, node);
+		pthread_mutex_lock(&w->m_mutex);
+
+		/* Publish entries. Subdirectories are pushed in reverse order,
+		 * so that they are read in the order they are merged */
+		node->m_done = TRUE;
+		for ( i = (node->m_list == NULL ? 0 : node->m_list->m_num) - 1; 
+				i >= 0; i -- )
+		{
+			if (node->m_dirs[i] == NULL)
+				continue;
+			node->m_dirs[i]->m_next = w->m_work;
+			w->m_work = node->m_dirs[i];
+		}
+		pthread_cond_broadcast(&w->m_work_cond);
+		pthread_cond_broadcast(&w->m_done_cond);
+	}
+	pthread_mutex_unlock(&w->m_mutex);
+	return NULL;
+} /* End of 'ingest_walker' function */
+
+/* Report progress */
+static void ingest_progress( ingest_walk_t *w )
+{
+	time_t now = time(NULL);
+	if (now == w->m_progress_time)
+		return;
+	w->m_progress_time = now;
+	logger_status_msg(player_log, 1, 
+			_("Adding files: %d found in %d directories"),
+			w->m_num_files, w->m_num_dirs);
+} /* End of 'ingest_progress' function */
+
+/* Merge directory contents in order */
+static bool_t ingest_merge( ingest_walk_t *w, ingest_dir_t *node,
+		ingest_func_t f, void *ctx )
+{
+	int i;
+
+	/* Wait for directory to be read */
+	pthread_mutex_lock(&w->m_mutex);
+	while (!node->m_done)
+		pthread_cond_wait(&w->m_done_cond, &w->m_mutex);
+	pthread_mutex_unlock(&w->m_mutex);
+	w->m_num_dirs ++;
+
+	for ( i = 0; node->m_list != NULL && i < node->m_list->m_num; i ++ )
+	{
+		if (ingest_cancelled())
+			return FALSE;
+
+		if (node->m_dirs[i] != NULL)
+		{
+			if (!ingest_merge(w, node->m_dirs[i], f, ctx))
+				return FALSE;
+			continue;
+		}
+
+		char *path = util_strcat(node->m_path, "/", 
+				node->m_list->m_entries[i].m_name, NULL);
+		bool_t cont = f(ctx, path);
+		free(path);
+		if (!cont)
+			return FALSE;
+
+		if (((++ w->m_num_files) % INGEST_PROGRESS_STEP) == 0)
+			ingest_progress(w);
+	}
+	return TRUE;
+} /* End of 'ingest_merge' function */
+
+/* Free directory tree */
+static void ingest_free_dir( ingest_dir_t *node )
+{
+	int i;
+
+	if (node->m_list != NULL)
+	{
+		for ( i = 0; i < node->m_list->m_num; i ++ )
+		{
+			if (node->m_dirs[i] != NULL)
+				ingest_free_dir(node->m_dirs[i]);
+		}
+		fu_list_free(node->m_list);
+		free(node->m_dirs);
+	}
+	free(node->m_path);
+	free(node);
+} /* End of 'ingest_free_dir' function */
+
+/* Walk directory tree calling function for each file */
+void ingest_walk( char *dir_path, ingest_func_t f, void *ctx )
+{
+	CFG_VAR_HANDLE(smart_add_h, "smart-dir-add");
+	CFG_VAR_HANDLE(skip_hidden_h, "skip-hidden-files");
+	pthread_t tids[INGEST_MAX_THREADS];
+	int num_threads, i;
+	ingest_walk_t w;
+
+	/* Initialize walk */
+	memset(&w, 0, sizeof(w));
+	pthread_mutex_init(&w.m_mutex, NULL);
+	pthread_cond_init(&w.m_work_cond, NULL);
+	pthread_cond_init(&w.m_done_cond, NULL);
+	w.m_smart_add = cfg_handle_get_var_bool(cfg_list, &smart_add_h);
+	w.m_skip_hidden = cfg_handle_get_var_bool(cfg_list, &skip_hidden_h);
+	w.m_progress_time = time(NULL);
+
+	ingest_dir_t *root = (ingest_dir_t *)malloc(sizeof(*root));
+	if (root == NULL)
+		return;
+	memset(root, 0, sizeof(*root));
+	root->m_path = strdup(dir_path);
+	w.m_work = root;
+
+	/* Start walkers */
+	num_threads = cfg_get_var_int(cfg_list, "add-threads");
+	if (num_threads < 1)
+		num_threads = 1;
+	else if (num_threads > INGEST_MAX_THREADS)
+		num_threads = INGEST_MAX_THREADS;
+	for ( i = 0; i < num_threads; i ++ )
+	{
+		if (pthread_create(&tids[i], NULL, ingest_walker, &w))
+			break;
+	}
+	num_threads = i;
+
+	/* Merge results */
+	if (num_threads > 0)
+		ingest_merge(&w, root, f, ctx);
+	else
+		logger_error(player_log, 0, _("Unable to create directory walker"));
+
+	/* Stop walkers */
+	pthread_mutex_lock(&w.m_mutex);
+	w.m_stop = TRUE;
+	pthread_cond_broadcast(&w.m_work_cond);
+	pthread_mutex_unlock(&w.m_mutex);
+	for ( i = 0; i < num_threads; i ++ )
+		pthread_join(tids[i], NULL);
+
+	ingest_free_dir(root);
+	pthread_cond_destroy(&w.m_done_cond);
+	pthread_cond_destroy(&w.m_work_cond);
+	pthread_mutex_destroy(&w.m_mutex);
+} /* End of 'ingest_walk' function */
+
+/* Jobs thread function */
+static void *ingest_thread( void *arg )
+{
+	pthread_mutex_lock(&ingest_mutex);
+	for ( ;; )
+	{
+		while (ingest_head == NULL && !ingest_end)
+			pthread_cond_wait(&ingest_cond, &ingest_mutex);
+		if (ingest_end)
+			break;
+
+		/* Take job */
+		ingest_job_t *job = ingest_head;
+		ingest_head = job->m_next;
+		if (ingest_head == NULL)
+			ingest_tail = NULL;
+		ingest_busy = TRUE;
+		ingest_cancel_flag = FALSE;
+		pthread_mutex_unlock(&ingest_mutex);
+
+		/* Add files and let window thread finish the job */
+		job->m_num_added = plist_add_set_files(job->m_pl, job->m_set);
+		if (player_wnd != NULL)
+			wnd_msg_send(player_wnd, "user", 
+					wnd_msg_user_new(PLAYER_MSG_ADD_DONE, job));
+		else
+			ingest_job_free(job);
+
+		pthread_mutex_lock(&ingest_mutex);
+		ingest_busy = FALSE;
+	}
+	pthread_mutex_unlock(&ingest_mutex);
+	return NULL;
+} /* End of 'ingest_thread' function */
+
+/* Initialize ingestion thread */
+bool_t ingest_init( void )
+{
+	ingest_end = FALSE;
+	if (pthread_create(&ingest_tid, NULL, ingest_thread, NULL))
+	{
+		ingest_tid = 0;
+		return FALSE;
+	}
+	return TRUE;
+} /* End of 'ingest_init' function */
+
+/* Drop pending jobs. Jobs mutex must be locked */
+static void ingest_drop_jobs( void )
+{
+	while (ingest_head != NULL)
+	{
+		ingest_job_t *next = ingest_head->m_next;
+		ingest_job_free(ingest_head);
+		ingest_head = next;
+	}
+	ingest_tail = NULL;
+} /* End of 'ingest_drop_jobs' function */
+
+/* Stop ingestion thread and drop pending jobs */
+void ingest_free( void )
+{
+	if (!ingest_tid)
+		return;
+
+	pthread_mutex_lock(&ingest_mutex);
+	ingest_end = TRUE;
+	ingest_cancel_flag = TRUE;
+	ingest_drop_jobs();
+	pthread_cond_signal(&ingest_cond);
+	pthread_mutex_unlock(&ingest_mutex);
+	pthread_join(ingest_tid, NULL);
+	ingest_tid = 0;
+} /* End of 'ingest_free' function */
+
+/* Add a set of files in background (set is copied) */
+bool_t ingest_push( plist_t *pl, plist_set_t *set, bool_t hook )
+{
+	ingest_job_t *job;
+
+	/* Add synchronously if there is no thread */
+	if (!ingest_tid)
+	{
+		bool_t ret = plist_add_set(pl, set);
+		if (hook)
+			pmng_hook(player_pmng, "playlist");
+		return ret;
+	}
+
+	job = (ingest_job_t *)malloc(sizeof(*job));
+	if (job == NULL)
+		return FALSE;
+	job->m_pl = pl;
+	job->m_set = plist_set_dup(set);
+	job->m_num_added = 0;
+	job->m_hook = hook;
+	job->m_next = NULL;
+	if (job->m_set == NULL)
+	{
+		free(job);
+		return FALSE;
+	}
+
+	pthread_mutex_lock(&ingest_mutex);
+	if (ingest_tail == NULL)
+		ingest_head = job;
+	else
+		ingest_tail->m_next = job;
+	ingest_tail = job;
+	pthread_cond_signal(&ingest_cond);
+	pthread_mutex_unlock(&ingest_mutex);
+	return TRUE;
+} /* End of 'ingest_push' function */
+
+/* Finish a job in the window thread */
+void ingest_job_done( ingest_job_t *job )
+{
+	plist_add_set_done(job->m_pl, job->m_set, job->m_num_added);
+	if (job->m_hook)
+		pmng_hook(player_pmng, "playlist");
+	logger_status_msg(player_log, 1, _("%d songs added"), job->m_num_added);
+	ingest_job_free(job);
+	wnd_invalidate(player_wnd);
+} /* End of 'ingest_job_done' function */
+
+/* Cancel the running and pending jobs */
+void ingest_cancel( void )
+{
+	bool_t was_busy;
+
+	pthread_mutex_lock(&ingest_mutex);
+	was_busy = ingest_busy || (ingest_head != NULL);
+	ingest_drop_jobs();
+	if (ingest_busy)
+		ingest_cancel_flag = TRUE;
+	pthread_mutex_unlock(&ingest_mutex);
+
+	if (was_busy)
+		logger_message(player_log, 0, _("Adding files cancelled"));
+} /* End of 'ingest_cancel' function */
+
+/* Check if adding was cancelled (only jobs may be cancelled) */
+bool_t ingest_cancelled( void )
+{
+	return ingest_cancel_flag && ingest_tid && 
+		pthread_equal(pthread_self(), ingest_tid);
+} /* End of 'ingest_cancelled' function */
+
+/* End of 'ingest.c' file */
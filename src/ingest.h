@@ -0,0 +1,81 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Interface for the play list files ingestion.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_INGEST_H__
+#define __SG_MPFC_INGEST_H__
+
+#include "types.h"
+#include "plist.h"
+
+/*
+ * Directories are walked by a pool of worker threads, while the
+ * calling thread merges their results in the same order a recursive
+ * sorted walk would give. Whole add requests may also be run in the
+ * background; they are done one by one and finished in the window
+ * thread with 'ingest_job_done'.
+ */
+
+/* Function called for each file found. Return FALSE to stop walking */
+typedef bool_t (*ingest_func_t)( void *ctx, char *path );
+
+/* Background add request */
+typedef struct tag_ingest_job_t
+{
+	/* Play list and files to add */
+	plist_t *m_pl;
+	plist_set_t *m_set;
+
+	/* Number of songs added */
+	int m_num_added;
+
+	/* Call play list hook when done */
+	bool_t m_hook;
+
+	/* Next job in the queue */
+	struct tag_ingest_job_t *m_next;
+} ingest_job_t;
+
+/* Initialize ingestion thread */
+bool_t ingest_init( void );
+
+/* Stop ingestion thread and drop pending jobs */
+void ingest_free( void );
+
+/* Walk directory tree calling function for each file */
+void ingest_walk( char *dir_path, ingest_func_t f, void *ctx );
+
+/* Add a set of files in background (set is copied) */
+bool_t ingest_push( plist_t *pl, plist_set_t *set, bool_t hook );
+
+/* Finish a job in the window thread */
+void ingest_job_done( ingest_job_t *job );
+
+/* Cancel the running and pending jobs */
+void ingest_cancel( void );
+
+/* Check if adding was cancelled */
+bool_t ingest_cancelled( void );
+
+#endif
+
+/* End of 'ingest.h' file */
@@ -40,41 +40,58 @@ typedef enum
 
 typedef int64_t song_time_t;
 
-/* Song type */
+/* Rarely used song fields. They are set when the song is created and 
+ * never change, so they are read without locking */
+typedef struct tag_song_cold_t
+{
+	/* Full name in an URI form. Set only for songs created from an URI;
+	 * for files it is made on demand (see song_get_uri) */
+	char *m_fullname;
+
+	/* Song start and end (for projected songs) */
+	song_time_t m_start_time, m_end_time;
+
+	/* Default title (used when no info is found) */
+	char *m_default_title;
+} song_cold_t;
+
+/* Song type. Fields used while traversing play list go first */
 typedef struct tag_song_t
 {
 	/* Song title */
 	str_t *m_title;
 
-	/* Full name in an URI form (with prefix and escaped special symbols) */
-	char *m_fullname;
-
-	/* Real file name (might be null if the song has been created from an URI) */
-	char *m_filename;
+	/* Song title decoded for displaying (built on demand) */
+	str_wide_t *m_wide_title;
 
 	/* Sliced song length */
 	song_time_t m_len;
 
-	/* Full song length */
-	song_time_t m_full_len;
+	/* Flags */
+	song_flags_t m_flags;
 
-	/* Song start and end (for projected songs) */
-	song_time_t m_start_time, m_end_time;
+	/* Song object references counter */
+	int m_ref_count;
+
+	/* Titles generation the title was built in (see song.c) */
+	dword m_title_gen;
 
 	/* Song information */
 	song_info_t *m_info;
 
-	/* Flags */
-	song_flags_t m_flags;
+	/* Real file name (might be null if the song has been created from an URI) */
+	char *m_filename;
 
-	/* Song object references counter */
-	int m_ref_count;
+	/* Full song length */
+	song_time_t m_full_len;
 
-	/* Default title (used when no info is found) */
-	char *m_default_title;
+	/* Rarely used fields. Allocated only for songs created from an URI,
+	 * sliced ones and ones with a fixed title (see song_get_cold) */
+	song_cold_t *m_cold;
 
-	/* Song mutex */
-	pthread_mutex_t m_mutex;
+	/* Songs registry chain and key hash (see song.c) */
+	struct tag_song_t *m_registry_next;
+	dword m_registry_hash;
 } song_t;
 
 static inline int TIME_TO_SECONDS(song_time_t x) { return x / 1000000000LL; }
@@ -96,6 +113,9 @@ typedef struct tag_song_metadata_t
 /* Play list type */
 typedef struct
 {
+	/* Play list name */
+	char *m_name;
+
 	/* List start position in the window */
 	int m_start_pos;
 
@@ -114,8 +134,11 @@ typedef struct
 	/* List size */
 	int m_len;
 
-	/* Songs list */
-	song_t **m_list;
+	/* Songs sequence */
+	struct tag_pseq_t *m_seq;
+
+	/* Checkpointer saving this list (see checkpoint.h) */
+	struct tag_ckpt_t *m_ckpt;
 
 	/* Mutex for synchronization play list operations */
 	pthread_mutex_t m_mutex;
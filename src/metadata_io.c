@@ -166,6 +166,19 @@ static song_info_t *md_get_info_gst( const char *full_name, song_time_t *len )
 				si_set_track(si, trackstr);
 			}
 
+			gdouble gain, peak;
+			if (gst_tag_list_get_double(tags, GST_TAG_TRACK_GAIN, &gain))
+			{
+				if (!gst_tag_list_get_double(tags, GST_TAG_TRACK_PEAK, &peak))
+					peak = 0;
+				si_set_replay_gain(si, FALSE, gain, peak);
+			}
+			if (gst_tag_list_get_double(tags, GST_TAG_ALBUM_GAIN, &gain))
+			{
+				if (!gst_tag_list_get_double(tags, GST_TAG_ALBUM_PEAK, &peak))
+					peak = 0;
+				si_set_replay_gain(si, TRUE, gain, peak);
+			}
 
 			gst_tag_list_free(tags);
 		}
@@ -196,6 +209,45 @@ finally:
 	return si;
 } /* End of 'md_get_info_gst' function */
 	
+#ifdef HAVE_TAGLIB_PROPERTY_GET
+/* Get a numeric value of a taglib property (e.g. "-6.20 dB") */
+static bool_t md_get_taglib_number( TagLib_File *file, const char *prop, float *val )
+{
+	char **values = taglib_property_get(file, prop);
+	if (values == NULL)
+		return FALSE;
+
+	bool_t found = FALSE;
+	if (values[0] != NULL)
+	{
+		char *end;
+		(*val) = strtof(values[0], &end);
+		found = (end != values[0]);
+	}
+	taglib_property_free(values);
+	return found;
+} /* End of 'md_get_taglib_number' function */
+
+/* Read ReplayGain values from the taglib properties */
+static void md_get_replay_gain_taglib( TagLib_File *file, song_info_t *si )
+{
+	float gain, peak;
+
+	if (md_get_taglib_number(file, "REPLAYGAIN_TRACK_GAIN", &gain))
+	{
+		if (!md_get_taglib_number(file, "REPLAYGAIN_TRACK_PEAK", &peak))
+			peak = 0;
+		si_set_replay_gain(si, FALSE, gain, peak);
+	}
+	if (md_get_taglib_number(file, "REPLAYGAIN_ALBUM_GAIN", &gain))
+	{
+		if (!md_get_taglib_number(file, "REPLAYGAIN_ALBUM_PEAK", &peak))
+			peak = 0;
+		si_set_replay_gain(si, TRUE, gain, peak);
+	}
+} /* End of 'md_get_replay_gain_taglib' function */
+#endif
+
 /* Get song information using taglib */
 static song_info_t *md_get_info_taglib( const char *file_name, song_time_t *len )
 {
@@ -233,6 +285,10 @@ static song_info_t *md_get_info_taglib( const char *file_name, song_time_t *len
 		si_set_track(si, t);
 	}
 
+#ifdef HAVE_TAGLIB_PROPERTY_GET
+	md_get_replay_gain_taglib(file, si);
+#endif
+
 	(*len) = SECONDS_TO_TIME(taglib_audioproperties_length(taglib_file_audioproperties(file)));
 
 	taglib_tag_free_strings();
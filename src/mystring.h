@@ -23,19 +23,23 @@
 #ifndef __SG_MPFC_MYSTRING_H__
 #define __SG_MPFC_MYSTRING_H__
 
+#include <wchar.h>
 #include "types.h"
 
+/* Size of the storage for short strings kept inside the string itself */
+#define STR_INLINE_SIZE 32
+
 /* String type */
 typedef struct
 {
-	/* String data */
+	/* String data (points to m_inline for short strings) */
 	char *m_data;
 
 	/* String length in bytes */
 	int m_len;
 
-	/* Amount of memory allocated for string and size of allocation portion */
-	int m_allocated, m_portion_size;
+	/* Amount of memory available for string data */
+	int m_allocated;
 
 	/* Multibyte UTF-8 sequence insertion state */
 	int m_bytes_to_complete;
@@ -43,8 +47,26 @@ typedef struct
 
 	/* Cached string width. -1 if not initialized */
 	int m_width;
+
+	/* Inline storage for short strings */
+	char m_inline[STR_INLINE_SIZE];
 } str_t;
 
+/* String decoded for displaying */
+typedef struct
+{
+	/* Characters and their display widths */
+	wchar_t *m_chars;
+	byte *m_widths;
+
+	/* Number of characters and total display width */
+	int m_len, m_width;
+
+	/* Last computed cut point: number of characters that fit into
+	 * 'm_cut_width' positions */
+	int m_cut_width, m_cut_len;
+} str_wide_t;
+
 /* Get string length */
 #define STR_BYTE_LEN(str) ((str)->m_len)
 
@@ -76,6 +98,12 @@ str_t *str_cat_cptr( str_t *dest, const char *src );
 /* Concatenate strings */
 str_t *str_cat( str_t *dest, const str_t *src );
 
+/* Concatenate string with first 'len' bytes of (char *) */
+str_t *str_cat_cptr_len( str_t *dest, const char *src, int len );
+
+/* Make sure that string has enough memory to hold 'len' bytes */
+void str_reserve( str_t *str, int len );
+
 /* Insert a character into string 
  * Returns number of inserted screen positions
  * If string becomes temporarily inconsistent (because incomplete utf-8 sequence
@@ -124,6 +152,16 @@ static inline int str_width( str_t *str )
  * sym_pos may be updated by a different delta if wide symbols are encountered */
 void str_skip_positions( str_t *str, int *byte_pos, int *sym_pos, int delta );
 
+/* Decode string for displaying */
+str_wide_t *str_wide_new( const str_t *str );
+
+/* Free decoded string */
+void str_wide_free( str_wide_t *ws );
+
+/* Get number of characters of a decoded string that fit into 
+ * 'width' positions */
+int str_wide_cut( str_wide_t *ws, int width );
+
 #endif
 
 /* End of 'mystring.h' file */
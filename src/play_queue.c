@@ -0,0 +1,336 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2013 by SG Software.
+ *
+ * SG MPFC. Play queue.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include "types.h"
+#include "play_queue.h"
+#include "plist.h"
+#include "song.h"
+
+/* Create a play queue */
+pqueue_t *pqueue_new( void )
+{
+	pqueue_t *q;
+
+	/* Allocate memory */
+	q = (pqueue_t *)malloc(sizeof(*q));
+	if (q == NULL)
+		return NULL;
+	memset(q, 0, sizeof(*q));
+
+	/* Set fields */
+	q->m_first_ticket = 1;
+	pthread_mutex_init(&q->m_mutex, NULL);
+	return q;
+} /* End of 'pqueue_new' function */
+
+/* Free play queue */
+void pqueue_free( pqueue_t *q )
+{
+	if (q == NULL)
+		return;
+
+	pqueue_clear(q);
+	pthread_mutex_destroy(&q->m_mutex);
+	free(q->m_entries);
+	free(q);
+} /* End of 'pqueue_free' function */
+
+/* Lock queue */
+void pqueue_lock( pqueue_t *q )
+{
+	if (q != NULL)
+		pthread_mutex_lock(&q->m_mutex);
+} /* End of 'pqueue_lock' function */
+
+/* Unlock queue */
+void pqueue_unlock( pqueue_t *q )
+{
+	if (q != NULL)
+		pthread_mutex_unlock(&q->m_mutex);
+} /* End of 'pqueue_unlock' function */
+
+/* Set entries tickets after entries have been rearranged */
+static void pqueue_update_tickets( pqueue_t *q )
+{
+	int i;
+
+	for ( i = 0; i < q->m_len; i ++ )
+		PQUEUE_ENTRY(q, i)->m_ticket = q->m_first_ticket + i;
+} /* End of 'pqueue_update_tickets' function */
+
+/* Add play list row to the queue tail */
+bool_t pqueue_push( pqueue_t *q, plist_t *pl, int index )
+{
+	struct tag_pqueue_entry_t *entry;
+	pseq_node_t *node;
+
+	if (q == NULL || pl == NULL)
+		return FALSE;
+
+	pqueue_lock(q);
+	plist_lock(pl);
+	node = pseq_node_at(pl->m_seq, index);
+	if (node == NULL)
+	{
+		plist_unlock(pl);
+		pqueue_unlock(q);
+		return FALSE;
+	}
+
+	/* Grow buffer (its size is kept a power of two) */
+	if (q->m_len == q->m_size)
+	{
+		int new_size = (q->m_size == 0) ? 16 : q->m_size * 2, i;
+		struct tag_pqueue_entry_t *entries = 
+			(struct tag_pqueue_entry_t *)malloc(sizeof(*entries) * new_size);
+		if (entries == NULL)
+		{
+			plist_unlock(pl);
+			pqueue_unlock(q);
+			return FALSE;
+		}
+		for ( i = 0; i < q->m_len; i ++ )
+			entries[i] = *PQUEUE_ENTRY(q, i);
+		free(q->m_entries);
+		q->m_entries = entries;
+		q->m_size = new_size;
+		q->m_head = 0;
+	}
+
+	/* Append */
+	entry = PQUEUE_ENTRY(q, q->m_len);
+	entry->m_plist = pl;
+	entry->m_node = node;
+	entry->m_song = song_add_ref(node->m_song);
+	entry->m_ticket = q->m_first_ticket + q->m_len;
+	q->m_len ++;
+
+	plist_unlock(pl);
+	pqueue_unlock(q);
+	return TRUE;
+} /* End of 'pqueue_push' function */
+
+/* Get play list index of the queued row (-1 if it is not in the list).
+ * Queue and play list must be locked */
+int pqueue_entry_index( struct tag_pqueue_entry_t *entry, plist_t *pl )
+{
+	pseq_node_t *node;
+	int i;
+
+	if (entry->m_plist != pl || entry->m_node == NULL)
+		return -1;
+	if (entry->m_node->m_song == entry->m_song)
+		return pseq_node_index(entry->m_node);
+
+	/* Songs were reordered in place (say, list was sorted), so find the 
+	 * row that has this song now */
+	for ( i = 0, node = pseq_node_at(pl->m_seq, 0); node != NULL; 
+			i ++, node = pseq_next(node) )
+	{
+		if (node->m_song == entry->m_song)
+		{
+			entry->m_node = node;
+			return i;
+		}
+	}
+	entry->m_node = NULL;
+	return -1;
+} /* End of 'pqueue_entry_index' function */
+
+/* Take entry from the queue head returning its play list index. Rows 
+ * that are no longer in the play list are skipped. Returns -1 if 
+ * queue is empty */
+int pqueue_pop( pqueue_t *q, plist_t *pl )
+{
+	int index = -1;
+
+	if (q == NULL)
+		return -1;
+
+	pqueue_lock(q);
+	while (q->m_len > 0 && index < 0)
+	{
+		struct tag_pqueue_entry_t *entry = PQUEUE_ENTRY(q, 0);
+		song_t *s = entry->m_song;
+
+		/* Find row in the play list */
+		plist_lock(pl);
+		index = pqueue_entry_index(entry, pl);
+		plist_unlock(pl);
+
+		/* Remove head. Tickets of the rest stay valid */
+		q->m_head = (q->m_head + 1) & (q->m_size - 1);
+		q->m_len --;
+		q->m_first_ticket ++;
+		song_free(s);
+	}
+	pqueue_unlock(q);
+	return index;
+} /* End of 'pqueue_pop' function */
+
+/* Get play list index of the row pqueue_pop would return */
+int pqueue_peek( pqueue_t *q, plist_t *pl )
+{
+	int i, index = -1;
+
+	if (q == NULL)
+		return -1;
+
+	pqueue_lock(q);
+	plist_lock(pl);
+	for ( i = 0; i < q->m_len && index < 0; i ++ )
+		index = pqueue_entry_index(PQUEUE_ENTRY(q, i), pl);
+	plist_unlock(pl);
+	pqueue_unlock(q);
+	return index;
+} /* End of 'pqueue_peek' function */
+
+/* Move queue entry to another position */
+bool_t pqueue_move( pqueue_t *q, int from, int to )
+{
+	struct tag_pqueue_entry_t entry;
+	int i;
+
+	if (q == NULL)
+		return FALSE;
+
+	pqueue_lock(q);
+	if (from < 0 || from >= q->m_len || to < 0 || to >= q->m_len)
+	{
+		pqueue_unlock(q);
+		return FALSE;
+	}
+	entry = *PQUEUE_ENTRY(q, from);
+	if (from < to)
+	{
+		for ( i = from; i < to; i ++ )
+			*PQUEUE_ENTRY(q, i) = *PQUEUE_ENTRY(q, i + 1);
+	}
+	else
+	{
+		for ( i = from; i > to; i -- )
+			*PQUEUE_ENTRY(q, i) = *PQUEUE_ENTRY(q, i - 1);
+	}
+	*PQUEUE_ENTRY(q, to) = entry;
+	pqueue_update_tickets(q);
+	pqueue_unlock(q);
+	return TRUE;
+} /* End of 'pqueue_move' function */
+
+/* Remove queue entry */
+bool_t pqueue_remove( pqueue_t *q, int pos )
+{
+	song_t *s;
+	int i;
+
+	if (q == NULL)
+		return FALSE;
+
+	pqueue_lock(q);
+	if (pos < 0 || pos >= q->m_len)
+	{
+		pqueue_unlock(q);
+		return FALSE;
+	}
+	s = PQUEUE_ENTRY(q, pos)->m_song;
+	for ( i = pos; i < q->m_len - 1; i ++ )
+		*PQUEUE_ENTRY(q, i) = *PQUEUE_ENTRY(q, i + 1);
+	q->m_len --;
+	pqueue_update_tickets(q);
+	song_free(s);
+	pqueue_unlock(q);
+	return TRUE;
+} /* End of 'pqueue_remove' function */
+
+/* Clear queue */
+void pqueue_clear( pqueue_t *q )
+{
+	int i;
+
+	if (q == NULL)
+		return;
+
+	pqueue_lock(q);
+	for ( i = 0; i < q->m_len; i ++ )
+		song_free(PQUEUE_ENTRY(q, i)->m_song);
+	q->m_first_ticket += q->m_len;
+	q->m_head = q->m_len = 0;
+	pqueue_unlock(q);
+} /* End of 'pqueue_clear' function */
+
+/* Drop entries of the play list rows that are going to be removed.
+ * Queue and play list must be locked */
+void pqueue_forget( pqueue_t *q, plist_t *pl, int start, int end )
+{
+	int i, len = 0;
+
+	if (q == NULL)
+		return;
+
+	for ( i = 0; i < q->m_len; i ++ )
+	{
+		struct tag_pqueue_entry_t *entry = PQUEUE_ENTRY(q, i);
+		if (entry->m_plist == pl && entry->m_node != NULL)
+		{
+			int index = pseq_node_index(entry->m_node);
+			if (index >= start && index <= end)
+			{
+				song_free(entry->m_song);
+				continue;
+			}
+		}
+		*PQUEUE_ENTRY(q, len ++) = *entry;
+	}
+	if (len != q->m_len)
+	{
+		q->m_len = len;
+		pqueue_update_tickets(q);
+	}
+} /* End of 'pqueue_forget' function */
+
+/* Get queue positions (starting from 1; 0 if row is not queued) of 
+ * 'num' play list rows starting from 'start'. Queue and play list must 
+ * be locked */
+void pqueue_get_positions( pqueue_t *q, plist_t *pl, int start, int num,
+		int *pos )
+{
+	int i;
+
+	memset(pos, 0, sizeof(*pos) * num);
+	if (q == NULL)
+		return;
+
+	/* Only the first entry of a row is shown, so go from the tail */
+	for ( i = q->m_len - 1; i >= 0; i -- )
+	{
+		struct tag_pqueue_entry_t *entry = PQUEUE_ENTRY(q, i);
+		int index = pqueue_entry_index(entry, pl);
+		if (index >= start && index < start + num)
+			pos[index - start] = 
+				(int)(entry->m_ticket - q->m_first_ticket) + 1;
+	}
+} /* End of 'pqueue_get_positions' function */
+
+/* End of 'play_queue.c' file */
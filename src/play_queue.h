@@ -0,0 +1,109 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2013 by SG Software.
+ *
+ * SG MPFC. Interface for play queue.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+#ifndef __SG_MPFC_PLAY_QUEUE_H__
+#define __SG_MPFC_PLAY_QUEUE_H__
+
+#include <pthread.h>
+#include "types.h"
+#include "main_types.h"
+#include "plist_seq.h"
+
+/* Play queue type. Entries are kept in a ring buffer and refer to play
+ * list rows (sequence nodes), so queue survives play list changes. 
+ * Every entry has a ticket; tickets of the consecutive entries are 
+ * consecutive, so taking the head doesn't renumber anything and entry
+ * position is its ticket minus the head ticket */
+typedef struct tag_pqueue_t
+{
+	/* Queue entries */
+	struct tag_pqueue_entry_t
+	{
+		/* Play list and its row (NULL if the row was removed) */
+		plist_t *m_plist;
+		pseq_node_t *m_node;
+
+		/* Song the row had when it was queued (a reference is held) */
+		song_t *m_song;
+
+		dword m_ticket;
+	} *m_entries;
+	int m_head, m_len, m_size;
+
+	/* Ticket of the queue head */
+	dword m_first_ticket;
+
+	pthread_mutex_t m_mutex;
+} pqueue_t;
+
+/* Access queue entry */
+#define PQUEUE_ENTRY(q, i) \
+	(&(q)->m_entries[((q)->m_head + (i)) & ((q)->m_size - 1)])
+
+/* Create a play queue */
+pqueue_t *pqueue_new( void );
+
+/* Free play queue */
+void pqueue_free( pqueue_t *q );
+
+/* Lock/unlock queue. Queue is locked before play lists */
+void pqueue_lock( pqueue_t *q );
+void pqueue_unlock( pqueue_t *q );
+
+/* Add play list row to the queue tail */
+bool_t pqueue_push( pqueue_t *q, plist_t *pl, int index );
+
+/* Get play list index of the queued row (-1 if it is not in the list).
+ * Queue and play list must be locked */
+int pqueue_entry_index( struct tag_pqueue_entry_t *entry, plist_t *pl );
+
+/* Take entry from the queue head returning its play list index. Rows 
+ * that are no longer in the play list are skipped. Returns -1 if 
+ * queue is empty */
+int pqueue_pop( pqueue_t *q, plist_t *pl );
+
+/* Get play list index of the row pqueue_pop would return, leaving
+ * the queue as is */
+int pqueue_peek( pqueue_t *q, plist_t *pl );
+
+/* Move queue entry to another position */
+bool_t pqueue_move( pqueue_t *q, int from, int to );
+
+/* Remove queue entry */
+bool_t pqueue_remove( pqueue_t *q, int pos );
+
+/* Clear queue */
+void pqueue_clear( pqueue_t *q );
+
+/* Drop entries of the play list rows that are going to be removed.
+ * Queue and play list must be locked */
+void pqueue_forget( pqueue_t *q, plist_t *pl, int start, int end );
+
+/* Get queue positions (starting from 1; 0 if row is not queued) of 
+ * 'num' play list rows starting from 'start'. Queue and play list must 
+ * be locked */
+void pqueue_get_positions( pqueue_t *q, plist_t *pl, int start, int num,
+		int *pos );
+
+#endif
+
+/* End of 'play_queue.h' file */
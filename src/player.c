@@ -23,6 +23,7 @@
 #include <getopt.h>
 #include <signal.h>
 #include <fcntl.h>
+#include <math.h>
 #include <sys/soundcard.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -33,10 +34,12 @@
 #include <gst/audio/audio.h>
 #include <json-glib/json-glib.h>
 #include "types.h"
+#include "bench.h"
 #include "browser.h"
 #include "cfg.h"
 #include "command.h"
 #include "help_screen.h"
+#include "ingest.h"
 #include "json_helpers.h"
 #include "logger.h"
 #include "logger_view.h"
@@ -44,7 +47,9 @@
 #include "player.h"
 #include "plist.h"
 #include "pmng.h"
+#include "prefetch.h"
 #include "server.h"
+#include "snapshot.h"
 #include "test.h"
 #include "undo.h"
 #include "util.h"
@@ -62,6 +67,7 @@
 #include "wnd_root.h"
 #include "wnd_repval.h"
 #include "info_rw_thread.h"
+#include "info_writer.h"
 #include "genp.h"
 
 /*****
@@ -74,8 +80,10 @@
 int player_num_files = 0;
 char **player_files = NULL;
 
-/* Play list */
+/* Active play list. It is switched only by the window thread under the
+ * write lock; other threads lock it for reading while they use it */
 plist_t *player_plist = NULL;
+static pthread_rwlock_t player_plist_rwlock = PTHREAD_RWLOCK_INITIALIZER;
 
 /* Command repeat value */
 int player_repval = 0;
@@ -102,12 +110,28 @@ player_context_t *player_context = NULL;
 bool_t player_end_of_stream = FALSE;
 GstElement *player_pipeline = NULL;
 
+/* Cross-fading volume element of the current pipeline */
+GstElement *player_fade = NULL;
+
+/* Previous track still playing (and fading out if the next one has 
+ * started) in its own pipeline */
+GstElement *player_tail_pipeline = NULL;
+GstElement *player_tail_fade = NULL;
+song_t *player_tail_song = NULL;
+bool_t player_tail_fading = FALSE;
+
 /* Edit boxes history lists */
 editbox_history_t *player_hist_lists[PLAYER_NUM_HIST_LISTS];
 
 /* Undo list */
 undo_list_t *player_ul = NULL;
 
+/* Named play lists */
+plmng_t *player_lists = NULL;
+
+/* Shuffle play engine */
+shuffle_t *player_shuffle = NULL;
+
 /* Do we story undo information now? */
 bool_t player_store_undo = TRUE;
 
@@ -153,9 +177,8 @@ logger_view_t *player_logview = NULL;
 /* Standard value for edit boxes width */
 #define PLAYER_EB_WIDTH	(2 * WND_WIDTH(player_wnd) / 3)
 
-/* enqueued songs */
-int queued_songs[PLAYER_MAX_ENQUEUED];
-int num_queued_songs = 0;
+/* Play queue */
+pqueue_t *player_queue = NULL;
 
 /* Main thread ID */
 pthread_t player_main_tid = 0; 
@@ -177,11 +200,14 @@ static void player_utf8_dialog( void );
  *
  *****/
 
-/* Load player state */
-static void player_load_state( void )
+/* Load player state from the old JSON state file */
+static bool_t player_load_json_state( snapshot_state_t *state )
 {
+	bool_t ret = FALSE;
 	char *fname = util_strcat(getenv("HOME"), "/.mpfc/state", NULL);
 	if (!fname)
+		return FALSE;
+	if (access(fname, F_OK) < 0)
 		goto finally_fname;
 
 	/* Parse */
@@ -189,7 +215,7 @@ static void player_load_state( void )
 	if (!json_parser_load_from_file(parser, fname, NULL))
 	{
 		logger_error(player_log, 1, _("unable to parse player state"));
-		goto finally_fname;
+		goto finally_js;
 	}
 
 	JsonNode *root_node = json_parser_get_root(parser);
@@ -202,50 +228,89 @@ static void player_load_state( void )
 	if (js_plist)
 		plist_import_from_json(player_plist, js_plist);
 
-	/* Start playing from last stop */
-	if (cfg_get_var_int(cfg_list, "play-from-stop"))
-	{
-		logger_debug(player_log, "Playing from stop");
-		player_context->m_status = js_get_int(js_root, "player-status", PLAYER_STATUS_STOPPED);
-		player_start = js_get_int(js_root, "player-start", 0) - 1;
-		player_end = js_get_int(js_root, "player-end", 0) - 1;
-		if (player_context->m_status != PLAYER_STATUS_STOPPED)
-			player_play(js_get_int(js_root, "cur-song", -1),
-					js_get_int(js_root, "cur-time", 0));
-		player_context->m_volume = js_get_double(js_root, "volume", VOLUME_DEF);
-	}
+	state->m_status = js_get_int(js_root, "player-status", PLAYER_STATUS_STOPPED);
+	state->m_start = js_get_int(js_root, "player-start", 0) - 1;
+	state->m_end = js_get_int(js_root, "player-end", 0) - 1;
+	state->m_cur_song = js_get_int(js_root, "cur-song", -1);
+	state->m_cur_time = js_get_int(js_root, "cur-time", 0);
+	state->m_volume = js_get_double(js_root, "volume", VOLUME_DEF);
+	ret = TRUE;
 
 finally_js:
 	g_object_unref(parser);
 
 finally_fname:
 	free(fname);
+	return ret;
 }
 
-/* Save player state */
-static void player_save_state( void )
+/* Load player state. Returns whether the play list was restored from the
+ * snapshot, so that journal is continued */
+static bool_t player_load_state( void )
 {
-	JsonObject *js_root = json_object_new();
+	snapshot_state_t state = { -1, 0, PLAYER_STATUS_STOPPED, -1, -1, 
+		VOLUME_DEF, 0, 0 };
+
+	/* Load snapshot and replay journal over it, falling back to the JSON 
+	 * state left by older versions */
+	char *fname = util_strcat(getenv("HOME"), "/.mpfc/state.bin", NULL);
+	if (!fname)
+		return FALSE;
+	bool_t restored = snapshot_load(fname, player_plist, &state);
+	free(fname);
+	if (restored)
+		ckpt_replay(player_plist->m_ckpt, &state);
+	bool_t loaded = restored || player_load_json_state(&state);
+
+	/* Load named play lists and activate the one used last time */
+	char *active = cfg_get_var(cfg_list, "active-plist");
+	plmng_load(player_lists, active, &state);
+	if (active != NULL && strcmp(active, PLMNG_DEFAULT_NAME) &&
+			player_switch_plist(active))
+		loaded = TRUE;
+	if (!loaded)
+		return FALSE;
 
-	/* Save playlist */
-	if (player_plist && cfg_get_var_int(cfg_list, "save-playlist-on-exit"))
+	/* Start playing from last stop */
+	if (cfg_get_var_int(cfg_list, "play-from-stop"))
 	{
-		json_object_set_array_member(js_root, "plist", plist_export_to_json(player_plist));
+		logger_debug(player_log, "Playing from stop");
+		player_context->m_status = state.m_status;
+		player_start = state.m_start;
+		player_end = state.m_end;
+		if (player_context->m_status != PLAYER_STATUS_STOPPED)
+			player_play(state.m_cur_song, state.m_cur_time);
+		player_context->m_volume = state.m_volume;
 	}
+	return restored;
+}
 
-	/* Save player state */
-	json_object_set_int_member(js_root, "cur-song", player_plist->m_cur_song);
-	json_object_set_int_member(js_root, "cur-time", player_context->m_cur_time);
-	json_object_set_int_member(js_root, "player-status", player_context->m_status);
-	json_object_set_int_member(js_root, "player-start", player_start + 1);
-	json_object_set_int_member(js_root, "player-end", player_end + 1);
-	json_object_set_double_member(js_root, "volume", player_context->m_volume);
-
-	/* Save to a file */
-	JsonGenerator *gen = json_generator_new();
-	json_generator_set_root(gen, js_make_node(js_root));
-	char *fname = util_strcat(getenv("HOME"), "/.mpfc/state", NULL);
-	json_generator_to_file(gen, fname, NULL);
+/* Get player state to be saved along with the play list. Only the 
+ * active list is being played */
+static void player_get_saved_state( plist_t *pl, snapshot_state_t *state )
+{
+	memset(state, 0, sizeof(*state));
+	state->m_cur_song = pl->m_cur_song;
+	state->m_volume = player_context->m_volume;
+	if (pl == player_plist)
+	{
+		state->m_cur_time = player_context->m_cur_time;
+		state->m_status = player_context->m_status;
+		state->m_start = player_start;
+		state->m_end = player_end;
+	}
+	else
+	{
+		state->m_status = PLAYER_STATUS_STOPPED;
+		state->m_start = state->m_end = -1;
+	}
+}
+
+/* Save player state */
+static void player_save_state( void )
+{
+	/* Final snapshots are saved by the checkpointers */
+	plmng_save(player_lists);
 
 	/* Save some stuff through the cfg system */
 	player_save_cfg();
@@ -365,6 +430,32 @@ bool_t player_init( int argc, char *argv[] )
 		return FALSE;
 	}
 
+	/* Initialize info writer threads */
+	logger_debug(player_log, "Initializing info writer threads");
+	if (!iw_init())
+	{
+		logger_fatal(player_log, 0, 
+				_("Unable to initialize info writer threads"));
+		return FALSE;
+	}
+
+	/* Initialize prefetching thread */
+	logger_debug(player_log, "Initializing prefetching thread");
+	if (!prefetch_init())
+	{
+		logger_error(player_log, 0, 
+				_("Unable to initialize prefetching thread"));
+	}
+
+	/* Initialize files adding thread */
+	logger_debug(player_log, "Initializing files adding thread");
+	if (!ingest_init())
+	{
+		logger_fatal(player_log, 0, 
+				_("Unable to initialize files adding thread"));
+		return FALSE;
+	}
+
 	/* Initialize undo list */
 	logger_debug(player_log, "Initializing undo list");
 	player_ul = undo_new();
@@ -373,14 +464,37 @@ bool_t player_init( int argc, char *argv[] )
 		logger_debug(player_log, 0, _("Unable to initialize undo list"));
 	}
 
-	/* Create a play list and add files to it */
+	/* Initialize play queue */
+	logger_debug(player_log, "Initializing play queue");
+	player_queue = pqueue_new();
+	if (player_queue == NULL)
+	{
+		logger_fatal(player_log, 0, _("Unable to initialize play queue"));
+		return FALSE;
+	}
+
+	/* Initialize shuffle engine */
+	logger_debug(player_log, "Initializing shuffle engine");
+	player_shuffle = shuffle_new();
+	if (player_shuffle == NULL)
+	{
+		logger_fatal(player_log, 0, _("Unable to initialize shuffle engine"));
+		return FALSE;
+	}
+
+	/* Create play lists manager with the default list and add files 
+	 * to it. Lists are saved by checkpointers */
 	logger_debug(player_log, "Initializing play list");
-	player_plist = plist_new(3);
-	if (player_plist == NULL)
+	mkdir(player_cfg_dir, 0770);
+	player_lists = plmng_new(player_cfg_dir, 
+			cfg_get_var_int(cfg_list, "save-playlist-on-exit"),
+			player_get_saved_state);
+	if (player_lists == NULL)
 	{
 		logger_fatal(player_log, 0, _("Play list initialization failed"));
 		return FALSE;
 	}
+	player_plist = PLMNG_DEFAULT(player_lists);
 	player_pmng->m_playlist = player_plist;
 
 	/* Make a set of files to add */
@@ -399,8 +513,12 @@ bool_t player_init( int argc, char *argv[] )
 
 	/* Load saved play list if files list is empty */
 	logger_debug(player_log, "Adding list.m3u");
+	bool_t restored = FALSE;
 	if (!player_num_files)
-		player_load_state();
+		restored = player_load_state();
+	else
+		plmng_load(player_lists, NULL, NULL);
+	ckpt_start(PLMNG_DEFAULT(player_lists)->m_ckpt, restored);
 
 	/* Initialize history lists */
 	logger_debug(player_log, "Initializing history");
@@ -430,6 +548,10 @@ bool_t player_init( int argc, char *argv[] )
 		player_utf8_dialog();
 	player_welcome_dialog();
 
+	/* Run benchmarks if requested */
+	if (cfg_get_var(cfg_list, "bench") != NULL)
+		test_start(TEST_BENCH);
+
 	return TRUE;
 } /* End of 'player_init' function */
 
@@ -475,10 +597,19 @@ void player_root_destructor( wnd_t *wnd )
 {
 	logger_debug(player_log, "In player_root_destructor");
 
+	/* Stop test or benchmark */
+	test_stop();
+
+	/* Stop adding files */
+	logger_debug(player_log, "Doing ingest_free");
+	ingest_free();
+
 	/* Save player state */
 	player_save_state();
 	
 	/* End playing thread */
+	logger_debug(player_log, "Doing iw_free");
+	iw_free();
 	logger_debug(player_log, "Doing irw_free");
 	irw_free();
 	logger_debug(player_log, "Setting next song to NULL");
@@ -493,6 +624,7 @@ void player_root_destructor( wnd_t *wnd )
 		player_end_thread = FALSE;
 		player_tid = 0;
 	}
+	prefetch_free();
 	
 	/* Stop general plugins */
 	pmng_stop_general_plugins(player_pmng);
@@ -534,15 +666,20 @@ void player_deinit( void )
 	}
 	
 	/* Destroy all objects */
-	if (player_plist != NULL)
+	if (player_lists != NULL)
 	{
-		logger_debug(player_log, "Destroying play list");
-		plist_free(player_plist);
+		logger_debug(player_log, "Destroying play lists");
+		plmng_free(player_lists);
+		player_lists = NULL;
 		player_plist = NULL;
 	}
 	logger_debug(player_log, "Freeing undo information");
 	undo_free(player_ul);
 	player_ul = NULL;
+	shuffle_free(player_shuffle);
+	player_shuffle = NULL;
+	pqueue_free(player_queue);
+	player_queue = NULL;
 	if (player_context != NULL)
 	{
 		free(player_context);
@@ -684,10 +821,26 @@ bool_t player_init_cfg( void )
 	free(log_file);
 	cfg_set_var_int(cfg_list, "save-playlist-on-exit", 1);
 	cfg_set_var_int(cfg_list, "play-from-stop", 1);
+	cfg_set_var_int(cfg_list, "checkpoint-interval", 60);
+	cfg_set_var_int(cfg_list, "add-threads", 4);
 	cfg_set_var(cfg_list, "lib-dir", LIBDIR"/mpfc");
 	cfg_set_var_bool(cfg_list, "autosave-plugins-params", TRUE);
 	cfg_set_var_bool(cfg_list, "search-nocase", TRUE);
 	cfg_set_var_bool(cfg_list, "view-follows-cur-song", TRUE);
+	cfg_set_var(cfg_list, "replaygain-mode", "none");
+	cfg_set_var_float(cfg_list, "replaygain-preamp", 0);
+	cfg_set_var_float(cfg_list, "replaygain-fallback", 0);
+	cfg_set_var_float(cfg_list, "crossfade-time", 0);
+	cfg_set_var_int(cfg_list, "prefetch-time", 30);
+	cfg_set_var_int(cfg_list, "prefetch-size", 4096);
+	cfg_set_var_int(cfg_list, "info-write-threads", 2);
+	cfg_set_var_bool(cfg_list, "info-write-sync", TRUE);
+	cfg_set_var_bool(cfg_list, "lazy-info-load", FALSE);
+	cfg_set_var_int(cfg_list, "bench-files", 2000);
+	cfg_set_var_int(cfg_list, "bench-depth", 2);
+	cfg_set_var_int(cfg_list, "bench-seed", 1);
+	cfg_set_var_int(cfg_list, "bench-repeat", 5);
+	cfg_set_var(cfg_list, "bench-output", "mpfc-bench.json");
 
 	/* Read configuration files */
 	cfg_rcfile_read(cfg_list, player_cfg_autosave_file);
@@ -725,6 +878,9 @@ void player_save_cfg( void )
 	/* Save 'dont_show' values for startup information dialogs */
 	cfg_rcfile_save_node(fd, cfg_search_node(cfg_list, "dont_show"), NULL);
 
+	/* Save active play list name */
+	cfg_rcfile_save_node(fd, cfg_search_node(cfg_list, "active-plist"), NULL);
+
 	fclose(fd);
 } /* End of 'player_save_cfg' function */
 
@@ -782,6 +938,11 @@ wnd_msg_retcode_t player_on_action( wnd_t *wnd, char *action, int repval )
 	{
 		player_queue_song();
 	}
+	/* Cancel adding files */
+	else if (!strcasecmp(action, "cancel_add"))
+	{
+		ingest_cancel();
+	}
 	/* Show help screen */
 	else if (!strcasecmp(action, "help"))
 	{
@@ -985,6 +1146,11 @@ wnd_msg_retcode_t player_on_action( wnd_t *wnd, char *action, int repval )
 	{
 		player_var_manager();
 	}
+	/* Launch play lists dialog */
+	else if (!strcasecmp(action, "plists"))
+	{
+		player_plists_dialog();
+	}
 	/* Audio output setup */
 	else if (!strcasecmp(action, "audio_setup"))
 	{
@@ -1153,7 +1319,7 @@ wnd_msg_retcode_t player_on_mouse_ldown( wnd_t *wnd, int x, int y,
 	{
 		if (player_plist->m_cur_song >= 0)
 		{
-			song_t *s = player_plist->m_list[player_plist->m_cur_song];
+			song_t *s = plist_get_song(player_plist, player_plist->m_cur_song);
 			if (s != NULL)
 			{
 				player_seek((x - PLAYER_SLIDER_TIME_X) * 
@@ -1215,6 +1381,16 @@ wnd_msg_retcode_t player_on_user( wnd_t *wnd, int id, void *data )
 	case PLAYER_MSG_NEXT_FOCUS:
 		wnd_next_focus(wnd_root);
 		break;
+	case PLAYER_MSG_ADD_DONE:
+		ingest_job_done((ingest_job_t *)data);
+		break;
+	case PLAYER_MSG_BENCH_RENDER:
+		bench_render((bench_render_t *)data);
+		break;
+	case PLAYER_MSG_SWITCH_PLIST:
+		player_switch_plist((char *)data);
+		free(data);
+		break;
 	}
 	return WND_MSG_RETCODE_OK;
 } /* End of 'player_on_user' function */
@@ -1270,16 +1446,18 @@ wnd_msg_retcode_t player_on_display( wnd_t *wnd )
 		char *shuffle_str, *loop_str;
 		
 		/* Print current song title */
-		s = player_plist->m_list[player_plist->m_cur_song];
+		s = plist_get_song(player_plist, player_plist->m_cur_song);
+		str_t *title = song_get_title(s);
 		wnd_move(wnd, 0, 0, 0);
 		wnd_apply_style(wnd, "title-style");
 		wnd_printf(wnd, WND_PRINT_ELLIPSES, WND_WIDTH(wnd) - 1, "%s", 
-				STR_TO_CPTR(s->m_title));
+				STR_TO_CPTR(title));
 
 		/* Set root title */
-		char *root_title = util_strcat("MPFC :: ", STR_TO_CPTR(s->m_title), NULL);
+		char *root_title = util_strcat("MPFC :: ", STR_TO_CPTR(title), NULL);
 		wnd_set_global_title(wnd, root_title);
 		free(root_title);
+		str_free(title);
 		
 		/* Print shuffle mode */
 		shuffle_str = _("Shuffle");
@@ -1407,7 +1585,7 @@ void player_seek( song_time_t val, bool_t rel )
 	if (player_plist->m_cur_song == -1)
 		return;
 
-	song_t *s = player_plist->m_list[player_plist->m_cur_song];
+	song_t *s = plist_get_song(player_plist, player_plist->m_cur_song);
 
 	song_time_t new_time = (rel ? (player_context->m_cur_time + val) : val);
 	if (new_time < 0)
@@ -1440,7 +1618,7 @@ void player_play( int song, song_time_t start_time )
 
 	/* Check that we have anything to play */
 	if (song < 0 || song >= player_plist->m_len ||
-			(s = player_plist->m_list[song]) == NULL)
+			(s = plist_get_song(player_plist, song)) == NULL)
 	{
 		player_plist->m_cur_song = -1;
 		return;
@@ -1448,9 +1626,12 @@ void player_play( int song, song_time_t start_time )
 
 	/* Start new playing thread */
 	cfg_set_var(cfg_list, "cur-song-name", song_get_short_name(s));
-	cfg_set_var(cfg_list, "cur-song-title", STR_TO_CPTR(s->m_title));
+	str_t *title = song_get_title(s);
+	cfg_set_var(cfg_list, "cur-song-title", STR_TO_CPTR(title));
+	str_free(title);
 	player_plist->m_cur_song = song;
 	player_context->m_cur_time = start_time;
+	shuffle_played(player_shuffle, song);
 //	player_context->m_status = PLAYER_STATUS_PLAYING;
 
 	/* Move cursor to current song */
@@ -1526,9 +1707,13 @@ void player_update_vol( void )
 	}
 } /* End of 'player_update_vol' function */
 
-/* Skip some songs */
-int player_skip_songs( int num, bool_t play )
+/* Find song which is num songs away from the current one. In peek mode 
+ * the play queue and the shuffle history are left as is (only num = 1 
+ * is supported then) */
+static int player_find_song( int num, bool_t peek )
 {
+	CFG_VAR_HANDLE(shuffle_h, "shuffle-play");
+	CFG_VAR_HANDLE(loop_h, "loop-play");
 	int len, base, song;
 	
 	if (player_plist == NULL || !player_plist->m_len)
@@ -1539,12 +1724,25 @@ int player_skip_songs( int num, bool_t play )
 	len = (player_start < 0) ? player_plist->m_len : 
 		(player_end - player_start + 1);
 	base = (player_start < 0) ? 0 : player_start;
-	if (cfg_get_var_int(cfg_list, "shuffle-play"))
-	{
-		int initial = song;
-
-		while (song == initial)
-			song = base + (rand() % len);
+	int queued = (peek ? pqueue_peek(player_queue, player_plist) :
+			pqueue_pop(player_queue, player_plist));
+	if (queued >= 0)
+		song = queued;
+	else if (cfg_handle_get_var_int(cfg_list, &shuffle_h) && peek)
+		song = shuffle_peek(player_shuffle, base, len, player_start < 0);
+	else if (cfg_handle_get_var_int(cfg_list, &shuffle_h))
+	{
+		/* Go back through the history of really played songs or take 
+		 * the next not played yet song */
+		for ( ; num < 0; num ++ )
+		{
+			int prev = shuffle_prev(player_shuffle);
+			if (prev < 0)
+				break;
+			song = prev;
+		}
+		for ( ; num > 0; num -- )
+			song = shuffle_next(player_shuffle, base, len, player_start < 0);
 	}
 	else 
 	{
@@ -1554,7 +1752,7 @@ int player_skip_songs( int num, bool_t play )
 		else 
 			s = cur - base;
 		s += num;
-		if (cfg_get_var_int(cfg_list, "loop-play"))
+		if (cfg_handle_get_var_int(cfg_list, &loop_h))
 		{
 			while (s < 0)
 				s += len;
@@ -1566,16 +1764,13 @@ int player_skip_songs( int num, bool_t play )
 		else
 			song = s + base;
 	}
-	if(num_queued_songs != 0)
-	{
-		int queue_loop;
-		song = queued_songs[0];
-		for(queue_loop = 0;queue_loop < num_queued_songs-1;queue_loop++)
-		{
-			queued_songs[queue_loop] = queued_songs[queue_loop+1];
-		}
-		num_queued_songs--;
-	}
+	return song;
+} /* End of 'player_find_song' function */
+
+/* Skip some songs */
+int player_skip_songs( int num, bool_t play )
+{
+	int song = player_find_song(num, FALSE);
 
 	/* Start or end play */
 	if (play)
@@ -1592,9 +1787,10 @@ int player_skip_songs( int num, bool_t play )
 /* Translate projected song time to real time */
 song_time_t player_translate_time( song_t *s, song_time_t t, bool_t virtual2real )
 {
-	if (s == NULL || s->m_start_time < 0)
+	if (s == NULL || song_get_start_time(s) < 0)
 		return t;
-	return (virtual2real ? s->m_start_time + t : t - s->m_start_time);
+	return (virtual2real ? song_get_start_time(s) + t : 
+			t - song_get_start_time(s));
 } /* End of 'player_translate_time' function */
 
 /* Handle a TAG message */
@@ -1734,9 +1930,176 @@ bool_t player_set_audio_sink( void )
 	return TRUE;
 }
 
+/* Get cross-fade duration */
+static song_time_t player_get_crossfade_time( void )
+{
+	CFG_VAR_HANDLE(xfade_h, "crossfade-time");
+	float xfade = cfg_handle_get_var_float(cfg_list, &xfade_h);
+	return (xfade > 0 ? (song_time_t)(xfade * 1000000000.) : 0);
+} /* End of 'player_get_crossfade_time' function */
+
+/* Set ReplayGain parameters for a song */
+static void player_set_replay_gain( GstElement *rg, song_t *s, bool_t album )
+{
+	CFG_VAR_HANDLE(preamp_h, "replaygain-preamp");
+	CFG_VAR_HANDLE(fallback_h, "replaygain-fallback");
+	gdouble preamp = cfg_handle_get_var_float(cfg_list, &preamp_h);
+	gdouble fallback = cfg_handle_get_var_float(cfg_list, &fallback_h);
+	float gain, peak;
+
+	/* rgvolume takes gain from the stream tags, but they may come in the 
+	 * middle of the stream (or not come at all for some formats). So gain
+	 * cached in the song info is used as fallback to have the right level 
+	 * from the first buffer */
+	song_lock(s);
+	if (si_get_replay_gain(s->m_info, album, &gain, &peak))
+	{
+		fallback = gain + preamp;
+		if (peak > 0 && fallback > -20. * log10(peak))
+			fallback = -20. * log10(peak);
+	}
+	song_unlock(s);
+
+	logger_debug(player_log, "gstreamer: ReplayGain fallback gain is %lg dB", fallback);
+	g_object_set(G_OBJECT(rg), "album-mode", (gboolean)album, "pre-amp", preamp,
+			"fallback-gain", fallback, NULL);
+} /* End of 'player_set_replay_gain' function */
+
+/* Create audio filter with ReplayGain and cross-fading volume 
+ * for the current pipeline. If it fails the song is played as is */
+static void player_set_audio_filter( song_t *s )
+{
+	CFG_VAR_HANDLE(mode_h, "replaygain-mode");
+	char *mode = cfg_handle_get_var(cfg_list, &mode_h);
+	bool_t album = (mode != NULL && !strcmp(mode, "album"));
+	bool_t rg = (album || (mode != NULL && !strcmp(mode, "track")));
+	GError *error = NULL;
+	GstElement *bin;
+
+	player_fade = NULL;
+	if (!rg && player_get_crossfade_time() <= 0)
+		return;
+
+	bin = gst_parse_bin_from_description(rg ? 
+			"audioconvert ! rgvolume name=rg ! rglimiter ! volume name=fade" :
+			"audioconvert ! volume name=fade", TRUE, &error);
+	if (error != NULL)
+	{
+		logger_error(player_log, 1, _("gstreamer: unable to create audio filter: %s"),
+				error->message);
+		g_error_free(error);
+		if (bin != NULL)
+			gst_object_unref(GST_OBJECT(bin));
+		return;
+	}
+
+	if (rg)
+	{
+		GstElement *rgvolume = gst_bin_get_by_name(GST_BIN(bin), "rg");
+		player_set_replay_gain(rgvolume, s, album);
+		gst_object_unref(GST_OBJECT(rgvolume));
+	}
+	player_fade = gst_bin_get_by_name(GST_BIN(bin), "fade");
+	g_object_set(G_OBJECT(player_pipeline), "audio-filter", bin, NULL);
+} /* End of 'player_set_audio_filter' function */
+
+/* Set cross-fading volume (factor is 0 for silence and 1 for full volume) */
+static void player_set_fade( GstElement *fade, double factor )
+{
+	if (factor < 0)
+		factor = 0;
+	else if (factor > 1)
+		factor = 1;
+
+	/* Keep the sum power of both tracks constant */
+	g_object_set(G_OBJECT(fade), "volume", (gdouble)sqrt(factor), NULL);
+} /* End of 'player_set_fade' function */
+
+/* Stop playing the previous track */
+static void player_tail_stop( void )
+{
+	if (player_tail_pipeline == NULL)
+		return;
+
+	logger_debug(player_log, "Stopping previous track %s",
+			song_get_name(player_tail_song));
+	gst_element_set_state(player_tail_pipeline, GST_STATE_NULL);
+	gst_object_unref(GST_OBJECT(player_tail_fade));
+	gst_object_unref(GST_OBJECT(player_tail_pipeline));
+	song_free(player_tail_song);
+	player_tail_pipeline = NULL;
+	player_tail_fade = NULL;
+	player_tail_song = NULL;
+	player_tail_fading = FALSE;
+} /* End of 'player_tail_stop' function */
+
+/* Continue playing the previous track */
+static void player_tail_update( void )
+{
+	GstMessage *msg;
+	GstBus *bus;
+	gint64 tm;
+	bool_t finished = FALSE;
+
+	if (player_tail_pipeline == NULL)
+		return;
+
+	/* Pause or stop drops it at once */
+	if (player_context->m_status != PLAYER_STATUS_PLAYING)
+	{
+		player_tail_stop();
+		return;
+	}
+
+	/* Its bus is not watched any more, so check it here */
+	bus = gst_element_get_bus(player_tail_pipeline);
+	while ((msg = gst_bus_pop_filtered(bus, 
+					GST_MESSAGE_EOS | GST_MESSAGE_ERROR)) != NULL)
+	{
+		finished = TRUE;
+		gst_message_unref(msg);
+	}
+	gst_object_unref(bus);
+
+	/* Fade out until the stream end */
+	if (!finished && player_tail_fading && 
+			gst_element_query_position(player_tail_pipeline, GST_FORMAT_TIME, &tm))
+	{
+		song_time_t left = player_tail_song->m_full_len - tm;
+		song_time_t xfade = player_get_crossfade_time();
+		if (left <= 0 || xfade <= 0)
+			finished = TRUE;
+		else
+			player_set_fade(player_tail_fade, (double)left / xfade);
+	}
+
+	if (finished)
+		player_tail_stop();
+} /* End of 'player_tail_update' function */
+
+/* Read ahead the song which is going to be played next */
+static void player_prefetch_next( void )
+{
+	int next = player_find_song(1, TRUE);
+	if (next < 0 || next == player_plist->m_cur_song)
+		return;
+
+	plist_lock(player_plist);
+	song_t *s = (next < player_plist->m_len ? 
+			plist_get_song(player_plist, next) : NULL);
+	if (s != NULL)
+	{
+		logger_debug(player_log, "Prefetching %s", song_get_name(s));
+		prefetch_song(s, (size_t)cfg_get_var_int(cfg_list, "prefetch-size") * 1024);
+	}
+	plist_unlock(player_plist);
+} /* End of 'player_prefetch_next' function */
+
 /* Player thread function */
 void *player_thread( void *arg )
 {
+	CFG_VAR_HANDLE(prefetch_h, "prefetch-time");
+
 	logger_debug(player_log, "In player_thread");
 
 	/* Main loop */
@@ -1750,24 +2113,36 @@ void *player_thread( void *arg )
 		bool_t song_finished;
 		GMainLoop *loop = NULL;
 		GstBus *bus = NULL;
+		guint bus_watch;
 		int was_status;
 		char *uri = NULL;
+		song_time_t xfade;
+		bool_t crossfade, fade_in, prefetched = FALSE;
+		int prefetch;
+
+		/* Let the previous track finish */
+		player_tail_update();
 
 		/* Skip to next iteration if there is nothing to play */
+		player_lock_plist();
 		if (player_plist->m_cur_song < 0 || 
 				player_context->m_status == PLAYER_STATUS_STOPPED)
 		{
+			player_unlock_plist();
 			util_wait();
 			continue;
 		}
 
-		/* Play track */
-		s = player_plist->m_list[player_plist->m_cur_song];
+		/* Play track. Song is referenced, since the list may be switched
+		 * while it is playing */
+		s = song_add_ref(plist_get_song(player_plist, 
+					player_plist->m_cur_song));
+		player_unlock_plist();
 		song_played = s;
 		//player_context->m_status = PLAYER_STATUS_PLAYING;
 		player_end_track = FALSE;
 	
-		logger_debug(player_log, "Playing track %s", s->m_fullname);
+		logger_debug(player_log, "Playing track %s", song_get_name(s));
 
 		/* Get song length and information */
 		logger_debug(player_log, "Updating song info");
@@ -1797,6 +2172,14 @@ void *player_thread( void *arg )
 			goto cleanup;
 		}
 
+		/* Set ReplayGain and cross-fading stage */
+		player_set_audio_filter(s);
+
+		/* Fade in if the previous track is fading out */
+		fade_in = (player_fade != NULL && player_tail_fading);
+		if (fade_in)
+			player_set_fade(player_fade, 0);
+
 		/* Set fake videosink */
 		GstElement *videosink = gst_element_factory_make("fakesink", "videosink");
 		g_object_set(G_OBJECT(player_pipeline), "video-sink", videosink, NULL);
@@ -1810,20 +2193,25 @@ void *player_thread( void *arg )
 		{
 			logger_error(player_log, 1, _("gst_pipeline_get_bus failed"));
 		}
-		gst_bus_add_watch(bus, player_gst_bus_call, NULL);
+		bus_watch = gst_bus_add_watch(bus, player_gst_bus_call, NULL);
 		gst_object_unref(bus);
 		g_signal_connect(player_pipeline, "audio-changed", (GCallback)player_on_audio_changed, NULL);
 
-		g_object_set(G_OBJECT(player_pipeline), "uri", song_played->m_fullname, NULL);
+		uri = song_get_uri(song_played);
+		g_object_set(G_OBJECT(player_pipeline), "uri", uri, NULL);
+		free(uri);
+		uri = NULL;
 
 		/* Start playing */
 		gst_element_set_state(player_pipeline, GST_STATE_PLAYING);
 		gst_element_get_state(player_pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
 
 		/* Seek to start time */
-		logger_debug(player_log, "start time is %lld", song_played->m_start_time);
+		logger_debug(player_log, "start time is %lld", 
+				song_get_start_time(song_played));
 		logger_debug(player_log, "cur_time is %lld", player_context->m_cur_time);
-		if (player_context->m_cur_time > 0 || song_played->m_start_time > -1)
+		if (player_context->m_cur_time > 0 || 
+				song_get_start_time(song_played) > -1)
 		{
 			guint64 tm = player_translate_time(song_played, player_context->m_cur_time, TRUE);
 			logger_debug(player_log, "gstreamer: seeking to time %lld", tm);
@@ -1837,10 +2225,12 @@ void *player_thread( void *arg )
 		/* Play */
 		logger_debug(player_log, "Going into track playing cycle");
 		song_finished = FALSE;
+		crossfade = FALSE;
 		was_status = PLAYER_STATUS_PLAYING;
 		while (!player_end_track)
 		{
 			g_main_context_iteration(NULL, FALSE);
+			player_tail_update();
 
 			if (player_context->m_status != was_status)
 			{
@@ -1881,14 +2271,46 @@ void *player_thread( void *arg )
 				}
 
 				/* Check for end of projected song */
-				if (song_played->m_end_time > -1 && 
+				if (song_get_end_time(song_played) > -1 && 
 						player_translate_time(song_played, player_context->m_cur_time, TRUE) >= 
-						song_played->m_end_time)
+						song_get_end_time(song_played))
 				{
 					logger_debug(player_log, _("stopping at time %lld(%lld) with end_time=%lld."), 
 							player_context->m_cur_time,
 							player_translate_time(song_played, player_context->m_cur_time, TRUE),
-							song_played->m_end_time);
+							song_get_end_time(song_played));
+					song_finished = TRUE;
+					break;
+				}
+
+				/* Warm the next track up. Cross-fade start time is
+				 * added, since the next track starts earlier then */
+				prefetch = cfg_handle_get_var_int(cfg_list, &prefetch_h);
+				if (!prefetched && prefetch > 0 &&
+						song_played->m_len - player_context->m_cur_time <=
+						SECONDS_TO_TIME(prefetch) + player_get_crossfade_time())
+				{
+					prefetched = TRUE;
+					player_prefetch_next();
+				}
+
+				/* Start the next track in advance to cross-fade them. 
+				 * Tracks from a single file are not cross-faded since
+				 * they are usually gapless */
+				xfade = player_get_crossfade_time();
+				if (fade_in)
+				{
+					fade_in = (xfade > 0 && player_context->m_cur_time < xfade);
+					player_set_fade(player_fade, fade_in ? 
+							(double)player_context->m_cur_time / xfade : 1);
+				}
+				if (xfade > 0 && player_fade != NULL &&
+						song_get_start_time(song_played) < 0 &&
+						song_played->m_len > 2 * xfade &&
+						song_played->m_len - player_context->m_cur_time <= xfade)
+				{
+					logger_debug(player_log, "Starting cross-fade");
+					crossfade = TRUE;
 					song_finished = TRUE;
 					break;
 				}
@@ -1906,15 +2328,38 @@ void *player_thread( void *arg )
 		}
 		logger_debug(player_log, "End playing track");
 
-		gst_element_set_state(player_pipeline, GST_STATE_NULL);
+		/* Leave the track playing in background while the next one
+		 * starts */
+		if (crossfade)
+		{
+			g_source_remove(bus_watch);
+			player_tail_stop();
+			player_tail_pipeline = player_pipeline;
+			player_tail_fade = player_fade;
+			player_tail_song = song_add_ref(song_played);
+			player_tail_fading = TRUE;
+			player_pipeline = NULL;
+			player_fade = NULL;
+		}
+		else
+			gst_element_set_state(player_pipeline, GST_STATE_NULL);
 
 		/* Send message about track end */
+		player_lock_plist();
 		if (!player_end_track)
 		{
 			logger_debug(player_log, "Going to the next track");
 			player_next_track();
 		}
 
+		/* No next track, so play the previous one up to its end */
+		if (crossfade && player_plist->m_cur_song < 0)
+		{
+			player_tail_fading = FALSE;
+			player_set_fade(player_tail_fade, 1);
+		}
+		player_unlock_plist();
+
 		/* End playing */
 		player_context->m_bitrate = player_context->m_freq = player_context->m_channels = player_context->m_depth = 0;
 
@@ -1922,6 +2367,11 @@ void *player_thread( void *arg )
 		wnd_invalidate(player_wnd);
 
 	cleanup:
+		if (player_fade)
+		{
+			gst_object_unref(GST_OBJECT(player_fade));
+			player_fade = NULL;
+		}
 		if (player_pipeline)
 		{
 			gst_object_unref(GST_OBJECT(player_pipeline));
@@ -1932,7 +2382,9 @@ void *player_thread( void *arg )
 			g_main_loop_unref(loop);
 			loop = NULL;
 		}
+		song_free(s);
 	}
+	player_tail_stop();
 	logger_debug(player_log, "Player thread finished");
 	return NULL;
 } /* End of 'player_thread' function */
@@ -2154,7 +2606,7 @@ bool_t player_info_dialog_fill( dialog_t *dlg, bool_t first_call )
 		for ( i = start, num_songs = 0; i <= end; i ++ )
 		{
 			/* Read info */
-			song_t *song = player_plist->m_list[i];
+			song_t *song = plist_get_song(player_plist, i);
 			song_update_info(song);
 			if (song->m_info == NULL)
 				continue;
@@ -2214,19 +2666,20 @@ bool_t player_info_dialog_fill( dialog_t *dlg, bool_t first_call )
 			song_update_info(songs_list[i]);
 		cur = songs_list[i]->m_info;
 
-		if (!name_diff && strcmp(info->m_name, cur->m_name))
+		/* Info strings are pooled, so equal strings are equal pointers */
+		if (!name_diff && info->m_name != cur->m_name)
 			name_diff = TRUE;
-		if (!album_diff && strcmp(info->m_album, cur->m_album))
+		if (!album_diff && info->m_album != cur->m_album)
 			album_diff = TRUE;
-		if (!artist_diff && strcmp(info->m_artist, cur->m_artist))
+		if (!artist_diff && info->m_artist != cur->m_artist)
 			artist_diff = TRUE;
-		if (!year_diff && strcmp(info->m_year, cur->m_year))
+		if (!year_diff && info->m_year != cur->m_year)
 			year_diff = TRUE;
-		if (!track_diff && strcmp(info->m_track, cur->m_track))
+		if (!track_diff && info->m_track != cur->m_track)
 			track_diff = TRUE;
-		if (!comment_diff && strcmp(info->m_comments, cur->m_comments))
+		if (!comment_diff && info->m_comments != cur->m_comments)
 			comment_diff = TRUE;
-		if (!genre_diff && strcmp(info->m_genre, cur->m_genre))
+		if (!genre_diff && info->m_genre != cur->m_genre)
 			genre_diff = TRUE;
 	}
 
@@ -2317,6 +2770,43 @@ void player_var_manager( void )
 	dialog_arrange_children(dlg);
 } /* End of 'player_var_manager' function */
 
+/* Launch play lists dialog */
+void player_plists_dialog( void )
+{
+	dialog_t *dlg;
+	vbox_t *vbox;
+	str_t *names;
+	int i;
+
+	dlg = dialog_new(wnd_root, _("Play lists"));
+
+	/* Show existing lists marking the active one */
+	names = str_new(_("Play lists: "));
+	pthread_mutex_lock(&player_lists->m_mutex);
+	for ( i = 0; i < player_lists->m_num_lists; i ++ )
+	{
+		plist_t *pl = player_lists->m_lists[i];
+		if (i > 0)
+			str_cat_cptr(names, ", ");
+		str_cat_cptr(names, pl->m_name);
+		if (pl == player_plist)
+			str_cat_cptr(names, "*");
+	}
+	pthread_mutex_unlock(&player_lists->m_mutex);
+	label_new(WND_OBJ(dlg->m_vbox), STR_TO_CPTR(names), "lists", 
+			LABEL_NOBOLD);
+	str_free(names);
+
+	editbox_new_with_label(WND_OBJ(dlg->m_vbox), _("&Name: "),
+			"name", player_plist->m_name, 'n', PLAYER_EB_WIDTH);
+	vbox = vbox_new(WND_OBJ(dlg->m_vbox), _("Operation"), 0);
+	radio_new(WND_OBJ(vbox), _("&Switch"), "switch", 's', TRUE);
+	radio_new(WND_OBJ(vbox), _("&Create and switch"), "create", 'c', FALSE);
+	radio_new(WND_OBJ(vbox), _("&Remove"), "remove", 'r', FALSE);
+	wnd_msg_add_handler(WND_OBJ(dlg), "ok_clicked", player_on_plists);
+	dialog_arrange_children(dlg);
+} /* End of 'player_plists_dialog' function */
+
 static void player_audio_setup_sync_device_box( wnd_t *wnd )
 {
 	editbox_t *sink_eb = EDITBOX_OBJ(wnd);
@@ -2466,6 +2956,7 @@ void player_test_dialog( void )
 	vbox = vbox_new(WND_OBJ(dlg->m_vbox), _("Tests"), 0);
 	radio_new(WND_OBJ(vbox), _("Test &1. Window library perfomance"), "1", '1', 
 			TRUE);
+	radio_new(WND_OBJ(vbox), _("Test &2. Benchmarks"), "2", '2', FALSE);
 	btn = button_new(WND_OBJ(dlg->m_hbox), _("&Stop job"), "stop", 's');
 	wnd_msg_add_handler(WND_OBJ(btn), "clicked", player_on_test_stop);
 	wnd_msg_add_handler(WND_OBJ(dlg), "ok_clicked", player_on_test);
@@ -2641,7 +3132,7 @@ wnd_msg_retcode_t player_on_add( wnd_t *wnd )
 {
 	editbox_t *eb = EDITBOX_OBJ(dialog_find_item(DIALOG_OBJ(wnd), "name"));
 	assert(eb);
-	plist_add(player_plist, EDITBOX_TEXT(eb));
+	plist_add_async(player_plist, EDITBOX_TEXT(eb));
 	return WND_MSG_RETCODE_OK;
 } /* End of 'player_on_add' function */
 
@@ -2758,6 +3249,7 @@ void player_save_info_dialog( dialog_t *dlg )
 			continue;
 
 		/* Prepare the info */
+		song_lock(songs_list[i]);
 		info = songs_list[i]->m_info;
 		assert(info);
 		if (name->m_modified)
@@ -2774,12 +3266,14 @@ void player_save_info_dialog( dialog_t *dlg )
 			si_set_comments(info, EDITBOX_TEXT(comments));
 		if (genre->m_modified)
 			si_set_genre(info, EDITBOX_TEXT(genre));
+		song_unlock(songs_list[i]);
 		song_update_title(songs_list[i]);
 		wnd_invalidate(player_wnd);
 
 		/* Save info */
-		irw_push(songs_list[i], SONG_INFO_WRITE);
+		iw_push(songs_list[i]);
 	}
+	iw_commit();
 } /* End of 'player_save_info_dialog' function */
 
 /* Handle 'ok_clicked' for info dialog */
@@ -2963,6 +3457,35 @@ wnd_msg_retcode_t player_on_var( wnd_t *wnd )
 	return WND_MSG_RETCODE_OK;
 } /* End of 'player_on_var' function */
 
+/* Handle 'ok_clicked' for play lists dialog */
+wnd_msg_retcode_t player_on_plists( wnd_t *wnd )
+{
+	editbox_t *name = EDITBOX_OBJ(dialog_find_item(DIALOG_OBJ(wnd), "name"));
+	radio_t *create = RADIO_OBJ(dialog_find_item(DIALOG_OBJ(wnd), "create"));
+	radio_t *rem = RADIO_OBJ(dialog_find_item(DIALOG_OBJ(wnd), "remove"));
+	char *text;
+	assert(name && create && rem);
+
+	text = EDITBOX_TEXT(name);
+	if (create->m_checked)
+	{
+		if (plmng_add(player_lists, text) == NULL)
+			logger_error(player_log, 1, 
+					_("unable to create play list %s"), text);
+		else
+			player_switch_plist(text);
+	}
+	else if (rem->m_checked)
+	{
+		if (!player_remove_plist(text))
+			logger_error(player_log, 1, 
+					_("unable to remove play list %s"), text);
+	}
+	else if (!player_switch_plist(text))
+		logger_error(player_log, 1, _("no play list %s"), text);
+	return WND_MSG_RETCODE_OK;
+} /* End of 'player_on_plists' function */
+
 /* Handle 'clicked' for variables manager view value button */
 wnd_msg_retcode_t player_on_var_view( wnd_t *wnd )
 {
@@ -3009,6 +3532,10 @@ wnd_msg_retcode_t player_on_test( wnd_t *wnd )
 	assert(r);
 	if (r->m_checked)
 		sel = TEST_WNDLIB_PERFOMANCE;
+	r = RADIO_OBJ(dialog_find_item(DIALOG_OBJ(wnd), "2"));
+	assert(r);
+	if (r->m_checked)
+		sel = TEST_BENCH;
 	if (sel < 0)
 		return WND_MSG_RETCODE_OK;
 
@@ -3123,13 +3650,19 @@ void player_pmng_dialog_destructor( wnd_t *wnd )
 static bool_t player_handle_var_title_format( cfg_node_t *var, char *value, 
 		void *data )
 {
-	int i;
+	int i, end;
 
+	/* Mark all titles stale; they are rebuilt on demand */
+	song_invalidate_titles();
 	if (player_plist == NULL)
 		return TRUE;
 
-	for ( i = 0; i < player_plist->m_len; i ++ )
-		song_update_title(player_plist->m_list[i]);
+	/* Rebuild visible rows right now */
+	end = player_plist->m_scrolled + PLIST_HEIGHT;
+	if (end > player_plist->m_len)
+		end = player_plist->m_len;
+	for ( i = player_plist->m_scrolled; i < end; i ++ )
+		song_update_title(plist_get_song(player_plist, i));
 	wnd_invalidate(wnd_root);
 	return TRUE;
 } /* End of 'player_handle_var_title_format' function */
@@ -3217,6 +3750,7 @@ void player_class_set_default_styles( cfg_node_t *list )
 
 	/* Initialize kbinds */
 	cfg_set_var(list, "kbind.queue", "'");
+	cfg_set_var(list, "kbind.cancel_add", "<Ctrl-g>");
 	cfg_set_var(list, "kbind.quit", "q;Q");
 	cfg_set_var(list, "kbind.move_down", "j;<Ctrl-n>;<Down>");
 	cfg_set_var(list, "kbind.move_up", "k;<Ctrl-p>;<Up>");
@@ -3253,6 +3787,7 @@ void player_class_set_default_styles( cfg_node_t *list )
 	cfg_set_var(list, "kbind.help", "?");
 	cfg_set_var(list, "kbind.shuffle", "R");
 	cfg_set_var(list, "kbind.var_manager", "o");
+	cfg_set_var(list, "kbind.plists", "gl");
 	cfg_set_var(list, "kbind.audio_setup", "A");
 	cfg_set_var(list, "kbind.plist_down", "J");
 	cfg_set_var(list, "kbind.plist_up", "K");
@@ -3387,9 +3922,87 @@ void player_stop( void )
 /* Queue the selected song */
 void player_queue_song( void )
 {
-	if(num_queued_songs < PLAYER_MAX_ENQUEUED)
-		queued_songs[num_queued_songs++] = player_plist->m_sel_end;
+	int pos = player_plist->m_sel_end;
+	if (pos >= 0 && pos < player_plist->m_len)
+		pqueue_push(player_queue, player_plist, pos);
 } /* End of 'player_queue_song' function */
 
+/* Make a named play list the active one. Playing is stopped and the 
+ * things bound to songs positions in the previous list (undo history, 
+ * shuffle order, play boundaries and marks) are reset. The list keeps
+ * its own cursor, selection and current song */
+bool_t player_switch_plist( const char *name )
+{
+	plist_t *pl = plmng_find(player_lists, name);
+	int i;
+
+	if (pl == NULL)
+		return FALSE;
+	if (pl == player_plist)
+		return TRUE;
+
+	/* Switch. Queue refers to rows of the previous list, so it is 
+	 * cleared too */
+	player_stop();
+	pthread_rwlock_wrlock(&player_plist_rwlock);
+	player_plist = pl;
+	player_pmng->m_playlist = pl;
+	pqueue_clear(player_queue);
+	pthread_rwlock_unlock(&player_plist_rwlock);
+	cfg_set_var(cfg_list, "active-plist", pl->m_name);
+
+	/* Reset position-dependent state */
+	player_start = player_end = -1;
+	player_last_pos = player_last_song = -1;
+	for ( i = 0; i < PLAYER_NUM_MARKS; i ++ )
+		player_marks[i] = -1;
+	shuffle_reset(player_shuffle);
+	undo_free(player_ul);
+	player_ul = undo_new();
+
+	if (player_wnd != NULL)
+		wnd_invalidate(player_wnd);
+	pmng_hook(player_pmng, "playlist");
+	return TRUE;
+} /* End of 'player_switch_plist' function */
+
+/* Ask window thread to make a named play list the active one */
+void player_request_switch_plist( const char *name )
+{
+	char *data = strdup(name);
+
+	if (data == NULL)
+		return;
+	if (player_wnd == NULL)
+	{
+		free(data);
+		return;
+	}
+	wnd_msg_send(player_wnd, "user", 
+			wnd_msg_user_new(PLAYER_MSG_SWITCH_PLIST, data));
+} /* End of 'player_request_switch_plist' function */
+
+/* Lock active play list pointer, so that it is not switched */
+void player_lock_plist( void )
+{
+	pthread_rwlock_rdlock(&player_plist_rwlock);
+} /* End of 'player_lock_plist' function */
+
+/* Unlock active play list pointer */
+void player_unlock_plist( void )
+{
+	pthread_rwlock_unlock(&player_plist_rwlock);
+} /* End of 'player_unlock_plist' function */
+
+/* Remove a named play list (active one can't be removed) */
+bool_t player_remove_plist( const char *name )
+{
+	plist_t *pl = plmng_find(player_lists, name);
+
+	if (pl == NULL || pl == player_plist)
+		return FALSE;
+	return plmng_remove(player_lists, name);
+} /* End of 'player_remove_plist' function */
+
 /* End of 'player.c' file */
 
@@ -25,12 +25,16 @@
 
 #include "types.h"
 #include "cfg.h"
+#include "checkpoint.h"
 #include "command.h"
 #include "logger.h"
 #include "logger_view.h"
 #include "main_types.h"
+#include "play_queue.h"
 #include "plist.h"
+#include "plist_mng.h"
 #include "pmng.h"
+#include "shuffle.h"
 #include "undo.h"
 #include "wnd.h"
 #include "wnd_dialog.h"
@@ -59,9 +63,9 @@
 /* Player window user messages IDs */
 #define PLAYER_MSG_INFO			0
 #define PLAYER_MSG_NEXT_FOCUS	1
-
-/* Max number of enqueued songs */
-#define PLAYER_MAX_ENQUEUED 	20
+#define PLAYER_MSG_ADD_DONE		2
+#define PLAYER_MSG_BENCH_RENDER	3
+#define PLAYER_MSG_SWITCH_PLIST	4
 
 /* Player window type */
 typedef struct
@@ -81,7 +85,13 @@ typedef struct
 /* Undo list */
 extern undo_list_t *player_ul;
 
-/* Play list */
+/* Named play lists */
+extern plmng_t *player_lists;
+
+/* Shuffle play engine */
+extern shuffle_t *player_shuffle;
+
+/* Active play list */
 extern plist_t *player_plist;
 
 /* Player context */
@@ -115,9 +125,8 @@ extern cfg_node_t *cfg_list;
 extern logger_t *player_log;
 extern logger_view_t *player_logview;
 
-/* enqueued songs - max of PLAYER_MAX_ENQUEUED */
-extern int queued_songs[PLAYER_MAX_ENQUEUED];
-extern int num_queued_songs;
+/* Play queue */
+extern pqueue_t *player_queue;
 
 /***
  * Initialization/deinitialization functions
@@ -266,6 +275,9 @@ void player_advanced_search_dialog( void );
 /* Launch variables manager */
 void player_var_manager( void );
 
+/* Launch play lists dialog */
+void player_plists_dialog( void );
+
 /* Launch test management dialog */
 void player_test_dialog( void );
 
@@ -318,6 +330,9 @@ wnd_msg_retcode_t player_on_info_reload( wnd_t *wnd );
 /* Handle 'ok_clicked' for variables manager */
 wnd_msg_retcode_t player_on_var( wnd_t *wnd );
 
+/* Handle 'ok_clicked' for play lists dialog */
+wnd_msg_retcode_t player_on_plists( wnd_t *wnd );
+
 /* Handle 'clicked' for variables manager view value button */
 wnd_msg_retcode_t player_on_var_view( wnd_t *wnd );
 
@@ -400,6 +415,21 @@ void player_stop( void );
 /* Queue the selected song */
 void player_queue_song( void );
 
+/* Make a named play list the active one. Must be called from the window
+ * thread; other threads use player_request_switch_plist */
+bool_t player_switch_plist( const char *name );
+
+/* Ask window thread to make a named play list the active one */
+void player_request_switch_plist( const char *name );
+
+/* Lock/unlock active play list pointer. Threads other than the window 
+ * one hold this lock while they use player_plist */
+void player_lock_plist( void );
+void player_unlock_plist( void );
+
+/* Remove a named play list (active one can't be removed) */
+bool_t player_remove_plist( const char *name );
+
 #endif
 
 /* End of 'player.h' file */
@@ -34,6 +34,7 @@
 #include <json-glib/json-glib.h>
 #include "types.h"
 #include "file_utils.h"
+#include "ingest.h"
 #include "json_helpers.h"
 #include "player.h"
 #include "plist.h"
@@ -44,6 +45,10 @@
 #include "wnd.h"
 #include "info_rw_thread.h"
 
+/* Undo history, shuffle order and playing song follow only the active
+ * play list */
+#define PLIST_IS_ACTIVE(pl) ((pl) == player_plist)
+
 /* Create a new play list */
 plist_t *plist_new( int start_pos )
 {
@@ -61,7 +66,14 @@ plist_t *plist_new( int start_pos )
 	pl->m_cur_song = -1;
 	pl->m_visual = FALSE;
 	pl->m_len = 0;
-	pl->m_list = NULL;
+	pl->m_name = NULL;
+	pl->m_ckpt = NULL;
+	pl->m_seq = pseq_new();
+	if (pl->m_seq == NULL)
+	{
+		free(pl);
+		return NULL;
+	}
 	pthread_mutex_init(&pl->m_mutex, NULL);
 	return pl;
 } /* End of 'plist_new' function */
@@ -71,18 +83,16 @@ void plist_free( plist_t *pl )
 {
 	if (pl != NULL)
 	{
-		if (pl->m_list != NULL)
-		{
-			int i;
-			
-			plist_lock(pl);
-			for ( i = 0; i < pl->m_len; i ++ )
-				song_free(pl->m_list[i]);
-			free(pl->m_list);
-			plist_unlock(pl);
-		}
+		pqueue_lock(player_queue);
+		plist_lock(pl);
+		pqueue_forget(player_queue, pl, 0, pl->m_len - 1);
+		pseq_remove(pl->m_seq, 0, pl->m_len, song_free);
+		pseq_free(pl->m_seq);
+		plist_unlock(pl);
+		pqueue_unlock(player_queue);
 		
 		pthread_mutex_destroy(&pl->m_mutex);
+		free(pl->m_name);
 		free(pl);
 	}
 } /* End of 'plist_free' function */
@@ -103,11 +113,26 @@ bool_t plist_add( plist_t *pl, char *filename )
 	return ret;
 } /* End of 'plist_add' function */
 
+/* Add a file to play list in background */
+bool_t plist_add_async( plist_t *pl, char *filename )
+{
+	plist_set_t *set;
+	bool_t ret;
+
+	set = plist_set_new(TRUE);
+	plist_set_add(set, filename);
+	ret = ingest_push(pl, set, TRUE);
+	plist_set_free(set);
+	return ret;
+} /* End of 'plist_add_async' function */
+
 /* Save play list */
 bool_t plist_save( plist_t *pl, char *filename )
 {
 	char *ext = util_extension(filename);
 	assert(pl);
+	if (cfg_get_var_bool(cfg_list, "lazy-info-load"))
+		plist_need_info(pl, 0, pl->m_len - 1, TRUE);
 
 	if (!strcasecmp(ext, "m3u"))
 		return plist_save_m3u(pl, filename);
@@ -120,7 +145,7 @@ bool_t plist_save( plist_t *pl, char *filename )
 bool_t plist_save_m3u( plist_t *pl, char *filename )
 {
 	FILE *fd;
-	int i;
+	pseq_node_t *node;
 
 	/* Try to create file */
 	fd = util_fopen(filename, "wt");
@@ -129,14 +154,18 @@ bool_t plist_save_m3u( plist_t *pl, char *filename )
 	
 	/* Write list head */
 	fprintf(fd, "#EXTM3U\n");
-	for ( i = 0; i < pl->m_len; i ++ )
+	for ( node = pseq_node_at(pl->m_seq, 0); node != NULL; 
+			node = pseq_next(node) )
 	{
-		song_t *s = pl->m_list[i];
+		song_t *s = node->m_song;
 		fprintf(fd, "#EXTINF:%i", TIME_TO_SECONDS(s->m_len));
-		if (s->m_start_time >= 0)
-			fprintf(fd, "-%i", TIME_TO_SECONDS(s->m_start_time));
+		if (song_get_start_time(s) >= 0)
+			fprintf(fd, "-%i", TIME_TO_SECONDS(song_get_start_time(s)));
 
-		fprintf(fd, ",%s\n%s\n", STR_TO_CPTR(s->m_title), song_get_name(s));
+		song_lock(s);
+		fprintf(fd, ",%s\n%s\n", STR_TO_CPTR(song_get_title_locked(s)), 
+				song_get_name(s));
+		song_unlock(s);
 	}
 
 	/* Close file */
@@ -148,6 +177,7 @@ bool_t plist_save_m3u( plist_t *pl, char *filename )
 bool_t plist_save_pls( plist_t *pl, char *filename )
 {
 	FILE *fd;
+	pseq_node_t *node;
 	int i;
 
 	/* Try to create file */
@@ -157,8 +187,9 @@ bool_t plist_save_pls( plist_t *pl, char *filename )
 	
 	/* Write list head */
 	fprintf(fd, "[playlist]\nnumberofentries=%d\n", pl->m_len);
-	for ( i = 0; i < pl->m_len; i ++ )
-		fprintf(fd, "File%d=%s\n", i + 1, song_get_name(pl->m_list[i]));
+	for ( i = 0, node = pseq_node_at(pl->m_seq, 0); node != NULL; 
+			i ++, node = pseq_next(node) )
+		fprintf(fd, "File%d=%s\n", i + 1, song_get_name(node->m_song));
 
 	/* Close file */
 	fclose(fd);
@@ -169,6 +200,7 @@ bool_t plist_save_pls( plist_t *pl, char *filename )
 int plist_song_cmp( song_t *s1, song_t *s2, int criteria )
 {
 	char dir1[MAX_FILE_NAME], dir2[MAX_FILE_NAME];
+	str_t *t1, *t2;
 	int res;
 	
 	if (s1 == NULL || s2 == NULL)
@@ -177,7 +209,12 @@ int plist_song_cmp( song_t *s1, song_t *s2, int criteria )
 	switch (criteria)
 	{
 	case PLIST_SORT_BY_TITLE:
-		return strcmp(STR_TO_CPTR(s1->m_title), STR_TO_CPTR(s2->m_title));
+		t1 = song_get_title(s1);
+		t2 = song_get_title(s2);
+		res = strcmp(STR_TO_CPTR(t1), STR_TO_CPTR(t2));
+		str_free(t1);
+		str_free(t2);
+		return res;
 	case PLIST_SORT_BY_NAME:
 		return strcmp(util_short_name(song_get_name(s1)),
 				util_short_name(song_get_name(s2)));
@@ -206,13 +243,57 @@ int plist_song_cmp( song_t *s1, song_t *s2, int criteria )
 	return 0;
 } /* End of 'plist_song_cmp' function */
 
+/* Song with its position before sorting. When sorting by title the 
+ * title is copied once rather than on every comparison */
+typedef struct
+{
+	song_t *m_song;
+	int m_index;
+	str_t *m_title;
+} plist_sort_item_t;
+
+/* Compare sorted items */
+static int plist_sort_item_cmp( plist_sort_item_t *i1, plist_sort_item_t *i2,
+		int criteria )
+{
+	if (criteria == PLIST_SORT_BY_TITLE)
+		return strcmp(STR_TO_CPTR(i1->m_title), STR_TO_CPTR(i2->m_title));
+	return plist_song_cmp(i1->m_song, i2->m_song, criteria);
+} /* End of 'plist_sort_item_cmp' function */
+
+/* Stable merge sort of songs */
+static void plist_merge_sort( plist_sort_item_t *items, plist_sort_item_t *tmp,
+		int num, int criteria )
+{
+	int half = num / 2, i, j, k;
+
+	if (num < 2)
+		return;
+	plist_merge_sort(items, tmp, half, criteria);
+	plist_merge_sort(&items[half], tmp, num - half, criteria);
+
+	/* Merge halves */
+	for ( i = 0, j = half, k = 0; i < half && j < num; k ++ )
+	{
+		if (plist_sort_item_cmp(&items[j], &items[i], criteria) < 0)
+			tmp[k] = items[j ++];
+		else
+			tmp[k] = items[i ++];
+	}
+	while (i < half)
+		tmp[k ++] = items[i ++];
+	while (j < num)
+		tmp[k ++] = items[j ++];
+	memcpy(items, tmp, sizeof(*items) * num);
+} /* End of 'plist_merge_sort' function */
+
 /* Sort play list with specified bounds */
 void plist_sort_bounds( plist_t *pl, int start, int end, int criteria )
 {
-	int i, j, was_song;
-	song_t *cur_song;
-	song_t **was_list = NULL;
-	bool_t finished = FALSE;
+	int i, num, was_song;
+	plist_sort_item_t *items, *tmp;
+	song_t **songs;
+	pseq_node_t *node;
 
 	assert(pl);
 	if (start > end)
@@ -223,91 +304,82 @@ void plist_sort_bounds( plist_t *pl, int start, int end, int criteria )
 		end = pl->m_len - 1;
 
 	/* Wait until info isn't got */
-	while ((criteria == PLIST_SORT_BY_TITLE || 
-				criteria == PLIST_SORT_BY_TRACK) && !finished)
-	{
-		finished = TRUE;
-		for ( i = 0; i < pl->m_len; i ++ )
-		{
-			if (pl->m_list[i]->m_flags & SONG_INFO_READ)
-			{
-				finished = FALSE;
-				break;
-			}
-		}
-		util_wait();
-	}
+	if (criteria == PLIST_SORT_BY_TITLE || criteria == PLIST_SORT_BY_TRACK)
+		plist_need_info(pl, start, end, TRUE);
 
 	/* Lock play list */
 	plist_lock(pl);
-
-	/* Save play list */
-	was_list = (song_t **)malloc(sizeof(song_t *) * pl->m_len);
-	memcpy(was_list, pl->m_list, sizeof(song_t *) * pl->m_len);
-	
-	/* Save current song */
-	was_song = pl->m_cur_song;
-	cur_song = (pl->m_cur_song < 0) ? NULL : pl->m_list[was_song];
-
-	/* Sort */
-	for ( i = start; i < end; i ++ )
+	num = end - start + 1;
+	if (num <= 0)
 	{
-		int k = i + 1, j;
-		song_t *s = pl->m_list[k];
+		plist_unlock(pl);
+		return;
+	}
 
-		for ( j = i; j >= start; j -- )
-		{
-			/* Compare songs and save current preferred position */
-			if (plist_song_cmp(s, pl->m_list[j], criteria) < 0)
-				k = j;
-			else
-				break;
-		}
+	/* Take songs out */
+	items = (plist_sort_item_t *)malloc(sizeof(*items) * num * 2);
+	songs = (song_t **)malloc(sizeof(*songs) * num);
+	if (items == NULL || songs == NULL)
+	{
+		free(items);
+		free(songs);
+		plist_unlock(pl);
+		return;
+	}
+	tmp = &items[num];
+	pseq_get_range(pl->m_seq, start, num, songs);
+	for ( i = 0; i < num; i ++ )
+	{
+		items[i].m_song = songs[i];
+		items[i].m_index = start + i;
+		items[i].m_title = (criteria == PLIST_SORT_BY_TITLE) ? 
+			song_get_title(songs[i]) : NULL;
+	}
 
-		/* Paste string to its place */
-		if (k <= i)
-		{
-			memmove(&pl->m_list[k + 1], &pl->m_list[k],
-					(i - k + 1) * sizeof(*pl->m_list));
-			pl->m_list[k] = s;
-		}
+	/* Sort and put songs back */
+	plist_merge_sort(items, tmp, num, criteria);
+	for ( i = 0; i < num; i ++ )
+	{
+		songs[i] = items[i].m_song;
+		str_free(items[i].m_title);
 	}
+	pseq_set_range(pl->m_seq, start, num, songs);
+	free(songs);
+
+	ckpt_log_reorder(pl->m_ckpt, pl);
+	if (PLIST_IS_ACTIVE(pl))
+		shuffle_reset(player_shuffle);
 
 	/* Find current song */
-	if (cur_song != NULL)
+	was_song = pl->m_cur_song;
+	if (was_song >= start && was_song <= end)
 	{
-		int i;
-
-		for ( i = start; i <= end; i ++ )
-			if (pl->m_list[i] == cur_song)
+		for ( i = 0; i < num; i ++ )
+			if (items[i].m_index == was_song)
 			{
-				pl->m_cur_song = i;
+				pl->m_cur_song = start + i;
 				break;
 			}
 	}
 
 	/* Store undo information */
-	if (player_store_undo)
+	if (player_store_undo && PLIST_IS_ACTIVE(pl))
 	{
 		struct tag_undo_list_item_t *undo;
+		int *transform;
 		undo = (struct tag_undo_list_item_t *)malloc(sizeof(*undo));
 		undo->m_type = UNDO_SORT;
 		undo->m_next = undo->m_prev = NULL;
 		undo->m_data.m_sort.m_was_song = was_song;
-		undo->m_data.m_sort.m_transform = (int *)malloc(
+		transform = undo->m_data.m_sort.m_transform = (int *)malloc(
 				sizeof(int) * pl->m_len);
 		for ( i = 0; i < pl->m_len; i ++ )
-		{
-			for ( j = 0; j < pl->m_len; j ++ )
-				if (was_list[i] == pl->m_list[j])
-				{
-					undo->m_data.m_sort.m_transform[i] = j;
-					break;
-				}
-		}
+			transform[i] = i;
+		for ( i = 0; i < num; i ++ )
+			transform[items[i].m_index] = start + i;
 		undo_add(player_ul, undo);
 	}
-	free(was_list);
+	free(items);
 
 	/* Unlock play list */
 	plist_unlock(pl);
@@ -352,10 +424,11 @@ void plist_rem( plist_t *pl )
 		return;
 
 	/* Store undo information */
-	if (player_store_undo)
+	if (player_store_undo && PLIST_IS_ACTIVE(pl))
 	{
 		struct tag_undo_list_item_t *undo;
 		struct tag_undo_list_rem_t *data;
+		pseq_node_t *node;
 		int j;
 		song_metadata_t metadata_empty = SONG_METADATA_EMPTY;
 		
@@ -366,9 +439,10 @@ void plist_rem( plist_t *pl )
 		data->m_num_files = end - start + 1;
 		data->m_start_pos = start;
 		data->m_files = (struct song_name *)malloc(sizeof(struct song_name) * data->m_num_files);
-		for ( i = start, j = 0; i <= end; i ++, j ++ )
+		for ( j = 0, node = pseq_node_at(pl->m_seq, start); 
+				j < data->m_num_files; j ++, node = pseq_next(node) )
 		{
-			song_t *s = pl->m_list[i];
+			song_t *s = node->m_song;
 			struct song_name *sn = &data->m_files[j];
 			if (s->m_filename)
 			{
@@ -377,17 +451,17 @@ void plist_rem( plist_t *pl )
 			}
 			else
 			{
-				sn->m_fullname = strdup(s->m_fullname);
+				sn->m_fullname = strdup(song_get_fullname(s));
 				sn->m_filename = NULL;
 			}
 
 			song_metadata_t *metadata = &sn->m_metadata;
 			(*metadata) = metadata_empty;
-			metadata->m_start_time = s->m_start_time;
-			metadata->m_end_time = s->m_end_time;
+			metadata->m_start_time = song_get_start_time(s);
+			metadata->m_end_time = song_get_end_time(s);
 			metadata->m_len = s->m_len;
-			if (s->m_default_title)
-				metadata->m_title = strdup(s->m_default_title);
+			if (song_get_default_title(s))
+				metadata->m_title = strdup(song_get_default_title(s));
 		}
 		undo_add(player_ul, undo);
 	}
@@ -395,28 +469,23 @@ void plist_rem( plist_t *pl )
 	/* Stop currently playing song if it is inside area being removed */
 	if (pl->m_cur_song >= start && pl->m_cur_song <= end)
 	{
-		player_end_play(TRUE);
+		if (PLIST_IS_ACTIVE(pl))
+			player_end_play(TRUE);
+		else
+			pl->m_cur_song = -1;
 	}
 
-	/* Unlock play list */
+	/* Lock play list (and the queue, which refers to its rows) */
+	pqueue_lock(player_queue);
 	plist_lock(pl);
 
 	/* Free memory */
-	for ( i = start; i <= end; i ++ )
-		song_free(pl->m_list[i]);
-
-	/* Shift songs list and reallocate memory */
-	memmove(&pl->m_list[start], &pl->m_list[end + 1],
-			(pl->m_len - end - 1) * sizeof(*pl->m_list));
+	ckpt_log_rem(pl->m_ckpt, pl, start, end);
+	if (PLIST_IS_ACTIVE(pl))
+		shuffle_remove(player_shuffle, start, end);
+	pqueue_forget(player_queue, pl, start, end);
+	pseq_remove(pl->m_seq, start, end - start + 1, song_free);
 	pl->m_len -= (end - start + 1);
-	if (pl->m_len)
-		pl->m_list = (song_t **)realloc(pl->m_list, 
-				pl->m_len * sizeof(*pl->m_list));
-	else
-	{
-		free(pl->m_list);
-		pl->m_list = NULL;
-	}
 
 	/* Fix cursor */
 	plist_move(pl, start, FALSE);
@@ -426,6 +495,7 @@ void plist_rem( plist_t *pl )
 
 	/* Unlock play list */
 	plist_unlock(pl);
+	pqueue_unlock(player_queue);
 
 	pmng_hook(player_pmng, "playlist");
 } /* End of 'plist_rem' function */
@@ -433,12 +503,15 @@ void plist_rem( plist_t *pl )
 /* Search for string */
 bool_t plist_search( plist_t *pl, char *pstr, int dir, int criteria )
 {
+	CFG_VAR_HANDLE(nocase_h, "search-nocase");
 	int i, count = 0;
 	bool_t found = FALSE;
 
 	assert(pl);
 	if (!pl->m_len)
 		return FALSE;
+	if (cfg_get_var_bool(cfg_list, "lazy-info-load"))
+		plist_need_info(pl, 0, pl->m_len - 1, TRUE);
 
 	/* Search */
 	for ( i = pl->m_sel_end, count = 0; count < pl->m_len && !found; count ++ )
@@ -454,13 +527,17 @@ bool_t plist_search( plist_t *pl, char *pstr, int dir, int criteria )
 			i = 0;
 
 		/* Search for specified string */
-		s = pl->m_list[i];
+		s = plist_get_song(pl, i);
+		song_lock(s);
 		if (criteria != PLIST_SEARCH_TITLE && s->m_info == NULL)
+		{
+			song_unlock(s);
 			continue;
+		}
 		switch (criteria)
 		{
 		case PLIST_SEARCH_TITLE:
-			str = STR_TO_CPTR(s->m_title);
+			str = STR_TO_CPTR(song_get_title_locked(s));
 			break;
 		case PLIST_SEARCH_NAME:
 			str = s->m_info->m_name;
@@ -488,7 +565,8 @@ bool_t plist_search( plist_t *pl, char *pstr, int dir, int criteria )
 			break;
 		}
 		found = util_search_regexp(pstr, str, 
-				cfg_get_var_int(cfg_list, "search-nocase"));
+				cfg_handle_get_var_int(cfg_list, &nocase_h));
+		song_unlock(s);
 		if (found)
 			plist_move(pl, i, FALSE);
 	} 
@@ -558,16 +636,61 @@ void plist_centrize( plist_t *pl, int index )
 	}
 } /* End of 'plist_centrize' function */
 
+/* Add songs from the range to the info reading hints */
+static void plist_hint_range( plist_t *pl, int start, int end, 
+		song_t **hints, int *num )
+{
+	pseq_node_t *node;
+
+	if (start < 0)
+		start = 0;
+	for ( node = pseq_node_at(pl->m_seq, start); start < end && node != NULL &&
+			(*num) < IRW_MAX_HINTS; start ++, node = pseq_next(node) )
+	{
+		if (node->m_song->m_flags & SONG_INFO_READ)
+			hints[(*num) ++] = node->m_song;
+	}
+} /* End of 'plist_hint_range' function */
+
+/* Make info of the songs user sees (or is going to see soon) read first.
+ * Play list must be locked */
+static void plist_hint_visible( plist_t *pl )
+{
+	song_t *hints[IRW_MAX_HINTS];
+	int num = 0, h = PLIST_HEIGHT;
+
+	/* Screen, next screen, previous screen and the current song */
+	plist_hint_range(pl, pl->m_scrolled, pl->m_scrolled + h, hints, &num);
+	plist_hint_range(pl, pl->m_scrolled + h, pl->m_scrolled + 2 * h, 
+			hints, &num);
+	plist_hint_range(pl, pl->m_scrolled - h, pl->m_scrolled, hints, &num);
+	if (pl->m_cur_song >= 0)
+		plist_hint_range(pl, pl->m_cur_song, pl->m_cur_song + 1, hints, &num);
+	irw_hint(hints, num);
+} /* End of 'plist_hint_visible' function */
+
 /* Display play list */
 void plist_display( plist_t *pl, wnd_t *wnd )
 {
 	int i, j, start, end;
+	int height = PLIST_HEIGHT;
+	int *queue_pos = NULL;
 	char time_text[80];
+	pseq_node_t *node;
 
 	assert(pl);
 	PLIST_GET_SEL(pl, start, end);
 
+	/* Get queue positions of the visible songs */
+	if (height > 0)
+		queue_pos = (int *)malloc(sizeof(int) * height);
+	pqueue_lock(player_queue);
 	plist_lock(pl);
+	if (queue_pos != NULL)
+		pqueue_get_positions(player_queue, pl, pl->m_scrolled, height, 
+				queue_pos);
+	pqueue_unlock(player_queue);
+	node = pseq_node_at(pl->m_seq, pl->m_scrolled);
 
 	/* Display each song */
 	for ( i = 0, j = pl->m_scrolled; i < PLIST_HEIGHT; i ++, j ++ )
@@ -593,36 +716,36 @@ void plist_display( plist_t *pl, wnd_t *wnd )
 		/* Print song title */
 		if (j < pl->m_len)
 		{
-			song_t *s = pl->m_list[j];
+			song_t *s = node->m_song;
 			char len[10];
 			int x;
-			int queueList;
 			
 			wnd_move(wnd, 0, 0, pl->m_start_pos + i);
-			wnd_printf(wnd, WND_PRINT_ELLIPSES, WND_WIDTH(wnd) - 8, 
-					"%i. %s", j + 1, STR_TO_CPTR(s->m_title));
-			for(queueList=0;queueList<num_queued_songs;queueList++)
-			{
-				if(queued_songs[queueList] == j)
-					wnd_printf(wnd, 0, 0, "    #%i in queue...", queueList+1);
-			}
+			wnd_printf(wnd, 0, WND_WIDTH(wnd) - 8, "%i. ", j + 1);
+			song_lock(s);
+			str_wide_t *ws = song_get_wide_title_locked(s);
+			str_t *title = song_get_title_locked(s);
+			if (ws != NULL)
+				wnd_put_wide(wnd, WND_PRINT_ELLIPSES, WND_WIDTH(wnd) - 8, ws);
+			else if (title != NULL)
+				wnd_printf(wnd, WND_PRINT_ELLIPSES, WND_WIDTH(wnd) - 8, 
+						"%s", STR_TO_CPTR(title));
+			song_unlock(s);
+			if (queue_pos != NULL && queue_pos[i] > 0)
+				wnd_printf(wnd, 0, 0, "    #%i in queue...", queue_pos[i]);
 			int l = TIME_TO_SECONDS(s->m_len);
 			sprintf(len, "%i:%02i", l / 60, l % 60);
 			wnd_move(wnd, WND_MOVE_ADVANCE, WND_WIDTH(wnd) - strlen(len) - 1, 
 					pl->m_start_pos + i);
 			wnd_printf(wnd, 0, 0, "%s", len);
+			node = pseq_next(node);
 		}
 	}
 
 	/* Display play list time */
-	song_time_t l_time = 0, s_time = 0;
-	if (pl->m_len)
-	{
-		for ( i = 0; i < pl->m_len; i ++ )
-			l_time += pl->m_list[i]->m_len;
-		for ( i = start; i <= end; i ++ )
-			s_time += pl->m_list[i]->m_len;
-	}
+	song_time_t l_time = pseq_get_time(pl->m_seq, 0, pl->m_len);
+	song_time_t s_time = (start >= 0) ? 
+		pseq_get_time(pl->m_seq, start, end - start + 1) : 0;
 	int l_seconds = TIME_TO_SECONDS(l_time);
 	int s_seconds = TIME_TO_SECONDS(s_time);
 	wnd_apply_style(wnd, "plist-time-style");
@@ -635,7 +758,10 @@ void plist_display( plist_t *pl, wnd_t *wnd )
 			pl->m_start_pos + PLIST_HEIGHT);
 	wnd_printf(wnd, 0, 0, "%s", time_text);
 
+	/* Read info of the visible songs first */
+	plist_hint_visible(pl);
 	plist_unlock(pl);
+	free(queue_pos);
 } /* End of 'plist_display' function */
 
 /* Lock play list */
@@ -653,8 +779,7 @@ void plist_unlock( plist_t *pl )
 /* Move selection in play list */
 void plist_move_sel( plist_t *pl, int y, bool_t relative )
 {
-	int start, end, i, j, num_songs;
-	song_t *cur_song;
+	int start, end, cur, num_songs;
 	
 	if (pl == NULL)
 		return;
@@ -673,14 +798,10 @@ void plist_move_sel( plist_t *pl, int y, bool_t relative )
 		y = 0;
 	else if (y >= pl->m_len - (end - start))
 		y = pl->m_len - (end - start) - 1;
-	if (pl->m_cur_song >= 0)
-		cur_song = pl->m_list[pl->m_cur_song];
-	else
-		cur_song = NULL;
 	num_songs = end - start + 1;
 
 	/* Store undo information */
-	if (player_store_undo)
+	if (player_store_undo && PLIST_IS_ACTIVE(pl))
 	{
 		struct tag_undo_list_item_t *undo;
 		undo = (struct tag_undo_list_item_t *)malloc(sizeof(*undo));
@@ -693,36 +814,21 @@ void plist_move_sel( plist_t *pl, int y, bool_t relative )
 	}
 
 	/* Move */
-	if (y - start < 0)
-	{
-		for ( i = start; i > y; i -- )
-		{
-			song_t *s = pl->m_list[i - 1];
-			memmove(&pl->m_list[i - 1], &pl->m_list[i], 
-					num_songs * sizeof(song_t *));
-			pl->m_list[i + num_songs - 1] = s;
-		}
-	}
-	else
-	{
-		for ( i = start; i < y; i ++ )
-		{
-			song_t *s = pl->m_list[i + num_songs];
-			memmove(&pl->m_list[i + 1], &pl->m_list[i], 
-					num_songs * sizeof(song_t *));
-			pl->m_list[i] = s;
-		}
-	}
+	ckpt_log_move(pl->m_ckpt, pl, start, end, y);
+	if (PLIST_IS_ACTIVE(pl))
+		shuffle_move(player_shuffle, start, end, y);
+	pseq_move(pl->m_seq, start, num_songs, y);
 
 	/* Update selection indecies and current song */
 	pl->m_sel_start += (y - start);
 	pl->m_sel_end += (y - start);
-	for ( i = 0; i < pl->m_len; i ++ )
-		if (pl->m_list[i] == cur_song)
-		{
-			pl->m_cur_song = i;
-			break;
-		}
+	cur = pl->m_cur_song;
+	if (cur >= start && cur <= end)
+		pl->m_cur_song += (y - start);
+	else if (y < start && cur >= y && cur < start)
+		pl->m_cur_song += num_songs;
+	else if (y > start && cur > end && cur < y + num_songs)
+		pl->m_cur_song -= num_songs;
 
 	/* Scroll if need */
 	if (pl->m_sel_end < pl->m_scrolled || 
@@ -743,6 +849,7 @@ void plist_move_sel( plist_t *pl, int y, bool_t relative )
 void plist_reload_info( plist_t *pl, bool_t global )
 {
 	int i, start, end;
+	pseq_node_t *node;
 	
 	if (pl == NULL || !pl->m_len)
 		return;
@@ -758,11 +865,9 @@ void plist_reload_info( plist_t *pl, bool_t global )
 		PLIST_GET_SEL(pl, start, end);
 	}
 
-	for ( i = start; i <= end; i ++ )
-	{
-		song_t *s = pl->m_list[i];
-		irw_push(s, SONG_INFO_READ);
-	}
+	for ( i = start, node = pseq_node_at(pl->m_seq, start); 
+			i <= end && node != NULL; i ++, node = pseq_next(node) )
+		irw_push(node->m_song, SONG_INFO_READ);
 } /* End of 'plist_reload_info' function */
 
 /* Check if specified file name belongs to an object */
@@ -776,25 +881,97 @@ bool_t plist_is_obj( char *filename )
 		return FALSE;
 } /* End of 'plist_is_obj' function */
 
-/* Set info for all scheduled songs */
-void plist_flush_scheduled( plist_t *pl )
+/* Set info for all scheduled songs (in lazy mode only mark them) */
+static void plist_set_scheduled( plist_t *pl, bool_t lazy )
 {
-	int i;
+	pseq_node_t *node;
 
-	for ( i = 0; i < pl->m_len; i ++ )
+	for ( node = pseq_node_at(pl->m_seq, 0); node != NULL; 
+			node = pseq_next(node) )
 	{
-		song_t *s = pl->m_list[i];
+		song_t *s = node->m_song;
 		if (s->m_flags & SONG_SCHEDULE)
 		{
-			irw_push(s, SONG_INFO_READ);
+			/* In lazy mode songs are only marked, they are queued when 
+			 * they are shown or needed (see plist_need_info) */
+			if (lazy)
+				s->m_flags |= SONG_INFO_READ;
+			else
+				irw_push(s, SONG_INFO_READ);
 			s->m_flags &= (~SONG_SCHEDULE);
 		}
 	}
+} /* End of 'plist_set_scheduled' function */
+
+/* Set info for all scheduled songs */
+void plist_flush_scheduled( plist_t *pl )
+{
+	plist_set_scheduled(pl, cfg_get_var_bool(cfg_list, "lazy-info-load"));
 } /* End of 'plist_flush_scheduled' function */
 
+/* Make sure info of songs in range is read or being read */
+void plist_need_info( plist_t *pl, int start, int end, bool_t wait )
+{
+	pseq_node_t *node;
+	int i;
+
+	if (start < 0)
+		start = 0;
+
+	/* Queue songs which are not read yet */
+	plist_lock(pl);
+	for ( i = start, node = pseq_node_at(pl->m_seq, start); 
+			i <= end && node != NULL; i ++, node = pseq_next(node) )
+	{
+		if (node->m_song->m_flags & SONG_INFO_READ)
+			irw_push(node->m_song, SONG_INFO_READ);
+	}
+	plist_unlock(pl);
+	if (wait)
+		plist_wait_info(pl, start, end, NULL);
+} /* End of 'plist_need_info' function */
+
+/* Wait until info of songs in range is read */
+bool_t plist_wait_info( plist_t *pl, int start, int end, bool_t *stop )
+{
+	pseq_node_t *node;
+	bool_t finished = FALSE;
+
+	if (start < 0)
+		start = 0;
+
+	/* Songs before the first not read one are not checked again */
+	irw_hurry(TRUE);
+	while (stop == NULL || !(*stop))
+	{
+		finished = TRUE;
+
+		plist_lock(pl);
+		for ( node = pseq_node_at(pl->m_seq, start); 
+				start <= end && node != NULL; start ++, node = pseq_next(node) )
+		{
+			if (node->m_song->m_flags & SONG_INFO_READ)
+			{
+				/* It might be added after we've queued songs */
+				irw_push(node->m_song, SONG_INFO_READ);
+				finished = FALSE;
+				break;
+			}
+		}
+		plist_unlock(pl);
+		if (finished)
+			break;
+		util_wait();
+	}
+	irw_hurry(FALSE);
+	return finished;
+} /* End of 'plist_wait_info' function */
+
 #define PLIST_TOO_NESTED -1
 #define PLP_STATUS_TOO_NESTED -1
 
+static plist_plugin_t *is_playlist( char *file );
+
 /* First see if this is a playlist prefix */
 static int plist_add_prefixed(plist_t *pl, char *name, song_metadata_t *metadata, int recc_level)
 {
@@ -806,14 +983,64 @@ static int plist_add_prefixed(plist_t *pl, char *name, song_metadata_t *metadata
 	return plist_add_uri(pl, name, metadata);
 }
 
+/* Number of play list items appended to the list at once */
+#define PLIST_ADD_BATCH 256
+
 typedef struct
 {
 	plist_t *pl;
 	char *m_pl_name;
 	int num_added;
 	int recc_level;
+
+	/* Songs waiting to be appended */
+	song_t *m_batch[PLIST_ADD_BATCH];
+	int m_batch_len;
 } plist_cb_ctx_t;
 
+/* Append batched play list items */
+static void plist_flush_batch( plist_cb_ctx_t *ctx )
+{
+	int i;
+
+	if (!ctx->m_batch_len)
+		return;
+	if (!plist_add_songs(ctx->pl, ctx->m_batch, ctx->m_batch_len))
+	{
+		for ( i = 0; i < ctx->m_batch_len; i ++ )
+			song_free(ctx->m_batch[i]);
+		ctx->num_added -= ctx->m_batch_len;
+	}
+	ctx->m_batch_len = 0;
+} /* End of 'plist_flush_batch' function */
+
+/* Add a file, batching plain songs. Nested play lists flush the batch
+ * first, so they keep their place in order */
+static int plist_batch_file( plist_cb_ctx_t *ctx, char *name, 
+		song_metadata_t *metadata )
+{
+	if (is_playlist(name))
+	{
+		plist_flush_batch(ctx);
+		int res = plist_add_one_file(ctx->pl, name, metadata, -1, 
+				ctx->recc_level);
+		if (res > 0)
+			ctx->num_added += res;
+		return res;
+	}
+
+	song_t *song = song_new_from_file(name, metadata);
+	if (song == NULL)
+		return 0;
+	if (!metadata->m_title)
+		song_schedule_info(song);
+	ctx->m_batch[ctx->m_batch_len ++] = song;
+	ctx->num_added ++;
+	if (ctx->m_batch_len == PLIST_ADD_BATCH)
+		plist_flush_batch(ctx);
+	return 1;
+} /* End of 'plist_batch_file' function */
+
 /* Cue sheets often have a .wav file specified
  * while actually relating to an encoded file
  * Try to fix this.
@@ -862,9 +1089,13 @@ static plp_status_t plist_add_playlist_item( void *ctxv, char *name, song_metada
 	plist_cb_ctx_t *ctx = (plist_cb_ctx_t *)ctxv;
 	plp_status_t ret = PLP_STATUS_OK;
 
+	if (ingest_cancelled())
+		return PLP_STATUS_FAILED;
+
 	/* Handle URI in a playlist */
 	if (fu_is_prefixed(name))
 	{
+		plist_flush_batch(ctx);
 		int res = plist_add_prefixed(ctx->pl, name, metadata, ctx->recc_level);
 		if (res == PLIST_TOO_NESTED)
 			return PLP_STATUS_TOO_NESTED;
@@ -899,6 +1130,7 @@ static plp_status_t plist_add_playlist_item( void *ctxv, char *name, song_metada
 		{
 			full_name = (char*)malloc(strlen(name) +
 					player_pmng->m_media_ext_max_len + 1);
+			strcpy(full_name, name);
 		}
 
 		/* If neither extension worked don't add this item */
@@ -906,14 +1138,8 @@ static plp_status_t plist_add_playlist_item( void *ctxv, char *name, song_metada
 			goto finish;
 	}
 
-	int res = plist_add_one_file(ctx->pl, full_name, metadata, -1, ctx->recc_level);
-	if (res == PLIST_TOO_NESTED)
+	if (plist_batch_file(ctx, full_name, metadata) == PLIST_TOO_NESTED)
 		ret = PLP_STATUS_TOO_NESTED;
-	else
-	{
-		assert(res >= 0);
-		ctx->num_added += res;
-	}
 
 finish:
 	if (full_name != name)
@@ -926,23 +1152,19 @@ void plist_add_song( plist_t *pl, song_t *song, int where )
 	/* Lock play list */
 	plist_lock(pl);
 
-	/* Try to reallocate memory for play list */
+	/* Insert song */
 	int was_len = pl->m_len;
-	pl->m_list = (song_t **)realloc(pl->m_list,
-			sizeof(song_t *) * (pl->m_len + 1));
-	if (pl->m_list == NULL)
+	if (where < 0 || where >= pl->m_len)  
+		where = pl->m_len;
+	if (!pseq_insert(pl->m_seq, where, &song, 1))
 	{
-		pl->m_len = 0;
 		plist_unlock(pl);
 		return;
 	}
-
-	if (where < 0 || where >= pl->m_len)  
-		where = pl->m_len;
-	memmove(&pl->m_list[where + 1], &pl->m_list[where], 
-			sizeof(song_t *) * (pl->m_len - where));
-	pl->m_list[where] = song;
 	pl->m_len ++;
+	ckpt_log_add(pl->m_ckpt, pl, song, where);
+	if (PLIST_IS_ACTIVE(pl))
+		shuffle_insert(player_shuffle, where, 1);
 
 	/* Update current song index */
 	if (pl->m_cur_song >= where)
@@ -959,6 +1181,36 @@ void plist_add_song( plist_t *pl, song_t *song, int where )
 	plist_unlock(pl);
 }
 
+/* Append several songs at once */
+bool_t plist_add_songs( plist_t *pl, song_t **songs, int num )
+{
+	int i;
+
+	if (num <= 0)
+		return TRUE;
+
+	plist_lock(pl);
+	if (!pseq_insert(pl->m_seq, pl->m_len, songs, num))
+	{
+		plist_unlock(pl);
+		return FALSE;
+	}
+	for ( i = 0; i < num; i ++ )
+		ckpt_log_add(pl->m_ckpt, pl, songs[i], pl->m_len + i);
+	if (PLIST_IS_ACTIVE(pl))
+		shuffle_insert(player_shuffle, pl->m_len, num);
+
+	/* If list was empty - put cursor to the first song */
+	if (!pl->m_len)
+	{
+		pl->m_sel_start = pl->m_sel_end = 0;
+		pl->m_visual = FALSE;
+	}
+	pl->m_len += num;
+	plist_unlock(pl);
+	return TRUE;
+} /* End of 'plist_add_songs' function */
+
 static plist_plugin_t *is_playlist(char *file)
 {
 	plist_plugin_t *plp = pmng_is_playlist_prefix(player_pmng, file);
@@ -977,12 +1229,19 @@ int plist_add_plist( plist_t *pl, plist_plugin_t *plp, char *file, int recc_leve
 	if (recc_level++ > 16)
 		return PLIST_TOO_NESTED;
 
-	plist_cb_ctx_t ctx = { pl, file, 0, recc_level };
+	plist_cb_ctx_t ctx;
+	ctx.pl = pl;
+	ctx.m_pl_name = file;
+	ctx.num_added = 0;
+	ctx.recc_level = recc_level;
+	ctx.m_batch_len = 0;
 	plp_status_t status = plp_for_each_item(plp, file, &ctx,
 			plist_add_playlist_item);
-	if (status != PLP_STATUS_OK)
-		return (status == PLP_STATUS_TOO_NESTED ? PLIST_TOO_NESTED : 0);
+	plist_flush_batch(&ctx);
+	if (status == PLP_STATUS_TOO_NESTED)
+		return PLIST_TOO_NESTED;
 
+	/* Songs added before a failure or cancellation stay in the list */
 	return ctx.num_added;
 }
 
@@ -1009,7 +1268,7 @@ int plist_add_one_file( plist_t *pl, char *file, song_metadata_t *metadata,
 
 	/* Schedule song for setting its info and length */
 	if (!metadata->m_title)
-		song->m_flags |= SONG_SCHEDULE;
+		song_schedule_info(song);
 
 	plist_add_song(pl, song, where);
 
@@ -1053,69 +1312,30 @@ static int plist_add_real_path( plist_t *pl, char *full_path )
 		return plist_add_file(pl, full_path);
 }
 
-static int plist_add_dir( plist_t *pl, char *dir_path )
+/* Directory walk callback */
+static bool_t plist_add_dir_item( void *ctxv, char *path )
 {
-	/* Get sorted directory contents */
-	struct dirent **namelist;
-	int n = scandir(dir_path, &namelist, NULL, alphasort);
-	if (n < 0)
-	{
-		logger_error(player_log, 1, "scandir failed");
-		return 0;
-	}
-
-	int num_added = 0;
-	int only_idx = -1;
-
-	/* Smart directory adding: scan directory for playlist and 
-	 * only one playlist if there is any */
-	if (cfg_get_var_bool(cfg_list, "smart-dir-add"))
-	{
-		int plist_idx = -1;
-		int rank = 0;
-		for ( int i = 0; i < n; i++ )
-		{
-			char *name = namelist[i]->d_name;
-
-			plist_plugin_t *plp = is_playlist(name);
-			if (!plp)
-				continue;
-
-			int this_rank = PLIST_RANK(plp);
-			if (plist_idx < 0 || this_rank > rank)
-			{
-				plist_idx = i;
-				rank = this_rank;
-			}
-		}
-
-		only_idx = plist_idx;
-	}
-
-	for ( int i = 0; i < n; i++ )
-	{
-		char *name = namelist[i]->d_name;
-
-		/* Skip everything except for playlist in the smart-add mode */
-		if (only_idx != -1 && only_idx != i)
-			goto finally;
-
-		if (fu_is_special_dir(name))
-			goto finally;
-		if ((*name) == '.' && cfg_get_var_bool(cfg_list, "skip-hidden-files"))
-			goto finally;
-
-		char *full_path = util_strcat(dir_path, "/", name, NULL);
-		num_added += plist_add_real_path(pl, full_path);
-		free(full_path);
-
-	finally:
-		free(namelist[i]);
-	}
+	plist_cb_ctx_t *ctx = (plist_cb_ctx_t *)ctxv;
+	song_metadata_t metadata = SONG_METADATA_EMPTY;
 
-	free(namelist);
+	plist_report_if_too_nested_and_continue(
+			plist_batch_file(ctx, path, &metadata), path);
+	return TRUE;
+} /* End of 'plist_add_dir_item' function */
 
-	return num_added;
+static int plist_add_dir( plist_t *pl, char *dir_path )
+{
+	plist_cb_ctx_t ctx;
+	ctx.pl = pl;
+	ctx.m_pl_name = dir_path;
+	ctx.num_added = 0;
+	ctx.recc_level = 0;
+	ctx.m_batch_len = 0;
+
+	/* Directories are read in parallel; files come in sorted order */
+	ingest_walk(dir_path, plist_add_dir_item, &ctx);
+	plist_flush_batch(&ctx);
+	return ctx.num_added;
 }
 
 int plist_add_uri( plist_t *pl, char *uri, song_metadata_t *metadata )
@@ -1125,7 +1345,7 @@ int plist_add_uri( plist_t *pl, char *uri, song_metadata_t *metadata )
 
 	/* Schedule song for setting its info and length */
 	if (!metadata->m_title)
-		s->m_flags |= SONG_SCHEDULE;
+		song_schedule_info(s);
 
 	plist_add_song(pl, s, -1);
 	return 1;
@@ -1169,17 +1389,16 @@ static int plist_add_path( plist_t *pl, char *path )
 	return res;
 }
 
-/* Add a set of files to play list */
-bool_t plist_add_set( plist_t *pl, plist_set_t *set )
+/* Add files of a set without storing undo information */
+int plist_add_set_files( plist_t *pl, plist_set_t *set )
 {
-	/* Do nothing if set is empty */
-	if (pl == NULL || set == NULL)
-		return FALSE;
-
 	int plist_num = 0;
 
 	for ( struct tag_plist_set_t *node = set->m_head; node; node = node->m_next )
 	{
+		if (ingest_cancelled())
+			break;
+
 		/* glob patterns */
 		if (set->m_patterns && !fu_is_prefixed(node->m_name))
 		{
@@ -1187,7 +1406,8 @@ bool_t plist_add_set( plist_t *pl, plist_set_t *set )
 			if (glob(node->m_name, GLOB_TILDE, NULL, &gl))
 				continue;
 
-			for ( char **path = gl.gl_pathv; *path; ++path )
+			for ( char **path = gl.gl_pathv; *path && !ingest_cancelled(); 
+					++path )
 				plist_num += plist_add_path(pl, *path);
 
 			globfree(&gl);
@@ -1196,12 +1416,29 @@ bool_t plist_add_set( plist_t *pl, plist_set_t *set )
 		else
 			plist_num += plist_add_path(pl, node->m_name);
 	}
+	return plist_num;
+} /* End of 'plist_add_set_files' function */
 
+/* Add a set of files to play list */
+bool_t plist_add_set( plist_t *pl, plist_set_t *set )
+{
+	/* Do nothing if set is empty */
+	if (pl == NULL || set == NULL)
+		return FALSE;
+
+	plist_add_set_done(pl, set, plist_add_set_files(pl, set));
+	return TRUE;
+} /* End of 'plist_add_set' function */
+
+/* Finish adding a set: set info, store undo information and sort */
+void plist_add_set_done( plist_t *pl, plist_set_t *set, int plist_num )
+{
 	/* Set info */
-	plist_flush_scheduled(pl);
+	plist_set_scheduled(pl, set->m_lazy_info || 
+			cfg_get_var_bool(cfg_list, "lazy-info-load"));
 	
 	/* Store undo information */
-	if (player_store_undo && plist_num)
+	if (player_store_undo && plist_num && PLIST_IS_ACTIVE(pl))
 	{
 		struct tag_undo_list_item_t *undo;
 		undo = (struct tag_undo_list_item_t *)malloc(sizeof(*undo));
@@ -1234,9 +1471,7 @@ bool_t plist_add_set( plist_t *pl, plist_set_t *set )
 			plist_sort_bounds(pl, pl->m_len - plist_num, pl->m_len - 1, cr);
 		}
 	}
-
-	return TRUE;
-} /* End of 'plist_add_set' function */
+} /* End of 'plist_add_set_done' function */
 
 /* Initialize a set of files for adding */
 plist_set_t *plist_set_new( bool_t patterns )
@@ -1248,6 +1483,7 @@ plist_set_t *plist_set_new( bool_t patterns )
 	if (set == NULL)
 		return NULL;
 	set->m_patterns = patterns;
+	set->m_lazy_info = FALSE;
 	set->m_head = set->m_tail = NULL;
 	return set;
 } /* End of 'plist_set_new' function */
@@ -1305,6 +1541,7 @@ plist_set_t *plist_set_dup( plist_set_t *set )
 		return NULL;
 
 	s = plist_set_new(set->m_patterns);
+	s->m_lazy_info = set->m_lazy_info;
 	for ( node = set->m_head; node != NULL; node = node->m_next )
 		plist_set_add(s, node->m_name);
 	return s;
@@ -1326,18 +1563,25 @@ void plist_clear( plist_t *pl )
 JsonArray *plist_export_to_json( plist_t *pl )
 {
 	JsonArray *js_plist = json_array_new();
-	for ( int i = 0; i < pl->m_len; i ++ )
+
+	/* Don't make client wait, it will get titles next time */
+	if (cfg_get_var_bool(cfg_list, "lazy-info-load"))
+		plist_need_info(pl, 0, pl->m_len - 1, FALSE);
+	for ( pseq_node_t *node = pseq_node_at(pl->m_seq, 0); node != NULL;
+			node = pseq_next(node) )
 	{
-		song_t *s = pl->m_list[i];
+		song_t *s = node->m_song;
 		JsonObject *js_song = json_object_new();
 
 		json_object_set_string_member(js_song, "name", song_get_name(s));
 		json_object_set_int_member(js_song, "length", s->m_full_len);
-		json_object_set_int_member(js_song, "start_time", s->m_start_time);
-		json_object_set_int_member(js_song, "end_time", s->m_end_time);
+		json_object_set_int_member(js_song, "start_time", 
+				song_get_start_time(s));
+		json_object_set_int_member(js_song, "end_time", song_get_end_time(s));
 
-		if (s->m_default_title)
-			json_object_set_string_member(js_song, "title", s->m_default_title);
+		if (song_get_default_title(s))
+			json_object_set_string_member(js_song, "title", 
+					song_get_default_title(s));
 
 		if (s->m_info && (s->m_info->m_flags & SI_INITIALIZED))
 		{
@@ -1347,6 +1591,7 @@ JsonArray *plist_export_to_json( plist_t *pl )
 			json_object_set_string_member(js_si, "name",		si->m_name);
 			json_object_set_string_member(js_si, "album",		si->m_album);
 			json_object_set_string_member(js_si, "year",		si->m_year);
+			json_object_set_string_member(js_si, "genre",		si->m_genre);
 			json_object_set_string_member(js_si, "comments",	si->m_comments);
 			json_object_set_string_member(js_si, "track",		si->m_track);
 			if (si->m_own_data)
@@ -26,6 +26,7 @@
 #include <pthread.h>
 #include "types.h"
 #include "main_types.h"
+#include "plist_seq.h"
 #include "plp.h"
 #include "song.h"
 #include "wnd.h"
@@ -35,6 +36,10 @@ typedef struct
 {
 	/* Whether files in set are patterns */
 	bool_t m_patterns;
+
+	/* Only mark added songs for reading info, as in lazy mode (info is
+	 * read by plist_need_info) */
+	bool_t m_lazy_info;
 	
 	/* Files */
 	struct tag_plist_set_t
@@ -75,6 +80,12 @@ typedef struct
 			(!(s)->m_info->m_not_own_present && \
 			 !(*((s)->m_info->m_own_data)))))
 
+/* Get song at the given position */
+static inline song_t *plist_get_song( plist_t *pl, int index )
+{
+	return pseq_get(pl->m_seq, index);
+}
+
 /* Create a new play list */
 plist_t *plist_new( int start_pos );
 
@@ -84,9 +95,18 @@ void plist_free( plist_t *pl );
 /* Add a file to play list (it may be directory) */
 bool_t plist_add( plist_t *pl, char *filename );
 
+/* Add a file to play list in background */
+bool_t plist_add_async( plist_t *pl, char *filename );
+
 /* Add a set of files to play list */
 bool_t plist_add_set( plist_t *pl, plist_set_t *set );
 
+/* Add files of a set without storing undo information */
+int plist_add_set_files( plist_t *pl, plist_set_t *set );
+
+/* Finish adding a set: set info, store undo information and sort */
+void plist_add_set_done( plist_t *pl, plist_set_t *set, int plist_num );
+
 /* Add single file to play list */
 int plist_add_one_file( plist_t *pl, char *file, song_metadata_t *metadata,
 		int where, int recc_level );
@@ -96,6 +116,9 @@ int plist_add_plist( plist_t *pl, plist_plugin_t *plp, char *file, int recc_leve
 
 void plist_add_song( plist_t *pl, song_t *song, int where );
 
+/* Append several songs at once (on failure they are left to the caller) */
+bool_t plist_add_songs( plist_t *pl, song_t **songs, int num );
+
 /* Add M3U play list */
 int plist_add_m3u( plist_t *pl, char *filename );
 
@@ -159,6 +182,14 @@ void plist_reload_info( plist_t *pl, bool_t global );
 /* Set info for all scheduled songs */
 void plist_flush_scheduled( plist_t *pl );
 
+/* Make sure info of songs in range is read or being read (in lazy mode
+ * it is read only when needed). If wait is TRUE, wait until it is read */
+void plist_need_info( plist_t *pl, int start, int end, bool_t wait );
+
+/* Wait until info of songs in range is read. Waiting is cancelled when
+ * 'stop' (if not NULL) becomes TRUE; FALSE is returned then */
+bool_t plist_wait_info( plist_t *pl, int start, int end, bool_t *stop );
+
 /* Initialize a set of files for adding */
 plist_set_t *plist_set_new( bool_t patterns );
 
@@ -0,0 +1,408 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Named play lists manager implementation.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <ctype.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include "types.h"
+#include "checkpoint.h"
+#include "logger.h"
+#include "player.h"
+#include "plist.h"
+#include "plist_mng.h"
+#include "snapshot.h"
+#include "util.h"
+
+/* Get names of the play list state files (they must be freed) */
+static bool_t plmng_state_files( plmng_t *mng, const char *name,
+		char **snapshot_name, char **journal_name )
+{
+	if (!strcmp(name, PLMNG_DEFAULT_NAME))
+	{
+		*snapshot_name = util_strcat(mng->m_cfg_dir, "/state.bin", NULL);
+		*journal_name = util_strcat(mng->m_cfg_dir, "/state.journal", NULL);
+	}
+	else
+	{
+		*snapshot_name = util_strcat(mng->m_cfg_dir, "/lists/", name, 
+				".bin", NULL);
+		*journal_name = util_strcat(mng->m_cfg_dir, "/lists/", name, 
+				".journal", NULL);
+	}
+	if (*snapshot_name == NULL || *journal_name == NULL)
+	{
+		free(*snapshot_name);
+		free(*journal_name);
+		return FALSE;
+	}
+	return TRUE;
+} /* End of 'plmng_state_files' function */
+
+/* Create an empty named play list */
+static plist_t *plmng_new_list( const char *name )
+{
+	plist_t *pl = plist_new(3);
+	if (pl == NULL)
+		return NULL;
+	pl->m_name = strdup(name);
+	if (pl->m_name == NULL)
+	{
+		plist_free(pl);
+		return NULL;
+	}
+	return pl;
+} /* End of 'plmng_new_list' function */
+
+/* Create checkpointer for the play list */
+static void plmng_attach_ckpt( plmng_t *mng, plist_t *pl )
+{
+	char *snapshot_name, *journal_name;
+
+	if (plmng_state_files(mng, pl->m_name, &snapshot_name, &journal_name))
+	{
+		pl->m_ckpt = ckpt_new(pl, snapshot_name, journal_name,
+				mng->m_save_plist, mng->m_get_state);
+		free(snapshot_name);
+		free(journal_name);
+	}
+	if (pl->m_ckpt == NULL)
+		logger_error(player_log, 0, 
+				_("Unable to initialize checkpointer for play list %s"), 
+				pl->m_name);
+} /* End of 'plmng_attach_ckpt' function */
+
+/* Stop play list checkpointer and free the list */
+static void plmng_free_list( plist_t *pl )
+{
+	ckpt_free(pl->m_ckpt);
+	pl->m_ckpt = NULL;
+	plist_free(pl);
+} /* End of 'plmng_free_list' function */
+
+/* Append play list to the set (mutex must be locked) */
+static bool_t plmng_append( plmng_t *mng, plist_t *pl )
+{
+	if (mng->m_num_lists == mng->m_size)
+	{
+		int new_size = (mng->m_size == 0) ? 4 : mng->m_size * 2;
+		plist_t **lists = (plist_t **)realloc(mng->m_lists, 
+				sizeof(plist_t *) * new_size);
+		if (lists == NULL)
+			return FALSE;
+		mng->m_lists = lists;
+		mng->m_size = new_size;
+	}
+	mng->m_lists[mng->m_num_lists ++] = pl;
+	return TRUE;
+} /* End of 'plmng_append' function */
+
+/* Search play list index (mutex must be locked) */
+static int plmng_index( plmng_t *mng, const char *name )
+{
+	int i;
+	for ( i = 0; i < mng->m_num_lists; i ++ )
+	{
+		if (!strcmp(mng->m_lists[i]->m_name, name))
+			return i;
+	}
+	return -1;
+} /* End of 'plmng_index' function */
+
+/* Create play lists manager with the default play list */
+plmng_t *plmng_new( const char *cfg_dir, bool_t save_plist,
+		void (*get_state)( plist_t *pl, snapshot_state_t *state ) )
+{
+	plmng_t *mng;
+	plist_t *pl;
+
+	/* Allocate memory */
+	mng = (plmng_t *)malloc(sizeof(*mng));
+	if (mng == NULL)
+		return NULL;
+	memset(mng, 0, sizeof(*mng));
+	mng->m_cfg_dir = strdup(cfg_dir);
+	mng->m_save_plist = save_plist;
+	mng->m_get_state = get_state;
+	pthread_mutex_init(&mng->m_mutex, NULL);
+
+	/* Create the default list. Its checkpointer is started by player
+	 * after loading state */
+	pl = (mng->m_cfg_dir == NULL) ? NULL : 
+		plmng_new_list(PLMNG_DEFAULT_NAME);
+	if (pl == NULL || !plmng_append(mng, pl))
+	{
+		plist_free(pl);
+		plmng_free(mng);
+		return NULL;
+	}
+	plmng_attach_ckpt(mng, pl);
+	return mng;
+} /* End of 'plmng_new' function */
+
+/* Save and free all the play lists and the manager */
+void plmng_free( plmng_t *mng )
+{
+	int i;
+
+	if (mng == NULL)
+		return;
+
+	for ( i = 0; i < mng->m_num_lists; i ++ )
+		plmng_free_list(mng->m_lists[i]);
+	for ( i = 0; i < mng->m_num_retired; i ++ )
+		plist_free(mng->m_retired[i]);
+	free(mng->m_lists);
+	free(mng->m_retired);
+	free(mng->m_cfg_dir);
+	pthread_mutex_destroy(&mng->m_mutex);
+	free(mng);
+} /* End of 'plmng_free' function */
+
+/* Stop checkpointers saving final state of all the play lists */
+void plmng_save( plmng_t *mng )
+{
+	int i;
+
+	if (mng == NULL)
+		return;
+
+	pthread_mutex_lock(&mng->m_mutex);
+	for ( i = 0; i < mng->m_num_lists; i ++ )
+	{
+		plist_t *pl = mng->m_lists[i];
+		ckpt_free(pl->m_ckpt);
+		pl->m_ckpt = NULL;
+	}
+	pthread_mutex_unlock(&mng->m_mutex);
+} /* End of 'plmng_save' function */
+
+/* Check that name may be used for a play list. Names are used for 
+ * state files names and in server commands, so only letters, digits,
+ * '-', '_' and '.' (not first) are allowed */
+bool_t plmng_valid_name( const char *name )
+{
+	int len;
+
+	if (name == NULL || (*name) == 0 || (*name) == '.')
+		return FALSE;
+	for ( len = 0; name[len]; len ++ )
+	{
+		char ch = name[len];
+		if (!(isalnum((byte)ch) || ch == '-' || ch == '_' || ch == '.'))
+			return FALSE;
+	}
+	return (len <= PLMNG_MAX_NAME);
+} /* End of 'plmng_valid_name' function */
+
+/* Find play list by name */
+plist_t *plmng_find( plmng_t *mng, const char *name )
+{
+	plist_t *pl = NULL;
+	int i;
+
+	if (mng == NULL || name == NULL)
+		return NULL;
+
+	pthread_mutex_lock(&mng->m_mutex);
+	i = plmng_index(mng, name);
+	if (i >= 0)
+		pl = mng->m_lists[i];
+	pthread_mutex_unlock(&mng->m_mutex);
+	return pl;
+} /* End of 'plmng_find' function */
+
+/* Create a new empty play list */
+plist_t *plmng_add( plmng_t *mng, const char *name )
+{
+	plist_t *pl;
+	char *dir;
+
+	if (mng == NULL || !plmng_valid_name(name))
+		return NULL;
+
+	/* Make sure state directory exists */
+	dir = util_strcat(mng->m_cfg_dir, "/lists", NULL);
+	if (dir != NULL)
+	{
+		mkdir(dir, 0770);
+		free(dir);
+	}
+
+	pthread_mutex_lock(&mng->m_mutex);
+	if (plmng_index(mng, name) >= 0)
+	{
+		pthread_mutex_unlock(&mng->m_mutex);
+		return NULL;
+	}
+	pl = plmng_new_list(name);
+	if (pl == NULL || !plmng_append(mng, pl))
+	{
+		pthread_mutex_unlock(&mng->m_mutex);
+		plist_free(pl);
+		return NULL;
+	}
+	pthread_mutex_unlock(&mng->m_mutex);
+
+	/* Empty list is saved at once */
+	plmng_attach_ckpt(mng, pl);
+	ckpt_start(pl->m_ckpt, FALSE);
+	return pl;
+} /* End of 'plmng_add' function */
+
+/* Remove play list and its saved state. Default list can't be removed */
+bool_t plmng_remove( plmng_t *mng, const char *name )
+{
+	char *snapshot_name, *journal_name;
+	plist_t *pl, **retired;
+	int i;
+
+	if (mng == NULL || name == NULL || !strcmp(name, PLMNG_DEFAULT_NAME))
+		return FALSE;
+
+	/* Move list to the retired ones */
+	pthread_mutex_lock(&mng->m_mutex);
+	i = plmng_index(mng, name);
+	retired = (plist_t **)realloc(mng->m_retired, 
+			sizeof(plist_t *) * (mng->m_num_retired + 1));
+	if (retired != NULL)
+		mng->m_retired = retired;
+	if (i < 0 || retired == NULL)
+	{
+		pthread_mutex_unlock(&mng->m_mutex);
+		return FALSE;
+	}
+	pl = mng->m_lists[i];
+	memmove(&mng->m_lists[i], &mng->m_lists[i + 1], 
+			sizeof(plist_t *) * (mng->m_num_lists - i - 1));
+	mng->m_num_lists --;
+	mng->m_retired[mng->m_num_retired ++] = pl;
+	pthread_mutex_unlock(&mng->m_mutex);
+
+	/* Stop saving it, release songs and remove its files */
+	if (pl->m_ckpt != NULL)
+		pl->m_ckpt->m_save_plist = FALSE;
+	ckpt_free(pl->m_ckpt);
+	pl->m_ckpt = NULL;
+	plist_clear(pl);
+	if (plmng_state_files(mng, name, &snapshot_name, &journal_name))
+	{
+		unlink(snapshot_name);
+		unlink(journal_name);
+		free(snapshot_name);
+		free(journal_name);
+	}
+	return TRUE;
+} /* End of 'plmng_remove' function */
+
+/* Load a named play list saved earlier */
+static void plmng_load_list( plmng_t *mng, const char *name, 
+		snapshot_state_t *state )
+{
+	char *snapshot_name, *journal_name;
+	plist_t *pl;
+	bool_t loaded;
+
+	if (!plmng_state_files(mng, name, &snapshot_name, &journal_name))
+		return;
+
+	/* Load snapshot. A list with broken snapshot is left on disk as is */
+	pl = plmng_new_list(name);
+	loaded = (pl != NULL && snapshot_load(snapshot_name, pl, state));
+	free(snapshot_name);
+	free(journal_name);
+	if (!loaded)
+	{
+		logger_error(player_log, 1, _("unable to load play list %s"), name);
+		plist_free(pl);
+		return;
+	}
+
+	/* Replay journal and continue it */
+	plmng_attach_ckpt(mng, pl);
+	ckpt_replay(pl->m_ckpt, state);
+	if (state->m_cur_song >= -1 && state->m_cur_song < pl->m_len)
+		pl->m_cur_song = state->m_cur_song;
+
+	pthread_mutex_lock(&mng->m_mutex);
+	if (!plmng_append(mng, pl))
+	{
+		pthread_mutex_unlock(&mng->m_mutex);
+		plmng_free_list(pl);
+		return;
+	}
+	pthread_mutex_unlock(&mng->m_mutex);
+	ckpt_start(pl->m_ckpt, TRUE);
+} /* End of 'plmng_load_list' function */
+
+/* Load named play lists saved earlier (default one is loaded by player).
+ * State of the list with the given name is returned */
+void plmng_load( plmng_t *mng, const char *active, 
+		snapshot_state_t *active_state )
+{
+	struct dirent *de;
+	char *dir_name;
+	DIR *dir;
+
+	if (mng == NULL)
+		return;
+
+	dir_name = util_strcat(mng->m_cfg_dir, "/lists", NULL);
+	if (dir_name == NULL)
+		return;
+	dir = opendir(dir_name);
+	free(dir_name);
+	if (dir == NULL)
+		return;
+
+	while ((de = readdir(dir)) != NULL)
+	{
+		snapshot_state_t state = { -1, 0, PLAYER_STATUS_STOPPED, -1, -1, 
+			VOLUME_DEF, 0, 0 };
+		char *name;
+		int len = strlen(de->d_name);
+
+		/* Take snapshots of the lists not loaded yet */
+		if (len <= 4 || strcmp(&de->d_name[len - 4], ".bin"))
+			continue;
+		name = strndup(de->d_name, len - 4);
+		if (name == NULL)
+			continue;
+		if (plmng_valid_name(name) && strcmp(name, PLMNG_DEFAULT_NAME) &&
+				plmng_find(mng, name) == NULL)
+		{
+			plmng_load_list(mng, name, &state);
+			if (active != NULL && !strcmp(name, active) && 
+					plmng_find(mng, name) != NULL)
+				(*active_state) = state;
+		}
+		free(name);
+	}
+	closedir(dir);
+} /* End of 'plmng_load' function */
+
+/* End of 'plist_mng.c' file */
@@ -0,0 +1,100 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Interface for named play lists manager.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_PLIST_MNG_H__
+#define __SG_MPFC_PLIST_MNG_H__
+
+#include <pthread.h>
+#include "types.h"
+#include "main_types.h"
+#include "snapshot.h"
+
+/* 
+ * Play lists manager keeps a set of named play lists. Songs are shared
+ * between the lists (see song registry in song.c), so switching the 
+ * active list does not re-create any songs. Every list is saved by its 
+ * own checkpointer: the default one to the old state files and others
+ * to the 'lists' subdirectory of the configuration directory.
+ */
+
+/* Name of the list kept in the old state files */
+#define PLMNG_DEFAULT_NAME "default"
+
+/* Maximal play list name length */
+#define PLMNG_MAX_NAME 64
+
+/* Play lists manager type */
+typedef struct tag_plmng_t
+{
+	/* Play lists (the default one is the first) */
+	plist_t **m_lists;
+	int m_num_lists, m_size;
+
+	/* Removed play lists. They are emptied but kept until the manager is
+	 * freed, since background adding may still refer to them */
+	plist_t **m_retired;
+	int m_num_retired;
+
+	/* Configuration directory */
+	char *m_cfg_dir;
+
+	/* Checkpointers parameters */
+	bool_t m_save_plist;
+	void (*m_get_state)( plist_t *pl, snapshot_state_t *state );
+
+	pthread_mutex_t m_mutex;
+} plmng_t;
+
+/* Create play lists manager with the default play list */
+plmng_t *plmng_new( const char *cfg_dir, bool_t save_plist,
+		void (*get_state)( plist_t *pl, snapshot_state_t *state ) );
+
+/* Save and free all the play lists and the manager */
+void plmng_free( plmng_t *mng );
+
+/* Stop checkpointers saving final state of all the play lists */
+void plmng_save( plmng_t *mng );
+
+/* Check that name may be used for a play list */
+bool_t plmng_valid_name( const char *name );
+
+/* Find play list by name */
+plist_t *plmng_find( plmng_t *mng, const char *name );
+
+/* Create a new empty play list */
+plist_t *plmng_add( plmng_t *mng, const char *name );
+
+/* Remove play list and its saved state. Default list can't be removed */
+bool_t plmng_remove( plmng_t *mng, const char *name );
+
+/* Load named play lists saved earlier (default one is loaded by player).
+ * State of the list with the given name is returned */
+void plmng_load( plmng_t *mng, const char *active, 
+		snapshot_state_t *active_state );
+
+/* Get default play list */
+#define PLMNG_DEFAULT(mng) ((mng)->m_lists[0])
+
+#endif
+
+/* End of 'plist_mng.h' file */
@@ -0,0 +1,455 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Play list songs sequence functions implementation.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+#include "types.h"
+#include "plist_seq.h"
+#include "song.h"
+
+/* Nodes are allocated in slabs of this many objects; free nodes are 
+ * kept in a list and reused */
+#define PSEQ_SLAB_SIZE 1024
+static pseq_node_t *pseq_free_list = NULL;
+static pthread_mutex_t pseq_slab_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Get subtree size */
+#define PSEQ_SIZE(node) ((node) == NULL ? 0 : (node)->m_size)
+
+/* Get subtree songs length */
+#define PSEQ_TIME(node) ((node) == NULL ? 0 : (node)->m_time)
+
+/* Allocate memory for a node */
+static pseq_node_t *pseq_alloc( void )
+{
+	pseq_node_t *node;
+
+	pthread_mutex_lock(&pseq_slab_mutex);
+
+	/* Allocate a new slab and put its objects to the free list */
+	if (pseq_free_list == NULL)
+	{
+		pseq_node_t *slab = (pseq_node_t *)malloc(sizeof(pseq_node_t) * 
+				PSEQ_SLAB_SIZE);
+		int i;
+
+		if (slab == NULL)
+		{
+			pthread_mutex_unlock(&pseq_slab_mutex);
+			return NULL;
+		}
+		for ( i = 0; i < PSEQ_SLAB_SIZE; i ++ )
+		{
+			*(pseq_node_t **)(&slab[i]) = pseq_free_list;
+			pseq_free_list = &slab[i];
+		}
+	}
+
+	/* Take object from the free list */
+	node = pseq_free_list;
+	pseq_free_list = *(pseq_node_t **)node;
+	pthread_mutex_unlock(&pseq_slab_mutex);
+	return node;
+} /* End of 'pseq_alloc' function */
+
+/* Return node memory to the free list */
+static void pseq_dealloc( pseq_node_t *node )
+{
+	pthread_mutex_lock(&pseq_slab_mutex);
+	*(pseq_node_t **)node = pseq_free_list;
+	pseq_free_list = node;
+	pthread_mutex_unlock(&pseq_slab_mutex);
+} /* End of 'pseq_dealloc' function */
+
+/* Generate a node priority */
+static dword pseq_rand( pseq_t *seq )
+{
+	dword x = seq->m_seed;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return (seq->m_seed = x);
+} /* End of 'pseq_rand' function */
+
+/* Recalculate node size and set its children parent */
+static void pseq_update( pseq_node_t *node )
+{
+	node->m_size = 1 + PSEQ_SIZE(node->m_left) + PSEQ_SIZE(node->m_right);
+	node->m_time = node->m_len + PSEQ_TIME(node->m_left) + 
+		PSEQ_TIME(node->m_right);
+	if (node->m_left != NULL)
+		node->m_left->m_parent = node;
+	if (node->m_right != NULL)
+		node->m_right->m_parent = node;
+} /* End of 'pseq_update' function */
+
+/* Split tree into first 'k' nodes and the rest. Parent links of the 
+ * resulting roots are not reset */
+static void pseq_split_impl( pseq_node_t *t, int k, pseq_node_t **a, 
+		pseq_node_t **b )
+{
+	if (t == NULL)
+	{
+		*a = *b = NULL;
+		return;
+	}
+
+	if (PSEQ_SIZE(t->m_left) < k)
+	{
+		pseq_split_impl(t->m_right, k - PSEQ_SIZE(t->m_left) - 1, 
+				&t->m_right, b);
+		*a = t;
+	}
+	else
+	{
+		pseq_split_impl(t->m_left, k, a, &t->m_left);
+		*b = t;
+	}
+	pseq_update(t);
+} /* End of 'pseq_split_impl' function */
+
+/* Split tree into first 'k' nodes and the rest */
+static void pseq_split( pseq_node_t *t, int k, pseq_node_t **a, 
+		pseq_node_t **b )
+{
+	pseq_split_impl(t, k, a, b);
+	if (*a != NULL)
+		(*a)->m_parent = NULL;
+	if (*b != NULL)
+		(*b)->m_parent = NULL;
+} /* End of 'pseq_split' function */
+
+/* Concatenate two trees */
+static pseq_node_t *pseq_merge( pseq_node_t *a, pseq_node_t *b )
+{
+	if (a == NULL)
+		return b;
+	if (b == NULL)
+		return a;
+
+	if (a->m_prio > b->m_prio)
+	{
+		a->m_right = pseq_merge(a->m_right, b);
+		pseq_update(a);
+		a->m_parent = NULL;
+		return a;
+	}
+	b->m_left = pseq_merge(a, b->m_left);
+	pseq_update(b);
+	b->m_parent = NULL;
+	return b;
+} /* End of 'pseq_merge' function */
+
+/* Free tree passing songs to 'func' in sequence order */
+static void pseq_free_tree( pseq_node_t *node, void (*func)( song_t *song ) )
+{
+	while (node != NULL)
+	{
+		pseq_node_t *right = node->m_right;
+
+		pseq_free_tree(node->m_left, func);
+		if (func != NULL)
+			func(node->m_song);
+		pseq_dealloc(node);
+		node = right;
+	}
+} /* End of 'pseq_free_tree' function */
+
+/* Fix sizes and parent links of a freshly built tree */
+static void pseq_fix_tree( pseq_node_t *node )
+{
+	if (node == NULL)
+		return;
+	pseq_fix_tree(node->m_left);
+	pseq_fix_tree(node->m_right);
+	pseq_update(node);
+} /* End of 'pseq_fix_tree' function */
+
+/* Build tree from an array of songs in linear time */
+static pseq_node_t *pseq_build( pseq_t *seq, song_t **songs, int num )
+{
+	pseq_node_t **stack;
+	pseq_node_t *root;
+	int i, depth = 0;
+
+	stack = (pseq_node_t **)malloc(sizeof(*stack) * num);
+	if (stack == NULL)
+		return NULL;
+
+	/* Build a cartesian tree on random priorities */
+	for ( i = 0; i < num; i ++ )
+	{
+		pseq_node_t *node = pseq_alloc(), *last = NULL;
+		if (node == NULL)
+		{
+			if (depth > 0)
+			{
+				pseq_fix_tree(stack[0]);
+				pseq_free_tree(stack[0], NULL);
+			}
+			free(stack);
+			return NULL;
+		}
+		node->m_song = songs[i];
+		node->m_len = songs[i]->m_len;
+		node->m_prio = pseq_rand(seq);
+		node->m_left = node->m_right = node->m_parent = NULL;
+
+		while (depth > 0 && stack[depth - 1]->m_prio < node->m_prio)
+			last = stack[-- depth];
+		node->m_left = last;
+		if (depth > 0)
+			stack[depth - 1]->m_right = node;
+		stack[depth ++] = node;
+	}
+	root = stack[0];
+	free(stack);
+
+	pseq_fix_tree(root);
+	root->m_parent = NULL;
+	return root;
+} /* End of 'pseq_build' function */
+
+/* Create a new sequence */
+pseq_t *pseq_new( void )
+{
+	pseq_t *seq = (pseq_t *)malloc(sizeof(*seq));
+	if (seq == NULL)
+		return NULL;
+	seq->m_root = NULL;
+	seq->m_seed = ((dword)time(NULL) ^ (dword)(uintptr_t)seq) | 1;
+	seq->m_len_gen = song_get_len_gen();
+	return seq;
+} /* End of 'pseq_new' function */
+
+/* Free sequence (songs are not freed) */
+void pseq_free( pseq_t *seq )
+{
+	if (seq == NULL)
+		return;
+	pseq_free_tree(seq->m_root, NULL);
+	free(seq);
+} /* End of 'pseq_free' function */
+
+/* Get node at the given position (NULL if index is out of range) */
+pseq_node_t *pseq_node_at( pseq_t *seq, int index )
+{
+	pseq_node_t *node = seq->m_root;
+
+	if (index < 0 || index >= PSEQ_LEN(seq))
+		return NULL;
+
+	for ( ;; )
+	{
+		int left = PSEQ_SIZE(node->m_left);
+		if (index < left)
+			node = node->m_left;
+		else if (index == left)
+			return node;
+		else
+		{
+			index -= left + 1;
+			node = node->m_right;
+		}
+	}
+} /* End of 'pseq_node_at' function */
+
+/* Get the next node in sequence order */
+pseq_node_t *pseq_next( pseq_node_t *node )
+{
+	if (node->m_right != NULL)
+	{
+		node = node->m_right;
+		while (node->m_left != NULL)
+			node = node->m_left;
+		return node;
+	}
+	while (node->m_parent != NULL && node->m_parent->m_right == node)
+		node = node->m_parent;
+	return node->m_parent;
+} /* End of 'pseq_next' function */
+
+/* Set node song and fix lengths of its ancestors */
+static void pseq_set_node( pseq_node_t *node, song_t *song )
+{
+	node->m_song = song;
+	node->m_len = song->m_len;
+	for ( ; node != NULL; node = node->m_parent )
+		node->m_time = node->m_len + PSEQ_TIME(node->m_left) + 
+			PSEQ_TIME(node->m_right);
+} /* End of 'pseq_set_node' function */
+
+/* Get node position */
+int pseq_node_index( pseq_node_t *node )
+{
+	int index = PSEQ_SIZE(node->m_left);
+
+	for ( ; node->m_parent != NULL; node = node->m_parent )
+	{
+		if (node->m_parent->m_right == node)
+			index += PSEQ_SIZE(node->m_parent->m_left) + 1;
+	}
+	return index;
+} /* End of 'pseq_node_index' function */
+
+/* Get song at the given position */
+song_t *pseq_get( pseq_t *seq, int index )
+{
+	pseq_node_t *node = pseq_node_at(seq, index);
+	return (node == NULL ? NULL : node->m_song);
+} /* End of 'pseq_get' function */
+
+/* Replace song at the given position */
+void pseq_set( pseq_t *seq, int index, song_t *song )
+{
+	pseq_node_t *node = pseq_node_at(seq, index);
+	if (node != NULL)
+		pseq_set_node(node, song);
+} /* End of 'pseq_set' function */
+
+/* Insert songs before position 'where' */
+bool_t pseq_insert( pseq_t *seq, int where, song_t **songs, int num )
+{
+	pseq_node_t *a, *b, *t;
+
+	if (num <= 0)
+		return TRUE;
+
+	t = pseq_build(seq, songs, num);
+	if (t == NULL)
+		return FALSE;
+
+	pseq_split(seq->m_root, where, &a, &b);
+	seq->m_root = pseq_merge(pseq_merge(a, t), b);
+	return TRUE;
+} /* End of 'pseq_insert' function */
+
+/* Remove 'num' songs starting from 'start' passing each of them 
+ * to 'func' (if it is not NULL) */
+void pseq_remove( pseq_t *seq, int start, int num, 
+		void (*func)( song_t *song ) )
+{
+	pseq_node_t *a, *b, *c;
+
+	if (num <= 0)
+		return;
+
+	pseq_split(seq->m_root, start, &a, &b);
+	pseq_split(b, num, &b, &c);
+	seq->m_root = pseq_merge(a, c);
+	pseq_free_tree(b, func);
+} /* End of 'pseq_remove' function */
+
+/* Move 'num' songs starting from 'start' so that they start at 'to' */
+void pseq_move( pseq_t *seq, int start, int num, int to )
+{
+	pseq_node_t *a, *b, *c;
+
+	if (num <= 0 || start == to)
+		return;
+
+	pseq_split(seq->m_root, start, &a, &b);
+	pseq_split(b, num, &b, &c);
+	pseq_split(pseq_merge(a, c), to, &a, &c);
+	seq->m_root = pseq_merge(pseq_merge(a, b), c);
+} /* End of 'pseq_move' function */
+
+/* Copy 'num' songs starting from 'start' to array */
+void pseq_get_range( pseq_t *seq, int start, int num, song_t **songs )
+{
+	pseq_node_t *node = pseq_node_at(seq, start);
+	int i;
+
+	for ( i = 0; i < num && node != NULL; i ++, node = pseq_next(node) )
+		songs[i] = node->m_song;
+} /* End of 'pseq_get_range' function */
+
+/* Replace 'num' songs starting from 'start' with songs from array */
+void pseq_set_range( pseq_t *seq, int start, int num, song_t **songs )
+{
+	pseq_node_t *node = pseq_node_at(seq, start);
+	int i;
+
+	for ( i = 0; i < num && node != NULL; i ++, node = pseq_next(node) )
+		pseq_set_node(node, songs[i]);
+} /* End of 'pseq_set_range' function */
+
+/* Recount lengths of songs in the subtree */
+static void pseq_recount( pseq_node_t *node )
+{
+	while (node != NULL)
+	{
+		pseq_recount(node->m_left);
+		node->m_len = node->m_song->m_len;
+		if (node->m_right == NULL)
+			break;
+		node = node->m_right;
+	}
+} /* End of 'pseq_recount' function */
+
+/* Get total length of the first 'k' songs */
+static song_time_t pseq_prefix_time( pseq_node_t *node, int k )
+{
+	song_time_t t = 0;
+
+	while (node != NULL && k > 0)
+	{
+		int left = PSEQ_SIZE(node->m_left);
+		if (k <= left)
+			node = node->m_left;
+		else
+		{
+			t += PSEQ_TIME(node->m_left) + node->m_len;
+			k -= left + 1;
+			node = node->m_right;
+		}
+	}
+	return t;
+} /* End of 'pseq_prefix_time' function */
+
+/* Get total length of 'num' songs starting from 'start' */
+song_time_t pseq_get_time( pseq_t *seq, int start, int num )
+{
+	dword gen;
+
+	if (num <= 0)
+		return 0;
+
+	/* Some songs lengths have changed since they were counted. Generation
+	 * is taken before lengths, so changes done meanwhile are caught by 
+	 * the next call */
+	gen = song_get_len_gen();
+	if (gen != seq->m_len_gen)
+	{
+		seq->m_len_gen = gen;
+		pseq_recount(seq->m_root);
+		pseq_fix_tree(seq->m_root);
+	}
+
+	return pseq_prefix_time(seq->m_root, start + num) - 
+		pseq_prefix_time(seq->m_root, start);
+} /* End of 'pseq_get_time' function */
+
+/* End of 'plist_seq.c' file */
+
@@ -0,0 +1,108 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Interface for play list songs sequence functions.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_PLIST_SEQ_H__
+#define __SG_MPFC_PLIST_SEQ_H__
+
+#include "types.h"
+#include "main_types.h"
+
+/* Songs sequence node. The sequence is a treap keyed implicitly by 
+ * position: every node knows its subtree size, so index lookup,
+ * insertion, removal and moving a range take logarithmic time. Total
+ * length of songs in the subtree is kept the same way */
+typedef struct tag_pseq_node_t
+{
+	song_t *m_song;
+
+	/* Tree links */
+	struct tag_pseq_node_t *m_left, *m_right, *m_parent;
+
+	/* Number of nodes in the subtree and heap priority */
+	int m_size;
+	dword m_prio;
+
+	/* Song length as it was counted and total length of the subtree */
+	song_time_t m_len, m_time;
+} pseq_node_t;
+
+/* Songs sequence type */
+typedef struct tag_pseq_t
+{
+	pseq_node_t *m_root;
+
+	/* Priorities generator state */
+	dword m_seed;
+
+	/* Songs lengths generation the lengths were counted in */
+	dword m_len_gen;
+} pseq_t;
+
+/* Get sequence length */
+#define PSEQ_LEN(seq) ((seq)->m_root == NULL ? 0 : (seq)->m_root->m_size)
+
+/* Create a new sequence */
+pseq_t *pseq_new( void );
+
+/* Free sequence (songs are not freed) */
+void pseq_free( pseq_t *seq );
+
+/* Get song at the given position */
+song_t *pseq_get( pseq_t *seq, int index );
+
+/* Replace song at the given position */
+void pseq_set( pseq_t *seq, int index, song_t *song );
+
+/* Get node at the given position (NULL if index is out of range) */
+pseq_node_t *pseq_node_at( pseq_t *seq, int index );
+
+/* Get the next node in sequence order */
+pseq_node_t *pseq_next( pseq_node_t *node );
+
+/* Get node position */
+int pseq_node_index( pseq_node_t *node );
+
+/* Insert songs before position 'where' */
+bool_t pseq_insert( pseq_t *seq, int where, song_t **songs, int num );
+
+/* Remove 'num' songs starting from 'start' passing each of them 
+ * to 'func' (if it is not NULL) */
+void pseq_remove( pseq_t *seq, int start, int num, 
+		void (*func)( song_t *song ) );
+
+/* Move 'num' songs starting from 'start' so that they start at 'to' */
+void pseq_move( pseq_t *seq, int start, int num, int to );
+
+/* Copy 'num' songs starting from 'start' to array */
+void pseq_get_range( pseq_t *seq, int start, int num, song_t **songs );
+
+/* Replace 'num' songs starting from 'start' with songs from array */
+void pseq_set_range( pseq_t *seq, int start, int num, song_t **songs );
+
+/* Get total length of 'num' songs starting from 'start' */
+song_time_t pseq_get_time( pseq_t *seq, int start, int num );
+
+#endif
+
+/* End of 'plist_seq.h' file */
+
@@ -0,0 +1,63 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Interface for the play list files reader.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_PLP_FILE_H__
+#define __SG_MPFC_PLP_FILE_H__
+
+#include <sys/types.h>
+#include "types.h"
+
+/*
+ * Play list files reader. The file is mapped into memory and its
+ * lines are returned as slices of that mapping, with the line end
+ * (LF or CRLF) replaced by a terminating zero. Lines may be of any
+ * length and stay valid until the reader is closed.
+ */
+typedef struct tag_plp_file_t
+{
+	/* File contents */
+	char *m_data;
+	size_t m_size;
+
+	/* Position of the next line */
+	size_t m_pos;
+
+	/* Whether contents are mapped (and not read into memory) */
+	bool_t m_mapped;
+
+	/* Copy of the last line if it has no line end */
+	char *m_tail;
+} plp_file_t;
+
+/* Open a play list file */
+plp_file_t *plp_file_open( const char *name );
+
+/* Close file */
+void plp_file_close( plp_file_t *f );
+
+/* Get next line. Returns FALSE at the end of file */
+bool_t plp_file_next_line( plp_file_t *f, char **line, size_t *len );
+
+#endif
+
+/* End of 'plp_file.h' file */
@@ -32,6 +32,27 @@
 #include "plugin.h"
 #include "wnd_types.h"
 
+/* Extensions hash set */
+typedef struct
+{
+	/* Buckets */
+	struct pmng_ext_set_item_t
+	{
+		/* Extension (in lower case) */
+		char *m_ext;
+		dword m_hash;
+
+		/* Playlist plugin handling this extension (if any) */
+		plist_plugin_t *m_plp;
+
+		struct pmng_ext_set_item_t *m_next;
+	} **m_buckets;
+	int m_size;
+} pmng_ext_set_t;
+
+/* Maximal extension length that may appear in extension sets */
+#define PMNG_MAX_EXT_LEN 32
+
 /* Plugin manager type */
 typedef struct tag_pmng_t
 {
@@ -64,6 +85,10 @@ typedef struct tag_pmng_t
 	/* The list of supported media file extensions */
 	char *m_media_file_exts;
 	unsigned m_media_ext_max_len;
+
+	/* Media and play list extensions sets for fast lookup */
+	pmng_ext_set_t m_media_ext_set;
+	pmng_ext_set_t m_plist_ext_set;
 } pmng_t;
 
 /* Initialize plugins */
@@ -0,0 +1,191 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Upcoming songs prefetching.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "types.h"
+#include "prefetch.h"
+#include "song.h"
+
+/* Size of a single read */
+#define PREFETCH_CHUNK (64 * 1024)
+
+/* Prefetch request */
+typedef struct
+{
+	char *m_filename;
+	size_t m_size;
+
+	/* Position of the song in the file (for songs from cue sheets) */
+	song_time_t m_start_time, m_full_len;
+} prefetch_req_t;
+
+/* Pending request (its file name is NULL if there is none) */
+static prefetch_req_t prefetch_pending;
+
+/* Thread stuff */
+static pthread_t prefetch_tid = 0;
+static pthread_mutex_t prefetch_mutex;
+static pthread_cond_t prefetch_cond;
+static bool_t prefetch_stop_thread = FALSE;
+
+/* Check if current request must be dropped. Must be called with
+ * mutex locked */
+static bool_t prefetch_interrupted( void )
+{
+	return (prefetch_stop_thread || prefetch_pending.m_filename != NULL);
+} /* End of 'prefetch_interrupted' function */
+
+/* Read file region into the page cache */
+static void prefetch_do( prefetch_req_t *req )
+{
+	static char buf[PREFETCH_CHUNK];
+	struct stat st;
+	off_t offset = 0, done = 0;
+	int fd;
+
+	fd = open(req->m_filename, O_RDONLY);
+	if (fd < 0)
+		return;
+
+	/* Find where the song starts */
+	if (req->m_start_time > 0 && req->m_full_len > 0 && !fstat(fd, &st))
+	{
+		offset = (off_t)((double)st.st_size * req->m_start_time / 
+				req->m_full_len);
+		offset &= ~(off_t)(PREFETCH_CHUNK - 1);
+	}
+
+	/* Ask kernel to start reading and read the data ourselves, since 
+	 * some file systems ignore the advice */
+	posix_fadvise(fd, offset, req->m_size, POSIX_FADV_WILLNEED);
+	while (done < (off_t)req->m_size)
+	{
+		ssize_t n = pread(fd, buf, PREFETCH_CHUNK, offset + done);
+		bool_t stop;
+
+		if (n <= 0)
+			break;
+		done += n;
+
+		pthread_mutex_lock(&prefetch_mutex);
+		stop = prefetch_interrupted();
+		pthread_mutex_unlock(&prefetch_mutex);
+		if (stop)
+			break;
+	}
+	close(fd);
+} /* End of 'prefetch_do' function */
+
+/* Thread function */
+static void *prefetch_thread( void *arg )
+{
+	pthread_mutex_lock(&prefetch_mutex);
+	while (!prefetch_stop_thread)
+	{
+		prefetch_req_t req;
+
+		if (prefetch_pending.m_filename == NULL)
+		{
+			pthread_cond_wait(&prefetch_cond, &prefetch_mutex);
+			continue;
+		}
+
+		/* Take request */
+		req = prefetch_pending;
+		prefetch_pending.m_filename = NULL;
+		pthread_mutex_unlock(&prefetch_mutex);
+
+		prefetch_do(&req);
+		free(req.m_filename);
+
+		pthread_mutex_lock(&prefetch_mutex);
+	}
+	pthread_mutex_unlock(&prefetch_mutex);
+	return NULL;
+} /* End of 'prefetch_thread' function */
+
+/* Initialize prefetching thread */
+bool_t prefetch_init( void )
+{
+	memset(&prefetch_pending, 0, sizeof(prefetch_pending));
+	prefetch_stop_thread = FALSE;
+	pthread_mutex_init(&prefetch_mutex, NULL);
+	pthread_cond_init(&prefetch_cond, NULL);
+	if (pthread_create(&prefetch_tid, NULL, prefetch_thread, NULL))
+	{
+		prefetch_tid = 0;
+		return FALSE;
+	}
+	return TRUE;
+} /* End of 'prefetch_init' function */
+
+/* Stop prefetching thread */
+void prefetch_free( void )
+{
+	if (!prefetch_tid)
+		return;
+
+	pthread_mutex_lock(&prefetch_mutex);
+	prefetch_stop_thread = TRUE;
+	pthread_cond_signal(&prefetch_cond);
+	pthread_mutex_unlock(&prefetch_mutex);
+	pthread_join(prefetch_tid, NULL);
+	prefetch_tid = 0;
+
+	free(prefetch_pending.m_filename);
+	prefetch_pending.m_filename = NULL;
+	pthread_cond_destroy(&prefetch_cond);
+	pthread_mutex_destroy(&prefetch_mutex);
+} /* End of 'prefetch_free' function */
+
+/* Read ahead the beginning of the song */
+void prefetch_song( song_t *song, size_t size )
+{
+	char *name;
+
+	/* Only local (or mounted) files may be read ahead */
+	if (!prefetch_tid || song == NULL || size == 0)
+		return;
+	song_lock(song);
+	name = (song->m_filename == NULL ? NULL : strdup(song->m_filename));
+	pthread_mutex_lock(&prefetch_mutex);
+	if (name != NULL)
+	{
+		free(prefetch_pending.m_filename);
+		prefetch_pending.m_filename = name;
+		prefetch_pending.m_size = size;
+		prefetch_pending.m_start_time = song_get_start_time(song);
+		prefetch_pending.m_full_len = song->m_full_len;
+		pthread_cond_signal(&prefetch_cond);
+	}
+	pthread_mutex_unlock(&prefetch_mutex);
+	song_unlock(song);
+} /* End of 'prefetch_song' function */
+
+/* End of 'prefetch.c' file */
@@ -0,0 +1,48 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Interface for upcoming songs prefetching.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_PREFETCH_H__
+#define __SG_MPFC_PREFETCH_H__
+
+#include "types.h"
+#include "main_types.h"
+
+/*
+ * Prefetching reads the beginning of the song that is going to be played
+ * next, so that its data is in the page cache by the time the player
+ * opens it. It helps with libraries on network or sleeping disks.
+ * Only the latest request is kept; a new one cancels the one in progress.
+ */
+
+/* Initialize prefetching thread */
+bool_t prefetch_init( void );
+
+/* Stop prefetching thread */
+void prefetch_free( void );
+
+/* Read ahead the beginning of the song (size is in bytes) */
+void prefetch_song( song_t *song, size_t size );
+
+#endif
+
+/* End of 'prefetch.h' file */
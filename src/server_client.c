@@ -23,6 +23,7 @@
 #include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
@@ -33,6 +34,7 @@
 #include "json_helpers.h"
 #include "player.h"
 #include "server_client.h"
+#include "song.h"
 #include "util.h"
 
 typedef union
@@ -181,6 +183,28 @@ finally:
 	json_node_free(node);
 } /* End of 'server_conn_response' function */
 
+/* Make the reply for 'get_playlist' command */
+JsonArray *server_conn_playlist_to_json( plist_t *pl )
+{
+	JsonArray *js = json_array_new();
+
+	for ( pseq_node_t *node = (pl == NULL) ? NULL : 
+				pseq_node_at(pl->m_seq, 0); 
+			node != NULL; node = pseq_next(node) )
+	{
+		JsonObject *js_child = json_object_new();
+		song_t *s = node->m_song;
+		song_lock(s);
+		json_object_set_string_member(js_child, "title", 
+				STR_TO_CPTR(song_get_title_locked(s)));
+		song_unlock(s);
+		json_object_set_int_member(js_child, "length", s->m_len);
+
+		json_array_add_object_element(js, js_child);
+	}
+	return js;
+} /* End of 'server_conn_playlist_to_json' function */
+
 /* Validate file name. It shall not contain '..' */
 static bool_t is_valid_file_name(char *name)
 {
@@ -220,47 +244,31 @@ static char *translate_file_name(char *name)
 static void server_conn_list_dir(char *name, JsonArray *js)
 {
 	char *real_name = NULL;
-	fu_dir_t *dir = NULL;
+	fu_list_t *list = NULL;
 
 	/* Translate virtual directory name */
 	real_name = translate_file_name(name);
 	if (!real_name)
 		goto finally;
 
-	/* Open directory */
-	dir = fu_opendir(real_name);
-	if (!dir)
+	/* Read directory */
+	list = fu_list_dir(real_name, FU_LIST_HIDDEN | FU_LIST_SKIP_SPECIAL);
+	if (!list)
 		goto finally;
 
-	for ( ;; )
+	for ( int i = 0; i < list->m_num; i ++ )
 	{
-		struct dirent *de = fu_readdir(dir);
-		if (!de)
-			break;
-
-		/* Skip special dirs */
-		if (fu_is_special_dir(de->d_name))
-			continue;
-
-		/* Determine file type */
-		bool_t is_dir;
-		{
-			char *full_name = util_strcat(real_name, "/", de->d_name, NULL);
-			bool_t ok = fu_file_type(full_name, &is_dir);
-			free(full_name);
-			if (!ok)
-				continue;
-		}
+		fu_list_entry_t *e = &list->m_entries[i];
 
 		JsonObject *js_child = json_object_new();
-		json_object_set_string_member(js_child, "name", de->d_name);
-		json_object_set_string_member(js_child, "type", is_dir ? "d" : "f");
+		json_object_set_string_member(js_child, "name", e->m_name);
+		json_object_set_string_member(js_child, "type", 
+				e->m_is_dir ? "d" : "f");
 		json_array_add_object_element(js, js_child);
 	}
 
 finally:
-	if (dir)
-		fu_closedir(dir);
+	fu_list_free(list);
 	if (real_name)
 		free(real_name);
 } /* End of 'server_conn_list_dir' function */
@@ -281,7 +289,8 @@ bool_t server_conn_exec_command(server_conn_desc_t *d)
 		return TRUE;
 	}
 
-	/* Execute */
+	/* Execute. Active play list is not switched meanwhile */
+	player_lock_plist();
 	if (!strcmp(cmd_name, "play"))
 	{
 		int song = (param_kind == PARAM_NUMBER ? param.num_param : 0);
@@ -320,8 +329,11 @@ bool_t server_conn_exec_command(server_conn_desc_t *d)
 		if (cur_song >= 0)
 		{
 			const char *status = "";
-			song_t *s = player_plist->m_list[cur_song];
-			json_object_set_string_member(js, "title", STR_TO_CPTR(s->m_title));
+			song_t *s = plist_get_song(player_plist, cur_song);
+			song_lock(s);
+			json_object_set_string_member(js, "title", 
+					STR_TO_CPTR(song_get_title_locked(s)));
+			song_unlock(s);
 			json_object_set_int_member(js, "time", player_context->m_cur_time);
 			json_object_set_int_member(js, "length", s->m_len);
 
@@ -337,21 +349,49 @@ bool_t server_conn_exec_command(server_conn_desc_t *d)
 		server_conn_response(d, js_make_node(js));
 	}
 	else if (!strcmp(cmd_name, "get_playlist"))
+	{
+		plist_t *pl = (param_kind == PARAM_STRING) ? 
+			plmng_find(player_lists, param.str_param) : player_plist;
+
+		server_conn_response(d, 
+				js_make_array_node(server_conn_playlist_to_json(pl)));
+	}
+	else if (!strcmp(cmd_name, "get_playlists"))
 	{
 		JsonArray *js = json_array_new();
 
-		for ( int i = 0; i < player_plist->m_len; i++ )
+		pthread_mutex_lock(&player_lists->m_mutex);
+		for ( int i = 0; i < player_lists->m_num_lists; i++ )
 		{
+			plist_t *pl = player_lists->m_lists[i];
 			JsonObject *js_child = json_object_new();
-			song_t *s = player_plist->m_list[i];
-			json_object_set_string_member(js_child, "title", STR_TO_CPTR(s->m_title));
-			json_object_set_int_member(js_child, "length", s->m_len);
+			json_object_set_string_member(js_child, "name", pl->m_name);
+			json_object_set_int_member(js_child, "length", pl->m_len);
+			json_object_set_int_member(js_child, "position", pl->m_cur_song);
+			json_object_set_boolean_member(js_child, "active", 
+					pl == player_plist);
 
 			json_array_add_object_element(js, js_child);
 		}
+		pthread_mutex_unlock(&player_lists->m_mutex);
 
 		server_conn_response(d, js_make_array_node(js));
 	}
+	else if (!strcmp(cmd_name, "new_playlist"))
+	{
+		if (param_kind == PARAM_STRING)
+			plmng_add(player_lists, param.str_param);
+	}
+	else if (!strcmp(cmd_name, "remove_playlist"))
+	{
+		if (param_kind == PARAM_STRING)
+			player_remove_plist(param.str_param);
+	}
+	else if (!strcmp(cmd_name, "switch_playlist"))
+	{
+		if (param_kind == PARAM_STRING)
+			player_request_switch_plist(param.str_param);
+	}
 	else if (!strcmp(cmd_name, "get_volume"))
 	{
 		JsonObject *js = json_object_new();
@@ -377,11 +417,28 @@ bool_t server_conn_exec_command(server_conn_desc_t *d)
 		if (param_kind == PARAM_STRING)
 		{
 			char *real_name = translate_file_name(param.str_param);
-			plist_add(player_plist, real_name);
+			plist_add_async(player_plist, real_name);
 			free(real_name);
 		}
 					
 	}
+	else if (!strcmp(cmd_name, "add_to"))
+	{
+		/* Parameter is play list name and file name separated by space */
+		char *name = (param_kind == PARAM_STRING) ? 
+			strchr(param.str_param, ' ') : NULL;
+		if (name != NULL)
+		{
+			*(name ++) = 0;
+			plist_t *pl = plmng_find(player_lists, param.str_param);
+			if (pl != NULL)
+			{
+				char *real_name = translate_file_name(name);
+				plist_add_async(pl, real_name);
+				free(real_name);
+			}
+		}
+	}
 	else if (!strcmp(cmd_name, "remove"))
 	{
 		if (param_kind == PARAM_NUMBER)
@@ -400,6 +457,52 @@ bool_t server_conn_exec_command(server_conn_desc_t *d)
 			player_queue_song();
 		}
 	}
+	else if (!strcmp(cmd_name, "get_queue"))
+	{
+		JsonArray *js = json_array_new();
+
+		pqueue_lock(player_queue);
+		plist_lock(player_plist);
+		for ( int i = 0; i < player_queue->m_len; i++ )
+		{
+			struct tag_pqueue_entry_t *entry = PQUEUE_ENTRY(player_queue, i);
+			JsonObject *js_child = json_object_new();
+			song_t *s = entry->m_song;
+			json_object_set_int_member(js_child, "position", 
+					pqueue_entry_index(entry, player_plist));
+			song_lock(s);
+			json_object_set_string_member(js_child, "title", 
+					STR_TO_CPTR(song_get_title_locked(s)));
+			song_unlock(s);
+			json_object_set_int_member(js_child, "length", s->m_len);
+
+			json_array_add_object_element(js, js_child);
+		}
+		plist_unlock(player_plist);
+		pqueue_unlock(player_queue);
+
+		server_conn_response(d, js_make_array_node(js));
+	}
+	else if (!strcmp(cmd_name, "queue_move"))
+	{
+		int from, to;
+		if (param_kind == PARAM_STRING && 
+				sscanf(param.str_param, "%d %d", &from, &to) == 2)
+		{
+			pqueue_move(player_queue, from, to);
+		}
+	}
+	else if (!strcmp(cmd_name, "unqueue"))
+	{
+		if (param_kind == PARAM_NUMBER)
+		{
+			pqueue_remove(player_queue, param.num_param);
+		}
+	}
+	else if (!strcmp(cmd_name, "clear_queue"))
+	{
+		pqueue_clear(player_queue);
+	}
 	else if (!strcmp(cmd_name, "seek"))
 	{
 		if (param_kind == PARAM_NUMBER)
@@ -410,12 +513,16 @@ bool_t server_conn_exec_command(server_conn_desc_t *d)
 	}
 	else if (!strcmp(cmd_name, "clear_playlist"))
 	{
-		plist_clear(player_plist);
+		plist_t *pl = (param_kind == PARAM_STRING) ? 
+			plmng_find(player_lists, param.str_param) : player_plist;
+		plist_clear(pl);
 	}
 	else if (!strcmp(cmd_name, "bye"))
 	{
+		player_unlock_plist();
 		return FALSE;
 	}
+	player_unlock_plist();
 	wnd_invalidate(player_wnd);
 	return TRUE;
 } /* End of 'server_conn_exec_command' function */
@@ -24,6 +24,7 @@
 #define __SG_MPFC_SERVER_CLIENT_H__
 
 #include <pthread.h>
+#include "main_types.h"
 #include "mystring.h"
 #include "rd_with_notify.h"
 
@@ -55,6 +56,9 @@ void server_conn_client_notify(server_conn_desc_t *d, char nv);
 /* Execute a command received from client */
 bool_t server_conn_exec_command(server_conn_desc_t *d);
 
+/* Make the reply for 'get_playlist' command */
+struct _JsonArray *server_conn_playlist_to_json( plist_t *pl );
+
 #endif
 
 /* End of 'server_client.h' file */
@@ -0,0 +1,483 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2013 by SG Software.
+ *
+ * SG MPFC. Shuffle play engine.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "types.h"
+#include "shuffle.h"
+
+/* Access history entry */
+#define SHUFFLE_HIST(sh, i) \
+	((sh)->m_hist[((sh)->m_hist_head + (i)) % SHUFFLE_HISTORY_SIZE])
+
+/* Create shuffle engine */
+shuffle_t *shuffle_new( void )
+{
+	shuffle_t *sh;
+
+	/* Allocate memory */
+	sh = (shuffle_t *)malloc(sizeof(*sh));
+	if (sh == NULL)
+		return NULL;
+	memset(sh, 0, sizeof(*sh));
+
+	/* Set fields. Generator has its own state not to interfere with
+	 * other rand() users */
+	sh->m_hist_cur = -1;
+	sh->m_rand = ((uint64_t)time(NULL) << 20) ^ ((uint64_t)getpid() << 40) ^
+		(uintptr_t)sh;
+	if (sh->m_rand == 0)
+		sh->m_rand = 1;
+	pthread_mutex_init(&sh->m_mutex, NULL);
+	return sh;
+} /* End of 'shuffle_new' function */
+
+/* Free shuffle engine */
+void shuffle_free( shuffle_t *sh )
+{
+	if (sh == NULL)
+		return;
+
+	pthread_mutex_destroy(&sh->m_mutex);
+	free(sh->m_perm);
+	free(sh->m_pos);
+	free(sh);
+} /* End of 'shuffle_free' function */
+
+/* Get random number below n (xorshift64* generator) */
+static int shuffle_rand( shuffle_t *sh, int n )
+{
+	uint64_t x = sh->m_rand;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	sh->m_rand = x;
+	return (int)((x * 0x2545F4914F6CDD1DULL) % (uint64_t)n);
+} /* End of 'shuffle_rand' function */
+
+/* Make sure permutation arrays can hold len entries */
+static bool_t shuffle_alloc( shuffle_t *sh, int len )
+{
+	int *perm, *pos;
+	int alloc = sh->m_alloc;
+
+	if (len <= alloc)
+		return TRUE;
+	if (alloc == 0)
+		alloc = 256;
+	while (alloc < len)
+		alloc *= 2;
+	perm = (int *)realloc(sh->m_perm, sizeof(int) * alloc);
+	if (perm == NULL)
+		return FALSE;
+	sh->m_perm = perm;
+	pos = (int *)realloc(sh->m_pos, sizeof(int) * alloc);
+	if (pos == NULL)
+		return FALSE;
+	sh->m_pos = pos;
+	sh->m_alloc = alloc;
+	return TRUE;
+} /* End of 'shuffle_alloc' function */
+
+/* Swap permutation entries */
+static void shuffle_swap( shuffle_t *sh, int a, int b )
+{
+	int t = sh->m_perm[a];
+	sh->m_perm[a] = sh->m_perm[b];
+	sh->m_perm[b] = t;
+	sh->m_pos[sh->m_perm[a] - sh->m_base] = a;
+	sh->m_pos[sh->m_perm[b] - sh->m_base] = b;
+} /* End of 'shuffle_swap' function */
+
+/* Move song to the played part of permutation */
+static void shuffle_mark( shuffle_t *sh, int song )
+{
+	int k;
+
+	if (!sh->m_valid || song < sh->m_base || song >= sh->m_base + sh->m_len)
+		return;
+	k = sh->m_pos[song - sh->m_base];
+	if (k < sh->m_drawn)
+		return;
+	shuffle_swap(sh, k, sh->m_drawn);
+	sh->m_drawn ++;
+} /* End of 'shuffle_mark' function */
+
+/* Start a new permutation over a range */
+static void shuffle_build( shuffle_t *sh, int base, int len, bool_t whole )
+{
+	int i;
+
+	sh->m_valid = FALSE;
+	if (!shuffle_alloc(sh, len))
+		return;
+	for ( i = 0; i < len; i ++ )
+	{
+		sh->m_perm[i] = base + i;
+		sh->m_pos[i] = i;
+	}
+	sh->m_base = base;
+	sh->m_len = len;
+	sh->m_drawn = 0;
+	sh->m_whole = whole;
+	sh->m_valid = TRUE;
+	sh->m_picked = FALSE;
+
+	/* Current song is already played */
+	if (sh->m_hist_cur >= 0)
+		shuffle_mark(sh, SHUFFLE_HIST(sh, sh->m_hist_cur));
+} /* End of 'shuffle_build' function */
+
+/* Add song to the history dropping the entries after the current one */
+static void shuffle_hist_push( shuffle_t *sh, int song )
+{
+	sh->m_hist_len = sh->m_hist_cur + 1;
+	if (sh->m_hist_len < SHUFFLE_HISTORY_SIZE)
+		sh->m_hist_len ++;
+	else
+		sh->m_hist_head = (sh->m_hist_head + 1) % SHUFFLE_HISTORY_SIZE;
+	sh->m_hist_cur = sh->m_hist_len - 1;
+	SHUFFLE_HIST(sh, sh->m_hist_cur) = song;
+} /* End of 'shuffle_hist_push' function */
+
+/* Choose the next song putting it to the start of the not played part 
+ * of permutation */
+static void shuffle_pick( shuffle_t *sh )
+{
+	int cur, j;
+
+	if (sh->m_picked)
+		return;
+
+	/* All songs are played - start a new round */
+	if (sh->m_drawn >= sh->m_len)
+		sh->m_drawn = 0;
+
+	/* Do the next Fisher-Yates step. Current song may be in the pool 
+	 * only at the round start, and it must not be repeated */
+	cur = (sh->m_hist_cur >= 0) ? SHUFFLE_HIST(sh, sh->m_hist_cur) : -1;
+	j = sh->m_drawn + shuffle_rand(sh, sh->m_len - sh->m_drawn);
+	if (sh->m_perm[j] == cur && sh->m_len - sh->m_drawn > 1)
+	{
+		int j2 = sh->m_drawn + shuffle_rand(sh, sh->m_len - sh->m_drawn - 1);
+		j = (j2 >= j) ? j2 + 1 : j2;
+	}
+	shuffle_swap(sh, sh->m_drawn, j);
+	sh->m_picked = TRUE;
+} /* End of 'shuffle_pick' function */
+
+/* Map play list index */
+static int shuffle_map_index( shuffle_map_t *map, int i )
+{
+	switch (map->m_type)
+	{
+	case SHUFFLE_MAP_INSERT:
+		return (i >= map->m_start) ? i + map->m_num : i;
+	case SHUFFLE_MAP_REMOVE:
+		if (i < map->m_start)
+			return i;
+		return (i <= map->m_end) ? -1 : i - map->m_num;
+	case SHUFFLE_MAP_MOVE:
+		if (i >= map->m_start && i <= map->m_end)
+			return i - map->m_start + map->m_to;
+		if (i > map->m_end)
+			i -= map->m_num;
+		return (i >= map->m_to) ? i + map->m_num : i;
+	}
+	return i;
+} /* End of 'shuffle_map_index' function */
+
+/* Fix up stored indices after play list change */
+static void shuffle_remap( shuffle_t *sh, shuffle_map_t *map )
+{
+	int i, k, len = 0, cur = -1, drawn = 0;
+
+	/* Fix history */
+	for ( i = 0; i < sh->m_hist_len; i ++ )
+	{
+		int song = shuffle_map_index(map, SHUFFLE_HIST(sh, i));
+		if (song < 0)
+			continue;
+		SHUFFLE_HIST(sh, len) = song;
+		if (i <= sh->m_hist_cur)
+			cur = len;
+		len ++;
+	}
+	sh->m_hist_len = len;
+	sh->m_hist_cur = cur;
+	sh->m_picked = FALSE;
+
+	/* Permutation over a part of list is made again when needed */
+	if (!sh->m_valid)
+		return;
+	if (!sh->m_whole)
+	{
+		sh->m_valid = FALSE;
+		return;
+	}
+
+	/* Fix permutation */
+	for ( k = 0, len = 0; k < sh->m_len; k ++ )
+	{
+		int song = shuffle_map_index(map, sh->m_perm[k]);
+		if (song < 0)
+			continue;
+		if (k < sh->m_drawn)
+			drawn ++;
+		sh->m_perm[len ++] = song;
+	}
+	sh->m_len = len;
+	sh->m_drawn = drawn;
+
+	/* Inserted songs are not played yet */
+	if (map->m_type == SHUFFLE_MAP_INSERT)
+	{
+		if (!shuffle_alloc(sh, sh->m_len + map->m_num))
+		{
+			sh->m_valid = FALSE;
+			return;
+		}
+		for ( i = 0; i < map->m_num; i ++ )
+			sh->m_perm[sh->m_len ++] = map->m_start + i;
+	}
+	for ( k = 0; k < sh->m_len; k ++ )
+		sh->m_pos[sh->m_perm[k] - sh->m_base] = k;
+} /* End of 'shuffle_remap' function */
+
+/* Apply queued play list changes */
+static void shuffle_flush( shuffle_t *sh )
+{
+	int i;
+
+	for ( i = 0; i < sh->m_num_maps; i ++ )
+		shuffle_remap(sh, &sh->m_maps[i]);
+	sh->m_num_maps = 0;
+} /* End of 'shuffle_flush' function */
+
+/* Try to merge change into the previous queued one */
+static bool_t shuffle_merge( shuffle_map_t *last, shuffle_map_t *map )
+{
+	if (last->m_type != map->m_type)
+		return FALSE;
+
+	/* Insertion inside or right after the previously inserted block */
+	if (map->m_type == SHUFFLE_MAP_INSERT)
+	{
+		if (map->m_start < last->m_start || 
+				map->m_start > last->m_start + last->m_num)
+			return FALSE;
+		last->m_num += map->m_num;
+		return TRUE;
+	}
+
+	/* Removal adjacent to the previously removed block */
+	if (map->m_type == SHUFFLE_MAP_REMOVE)
+	{
+		if (map->m_start > last->m_start || last->m_start > map->m_end + 1)
+			return FALSE;
+		last->m_start = map->m_start;
+		last->m_num += map->m_num;
+		last->m_end = last->m_start + last->m_num - 1;
+		return TRUE;
+	}
+	return FALSE;
+} /* End of 'shuffle_merge' function */
+
+/* Queue play list change */
+static void shuffle_queue( shuffle_t *sh, shuffle_map_t *map )
+{
+	pthread_mutex_lock(&sh->m_mutex);
+	sh->m_picked = FALSE;
+	if (sh->m_num_maps == 0 || 
+			!shuffle_merge(&sh->m_maps[sh->m_num_maps - 1], map))
+	{
+		if (sh->m_num_maps == SHUFFLE_MAX_MAPS)
+			shuffle_flush(sh);
+		sh->m_maps[sh->m_num_maps ++] = *map;
+	}
+	pthread_mutex_unlock(&sh->m_mutex);
+} /* End of 'shuffle_queue' function */
+
+/* Get next song in the range of len songs starting from base */
+int shuffle_next( shuffle_t *sh, int base, int len, bool_t whole )
+{
+	int song;
+
+	if (sh == NULL || len <= 0)
+		return -1;
+
+	pthread_mutex_lock(&sh->m_mutex);
+	shuffle_flush(sh);
+
+	/* Go forward in history if we went back before */
+	if (sh->m_hist_cur < sh->m_hist_len - 1)
+	{
+		song = SHUFFLE_HIST(sh, ++sh->m_hist_cur);
+		pthread_mutex_unlock(&sh->m_mutex);
+		return song;
+	}
+
+	/* Make permutation for this range */
+	if (!sh->m_valid || sh->m_base != base || sh->m_len != len ||
+			sh->m_whole != whole)
+	{
+		shuffle_build(sh, base, len, whole);
+		if (!sh->m_valid)
+		{
+			pthread_mutex_unlock(&sh->m_mutex);
+			return base + (len > 1 ? shuffle_rand(sh, len) : 0);
+		}
+	}
+
+	/* Take the chosen song */
+	shuffle_pick(sh);
+	song = sh->m_perm[sh->m_drawn ++];
+	sh->m_picked = FALSE;
+	shuffle_hist_push(sh, song);
+
+	pthread_mutex_unlock(&sh->m_mutex);
+	return song;
+} /* End of 'shuffle_next' function */
+
+/* Get song that shuffle_next will return without going to it */
+int shuffle_peek( shuffle_t *sh, int base, int len, bool_t whole )
+{
+	int song = -1;
+
+	if (sh == NULL || len <= 0)
+		return -1;
+
+	pthread_mutex_lock(&sh->m_mutex);
+	shuffle_flush(sh);
+	if (sh->m_hist_cur < sh->m_hist_len - 1)
+		song = SHUFFLE_HIST(sh, sh->m_hist_cur + 1);
+	else
+	{
+		if (!sh->m_valid || sh->m_base != base || sh->m_len != len ||
+				sh->m_whole != whole)
+			shuffle_build(sh, base, len, whole);
+		if (sh->m_valid)
+		{
+			shuffle_pick(sh);
+			song = sh->m_perm[sh->m_drawn];
+		}
+	}
+	pthread_mutex_unlock(&sh->m_mutex);
+	return song;
+} /* End of 'shuffle_peek' function */
+
+/* Get previously played song (-1 if history is over) */
+int shuffle_prev( shuffle_t *sh )
+{
+	int song = -1;
+
+	if (sh == NULL)
+		return -1;
+
+	pthread_mutex_lock(&sh->m_mutex);
+	shuffle_flush(sh);
+	if (sh->m_hist_cur > 0)
+	{
+		song = SHUFFLE_HIST(sh, --sh->m_hist_cur);
+		sh->m_picked = FALSE;
+	}
+	pthread_mutex_unlock(&sh->m_mutex);
+	return song;
+} /* End of 'shuffle_prev' function */
+
+/* Remember that song is being played */
+void shuffle_played( shuffle_t *sh, int song )
+{
+	if (sh == NULL || song < 0)
+		return;
+
+	pthread_mutex_lock(&sh->m_mutex);
+	shuffle_flush(sh);
+	if (sh->m_hist_cur < 0 || SHUFFLE_HIST(sh, sh->m_hist_cur) != song)
+	{
+		sh->m_picked = FALSE;
+		shuffle_mark(sh, song);
+		shuffle_hist_push(sh, song);
+	}
+	pthread_mutex_unlock(&sh->m_mutex);
+} /* End of 'shuffle_played' function */
+
+/* Notify about songs insertion */
+void shuffle_insert( shuffle_t *sh, int pos, int num )
+{
+	shuffle_map_t map;
+
+	if (sh == NULL || num <= 0)
+		return;
+	map.m_type = SHUFFLE_MAP_INSERT;
+	map.m_start = pos;
+	map.m_num = num;
+	shuffle_queue(sh, &map);
+} /* End of 'shuffle_insert' function */
+
+/* Notify about songs removal */
+void shuffle_remove( shuffle_t *sh, int start, int end )
+{
+	shuffle_map_t map;
+
+	if (sh == NULL || start > end)
+		return;
+	map.m_type = SHUFFLE_MAP_REMOVE;
+	map.m_start = start;
+	map.m_end = end;
+	map.m_num = end - start + 1;
+	shuffle_queue(sh, &map);
+} /* End of 'shuffle_remove' function */
+
+/* Notify about songs moving */
+void shuffle_move( shuffle_t *sh, int start, int end, int to )
+{
+	shuffle_map_t map;
+
+	if (sh == NULL || start > end || start == to)
+		return;
+	map.m_type = SHUFFLE_MAP_MOVE;
+	map.m_start = start;
+	map.m_end = end;
+	map.m_to = to;
+	map.m_num = end - start + 1;
+	shuffle_queue(sh, &map);
+} /* End of 'shuffle_move' function */
+
+/* Notify about reordering; shuffling is restarted */
+void shuffle_reset( shuffle_t *sh )
+{
+	if (sh == NULL)
+		return;
+	pthread_mutex_lock(&sh->m_mutex);
+	sh->m_valid = FALSE;
+	sh->m_num_maps = 0;
+	sh->m_hist_len = 0;
+	sh->m_hist_cur = -1;
+	pthread_mutex_unlock(&sh->m_mutex);
+} /* End of 'shuffle_reset' function */
+
+/* End of 'shuffle.c' file */
@@ -0,0 +1,114 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2013 by SG Software.
+ *
+ * SG MPFC. Interface for shuffle play engine.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_SHUFFLE_H__
+#define __SG_MPFC_SHUFFLE_H__
+
+#include <pthread.h>
+#include <stdint.h>
+#include "types.h"
+
+/* Number of songs remembered in the history */
+#define SHUFFLE_HISTORY_SIZE 1024
+
+/* Maximal number of play list changes waiting to be applied */
+#define SHUFFLE_MAX_MAPS 64
+
+/* Play list indices mapping (returns -1 for the removed songs) */
+typedef struct
+{
+	int m_start, m_end, m_to, m_num;
+	enum
+	{
+		SHUFFLE_MAP_INSERT,
+		SHUFFLE_MAP_REMOVE,
+		SHUFFLE_MAP_MOVE
+	} m_type;
+} shuffle_map_t;
+
+/* Shuffle engine type.
+ * Songs of the shuffled range are kept in a permutation which is 
+ * generated step by step (Fisher-Yates). Its first m_drawn entries have 
+ * already been played in this round. Play list indices stored here are
+ * fixed up when play list changes. This is done lazily: changes are 
+ * queued (neighbouring ones merged) and applied when a song is chosen */
+typedef struct tag_shuffle_t
+{
+	/* Permutation of play list indices and positions of indices in it */
+	int *m_perm, *m_pos;
+	int m_base, m_len, m_drawn, m_alloc;
+
+	/* Is permutation built and does it cover the whole play list? */
+	bool_t m_valid, m_whole;
+
+	/* Is the next song already chosen (it is at m_perm[m_drawn])? */
+	bool_t m_picked;
+
+	/* History ring (m_hist_cur is the current song position in it) */
+	int m_hist[SHUFFLE_HISTORY_SIZE];
+	int m_hist_head, m_hist_len, m_hist_cur;
+
+	/* Play list changes not applied yet */
+	shuffle_map_t m_maps[SHUFFLE_MAX_MAPS];
+	int m_num_maps;
+
+	/* Random generator state */
+	uint64_t m_rand;
+
+	pthread_mutex_t m_mutex;
+} shuffle_t;
+
+/* Create shuffle engine */
+shuffle_t *shuffle_new( void );
+
+/* Free shuffle engine */
+void shuffle_free( shuffle_t *sh );
+
+/* Get next song in the range of len songs starting from base */
+int shuffle_next( shuffle_t *sh, int base, int len, bool_t whole );
+
+/* Get song that shuffle_next will return without going to it 
+ * (-1 if it is not known) */
+int shuffle_peek( shuffle_t *sh, int base, int len, bool_t whole );
+
+/* Get previously played song (-1 if history is over) */
+int shuffle_prev( shuffle_t *sh );
+
+/* Remember that song is being played */
+void shuffle_played( shuffle_t *sh, int song );
+
+/* Notify about songs insertion */
+void shuffle_insert( shuffle_t *sh, int pos, int num );
+
+/* Notify about songs removal */
+void shuffle_remove( shuffle_t *sh, int start, int end );
+
+/* Notify about songs moving */
+void shuffle_move( shuffle_t *sh, int start, int end, int to );
+
+/* Notify about reordering; shuffling is restarted */
+void shuffle_reset( shuffle_t *sh );
+
+#endif
+
+/* End of 'shuffle.h' file */
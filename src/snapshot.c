@@ -0,0 +1,437 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2013 by SG Software.
+ *
+ * SG MPFC. Binary player state snapshots.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "types.h"
+#include "logger.h"
+#include "player.h"
+#include "plist.h"
+#include "snapshot.h"
+#include "song.h"
+#include "song_info.h"
+#include "util.h"
+
+/* Value written to the byte order field */
+#define SNAPSHOT_BYTE_ORDER 0x01020304
+
+/* String table being built. Equal strings are stored once */
+typedef struct
+{
+	char *m_data;
+	dword m_size, m_alloc;
+
+	/* Hash of offsets (open addressing) */
+	dword *m_hash;
+	dword m_hash_size, m_num_strings;
+} snapshot_strtab_t;
+
+/* Calculate string hash */
+static dword snapshot_hash( const char *str )
+{
+	dword h = 2166136261u;
+	for ( ; *str; str ++ )
+	{
+		h ^= (byte)(*str);
+		h *= 16777619u;
+	}
+	return h;
+} /* End of 'snapshot_hash' function */
+
+/* Grow strings hash */
+static bool_t snapshot_strtab_rehash( snapshot_strtab_t *st )
+{
+	dword new_size = (st->m_hash_size == 0) ? 1024 : st->m_hash_size * 2;
+	dword *hash = (dword *)malloc(sizeof(dword) * new_size);
+	dword i;
+	if (hash == NULL)
+		return FALSE;
+	memset(hash, 0xFF, sizeof(dword) * new_size);
+
+	for ( i = 0; i < st->m_hash_size; i ++ )
+	{
+		dword offs = st->m_hash[i], j;
+		if (offs == SNAPSHOT_NONE)
+			continue;
+		j = snapshot_hash(&st->m_data[offs]) & (new_size - 1);
+		while (hash[j] != SNAPSHOT_NONE)
+			j = (j + 1) & (new_size - 1);
+		hash[j] = offs;
+	}
+	free(st->m_hash);
+	st->m_hash = hash;
+	st->m_hash_size = new_size;
+	return TRUE;
+} /* End of 'snapshot_strtab_rehash' function */
+
+/* Add string to the table returning its offset */
+static dword snapshot_strtab_add( snapshot_strtab_t *st, const char *str )
+{
+	dword i, len;
+
+	if (str == NULL)
+		return SNAPSHOT_NONE;
+
+	/* Keep load factor below 1/2 */
+	if (st->m_num_strings * 2 >= st->m_hash_size)
+	{
+		if (!snapshot_strtab_rehash(st))
+			return SNAPSHOT_NONE;
+	}
+
+	/* Search for this string */
+	i = snapshot_hash(str) & (st->m_hash_size - 1);
+	for ( ; st->m_hash[i] != SNAPSHOT_NONE; i = (i + 1) & (st->m_hash_size - 1) )
+	{
+		if (!strcmp(&st->m_data[st->m_hash[i]], str))
+			return st->m_hash[i];
+	}
+
+	/* Append it */
+	len = strlen(str) + 1;
+	if (st->m_size + len > st->m_alloc)
+	{
+		dword new_alloc = (st->m_alloc == 0) ? 65536 : st->m_alloc;
+		char *data;
+		while (new_alloc < st->m_size + len)
+			new_alloc *= 2;
+		data = (char *)realloc(st->m_data, new_alloc);
+		if (data == NULL)
+			return SNAPSHOT_NONE;
+		st->m_data = data;
+		st->m_alloc = new_alloc;
+	}
+	memcpy(&st->m_data[st->m_size], str, len);
+	st->m_hash[i] = st->m_size;
+	st->m_num_strings ++;
+	st->m_size += len;
+	return st->m_hash[i];
+} /* End of 'snapshot_strtab_add' function */
+
+/* Fill song info record */
+static void snapshot_fill_info( snapshot_strtab_t *st, snapshot_info_t *rec,
+		song_info_t *si )
+{
+	rec->m_fields[0] = snapshot_strtab_add(st, si->m_artist);
+	rec->m_fields[1] = snapshot_strtab_add(st, si->m_name);
+	rec->m_fields[2] = snapshot_strtab_add(st, si->m_album);
+	rec->m_fields[3] = snapshot_strtab_add(st, si->m_year);
+	rec->m_fields[4] = snapshot_strtab_add(st, si->m_genre);
+	rec->m_fields[5] = snapshot_strtab_add(st, si->m_comments);
+	rec->m_fields[6] = snapshot_strtab_add(st, si->m_track);
+	rec->m_fields[7] = snapshot_strtab_add(st, si->m_own_data);
+	rec->m_flags = si->m_flags;
+	rec->m_gains[0] = si->m_track_gain;
+	rec->m_gains[1] = si->m_track_peak;
+	rec->m_gains[2] = si->m_album_gain;
+	rec->m_gains[3] = si->m_album_peak;
+} /* End of 'snapshot_fill_info' function */
+
+/* Save songs and player state to a snapshot file */
+bool_t snapshot_save( const char *filename, song_t **list, int num_songs,
+		snapshot_state_t *state )
+{
+	snapshot_header_t hdr;
+	snapshot_strtab_t st;
+	snapshot_song_t *songs = NULL;
+	snapshot_info_t *infos = NULL;
+	char *tmp_name = NULL;
+	FILE *fd = NULL;
+	bool_t ret = FALSE;
+	int i;
+
+	memset(&st, 0, sizeof(st));
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.m_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+	hdr.m_version = SNAPSHOT_VERSION;
+	hdr.m_byte_order = SNAPSHOT_BYTE_ORDER;
+	hdr.m_cur_song = state->m_cur_song;
+	hdr.m_status = state->m_status;
+	hdr.m_start = state->m_start;
+	hdr.m_end = state->m_end;
+	hdr.m_cur_time = state->m_cur_time;
+	hdr.m_volume = state->m_volume;
+	hdr.m_journal_seq = state->m_journal_seq;
+	hdr.m_journal_offset = state->m_journal_offset;
+
+	/* Build records */
+	if (num_songs > 0)
+	{
+		songs = (snapshot_song_t *)malloc(sizeof(*songs) * num_songs);
+		infos = (snapshot_info_t *)malloc(sizeof(*infos) * num_songs);
+		if (songs == NULL || infos == NULL)
+			goto finally;
+	}
+	for ( i = 0; i < num_songs; i ++ )
+	{
+		song_t *s = list[i];
+		snapshot_song_t *rec = &songs[i];
+
+		song_lock(s);
+		rec->m_name = snapshot_strtab_add(&st, song_get_name(s));
+		rec->m_title = snapshot_strtab_add(&st, song_get_default_title(s));
+		rec->m_flags = 0;
+		if (s->m_filename == NULL)
+			rec->m_flags |= SNAPSHOT_SONG_URI;
+		rec->m_len = s->m_full_len;
+		rec->m_start_time = song_get_start_time(s);
+		rec->m_end_time = song_get_end_time(s);
+		rec->m_info = SNAPSHOT_NONE;
+		if (s->m_info && (s->m_info->m_flags & SI_INITIALIZED))
+		{
+			rec->m_info = hdr.m_num_infos ++;
+			snapshot_fill_info(&st, &infos[rec->m_info], s->m_info);
+			if (s->m_flags & SONG_STATIC_INFO)
+				rec->m_flags |= SNAPSHOT_SONG_STATIC_INFO;
+		}
+		song_unlock(s);
+
+		/* Strings addition fails only on allocation failure */
+		if (rec->m_name == SNAPSHOT_NONE)
+			goto finally;
+	}
+	hdr.m_num_songs = num_songs;
+	hdr.m_strtab_size = st.m_size;
+
+	/* Write to a temporary file and then replace the old snapshot, so
+	 * that it is never left half-written */
+	tmp_name = util_strcat(filename, ".tmp", NULL);
+	if (tmp_name == NULL)
+		goto finally;
+	fd = fopen(tmp_name, "wb");
+	if (fd == NULL)
+	{
+		logger_error(player_log, 1, _("unable to open file %s for writing"),
+				tmp_name);
+		goto finally;
+	}
+	if (fwrite(&hdr, sizeof(hdr), 1, fd) != 1 ||
+			(num_songs > 0 && 
+			 fwrite(songs, sizeof(*songs), num_songs, fd) != num_songs) ||
+			(hdr.m_num_infos > 0 && 
+			 fwrite(infos, sizeof(*infos), hdr.m_num_infos, fd) != 
+			 	hdr.m_num_infos) ||
+			(st.m_size > 0 && fwrite(st.m_data, 1, st.m_size, fd) != st.m_size))
+	{
+		logger_error(player_log, 1, _("unable to write player state"));
+		fclose(fd);
+		unlink(tmp_name);
+		goto finally;
+	}
+	if (fclose(fd) != 0 || rename(tmp_name, filename) < 0)
+	{
+		logger_error(player_log, 1, _("unable to write player state"));
+		unlink(tmp_name);
+		goto finally;
+	}
+	ret = TRUE;
+
+finally:
+	free(tmp_name);
+	free(songs);
+	free(infos);
+	free(st.m_data);
+	free(st.m_hash);
+	return ret;
+} /* End of 'snapshot_save' function */
+
+/* Get string from the table. Offset is supposed to be validated */
+static inline const char *snapshot_str( const char *strtab, dword offs )
+{
+	return (offs == SNAPSHOT_NONE) ? NULL : &strtab[offs];
+} /* End of 'snapshot_str' function */
+
+/* Check a string offset */
+static inline bool_t snapshot_check_str( snapshot_header_t *hdr, dword offs )
+{
+	return (offs == SNAPSHOT_NONE || offs < hdr->m_strtab_size);
+} /* End of 'snapshot_check_str' function */
+
+/* Create song info from a record */
+static song_info_t *snapshot_load_info( snapshot_header_t *hdr,
+		snapshot_info_t *rec, const char *strtab )
+{
+	song_info_t *si;
+	int i;
+
+	for ( i = 0; i < SNAPSHOT_INFO_FIELDS; i ++ )
+	{
+		if (!snapshot_check_str(hdr, rec->m_fields[i]))
+			return NULL;
+	}
+
+	si = si_new();
+	if (si == NULL)
+		return NULL;
+	si_set_artist	(si, snapshot_str(strtab, rec->m_fields[0]));
+	si_set_name		(si, snapshot_str(strtab, rec->m_fields[1]));
+	si_set_album	(si, snapshot_str(strtab, rec->m_fields[2]));
+	si_set_year		(si, snapshot_str(strtab, rec->m_fields[3]));
+	si_set_genre	(si, snapshot_str(strtab, rec->m_fields[4]));
+	si_set_comments	(si, snapshot_str(strtab, rec->m_fields[5]));
+	si_set_track	(si, snapshot_str(strtab, rec->m_fields[6]));
+	si_set_own_data	(si, snapshot_str(strtab, rec->m_fields[7]));
+	si->m_flags = rec->m_flags;
+	si->m_track_gain = rec->m_gains[0];
+	si->m_track_peak = rec->m_gains[1];
+	si->m_album_gain = rec->m_gains[2];
+	si->m_album_peak = rec->m_gains[3];
+	return si;
+} /* End of 'snapshot_load_info' function */
+
+/* Load snapshot appending songs to the play list */
+bool_t snapshot_load( const char *filename, plist_t *pl,
+		snapshot_state_t *state )
+{
+	struct stat st;
+	snapshot_header_t *hdr;
+	snapshot_song_t *songs;
+	snapshot_info_t *infos;
+	const char *strtab;
+	song_t **list = NULL;
+	void *data = MAP_FAILED;
+	uint64_t expected;
+	bool_t ret = FALSE;
+	dword i, num = 0;
+	int fd;
+
+	/* Map file */
+	fd = open(filename, O_RDONLY);
+	if (fd < 0)
+	{
+		if (errno != ENOENT)
+			logger_error(player_log, 1, _("unable to open file %s"), filename);
+		return FALSE;
+	}
+	if (fstat(fd, &st) < 0 || st.st_size < sizeof(snapshot_header_t))
+		goto corrupt;
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED)
+		goto corrupt;
+
+	/* Check header */
+	hdr = (snapshot_header_t *)data;
+	if (memcmp(hdr->m_magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) ||
+			hdr->m_version != SNAPSHOT_VERSION ||
+			hdr->m_byte_order != SNAPSHOT_BYTE_ORDER)
+		goto corrupt;
+	expected = sizeof(snapshot_header_t) + 
+		(uint64_t)hdr->m_num_songs * sizeof(snapshot_song_t) +
+		(uint64_t)hdr->m_num_infos * sizeof(snapshot_info_t) +
+		hdr->m_strtab_size;
+	if (expected != (uint64_t)st.st_size)
+		goto corrupt;
+	songs = (snapshot_song_t *)(hdr + 1);
+	infos = (snapshot_info_t *)(songs + hdr->m_num_songs);
+	strtab = (const char *)(infos + hdr->m_num_infos);
+
+	/* Every offset below the table size points to a terminated string */
+	if (hdr->m_strtab_size > 0 && strtab[hdr->m_strtab_size - 1] != 0)
+		goto corrupt;
+
+	/* Create songs */
+	if (hdr->m_num_songs > 0)
+	{
+		list = (song_t **)malloc(sizeof(song_t *) * hdr->m_num_songs);
+		if (list == NULL)
+			goto finally;
+	}
+	for ( i = 0; i < hdr->m_num_songs; i ++ )
+	{
+		snapshot_song_t *rec = &songs[i];
+		song_metadata_t metadata = SONG_METADATA_EMPTY;
+		song_info_t *si = NULL;
+		song_t *s;
+
+		if (rec->m_name == SNAPSHOT_NONE || 
+				!snapshot_check_str(hdr, rec->m_name) ||
+				!snapshot_check_str(hdr, rec->m_title))
+			goto corrupt;
+		if (rec->m_info != SNAPSHOT_NONE)
+		{
+			if (rec->m_info >= hdr->m_num_infos)
+				goto corrupt;
+			si = snapshot_load_info(hdr, &infos[rec->m_info], strtab);
+			if (si == NULL)
+				goto corrupt;
+		}
+
+		metadata.m_title = snapshot_str(strtab, rec->m_title);
+		metadata.m_len = rec->m_len;
+		metadata.m_start_time = rec->m_start_time;
+		metadata.m_end_time = rec->m_end_time;
+		if (rec->m_flags & SNAPSHOT_SONG_STATIC_INFO)
+		{
+			metadata.m_song_info = si;
+			si = NULL;
+		}
+
+		s = song_new_from_state(snapshot_str(strtab, rec->m_name),
+				(rec->m_flags & SNAPSHOT_SONG_URI) ? TRUE : FALSE,
+				&metadata, si);
+		if (s == NULL)
+		{
+			si_free(metadata.m_song_info);
+			si_free(si);
+			continue;
+		}
+		list[num ++] = s;
+	}
+
+	/* Add songs all at once */
+	if (!plist_add_songs(pl, list, num))
+		goto finally;
+	num = 0;
+
+	state->m_cur_song = hdr->m_cur_song;
+	state->m_cur_time = hdr->m_cur_time;
+	state->m_status = hdr->m_status;
+	state->m_start = hdr->m_start;
+	state->m_end = hdr->m_end;
+	state->m_volume = hdr->m_volume;
+	state->m_journal_seq = hdr->m_journal_seq;
+	state->m_journal_offset = hdr->m_journal_offset;
+	ret = TRUE;
+	goto finally;
+
+corrupt:
+	logger_error(player_log, 1, _("player state file %s is corrupted"), 
+			filename);
+
+finally:
+	for ( i = 0; i < num; i ++ )
+		song_free(list[i]);
+	free(list);
+	if (data != MAP_FAILED)
+		munmap(data, st.st_size);
+	close(fd);
+	return ret;
+} /* End of 'snapshot_load' function */
+
+/* End of 'snapshot.c' file */
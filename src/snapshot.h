@@ -0,0 +1,122 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2013 by SG Software.
+ *
+ * SG MPFC. Interface for binary player state snapshots.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+
+#ifndef __SG_MPFC_SNAPSHOT_H__
+#define __SG_MPFC_SNAPSHOT_H__
+
+#include "types.h"
+#include "main_types.h"
+
+/* Snapshot file signature and format version */
+#define SNAPSHOT_MAGIC "MPFCSNP"
+#define SNAPSHOT_VERSION 3
+
+/* Value used for absent string offsets and info indices */
+#define SNAPSHOT_NONE 0xFFFFFFFF
+
+/* Snapshot file header. 
+ * It is followed by song records, info records and the string table */
+typedef struct tag_snapshot_header_t
+{
+	char m_magic[8];
+	dword m_version;
+
+	/* Is used to reject files written with another byte order */
+	dword m_byte_order;
+
+	/* Sections sizes */
+	dword m_num_songs;
+	dword m_num_infos;
+	dword m_strtab_size;
+
+	/* Player state */
+	int32_t m_cur_song;
+	int32_t m_status;
+	int32_t m_start, m_end;
+	int64_t m_cur_time;
+	double m_volume;
+
+	/* Journal position the snapshot is up to date with */
+	dword m_journal_seq;
+	dword m_reserved;
+	int64_t m_journal_offset;
+} snapshot_header_t;
+
+/* Song record */
+typedef struct tag_snapshot_song_t
+{
+	/* Offsets in the string table */
+	dword m_name;
+	dword m_title;
+
+	/* Index of the info record */
+	dword m_info;
+
+	/* Record flags */
+	dword m_flags;
+
+	int64_t m_len;
+	int64_t m_start_time, m_end_time;
+} snapshot_song_t;
+
+/* Song record flags */
+#define SNAPSHOT_SONG_URI 0x00000001
+#define SNAPSHOT_SONG_STATIC_INFO 0x00000002
+
+/* Song info record (offsets of artist, name, album, year, genre,
+ * comments, track and own data strings; track gain and peak, album gain 
+ * and peak) */
+#define SNAPSHOT_INFO_FIELDS 8
+#define SNAPSHOT_INFO_GAINS 4
+typedef struct tag_snapshot_info_t
+{
+	dword m_fields[SNAPSHOT_INFO_FIELDS];
+	dword m_flags;
+	float m_gains[SNAPSHOT_INFO_GAINS];
+} snapshot_info_t;
+
+/* Player state saved along with the play list */
+typedef struct tag_snapshot_state_t
+{
+	int m_cur_song;
+	song_time_t m_cur_time;
+	int m_status;
+	int m_start, m_end;
+	double m_volume;
+
+	/* Journal sequence number and offset in it (see checkpoint.h) */
+	dword m_journal_seq;
+	int64_t m_journal_offset;
+} snapshot_state_t;
+
+/* Save songs and player state to a snapshot file */
+bool_t snapshot_save( const char *filename, song_t **list, int num_songs,
+		snapshot_state_t *state );
+
+/* Load snapshot appending songs to the play list */
+bool_t snapshot_load( const char *filename, plist_t *pl,
+		snapshot_state_t *state );
+
+#endif
+
+/* End of 'snapshot.h' file */
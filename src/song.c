@@ -33,30 +33,300 @@
 #include "song_info.h"
 #include "util.h"
 
+/* Compiled title format operation: either a literal span or a reference
+ * to a song field */
+typedef struct
+{
+	/* Field character (zero for literals) */
+	char m_field;
+
+	/* Literal span */
+	const char *m_literal;
+	int m_len;
+} song_title_op_t;
+
+/* Compiled title format */
+static struct
+{
+	/* Format source */
+	char *m_src;
+
+	/* Operations list */
+	song_title_op_t *m_ops;
+	int m_num_ops;
+
+	/* Scratch space for rendering (resolved items and their lengths) */
+	const char **m_items;
+	int *m_lens;
+} song_title_fmt = { NULL, NULL, 0, NULL, NULL };
+static pthread_mutex_t song_title_fmt_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Titles generation. Title of a song is stale if it was built in another
+ * generation, so all titles are invalidated just by incrementing it. 
+ * Songs never get generation zero, so their titles are built on first 
+ * use */
+static dword song_title_gen = 1;
+
+/* Lengths generation. It is incremented whenever a song length changes,
+ * so that lengths counted elsewhere are known to be stale */
+static dword song_len_gen = 1;
+
+/* Songs locks */
+pthread_mutex_t song_locks[SONG_LOCK_STRIPES];
+__thread int song_locks_held = 0;
+static pthread_once_t song_locks_once = PTHREAD_ONCE_INIT;
+
+/* Songs are allocated in slabs of this many objects; free objects are 
+ * kept in a list and reused */
+#define SONG_SLAB_SIZE 256
+static song_t *song_free_list = NULL;
+static pthread_mutex_t song_slab_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Songs registry. Every song is registered under its name and slice 
+ * start, so a song that is already loaded (say, in another play list) 
+ * is shared instead of being created again. The registry mutex also 
+ * guards songs reference counters */
+#define SONG_REGISTRY_INITIAL_SIZE 1021
+static song_t **song_registry = NULL;
+static int song_registry_size = 0;
+static int song_registry_count = 0;
+static pthread_mutex_t song_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* Initialize songs locks */
+static void song_init_locks( void )
+{
+	int i;
+	for ( i = 0; i < SONG_LOCK_STRIPES; i ++ )
+		pthread_mutex_init(&song_locks[i], NULL);
+} /* End of 'song_init_locks' function */
+
+/* Allocate memory for a song object */
+static song_t *song_alloc( void )
+{
+	song_t *song;
+
+	pthread_once(&song_locks_once, song_init_locks);
+	pthread_mutex_lock(&song_slab_mutex);
+
+	/* Allocate a new slab and put its objects to the free list */
+	if (song_free_list == NULL)
+	{
+		song_t *slab = (song_t *)malloc(sizeof(song_t) * SONG_SLAB_SIZE);
+		int i;
+
+		if (slab == NULL)
+		{
+			pthread_mutex_unlock(&song_slab_mutex);
+			return NULL;
+		}
+		for ( i = 0; i < SONG_SLAB_SIZE; i ++ )
+		{
+			*(song_t **)(&slab[i]) = song_free_list;
+			song_free_list = &slab[i];
+		}
+	}
+
+	/* Take object from the free list */
+	song = song_free_list;
+	song_free_list = *(song_t **)song;
+	pthread_mutex_unlock(&song_slab_mutex);
+	return song;
+} /* End of 'song_alloc' function */
+
+/* Return song object memory to the free list */
+static void song_dealloc( song_t *song )
+{
+	pthread_mutex_lock(&song_slab_mutex);
+	*(song_t **)song = song_free_list;
+	song_free_list = song;
+	pthread_mutex_unlock(&song_slab_mutex);
+} /* End of 'song_dealloc' function */
+
+/* Calculate registry key hash */
+static dword song_registry_hash( const char *name, song_time_t start_time )
+{
+	dword val = 2166136261U;
+
+	for ( ; *name; name ++ )
+	{
+		val ^= (byte)(*name);
+		val *= 16777619U;
+	}
+	val ^= (dword)start_time ^ (dword)(start_time >> 32);
+	val *= 16777619U;
+	return val;
+} /* End of 'song_registry_hash' function */
+
+/* Change registry table size (registry mutex must be locked) */
+static bool_t song_registry_resize( int new_size )
+{
+	song_t **table;
+	int i;
+
+	table = (song_t **)calloc(new_size, sizeof(*table));
+	if (table == NULL)
+		return FALSE;
+	for ( i = 0; i < song_registry_size; i ++ )
+	{
+		song_t *s, *next;
+		for ( s = song_registry[i]; s != NULL; s = next )
+		{
+			next = s->m_registry_next;
+			s->m_registry_next = table[s->m_registry_hash % new_size];
+			table[s->m_registry_hash % new_size] = s;
+		}
+	}
+	free(song_registry);
+	song_registry = table;
+	song_registry_size = new_size;
+	return TRUE;
+} /* End of 'song_registry_resize' function */
+
+/* Find a registered song and add a reference to it. Song info passed 
+ * for the new song is not needed if it is found, so it is freed */
+static song_t *song_registry_find( const char *name, 
+		song_metadata_t *metadata, song_info_t *si )
+{
+	song_time_t start_time = (metadata->m_start_time >= 0) ? 
+		metadata->m_start_time : -1;
+	dword hash = song_registry_hash(name, start_time);
+	song_t *s = NULL;
+
+	pthread_mutex_lock(&song_registry_mutex);
+	if (song_registry_size > 0)
+	{
+		for ( s = song_registry[hash % song_registry_size]; s != NULL; 
+				s = s->m_registry_next )
+		{
+			if (s->m_registry_hash == hash && 
+					song_get_start_time(s) == start_time &&
+					!strcmp(song_get_name(s), name))
+			{
+				s->m_ref_count ++;
+				break;
+			}
+		}
+	}
+	pthread_mutex_unlock(&song_registry_mutex);
+
+	if (s != NULL)
+	{
+		si_free(metadata->m_song_info);
+		si_free(si);
+	}
+	return s;
+} /* End of 'song_registry_find' function */
+
+/* Register a new song and add the first reference to it. If an equal
+ * song has been registered meanwhile, it is returned and the new one 
+ * is freed */
+static song_t *song_register( song_t *song )
+{
+	const char *name = song_get_name(song);
+	song_time_t start_time = song_get_start_time(song);
+	dword hash = song_registry_hash(name, start_time);
+	song_t *s = NULL;
+
+	pthread_mutex_lock(&song_registry_mutex);
+	if (song_registry != NULL || 
+			song_registry_resize(SONG_REGISTRY_INITIAL_SIZE))
+	{
+		for ( s = song_registry[hash % song_registry_size]; s != NULL; 
+				s = s->m_registry_next )
+		{
+			if (s->m_registry_hash == hash && 
+					song_get_start_time(s) == start_time &&
+					!strcmp(song_get_name(s), name))
+			{
+				s->m_ref_count ++;
+				break;
+			}
+		}
+		if (s == NULL)
+		{
+			song->m_registry_hash = hash;
+			song->m_registry_next = song_registry[hash % song_registry_size];
+			song_registry[hash % song_registry_size] = song;
+
+			/* Enlarge table if it has become too crowded */
+			song_registry_count ++;
+			if (song_registry_count > song_registry_size * 2)
+				song_registry_resize(song_registry_size * 2 + 1);
+		}
+	}
+	song->m_ref_count ++;
+	pthread_mutex_unlock(&song_registry_mutex);
+
+	if (s != NULL)
+	{
+		song_free(song);
+		return s;
+	}
+	return song;
+} /* End of 'song_register' function */
+
+static void song_rebuild_title( song_t *song );
+
+/* Free song object memory */
+static void song_destroy( song_t *song )
+{
+	str_free(song->m_title);
+	str_wide_free(song->m_wide_title);
+	si_free(song->m_info);
+	if (song->m_filename)
+		free(song->m_filename);
+	if (song->m_cold != NULL)
+	{
+		free(song->m_cold->m_fullname);
+		free(song->m_cold->m_default_title);
+		free(song->m_cold);
+	}
+	song_dealloc(song);
+} /* End of 'song_destroy' function */
+
+/* Get rarely used fields of a song being created, allocating them if
+ * they are not yet */
+static song_cold_t *song_get_cold( song_t *song )
+{
+	if (song->m_cold == NULL)
+	{
+		song->m_cold = (song_cold_t *)malloc(sizeof(song_cold_t));
+		if (song->m_cold == NULL)
+			return NULL;
+		memset(song->m_cold, 0, sizeof(song_cold_t));
+		song->m_cold->m_start_time = song->m_cold->m_end_time = -1;
+	}
+	return song->m_cold;
+} /* End of 'song_get_cold' function */
+
 static void song_set_sliced_len( song_t *song )
 {
-	song->m_len = (song->m_end_time > -1) ? 
-		(song->m_end_time - song->m_start_time) : 
-			(song->m_full_len - song->m_start_time);
+	song_time_t start = song_get_start_time(song),
+				end = song_get_end_time(song);
+	song->m_len = (end > -1) ? (end - start) : (song->m_full_len - start);
 }
 
 static song_t *song_new( song_metadata_t *metadata )
 {
 	/* Try to allocate memory for new song */
-	song_t *song = (song_t *)malloc(sizeof(song_t));
+	song_t *song = song_alloc();
 	if (song == NULL)
 		return NULL;
 	memset(song, 0, sizeof(*song));
 
-	song->m_start_time = song->m_end_time = -1;
 	song->m_len = song->m_full_len = metadata->m_len;
-	pthread_mutex_init(&song->m_mutex, NULL);
 
 	/* Slice song */
 	if (metadata->m_start_time >= 0)
 	{
-		song->m_start_time = metadata->m_start_time;
-		song->m_end_time = metadata->m_end_time;
+		song_cold_t *cold = song_get_cold(song);
+		if (cold == NULL)
+		{
+			song_dealloc(song);
+			return NULL;
+		}
+		cold->m_start_time = metadata->m_start_time;
+		cold->m_end_time = metadata->m_end_time;
 		song_set_sliced_len(song);
 	}
 
@@ -74,11 +344,13 @@ static void song_set_title( song_t *s, song_metadata_t *metadata )
 {
 	const char *title = metadata->m_title;
 	if (title == NULL)
-		song_update_title(s);
+		song_rebuild_title(s);
 	else
 	{
+		song_cold_t *cold = song_get_cold(s);
 		s->m_title = str_new(title);
-		s->m_default_title = strdup(title);
+		if (cold != NULL)
+			cold->m_default_title = strdup(title);
 	}
 }
 
@@ -88,6 +360,11 @@ song_t *song_new_from_file( const char *filename, song_metadata_t *metadata )
 	/* Must be an absolute path */
 	assert((*filename) == '/');
 
+	/* Share the song if it is already loaded */
+	song_t *song = song_registry_find(filename, metadata, NULL);
+	if (song != NULL)
+		return song;
+
 	/* Is this a supported format? */
 	const char *ext = strrchr(filename, '.');
 	if (!ext)
@@ -97,64 +374,111 @@ song_t *song_new_from_file( const char *filename, song_metadata_t *metadata )
 	if (!pmng_search_format(player_pmng, filename, ext))
 		return NULL;
 	
-	song_t *song = song_new(metadata);
-
-	/* Set various types of file name */
-	song->m_fullname = gst_filename_to_uri(filename, NULL);
-	if (!song->m_fullname)
-	{
-		free(song);
+	song = song_new(metadata);
+	if (song == NULL)
 		return NULL;
-	}
+
+	/* URI is made from file name on demand */
 	song->m_filename = strdup(filename);
 
 	song_set_title(song, metadata);
 
-	return song_add_ref(song);
+	return song_register(song);
 } /* End of 'song_new_from_file' function */
 
 /* Create a new song from an URI */
 song_t *song_new_from_uri( const char *uri, song_metadata_t *metadata )
 {
-	song_t *song = song_new(metadata);
-	song->m_fullname = strdup(uri);
+	song_t *song = song_registry_find(uri, metadata, NULL);
+	if (song != NULL)
+		return song;
+
+	song = song_new(metadata);
+	if (song == NULL)
+		return NULL;
+	if (song_get_cold(song) == NULL)
+	{
+		song_destroy(song);
+		return NULL;
+	}
+	song->m_cold->m_fullname = strdup(uri);
 
 	song_set_title(song, metadata);
 
-	return song_add_ref(song);
+	return song_register(song);
 } /* End of 'song_new' function */
 
+/* Create a song restored from the saved player state. Name is trusted
+ * to be a supported one, and title is built only when it is needed */
+song_t *song_new_from_state( const char *name, bool_t is_uri,
+		song_metadata_t *metadata, song_info_t *si )
+{
+	song_t *song = song_registry_find(name, metadata, si);
+	if (song != NULL)
+		return song;
+
+	song = song_new(metadata);
+	if (song == NULL)
+		return NULL;
+	if (!is_uri)
+		song->m_filename = strdup(name);
+	else if (song_get_cold(song) != NULL)
+		song->m_cold->m_fullname = strdup(name);
+	else
+	{
+		song_destroy(song);
+		si_free(si);
+		return NULL;
+	}
+
+	if (song->m_info == NULL)
+		song->m_info = si;
+	if (metadata->m_title != NULL)
+		song_set_title(song, metadata);
+
+	return song_register(song);
+} /* End of 'song_new_from_state' function */
+
 /* Add a reference to the song object */
 song_t *song_add_ref( song_t *song )
 {
 	assert(song);
-	assert(song->m_ref_count >= 0);
+	pthread_mutex_lock(&song_registry_mutex);
+	assert(song->m_ref_count > 0);
 	song->m_ref_count ++;
+	pthread_mutex_unlock(&song_registry_mutex);
 	return song;
 } /* End of 'song_add_ref' function */
 
 /* Free song */
 void song_free( song_t *song )
 {
+	bool_t last;
+
 	assert(song);
-	assert(song->m_ref_count > 0);
 
-	/* Release reference */
+	/* Release reference and remove the last one from the registry */
+	pthread_mutex_lock(&song_registry_mutex);
+	assert(song->m_ref_count > 0);
 	song->m_ref_count --;
-
-	/* Free object */
-	if (song->m_ref_count == 0)
+	last = (song->m_ref_count == 0);
+	if (last && song_registry_size > 0)
 	{
-		str_free(song->m_title);
-		si_free(song->m_info);
-		if (song->m_filename)
-			free(song->m_filename);
-		free(song->m_fullname);
-		if (song->m_default_title != NULL)
-			free(song->m_default_title);
-		pthread_mutex_destroy(&song->m_mutex);
-		free(song);
+		song_t **prev;
+		for ( prev = &song_registry[song->m_registry_hash % 
+				song_registry_size]; (*prev) != NULL && (*prev) != song; 
+				prev = &(*prev)->m_registry_next );
+		if ((*prev) != NULL)
+		{
+			*prev = song->m_registry_next;
+			song_registry_count --;
+		}
 	}
+	pthread_mutex_unlock(&song_registry_mutex);
+
+	/* Free object */
+	if (last)
+		song_destroy(song);
 } /* End of 'song_free' function */
 
 /* Set current song info */
@@ -171,11 +495,22 @@ void song_set_info( song_t *song, song_info_t *si )
 		si_free(song->m_info);
 	song->m_info = si;
 
-	song_update_title(song);
+	song_rebuild_title(song);
 
 	song_unlock(song);
 }
 
+/* Schedule reading song info unless the song has it already (songs are
+ * shared, so it may be read for another list) or it is going to be read */
+void song_schedule_info( song_t *song )
+{
+	song_lock(song);
+	if (song->m_info == NULL && 
+			!(song->m_flags & (SONG_SCHEDULE | SONG_INFO_READ)))
+		song->m_flags |= SONG_SCHEDULE;
+	song_unlock(song);
+} /* End of 'song_schedule_info' function */
+
 /* Update song information */
 void song_update_info( song_t *song )
 {
@@ -184,56 +519,189 @@ void song_update_info( song_t *song )
 		return;
 	}
 
-	song_lock(song);
+	/* Read the file without the lock, so that rendering threads 
+	 * sharing the lock stripe are not held up by the I/O */
+	song_time_t full_len = 0, old_len;
+	char *uri = song_get_uri(song);
+	song_info_t *new_info = md_get_info(song->m_filename, uri, &full_len);
+	free(uri);
 
-	song_info_t *new_info = md_get_info(song->m_filename,
-			song->m_fullname, &song->m_full_len);
-	song->m_len = song->m_full_len;
+	song_lock(song);
+	old_len = song->m_len;
+	song->m_full_len = full_len;
+	song->m_len = full_len;
 	if (!(song->m_flags & SONG_STATIC_INFO))
 	{
 		si_free(song->m_info);
 		song->m_info = new_info;
 	}
 	else if (new_info)
+	{
+		/* Static info still takes ReplayGain values from the file */
+		if (song->m_info)
+		{
+			song->m_info->m_flags &= ~(SI_TRACK_GAIN | SI_ALBUM_GAIN);
+			if (new_info->m_flags & SI_TRACK_GAIN)
+				si_set_replay_gain(song->m_info, FALSE, 
+						new_info->m_track_gain, new_info->m_track_peak);
+			if (new_info->m_flags & SI_ALBUM_GAIN)
+				si_set_replay_gain(song->m_info, TRUE, 
+						new_info->m_album_gain, new_info->m_album_peak);
+		}
 		si_free(new_info);
+	}
 
-	if (song->m_start_time > -1)
+	if (song_get_start_time(song) > -1)
 	{
 		song_set_sliced_len(song);
 	}
 
-	song_update_title(song);
+	/* Play lists recount their times only if some length has changed */
+	if (song->m_len != old_len)
+		__atomic_add_fetch(&song_len_gen, 1, __ATOMIC_RELEASE);
+
+	song_rebuild_title(song);
 	song->m_flags &= (~SONG_INFO_READ);
 	song_unlock(song);
 } /* End of 'song_update_info' function */
 
+/* Get song URI (returned string must be freed) */
+char *song_get_uri( song_t *song )
+{
+	const char *fullname = song_get_fullname(song);
+	if (fullname != NULL)
+		return strdup(fullname);
+	return gst_filename_to_uri(song->m_filename, NULL);
+} /* End of 'song_get_uri' function */
+
 /* Get short filename but only if it is not uri-based */
 const char* song_get_short_name( song_t *s )
 {
-	return (s->m_filename ? util_short_name(s->m_filename) : s->m_fullname);
+	return (s->m_filename ? util_short_name(s->m_filename) : 
+			song_get_fullname(s));
 }
 
 static str_t *song_default_title( song_t *s )
 {
+	CFG_VAR_HANDLE(convert_h, "convert-underscores2spaces");
 	str_t *title = str_new(song_get_short_name(s));
-	if (cfg_get_var_int(cfg_list, "convert-underscores2spaces"))
+	if (cfg_handle_get_var_int(cfg_list, &convert_h))
 		str_replace_char(title, '_', ' ');
 	return title;
 }
 
-/* Fill song title from data from song info and other parameters */
-void song_update_title( song_t *song )
+/* Compile title format to the list of operations */
+static void song_title_fmt_compile( const char *fmt )
+{
+	song_title_op_t *ops;
+	int num_ops = 0, len;
+	const char *p;
+
+	/* Free the previous format */
+	free(song_title_fmt.m_src);
+	free(song_title_fmt.m_ops);
+	free(song_title_fmt.m_items);
+	free(song_title_fmt.m_lens);
+	song_title_fmt.m_src = NULL;
+	song_title_fmt.m_ops = NULL;
+	song_title_fmt.m_items = NULL;
+	song_title_fmt.m_lens = NULL;
+	song_title_fmt.m_num_ops = 0;
+
+	/* Each character produces not more than one operation */
+	len = strlen(fmt) + 1;
+	ops = (song_title_op_t *)malloc(sizeof(*ops) * len);
+	song_title_fmt.m_items = (const char **)malloc(sizeof(char *) * len);
+	song_title_fmt.m_lens = (int *)malloc(sizeof(int) * len);
+	song_title_fmt.m_src = strdup(fmt);
+	if (ops == NULL || song_title_fmt.m_src == NULL || 
+			song_title_fmt.m_items == NULL || song_title_fmt.m_lens == NULL)
+	{
+		free(ops);
+		return;
+	}
+
+	for ( p = song_title_fmt.m_src; *p; )
+	{
+		song_title_op_t *op = &ops[num_ops];
+
+		/* Field reference */
+		if (*p == '%')
+		{
+			p ++;
+			if (*p == 0)
+				break;
+			op->m_field = *p;
+			op->m_literal = NULL;
+			op->m_len = 0;
+			p ++;
+		}
+		/* Literal span */
+		else
+		{
+			op->m_field = 0;
+			op->m_literal = p;
+			for ( ; *p && *p != '%'; p ++ );
+			op->m_len = p - op->m_literal;
+		}
+		num_ops ++;
+	}
+	song_title_fmt.m_ops = ops;
+	song_title_fmt.m_num_ops = num_ops;
+} /* End of 'song_title_fmt_compile' function */
+
+/* Get the value of a title format field */
+static const char *song_title_field( song_t *song, song_info_t *info, 
+		char field )
 {
-	char *fmt;
+	const char *filename = song_get_name(song);
+
+	switch (field)
+	{
+	case 'p':
+		return info->m_artist;
+	case 'a':
+		return info->m_album;
+	case 'f':
+		return util_short_name(filename);
+	case 'F':
+		return filename;
+	case 'e':
+		return util_extension(filename);
+	case 't':
+		return info->m_name;
+	case 'n':
+		return info->m_track;
+	case 'y':
+		return info->m_year;
+	case 'g':
+		return info->m_genre;
+	case 'c':
+		return info->m_comments;
+	}
+	return NULL;
+} /* End of 'song_title_field' function */
+
+/* Build song title (song must be locked or not shared yet) */
+static void song_rebuild_title( song_t *song )
+{
+	CFG_VAR_HANDLE(fmt_h, "title-format");
+	const char *fmt;
 	str_t *str;
-	bool_t finish = FALSE;
 	song_info_t *info;
+	const char **items;
+	int *lens;
+	int i, len = 0;
+	bool_t empty_title = TRUE;
 
-	if (song == NULL || song->m_default_title != NULL)
+	song->m_title_gen = __atomic_load_n(&song_title_gen, __ATOMIC_ACQUIRE);
+	if (song_get_default_title(song) != NULL)
 		return;
 
 	/* Free current title */
 	str_free(song->m_title);
+	str_wide_free(song->m_wide_title);
+	song->m_wide_title = NULL;
 	
 	/* Case that we have no info */
 	info = song->m_info;
@@ -244,98 +712,131 @@ void song_update_title( song_t *song )
 		return;
 	}
 
-	/* Use specified title format */
-	fmt = cfg_get_var(cfg_list, "title-format");
-	str = song->m_title = str_new("");
-	const char *filename = song_get_name(song);
-	bool_t empty_title = TRUE;
-	if (fmt != NULL && (*fmt != 0))
+	/* Recompile format if it has changed (empty format means 
+	 * "artist - name") */
+	pthread_mutex_lock(&song_title_fmt_mutex);
+	fmt = cfg_handle_get_var(cfg_list, &fmt_h);
+	if (fmt == NULL || (*fmt) == 0)
+		fmt = "%p - %t";
+	if (song_title_fmt.m_src == NULL || strcmp(song_title_fmt.m_src, fmt))
+		song_title_fmt_compile(fmt);
+
+	/* Resolve fields and calculate the title length */
+	items = song_title_fmt.m_items;
+	lens = song_title_fmt.m_lens;
+	for ( i = 0; i < song_title_fmt.m_num_ops; i ++ )
 	{
-		for ( ; *fmt && !finish; fmt ++ )
+		song_title_op_t *op = &song_title_fmt.m_ops[i];
+		if (op->m_field == 0)
 		{
-			char *g;
-			
-			if (*fmt == '%')
-			{
-				fmt ++;
-				const char *item = NULL;
-				switch (*fmt)
-				{
-				case 'p':
-					item = info->m_artist;
-					break;
-				case 'a':
-					item = info->m_album;
-					break;
-				case 'f':
-					item = util_short_name(filename);
-					break;
-				case 'F':
-					item = filename;
-					break;
-				case 'e':
-					item = util_extension(filename);
-					break;
-				case 't':
-					item = info->m_name;
-					break;
-				case 'n':
-					item = info->m_track;
-					break;
-				case 'y':
-					item = info->m_year;
-					break;
-				case 'g':
-					item = info->m_genre;
-					break;
-				case 'c':
-					item = info->m_comments;
-					break;
-				case 0:
-					finish = TRUE;
-					break;
-				}
-
-				if (item && (*item))
-				{
-					str_cat_cptr(str, item);
-					empty_title = FALSE;
-				}
-			}
-			else
-			{
-				str_insert_char(str, *fmt, str->m_len);
-			}
+			items[i] = op->m_literal;
+			lens[i] = op->m_len;
 		}
-	}
-	else
-	{
-		str_printf(str, "%s - %s", info->m_artist, info->m_name);
-		if (*(info->m_artist) || *(info->m_name))
-			empty_title = FALSE;
+		else
+		{
+			items[i] = song_title_field(song, info, op->m_field);
+			lens[i] = (items[i] == NULL) ? 0 : strlen(items[i]);
+			if (lens[i] > 0)
+				empty_title = FALSE;
+		}
+		len += lens[i];
 	}
 
 	/* If all info items participating in forming the title are empty,
 	 * use the default (filename-based) one */
 	if (empty_title)
 	{
-		str_free(song->m_title);
+		pthread_mutex_unlock(&song_title_fmt_mutex);
 		song->m_title = song_default_title(song);
+		return;
 	}
-} /* End of 'song_get_title_from_info' function */
+
+	/* Render title in one pass */
+	str = song->m_title = str_new("");
+	str_reserve(str, len);
+	for ( i = 0; i < song_title_fmt.m_num_ops; i ++ )
+	{
+		if (lens[i] > 0)
+			str_cat_cptr_len(str, items[i], lens[i]);
+	}
+	pthread_mutex_unlock(&song_title_fmt_mutex);
+} /* End of 'song_rebuild_title' function */
+
+/* Fill song title from data from song info and other parameters */
+void song_update_title( song_t *song )
+{
+	if (song == NULL)
+		return;
+	song_lock(song);
+	song_rebuild_title(song);
+	song_unlock(song);
+} /* End of 'song_update_title' function */
+
+/* Make titles of all songs stale */
+void song_invalidate_titles( void )
+{
+	__atomic_add_fetch(&song_title_gen, 1, __ATOMIC_RELEASE);
+} /* End of 'song_invalidate_titles' function */
+
+/* Get songs lengths generation */
+dword song_get_len_gen( void )
+{
+	return __atomic_load_n(&song_len_gen, __ATOMIC_ACQUIRE);
+} /* End of 'song_get_len_gen' function */
+
+/* Get title of a locked song */
+str_t *song_get_title_locked( song_t *song )
+{
+	if (song->m_title_gen != 
+			__atomic_load_n(&song_title_gen, __ATOMIC_ACQUIRE))
+		song_rebuild_title(song);
+	return song->m_title;
+} /* End of 'song_get_title_locked' function */
+
+/* Get song title */
+str_t *song_get_title( song_t *song )
+{
+	str_t *title;
+
+	song_lock(song);
+	title = str_dup(song_get_title_locked(song));
+	song_unlock(song);
+	return title;
+} /* End of 'song_get_title' function */
+
+/* Get title of a locked song decoded for displaying (NULL if there is 
+ * no memory). Returned string is owned by the song and stays valid until 
+ * it is unlocked */
+str_wide_t *song_get_wide_title_locked( song_t *song )
+{
+	/* Getting title rebuilds it (and drops decoded one) if it is stale */
+	str_t *title = song_get_title_locked(song);
+	if (song->m_wide_title == NULL)
+		song->m_wide_title = str_wide_new(title);
+	return song->m_wide_title;
+} /* End of 'song_get_wide_title_locked' function */
 
 /* Write song info */
-void song_write_info( song_t *s )
+bool_t song_write_info( song_t *s )
 {
 	char *name = s->m_filename;
-	bool_t is_sliced = s->m_start_time > 0 || s->m_end_time >= 0;
-	if (!name || is_sliced || !md_save_info(name, s->m_info))
-	{
-		song_update_info(s);
-		logger_error(player_log, 0, _("Failed to save info to file %s"),
-				s->m_fullname);
-	}
-	s->m_flags &= ~(SONG_INFO_READ | SONG_INFO_WRITE);
+	bool_t is_sliced = song_get_start_time(s) > 0 || 
+		song_get_end_time(s) >= 0;
+	song_info_t *si;
+	bool_t saved;
+
+	if (!name || is_sliced)
+		return FALSE;
+
+	/* Write a copy not to keep song locked during file writing */
+	song_lock(s);
+	si = si_dup(s->m_info);
+	song_unlock(s);
+	if (si == NULL)
+		return FALSE;
+	saved = md_save_info(name, si);
+	si_free(si);
+	return saved;
 } /* End of 'song_write_info' function */
 
 /* End of 'song.c' file */
@@ -23,6 +23,7 @@
 #ifndef __SG_MPFC_SONG_H__
 #define __SG_MPFC_SONG_H__
 
+#include <assert.h>
 #include <pthread.h>
 #include "types.h"
 #include "main_types.h"
@@ -35,6 +36,10 @@ song_t *song_new_from_file( const char *file, song_metadata_t *metadata );
 /* Create a new song */
 song_t *song_new_from_uri( const char *uri, song_metadata_t *metadata);
 
+/* Create a song restored from the saved player state */
+song_t *song_new_from_state( const char *name, bool_t is_uri,
+		song_metadata_t *metadata, song_info_t *si );
+
 /* Add a reference to the song object */
 song_t *song_add_ref( song_t *song );
 
@@ -44,30 +49,136 @@ void song_free( song_t *song );
 /* Set current song info */
 void song_set_info( song_t *song, song_info_t *si );
 
+/* Schedule reading song info (see plist_flush_scheduled) */
+void song_schedule_info( song_t *song );
+
 /* Update song information */
 void song_update_info( song_t *song );
 
 /* Fill song title from data from song info and other parameters */
 void song_update_title( song_t *song );
 
-/* Write song info */
-void song_write_info( song_t *song );
+/* Make titles of all songs stale, so they are rebuilt when they are used 
+ * next time (say, after title format has changed) */
+void song_invalidate_titles( void );
+
+/* Get songs lengths generation. It changes whenever length of any song
+ * changes */
+dword song_get_len_gen( void );
+
+/* Write song info to file (returns FALSE if it failed) */
+bool_t song_write_info( song_t *song );
+
+/* Get song title rebuilding it if it is stale (returned string must be 
+ * freed) */
+str_t *song_get_title( song_t *song );
+
+/* The same for a locked song. Returned string is owned by the song and 
+ * stays valid until it is unlocked */
+str_t *song_get_title_locked( song_t *song );
+
+/* Get title of a locked song decoded for displaying. Returned string is 
+ * owned by the song and stays valid until it is unlocked */
+str_wide_t *song_get_wide_title_locked( song_t *song );
+
+/* Get song URI (returned string must be freed) */
+char *song_get_uri( song_t *song );
 
 /* Get song file name or full name if it's uri-based */
 static inline const char* song_get_name( song_t *song )
 {
 	char *name = song->m_filename;
 	if (!name)
-		name = song->m_fullname;
+		name = song->m_cold->m_fullname;
 	return name;
 }
 
+/* Get full name of an uri-based song (NULL for files) */
+static inline const char *song_get_fullname( song_t *song )
+{
+	return (song->m_cold == NULL) ? NULL : song->m_cold->m_fullname;
+}
+
+/* Get start time of a sliced song (negative if song is not sliced) */
+static inline song_time_t song_get_start_time( song_t *song )
+{
+	return (song->m_cold == NULL) ? -1 : song->m_cold->m_start_time;
+}
+
+/* Get end time of a sliced song (negative if song lasts till file end) */
+static inline song_time_t song_get_end_time( song_t *song )
+{
+	return (song->m_cold == NULL) ? -1 : song->m_cold->m_end_time;
+}
+
+/* Get song default title (NULL if title is made from the info) */
+static inline const char *song_get_default_title( song_t *song )
+{
+	return (song->m_cold == NULL) ? NULL : song->m_cold->m_default_title;
+}
+
 /* Get short filename but only if it is not uri-based */
 const char* song_get_short_name( song_t *s );
 
-/* Lock/unlock song */
-#define song_lock(s) (pthread_mutex_lock(&((s)->m_mutex)))
-#define song_unlock(s) (pthread_mutex_unlock(&((s)->m_mutex)))
+/* Songs are protected by a fixed set of locks, each shared by the songs
+ * whose addresses hash to it. A thread may hold only one of them at a time;
+ * two songs must be locked together with song_lock_pair, which takes 
+ * locks in a fixed order */
+#define SONG_LOCK_STRIPES 64
+extern pthread_mutex_t song_locks[SONG_LOCK_STRIPES];
+
+/* Number of song locks held by the current thread */
+extern __thread int song_locks_held;
+
+/* Get lock protecting the song */
+static inline pthread_mutex_t *song_get_lock( song_t *song )
+{
+	return &song_locks[((uintptr_t)song / sizeof(song_t)) % SONG_LOCK_STRIPES];
+}
+
+/* Lock song */
+static inline void song_lock( song_t *song )
+{
+	assert(song_locks_held == 0);
+	pthread_mutex_lock(song_get_lock(song));
+	song_locks_held ++;
+}
+
+/* Unlock song */
+static inline void song_unlock( song_t *song )
+{
+	song_locks_held --;
+	pthread_mutex_unlock(song_get_lock(song));
+}
+
+/* Lock two songs */
+static inline void song_lock_pair( song_t *s1, song_t *s2 )
+{
+	pthread_mutex_t *l1 = song_get_lock(s1), *l2 = song_get_lock(s2);
+
+	assert(song_locks_held == 0);
+	if (l1 > l2)
+	{
+		pthread_mutex_t *l = l1;
+		l1 = l2;
+		l2 = l;
+	}
+	pthread_mutex_lock(l1);
+	if (l2 != l1)
+		pthread_mutex_lock(l2);
+	song_locks_held ++;
+}
+
+/* Unlock two songs */
+static inline void song_unlock_pair( song_t *s1, song_t *s2 )
+{
+	pthread_mutex_t *l1 = song_get_lock(s1), *l2 = song_get_lock(s2);
+
+	song_locks_held --;
+	pthread_mutex_unlock(l1);
+	if (l2 != l1)
+		pthread_mutex_unlock(l2);
+}
 
 #endif
 
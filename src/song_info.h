@@ -28,7 +28,9 @@
 /* Some types */
 struct tag_pmng_t;
 
-/* Song information type */
+/* Song information type. 
+ * String fields are taken from the strings pool (see strpool.h), so they 
+ * must be changed only with the setters below */
 typedef struct tag_song_info_t
 {
 	char *m_artist;
@@ -40,11 +42,18 @@ typedef struct tag_song_info_t
 	char *m_track;
 	char *m_own_data;
 	dword m_flags;
+
+	/* ReplayGain values (in dB) and peaks. Valid only if the respective
+	 * SI_TRACK_GAIN or SI_ALBUM_GAIN flag is set */
+	float m_track_gain, m_track_peak;
+	float m_album_gain, m_album_peak;
 } song_info_t;
 
 /* Song information flags */
 #define SI_INITIALIZED 0x00000001
 #define SI_ONLY_OWN    0x00000002
+#define SI_TRACK_GAIN  0x00000004
+#define SI_ALBUM_GAIN  0x00000008
 
 /* Initialize song info */
 song_info_t *si_new( void );
@@ -79,6 +88,12 @@ void si_set_genre( song_info_t *si, const char *genre );
 /* Set own data */
 void si_set_own_data( song_info_t *si, const char *own_data );
 
+/* Set ReplayGain values (peak is 0 if unknown) */
+void si_set_replay_gain( song_info_t *si, bool_t album, float gain, float peak );
+
+/* Get gain for playing song with ReplayGain */
+bool_t si_get_replay_gain( song_info_t *si, bool_t album, float *gain, float *peak );
+
 #endif
 
 /* End of 'song_info.h' file */
@@ -0,0 +1,48 @@
+/******************************************************************
+ * Copyright (C) 2003 - 2011 by SG Software.
+ *
+ * SG MPFC. Interface for the shared strings pool.
+ * $Id$
+ *
+ * This program is free software; you can redistribute it and/or 
+ * modify it under the terms of the GNU General Public License 
+ * as published by the Free Software Foundation; either version 2 
+ * of the License, or (at your option) any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public 
+ * License along with this program; if not, write to the Free 
+ * Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, 
+ * MA 02111-1307, USA.
+ */
+
+#ifndef __SG_MPFC_STRPOOL_H__
+#define __SG_MPFC_STRPOOL_H__
+
+#include "types.h"
+
+/* 
+ * Strings pool keeps a single reference counted copy of every string
+ * put into it. Strings got from the pool must not be modified. Equal
+ * pooled strings are the same pointer, so they may be compared directly.
+ */
+
+/* The shared empty string. It is not reference counted */
+extern char strpool_empty[];
+
+/* Get a pooled copy of the string (adding a reference to it) */
+char *strpool_get( const char *str );
+
+/* Add a reference to a pooled string */
+char *strpool_ref( char *str );
+
+/* Release a reference to a pooled string */
+void strpool_release( char *str );
+
+#endif
+
+/* End of 'strpool.h' file */
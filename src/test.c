@@ -21,7 +21,9 @@
  */
 
 #include <pthread.h>
+#include <string.h>
 #include "types.h"
+#include "bench.h"
 #include "player.h"
 #include "test.h"
 #include "wnd_root.h"
@@ -66,6 +68,9 @@ void *test_thread( void *arg )
 	case TEST_WNDLIB_PERFOMANCE:
 		test_wndlib_perfomance();
 		break;
+	case TEST_BENCH:
+		test_bench();
+		break;
 	}
 	test_job = TEST_NO_JOB;
 	return NULL;
@@ -77,6 +82,7 @@ void test_wndlib_perfomance( void )
 	int i, j;
 
 	/* First execute info dialogs for each of the play list songs */
+	player_lock_plist();
 	for ( i = 0; i < player_plist->m_len && (!test_stop_job); i ++ )
 	{
 		wnd_msg_send(player_wnd, "user", 
@@ -90,7 +96,20 @@ void test_wndlib_perfomance( void )
 			wnd_msg_send(player_wnd, "user", 
 					wnd_msg_user_new(PLAYER_MSG_NEXT_FOCUS, (void *)((intptr_t)i)));
 	}
+	player_unlock_plist();
 } /* End of 'test_wndlib_perfomance' function */
 
+/* Run benchmarks. When they are requested from the command line the 
+ * player exits after them */
+void test_bench( void )
+{
+	char *suites = cfg_get_var(cfg_list, "bench");
+
+	/* Plain '--bench' means all suites */
+	bench_run((suites == NULL || !strcmp(suites, "1")) ? "all" : suites);
+	if (suites != NULL && !test_stop_job)
+		wnd_close(wnd_root);
+} /* End of 'test_bench' function */
+
 /* End of 'test.c' file */
 
@@ -30,9 +30,13 @@ enum
 {
 	TEST_NO_JOB = -1,
 	TEST_WNDLIB_PERFOMANCE,
+	TEST_BENCH,
 	TEST_NUMBER
 };
 
+/* Set when the running job must stop */
+extern bool_t test_stop_job;
+
 /* Start test */
 bool_t test_start( int id );
 
@@ -45,6 +49,9 @@ void *test_thread( void *arg );
 /* Test the window library perfomance */
 void test_wndlib_perfomance( void );
 
+/* Run benchmarks */
+void test_bench( void );
+
 #endif
 
 /* End of 'test.h' file */
@@ -157,15 +157,18 @@ void undo_do( struct tag_undo_list_item_t *item )
 		int i;
 		struct tag_undo_list_sort_t *data = &item->m_data.m_sort;
 		song_t **list = (song_t **)malloc(sizeof(song_t *) * 
-				player_plist->m_len);
+				player_plist->m_len * 2);
+		song_t **new_list = list + player_plist->m_len;
 		plist_lock(player_plist);
-		memcpy(list, player_plist->m_list, sizeof(song_t *) * 
-				player_plist->m_len);
+		pseq_get_range(player_plist->m_seq, 0, player_plist->m_len, list);
 		for ( i = 0; i < player_plist->m_len; i ++ )
-			player_plist->m_list[data->m_transform[i]] = list[i];
+			new_list[data->m_transform[i]] = list[i];
+		pseq_set_range(player_plist->m_seq, 0, player_plist->m_len, new_list);
 		if (player_plist->m_cur_song >= 0)
 			player_plist->m_cur_song = 
 				data->m_transform[player_plist->m_cur_song];
+		ckpt_log_reorder(player_plist->m_ckpt, player_plist);
+		shuffle_reset(player_shuffle);
 		plist_unlock(player_plist);
 		free(list);
 	}
@@ -248,13 +251,16 @@ void undo_undo( struct tag_undo_list_item_t *item )
 		int i, j;
 		struct tag_undo_list_sort_t *data = &item->m_data.m_sort;
 		song_t **list = (song_t **)malloc(sizeof(song_t *) * 
-				player_plist->m_len);
+				player_plist->m_len * 2);
+		song_t **new_list = list + player_plist->m_len;
 		plist_lock(player_plist);
-		memcpy(list, player_plist->m_list, sizeof(song_t *) * 
-				player_plist->m_len);
+		pseq_get_range(player_plist->m_seq, 0, player_plist->m_len, list);
 		for ( i = 0; i < player_plist->m_len; i ++ )
-			player_plist->m_list[i] = list[data->m_transform[i]];
+			new_list[i] = list[data->m_transform[i]];
+		pseq_set_range(player_plist->m_seq, 0, player_plist->m_len, new_list);
 		player_plist->m_cur_song = data->m_was_song;
+		ckpt_log_reorder(player_plist->m_ckpt, player_plist);
+		shuffle_reset(player_shuffle);
 		plist_unlock(player_plist);
 		free(list);
 	}